@@ -1,5 +1,5 @@
 # External dependencies of the redux modules
 #set(redux_DEPS boost fftw3 gsl opencv threads CACHE INTERNAL "")
-set(redux_DEPS boost fits fftw3 gsl opencv threads zlib CACHE INTERNAL "")
+set(redux_DEPS boost fits fftw3 fftw3f gsl lz4 opencv threads zlib zstd CACHE INTERNAL "")
 set(reduxgui_DEPS qt CACHE INTERNAL "")
 
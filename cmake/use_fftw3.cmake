@@ -4,6 +4,7 @@
 
 set( EXT_NAME "FFTW3" )
 
+# N.B. the single precision libraries are optional, see use_fftw3f.cmake
 set( EXT_COMPONENTS fftw3 fftw3_threads )
 
 if(WIN32)
@@ -0,0 +1,22 @@
+#
+# Set input data for FindExternal.cmake
+#
+
+# Single precision FFTW3, optional (only used for SINGLE_PRECISION in momfbd)
+set( EXT_NAME "FFTW3F" )
+
+set( EXT_COMPONENTS fftw3f fftw3f_threads )
+
+if(WIN32)
+    set (EXT_HINT "${THIRDPARTY_DIR}/vendor/fftw3/3.3.3")
+    set( EXT_LIB_SUFFIXES "" "-3" )
+endif()
+
+
+set( EXT_HEADER_FILE "fftw3.h" )
+
+# Attempt to locate libs/headers automagically
+include("${CMAKE_CURRENT_LIST_DIR}/FindExternal.cmake")
+
+
+appendPaths()
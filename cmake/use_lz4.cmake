@@ -0,0 +1,20 @@
+#
+# Set input data for FindExternal.cmake
+#
+
+set( EXT_NAME "LZ4" )
+
+set( EXT_COMPONENTS lz4 )
+
+set( EXT_HEADER_FILE "lz4.h" )
+set( EXT_VERSION_FILE "lz4.h" )
+set( EXT_MAJOR_REGEXP "LZ4_VERSION_MAJOR" )
+set( EXT_MINOR_REGEXP "LZ4_VERSION_MINOR" )
+set( EXT_PATCH_REGEXP "LZ4_VERSION_RELEASE" )
+
+
+# Attempt to locate libs/headers automagically
+include("${CMAKE_CURRENT_LIST_DIR}/FindExternal.cmake")
+
+
+appendPaths()
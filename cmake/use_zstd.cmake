@@ -0,0 +1,20 @@
+#
+# Set input data for FindExternal.cmake
+#
+
+set( EXT_NAME "ZSTD" )
+
+set( EXT_COMPONENTS zstd )
+
+set( EXT_HEADER_FILE "zstd.h" )
+set( EXT_VERSION_FILE "zstd.h" )
+set( EXT_MAJOR_REGEXP "ZSTD_VERSION_MAJOR" )
+set( EXT_MINOR_REGEXP "ZSTD_VERSION_MINOR" )
+set( EXT_PATCH_REGEXP "ZSTD_VERSION_RELEASE" )
+
+
+# Attempt to locate libs/headers automagically
+include("${CMAKE_CURRENT_LIST_DIR}/FindExternal.cmake")
+
+
+appendPaths()
@@ -8,6 +8,7 @@
 #include "redux/network/host.hpp"
 #include "redux/network/tcpserver.hpp"
 #include "redux/util/datautil.hpp"
+#include "redux/util/executor.hpp"
 #include "redux/util/semaphore.hpp"
 
 #include <mutex>
@@ -36,6 +37,7 @@ namespace redux {
         void checkSwapSpace( void );
         void checkCurrentUsage( void );
         void check_limits( void );
+        void initFFTW( void );                  //!< planner rigor, wisdom (in cache-dir) and pre-planned sizes
         bool doWork(void) override;
         
         bool workerInit( void );
@@ -74,12 +76,16 @@ namespace redux {
         WorkInProgress::Ptr getWIP( const network::Host::Ptr& );
         void removeWIP( const network::Host::Ptr& );
         void updateWIP( const network::Host::Ptr&, WorkInProgress::Ptr& );
+        void mergeWIP( const network::Host::Ptr&, const WorkInProgress::Ptr& );
+        void releaseParts( const WorkInProgress::Ptr&, const std::vector<uint64_t>& );
         void sendWork( network::TcpConnection::Ptr );
         void putParts( network::TcpConnection::Ptr );
+        void putCheckpoint( network::TcpConnection::Ptr );
         void sendJobList( network::TcpConnection::Ptr& );
         void updateHostStatus( network::TcpConnection::Ptr& );
         void sendJobStats( network::TcpConnection::Ptr& );
         void sendPeerList( network::TcpConnection::Ptr& );
+        void sendExecutorStats( network::TcpConnection::Ptr& );
         void addToLog( network::TcpConnection::Ptr& );
         void updateLoadAvg( void );
         
@@ -91,8 +97,8 @@ namespace redux {
         WorkInProgress::Ptr getIdleWIP( void );
         void putIdleWIP( WorkInProgress::Ptr );
         WorkInProgress::Ptr getLocalWIP( void );
-        WorkInProgress::Ptr getRemoteWIP( void );
-        bool getWork( WorkInProgress::Ptr&, bool remote=false );
+        WorkInProgress::Ptr getRemoteWIP( const Job::JobPtr& onlyJob=nullptr, const network::Host::Ptr& host=nullptr );
+        bool getWork( WorkInProgress::Ptr&, bool remote=false, const Job::JobPtr& onlyJob=nullptr, const network::Host::Ptr& host=nullptr );
         void returnWork( WorkInProgress::Ptr );
         void prepareLocalWork( int n=1 );
         void prepareRemoteWork( int n=1 );
@@ -118,12 +124,18 @@ namespace redux {
         void delThread( uint16_t n );
         void cleanupThreads( void );
         size_t nSysThreads( void );
+        void resizeExecutor( size_t n );        //!< resize Executor::get() and recompute the lane limits.
         void threadLoop( void );
         
         std::mutex wip_active_mtx, wip_idle_mtx, wip_queue_mtx, wip_lqueue_mtx, wip_completed_mtx;
         std::atomic<uint16_t>  max_local, max_remote;
         std::set<WorkInProgress::Ptr, redux::util::ObjCompare<WorkInProgress>> wip_active;
         std::map<network::Host::Ptr, WorkInProgress::Ptr, network::Host::Compare> peerWIP;
+        
+        std::map<network::Host::Ptr, HostAffinity, network::Host::Compare> hostAffinity;      // guarded by peerMutex
+        void updateAffinity( const network::Host::Ptr&, size_t jobID, const WorkInProgress::Ptr& sent=nullptr );
+        void updateSpeed( const network::Host::Ptr&, const WorkInProgress::Ptr& returned );
+        bool isFastHost( double secPerCost );   // N.B. peerMutex must be locked
         std::set<WorkInProgress::Ptr> wip_idle;
         std::deque<WorkInProgress::Ptr> wip_queue;
         std::deque<WorkInProgress::Ptr> wip_localqueue;
@@ -140,6 +152,8 @@ namespace redux {
         std::unique_ptr<network::TcpServer> server;
         
         Worker worker;
+        std::thread prepareThread;
+        util::TaskGroup tasks;                  //!< executor-tasks using this instance, drained in stop()
         
         friend class network::TcpServer;
         friend class Worker;
@@ -13,6 +13,13 @@ namespace redux {
         int anadecrunch8( const unsigned char *x, int8_t *array, int r9, int nx, int ny, int );
         int anadecrunch( const unsigned char *x, int16_t *array, int r9, int nx, int ny, int );
 
+        /*! Find where the next block starts, without decoding. Used to split a stream for parallel decompression.
+         *  @param offset (in/out) byte offset of the current block, advanced past nBlocks blocks.
+         *  @param type compression type, as in the compressed header (the run-length types 2/3 are not supported).
+         *  @returns 1 on success, -1 for a corrupt stream/unsupported type.
+         */
+        int anaskipblocks( const unsigned char *x, size_t nBytes, size_t& offset, int type, int slice, int nx, int nBlocks );
+
     }
 }
 
@@ -32,6 +32,7 @@ namespace redux {
                              ANA_COMPLEX=8,     // experimental support (=8 to match IDL's DCOMPLEX)
                              ANA_UNDEF=255 };
             static const uint8_t typeSizes[];   // = { 1, 2, 4, 4, 8, 8, 0, 0, 16 };
+            static unsigned int maxThreads;     //!< threads used for (de)compressing large images, 0 = all cores.
 
             typedef std::shared_ptr<Ana> Ptr;
             
@@ -9,6 +9,8 @@
 #include "redux/util/array.hpp"
 #include "redux/util/arrayutil.hpp"
 
+#include <atomic>
+
 #include <fitsio.h>
 
 namespace redux {
@@ -39,6 +41,8 @@ namespace redux {
                              FITS_LONG,
                              FITS_ULONG };
             static const uint8_t typeSizes[];   // = { 0, 1, 2, 4, 4, 8, 8, 0, 0, 16 };
+            static unsigned int maxThreads;     //!< threads used for decoding tile-compressed images, 0 = all cores.
+            static std::atomic<uint64_t> nativeTiles;   //!< number of tiles decoded by the native reader (i.e. not by cfitsio)
             
             Fits( void );
             explicit Fits( const std::string& );
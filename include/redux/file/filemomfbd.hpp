@@ -72,6 +72,22 @@ namespace redux {
             
             size_t load ( std::ifstream& file, char* data, uint8_t loadMask, int verbosity=0, uint8_t alignTo=4 );
             
+            /*! @name Memory-mapped access
+             *  @brief map() indexes the file (read()) and maps it read-only, after which single fields can be fetched
+             *  at random without loading the rest of the file.
+             *  @details The returned arrays point straight into the mapping when the data is in native byte-order and
+             *  properly aligned (they keep the mapping alive, also after this object is gone). Otherwise, e.g. for
+             *  files written on a system with different endianess, only the requested field is copied and converted.
+             *  An empty array is returned if the field is not in the file.
+             */
+            //@{
+            void map( const std::string& );
+            bool isMapped( void ) const { return static_cast<bool>( mapping ); }
+            redux::util::Array<float> getPatchData( int y, int x, uint8_t field ) const;   //!< field is one of MOMFBD_IMG/PSF/OBJ/RES/ALPHA/DIV
+            redux::util::Array<float> getPupil( void ) const;
+            redux::util::Array<float> getModes( void ) const;
+            //@}
+            
             std::vector<std::string> getText( bool ) override { return std::vector<std::string>(1,""); }
             int getFormat(void) override { return FMT_MOMFBD; };
 
@@ -97,6 +113,9 @@ namespace redux {
             bool swapNeeded;                    //!< File & current system have different endianess
             
             redux::util::Array<PatchInfo> patches;
+            
+            std::shared_ptr<char> mapping;      //!< the whole file, when map() has been called.
+            size_t mappingSize;
 
         };
 
@@ -8,6 +8,7 @@
 #include <cassert>
 #include <mutex>
 #include <numeric>
+#include <string>
 
 namespace redux {
 
@@ -27,9 +28,17 @@ namespace redux {
         class FourierTransform : public redux::util::Array<complex_t> {
             
             struct PlansContainer {
-                PlansContainer() { fftw_init_threads(); };
+#ifdef HAVE_FFTW3F
+                PlansContainer() : rigor(FFTW_MEASURE), wisdomDirty(false) { fftw_init_threads(); fftwf_init_threads(); };
+                ~PlansContainer(){ fftw_cleanup_threads(); fftwf_cleanup_threads(); };
+#else
+                PlansContainer() : rigor(FFTW_MEASURE), wisdomDirty(false) { fftw_init_threads(); };
                 ~PlansContainer(){ fftw_cleanup_threads(); };
+#endif
                 std::mutex mtx;
+                unsigned rigor;                 //!< FFTW planner flag used for new plans
+                std::string wisdomFile;         //!< if non-empty, wisdom is exported here by Plan::saveWisdom
+                bool wisdomDirty;               //!< new plans have been created since the last export
             };
 
         public:
@@ -39,21 +48,33 @@ namespace redux {
 #endif
             {
                 typedef std::shared_ptr<const Plan> Ptr;
-                enum TYPE { R2C=1, C2C };
+                enum TYPE { R2C=1, C2C, C2C_F, R2C_F };  //!< *_F are single precision (requires HAVE_FFTW3F), and only set forward_plan_f/backward_plan_f
                 struct Index {
-                    Index(const std::vector<size_t>& dims, TYPE t, uint8_t nt);
-                    Index( size_t sizeY, size_t sizeX, TYPE t, uint8_t nt);
+                    Index(const std::vector<size_t>& dims, TYPE t, uint8_t nt, uint32_t hm=1);
+                    Index( size_t sizeY, size_t sizeX, TYPE t, uint8_t nt, uint32_t hm=1);
                     bool operator<( const Index& rhs ) const;
                     TYPE tp;
                     uint8_t nThreads;
+                    uint32_t howMany;                   //!< Number of consecutive transforms performed by each execution (fftw_plan_many_*)
                     std::vector<size_t> sizes;
                 } id;
                 fftw_plan forward_plan, backward_plan;
+                fftwf_plan forward_plan_f, backward_plan_f;
                 explicit Plan( const Index& );
                 ~Plan();
-                static Plan::Ptr get(const std::vector<size_t>& dims, Plan::TYPE tp, uint8_t nThreads=1);
-                static Plan::Ptr get(size_t sizeY, size_t sizeX, Plan::TYPE tp, uint8_t nThreads=1);
+                static Plan::Ptr get(const std::vector<size_t>& dims, Plan::TYPE tp, uint8_t nThreads=1, uint32_t howMany=1);
+                static Plan::Ptr get(size_t sizeY, size_t sizeX, Plan::TYPE tp, uint8_t nThreads=1, uint32_t howMany=1);
                 static void clear(void);
+                /*! Planner rigor, "estimate", "measure" (default) or "patient". Only affects plans created after the call.
+                 */
+                static void setRigor( const std::string& );
+                static void setRigor( unsigned fftwFlag );
+                static unsigned rigor( void );
+                /*! Import FFTW wisdom from dir (if it exists), saveWisdom() exports it there again.
+                 *  The file is named after the CPU model, so hosts of different types can share dir. An empty dir disables it.
+                 */
+                static void setWisdomDir( const std::string& dir );
+                static void saveWisdom( void );         //!< Export the wisdom, if any plans were created since the last call.
                 static PlansContainer pc;
                 void init( void );
                 void forward( double* __restrict__ in, fftw_complex* __restrict__ out ) const ;
@@ -184,6 +205,26 @@ namespace redux {
                 // TODO
             }
             
+            /*! Expand the un-centered half-plane (nY x (nX/2+1)) of a Hermitian transform into the full, centered, (nY x nX) array.
+             */
+            template <typename T, typename U>
+            static void reorderHalfInto( const T* __restrict__ inHalf, size_t nY, size_t nX, U* __restrict__ out ) {
+                const size_t nXh = nX/2+1;
+                const size_t midY = nY/2;
+                const size_t midX = nX/2;
+                for( size_t y=0; y<nY; ++y ) {
+                    const T* __restrict__ row = inHalf + y*nXh;
+                    const T* __restrict__ mirrorRow = inHalf + ((nY-y)%nY)*nXh;
+                    U* __restrict__ outRow = out + ((y+midY)%nY)*nX;
+                    for( size_t x=0; x<nXh; ++x ) {
+                        outRow[(x+midX)%nX] = row[x];
+                    }
+                    for( size_t x=nXh; x<nX; ++x ) {
+                        outRow[(x+midX)%nX] = std::conj( mirrorRow[nX-x] );
+                    }
+                }
+            }
+            
             FourierTransform reordered (void) const;
             
             
@@ -305,6 +346,26 @@ namespace redux {
                 FourierTransform tmpFT( inout, nY, nX, FULLCOMPLEX );
                 tmpFT.autocorrelate( inout, inout, center );
             }
+            /*! Batched autocorrelation of nBlocks consecutive (nY x nX) complex blocks, using a single "many"-plan
+             *  for the forward and backward transforms. The result is normalized and NOT centered.
+             *  @param inout    nBlocks*nY*nX elements, overwritten by the autocorrelations.
+             *  @param work     Scratch area of the same size as inout (must not overlap).
+             */
+            static void autocorrelate( complex_t* inout, complex_t* work, size_t nY, size_t nX, size_t nBlocks, uint8_t nThreads=1 );
+#ifdef HAVE_FFTW3F
+            //! Single precision version of the above.
+            static void autocorrelate( complexf_t* inout, complexf_t* work, size_t nY, size_t nX, size_t nBlocks, uint8_t nThreads=1 );
+#endif
+            /*! Batched autocorrelation using the symmetry of the result: the (real) squared modulus is transformed back
+             *  with an r2c plan, so only the un-centered (nY x (nX/2+1)) half-plane of each block is computed.
+             *  Use reorderHalfInto to expand a block into the full, centered, array.
+             *  @param in       nBlocks*nY*nX elements, used as scratch (i.e. destroyed).
+             *  @param out      Result, nBlocks consecutive half-planes, i.e. with a block-stride of nY*(nX/2+1).
+             */
+            static void autocorrelateHalf( complex_t* in, complex_t* out, size_t nY, size_t nX, size_t nBlocks, uint8_t nThreads=1 );
+#ifdef HAVE_FFTW3F
+            static void autocorrelateHalf( complexf_t* in, complexf_t* out, size_t nY, size_t nX, size_t nBlocks, uint8_t nThreads=1 );
+#endif
 
             template <typename T, typename U>
             void convolve( const T* in, U* out ) const {
@@ -36,6 +36,7 @@ namespace redux {
             std::shared_ptr<double*> dist2D(void) { return redux::util::reshapeArray( distance.get(), id.size.y, id.size.x ); }
             std::shared_ptr<double*> angle2D(void) { return redux::util::reshapeArray( angle.get(), id.size.y, id.size.x ); }
             bool operator<( const Grid& rhs ) const { return ( id < rhs.id ); }
+            size_t cacheSize(void) const { return sizeof(Grid) + 2*id.size.y*id.size.x*sizeof(double); }
             static std::shared_ptr<Grid> get(const ID&);
             static std::shared_ptr<Grid> get(uint32_t n) { return get( ID(n) ); };
             static std::shared_ptr<Grid> get(uint32_t n, float y, float x) { return get( ID(n,y,x) ); };
@@ -0,0 +1,50 @@
+#ifndef REDUX_IMAGE_PIXELFILLER_HPP
+#define REDUX_IMAGE_PIXELFILLER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace redux {
+
+    namespace image {
+
+        /*! @brief Bad-pixel repair for a series of frames that share the same (gain-)mask.
+         *  @details The candidate pixels (non-zero in the mask) are collected once, so each frame only has to visit
+         *  those. The replacement values are computed with inlined kernels (the same inverse-distance weights as
+         *  inverseDistanceWeight(), or horizontalInterpolation()) for all bad pixels before any of them is written back,
+         *  i.e. the result does not depend on the order, and the list can be split over several threads.
+         */
+        class PixelFiller {
+
+        public:
+            enum Method : uint8_t { IDW=0, HORINT };
+
+            PixelFiller( void ) : sy(0), sx(0), hasMask(false) {}
+            PixelFiller( size_t sy, size_t sx, const uint8_t* mask=nullptr );
+
+            void init( size_t sy, size_t sx, const uint8_t* mask=nullptr );
+            bool valid( size_t y, size_t x ) const { return (y == sy) && (x == sx); }
+            size_t nCandidates( void ) const { return hasMask ? candidates.size() : sy*sx; }
+
+            /*! Replace the pixels with a value <= threshold. Only the candidate pixels are considered, unless useMask is false
+             *  or there is no mask.
+             *  @returns The number of replaced pixels.
+             */
+            template <typename T>
+            size_t fill( T* img, double threshold, Method m=IDW, bool useMask=true, unsigned int nThreads=1 ) const;
+
+            static const int maxDistance = 64;      //!< half-size of the window used for the inverse-distance weighting.
+
+        private:
+            size_t sy, sx;
+            bool hasMask;
+            std::vector<size_t> candidates;         //!< offsets of the masked pixels, in row-major order.
+
+        };
+
+    }   // image
+
+}   // redux
+
+#endif  // REDUX_IMAGE_PIXELFILLER_HPP
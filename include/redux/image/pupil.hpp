@@ -56,7 +56,12 @@ namespace redux {
             
             void generate( uint16_t pupilPixels, double pupilRadius, double coRadius=0.0 );
             void generate( void );
-            void generateSupport(double threshold=0);                           //!< Gets the indices of elements in the pupil/otf which are >threshold
+            void generateSupport(double threshold=0);                           //!< Gets the indices of elements in the pupil/otf which are >threshold. N.B. otfSupport is made point-symmetric (a point is included if it, or its mirror, is >threshold)
+            void generateIndexArrays(void);                                     //!< Build the structure-of-arrays copy of pupilInOTF, and the half-plane otf-support
+            size_t otfMirror( size_t ind ) const {                              //!< Index of the point-mirrored frequency (in the centered OTF)
+                const size_t N = 2*nPixels;
+                return ((N-ind/N)%N)*N + (N-ind%N)%N;
+            }
             void normalize( void );                                             //!< Scale pupil to the interval [0,1]
             void dump( std::string tag="pupil" ) const;
             
@@ -73,6 +78,10 @@ namespace redux {
             
             std::vector<size_t> pupilSupport, otfSupport;                       //!< The indices to the support of the pupil/otf (i.e. elements greater than some threshold)
             std::vector<std::pair<size_t,size_t>> pupilInOTF;                   //!< Maps the pupil-support into OTF-space (which is (2*nPixels,2*nPixels))
+            std::vector<int32_t> pupilIndex, otfIndex;                          //!< pupilInOTF as separate arrays, padded to a multiple of kernels::simdWidth
+            std::vector<double> pupilWeight;                                    //!< Pupil values at pupilIndex (same layout/padding)
+            std::vector<size_t> otfHalfSupport, otfHalfMirror;                  //!< The part of otfSupport with index <= otfMirror(index), and the mirrored indices.
+            std::vector<double> otfHalfWeight;                                  //!< 2 (or 1 for self-conjugate points), sums of symmetric terms over otfSupport can be done over the half-support.
             std::mutex mtx;
 
         };
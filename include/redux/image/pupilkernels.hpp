@@ -0,0 +1,59 @@
+#ifndef REDUX_IMAGE_PUPILKERNELS_HPP
+#define REDUX_IMAGE_PUPILKERNELS_HPP
+
+#include "redux/types.hpp"
+
+#include <string>
+
+namespace redux {
+
+    namespace image {
+
+        /*! Kernels for the sparse pupil-/OTF-support loops.
+         *  The index/weight arrays are the structure-of-arrays representation kept by Pupil (see Pupil::generateIndexArrays).
+         *  The implementation is chosen at runtime (AVX2+FMA if the CPU supports it, plain scalar otherwise).
+         */
+        namespace kernels {
+
+            static const size_t simdWidth = 4;          //!< Index/weight arrays are padded to a multiple of this
+
+            enum KERNEL_LEVEL { KL_SCALAR=0, KL_AVX2 };
+
+            KERNEL_LEVEL maxLevel( void );                  //!< Highest level supported by this CPU
+            KERNEL_LEVEL level( void );                     //!< Currently used level
+            void setLevel( KERNEL_LEVEL );                  //!< Force a level (clamped to maxLevel()), mainly for testing
+            std::string levelName( void );
+
+            /*! pf[pIdx[i]] = w[i]*exp(i*phi[pIdx[i]]), and otf[oIdx[i]] = otfScale*pf[pIdx[i]]
+             *  Either of pf/otf can be nullptr, in which case it is skipped.
+             *  N.B. n may include padding, as long as padded elements duplicate a valid element.
+             */
+            void polar( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n, const double* phi,
+                        complex_t* pf, complex_t* otf, double otfScale );
+            void polar( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n, const double* phi,
+                        complex_t* pf, complexf_t* otf, double otfScale );      //!< Single precision OTF output (see SINGLE_PRECISION)
+
+            /*! out[oIdx[i]] = outScale*w[i]*exp(i*(phi[pIdx[i]]+scale*phiOffset[pIdx[i]]))
+             */
+            void polarOffset( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n, const double* phi,
+                              const double* phiOffset, double scale, complex_t* out, double outScale=1.0 );
+            void polarOffset( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n, const double* phi,
+                              const double* phiOffset, double scale, complexf_t* out, double outScale=1.0 );
+
+            /*! Sum of a[idx[i]]*b[idx[i]], for i in [0,n). N.B. n must NOT include padding.
+             */
+            double gatherDot( const int32_t* idx, size_t n, const double* a, const double* b );
+
+            /*! out[pIdx[i]] = imag( conj(pf[pIdx[i]])*otf[oIdx[i]] )*w[i]
+             */
+            void vogel( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n,
+                        const complex_t* pf, const complex_t* otf, double* out );
+
+        }
+
+    }   // image
+
+}   // redux
+
+
+#endif  // REDUX_IMAGE_PUPILKERNELS_HPP
@@ -9,6 +9,7 @@
 #endif
 
 #include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -185,6 +186,14 @@ namespace redux {
         virtual void ungetWork(WorkInProgress::Ptr) { };
         virtual void failWork(WorkInProgress::Ptr) { };
         virtual void returnResults(WorkInProgress::Ptr) { };
+        
+        /*! Checkpointing of partially processed parts.
+         *  On a slave, the job calls checkpointCallback with a packed state (the worker sends it to the master),
+         *  on the master, putCheckpoint is called with that state for the part the slave is currently working on.
+         */
+        typedef std::function<void(std::shared_ptr<char>, uint64_t)> checkpoint_cb;
+        void setCheckpointCallback( checkpoint_cb cb ) { checkpointCallback = cb; }
+        virtual void putCheckpoint(WorkInProgress::Ptr, const char*, uint64_t, bool) { };
 
         void setFailed(void);
         bool isOK(void);
@@ -229,6 +238,7 @@ namespace redux {
     protected:
        
         mutable PackedData packed;
+        checkpoint_cb checkpointCallback;
         std::mutex jobMutex;
         static std::mutex globalMutex;
         std::string cachePath;
@@ -76,8 +76,10 @@ namespace redux {
                 entryTime = boost::posix_time::microsec_clock::universal_time();
             }
             inline void setMask( LogMask m ) { mask = m; }
+            inline void setTime( const boost::posix_time::ptime& t ) { entryTime = t; }
             inline uint8_t getMask(void) const { return mask; }
             inline const char *getMessage(void) const { return message.c_str(); }
+            inline size_t getMessageLength(void) const { return message.length(); }
             inline const boost::posix_time::ptime &getTime(void) const { return entryTime; }
 
             template <typename T>
@@ -8,8 +8,12 @@
 #include "redux/util/datautil.hpp"
 
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <boost/program_options.hpp>
@@ -21,9 +25,21 @@ namespace redux {
 
     namespace logging {
         
+        /*! @brief Collects log entries and forwards them to the outputs (files, streams, network or other Loggers).
+         *  @details append() does not lock or allocate: the finished entry is copied into a fixed-size ring buffer owned
+         *  by the calling thread, and a background thread (started at the first entry) drains all rings, in time-order,
+         *  and fans the entries out to the outputs. It is woken every flushInterval ms, when a ring is half full,
+         *  or for warnings and more severe entries.
+         *  When a ring is full, the entry is dropped (and counted), unless the policy is OVERFLOW_FLUSH or the entry
+         *  is a warning/error, in which case the calling thread flushes the buffers itself.
+         *  With flushPeriod <= 1 (the default) append() also flushes, i.e. logging is synchronous as before.
+         *  Entries too long for a ring (> 16 KiB) are passed on through the (locking) item queue, they are not truncated.
+         */
         class Logger : public LogOutput {
         public:
 
+            enum OverflowPolicy : uint8_t { OVERFLOW_DROP=0, OVERFLOW_FLUSH };
+
             Logger(void);
             explicit Logger( bpo::variables_map& );
             ~Logger();
@@ -43,6 +59,8 @@ namespace redux {
             void netReceive( network::TcpConnection::Ptr conn );
             void setContext( const std::string& c ) { context = c; };
             void setLevel( uint8_t l ) override;
+            void setOverflowPolicy( OverflowPolicy p ) { overflowPolicy = p; };
+            uint64_t nDropped( void ) const { return dropped; };
             
             LogItem& getItem( LogMask m=LOG_MASK_NORMAL ) {
                 threadItem.setLogger( this );
@@ -66,9 +84,29 @@ namespace redux {
             static std::string environmentMap( const std::string& );
             static bpo::options_description getOptions( const std::string& application_name );
 
+            static const unsigned int flushInterval = 100;         //!< ms
+
         private:
+            struct Ring;
+            Ring* getRing( void );
+            size_t drainRings( std::vector<LogItemPtr>& );
+            void wake( void );
+            void flushLoop( void );
+
             std::string context;
             
+            const uint64_t id;                  //!< unique for each instance, used to look up the thread's ring.
+            std::mutex ringMutex;               //!< protects rings and the start/stop of flushThread.
+            std::vector<std::shared_ptr<Ring>> rings;
+            std::mutex drainMutex;              //!< only one thread at a time may read from the rings.
+            std::thread flushThread;
+            std::mutex wakeMutex;
+            std::condition_variable wakeCond;
+            std::atomic<bool> running, wakeRequested;
+            std::atomic<uint8_t> overflowPolicy;
+            std::atomic<uint64_t> dropped;
+            uint64_t reportedDropped;
+            
             typedef std::map<std::string, LogOutputPtr> OutputMap;
             OutputMap outputs;
             std::mutex outputMutex;
@@ -5,6 +5,7 @@
 #include "redux/momfbd/solver.hpp"
 
 #include "redux/image/image.hpp"
+#include "redux/image/pixelfiller.hpp"
 #include "redux/util/arraystats.hpp"
 #include "redux/util/progresswatch.hpp"
 #include "redux/util/region.hpp"
@@ -19,6 +20,13 @@
 #include <boost/property_tree/ptree.hpp>
 namespace bpt = boost::property_tree;
 
+namespace testsuite {
+    namespace momfbd {
+        struct ChannelTest;
+        struct SolverTest;
+    }
+}
+
 
 namespace redux {
 
@@ -111,7 +119,13 @@ namespace redux {
             void unloadCalib(void);
 
             void addTimeStamps( const bpx::ptime& newStart, const bpx::ptime& newEnd );
+            struct Pipeline;
+            void readStage( boost::asio::io_context&, std::shared_ptr<Pipeline> );
+            void frameStage( boost::asio::io_context&, std::shared_ptr<Pipeline>, size_t fileIndex, size_t frame );
+            void finishFile( Pipeline&, size_t fileIndex );
             void loadFile( size_t fileIndex, size_t offset );
+            bool calibrateImage( redux::util::Array<double>&, size_t index );
+            void fillImage( redux::util::Array<double>& );
             void preprocessImage( size_t index );
             void maybeLoadImages( void );          
             void getStorage(ChannelData&);          
@@ -128,7 +142,7 @@ namespace redux {
             redux::image::Image<float> ccdResponse, ccdScattering;
             redux::image::Image<float> psf, modulationMatrix;
             redux::image::Image<int16_t> xOffset, yOffset;
-            std::shared_ptr<uint8_t> gainMask;
+            redux::image::PixelFiller pixelFiller;                          //!< bad-pixel list from the gain-mask, shared by all frames.
             bpx::ptime startT, endT;
             std::future<bool> patchWriteFail;
             std::vector<size_t> nFrames;                                    //!< Number of frames in each file
@@ -162,6 +176,8 @@ namespace redux {
             friend struct ModeSet;
             friend struct Solver;
             friend struct SubImage;
+            friend struct testsuite::momfbd::ChannelTest;      // unit-tests of the (private) preprocessing
+            friend struct testsuite::momfbd::SolverTest;       // unit-tests of the line-search on a synthetic setup
             
         };
 
@@ -34,7 +34,8 @@ namespace redux {
         enum RunFlags  { RF_CALIBRATE=1, RF_DONT_MATCH_IMAGE_NUMS, RF_FAST_QR=4, RF_FIT_PLANE=8,
                          RF_FLATFIELD=16, RF_GLOBAL_NOISE=32, RF_NEW_CONSTRAINTS=64, RF_NO_CLIP=128,
                          RF_NO_CONSTRAINTS=256, RF_NO_FILTER=512, RF_FORCE_WRITE=1024, RF_NOSWAP=2048,
-                         RF_OLD_NS=4096, RF_SORT_MODES=8192 };
+                         RF_OLD_NS=4096, RF_SORT_MODES=8192, RF_FAST_LINESEARCH=16384,
+                         RF_SINGLE_PRECISION=32768 };
         enum NormType { NORM_NONE=0, NORM_OBJ_MAX_MEAN, NORM_OBJ_MAX_MEDIAN, NORM_OBJ_MEDIAN_MEDIAN };
         
         struct cicomp {  // case-insensitive comparator for the maps below.
@@ -215,6 +216,7 @@ namespace redux {
             uint16_t minIterations;
             uint16_t maxIterations;
             uint16_t targetIterations;  //!< Exit loop after this many successful (i.e. improving) iterations
+            uint16_t checkpointInterval;    //!< Save the solver state of a running patch this often (seconds, 0 = never)
             uint8_t fillpixMethod;
             uint8_t gradientMethod;
             uint8_t getstepMethod;
@@ -138,6 +138,35 @@ namespace redux {
             
         };
 
+        /*! Solver state for a partially processed patch. It is stored in the cache (next to the patch) and also sent to
+         *  the master, so that the patch can be resumed by another slave if the current one dies or times out.
+         *  The state is only saved between iterations, so the minimizer is restarted from "alpha", i.e. the search-history
+         *  of the conjugate-gradient/BFGS methods is lost, but no evaluated iterations are.
+         */
+        struct SolverCheckpoint : public redux::util::CacheItem {
+            
+            SolverCheckpoint(void) : modeCount(0), iteration(0), totalIterations(0), failCount(0) {};
+            bool valid( void ) const { return !alpha.empty(); }
+            void clear( void );
+            uint64_t size(void) const;
+            uint64_t pack(char*) const;
+            uint64_t unpack(const char*, bool);
+            static uint64_t packedSize( const char*, uint64_t maxSize, bool ); //!< size of a packed checkpoint, 0 if it does not fit in maxSize
+            size_t csize(void) const override { return size(); };
+            uint64_t cpack(char* p) const override { return pack(p); };
+            uint64_t cunpack(const char* p, bool e) override { return unpack(p,e); };
+            void cclear(void) override { clear(); };
+            SolverCheckpoint& operator=(const SolverCheckpoint&);
+            
+            uint16_t modeCount;                         //!< number of enabled modes when the state was saved
+            uint16_t iteration;                         //!< iterations done with this modeCount
+            uint32_t totalIterations;
+            uint16_t failCount;
+            std::vector<double> alpha;                  //!< Full solution (i.e. including the offset), nImages*nModes
+            std::vector<float> metrics;                 //!< Metric history so far (PatchData::metrics)
+            
+        };
+        
         enum PartType { PT_DEFAULT=0, PT_GLOBAL };
         
         class MomfbdJob;
@@ -152,6 +181,7 @@ namespace redux {
             redux::util::Region16 roi;                       //! Region/position of this patch in the full image
             float finalMetric;
             std::vector<float> metrics;
+            SolverCheckpoint checkpoint;                     //! Saved solver state (only valid for a partially processed patch)
             explicit PatchData( MomfbdJob& j, uint16_t yid=0, uint16_t xid=0);
             PatchData( const PatchData& ) = delete;
             ~PatchData();
@@ -163,6 +193,8 @@ namespace redux {
             void load(void) override;
             void unload(void) override;
             void prePack( bool force=false ) override;
+            double cost( void ) const override;                  //!< ~ nImages x nModes x patchSize^2, i.e. the same for all patches of a job (it only differs between jobs)
+            double distance( const Part& ) const override;       //!< distance (in patches) in the mozaic.
             void clear(void);
             uint64_t size(void) const override;
             uint64_t pack(char*) const override;
@@ -136,6 +136,8 @@ namespace redux {
             
             void normalize( double scale=1.0 );
             
+            void compactSupport( const redux::image::Pupil& );   //!< Store the modes, restricted to the pupil-support, in supportModes
+            
             ModeInfo info;
             
             double J_T_xy[2][2];          //!< Jacobian for the tilts w.r.t. the pixel coordinates. Used for converting tilts to pixels.
@@ -147,6 +149,8 @@ namespace redux {
             std::vector<double*> modePointers;
             std::vector<double> atm_rms;
             std::vector<double> norms;                      //!< (square of) L_{2,2} norms for the modes over the pupil
+            std::vector<double> supportModes;               //!< nModes x supportSize (row-major), values at Pupil::pupilIndex
+            size_t supportSize;
             std::mutex mtx;
 
             
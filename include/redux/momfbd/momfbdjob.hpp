@@ -9,6 +9,7 @@
 
 #include "redux/job.hpp"
 #include "redux/util/array.hpp"
+#include "redux/util/executor.hpp"
 #include "redux/util/progresswatch.hpp"
 #include "redux/util/region.hpp"
 
@@ -18,6 +19,13 @@ namespace bpo = boost::program_options;
 // define RDX_DO_TRANSPOSE to enable old way of transposing input
 //#define RDX_DO_TRANSPOSE
 
+namespace testsuite {
+    namespace momfbd {
+        struct JobTest;
+        struct SolverTest;
+    }
+}
+
 namespace redux {
 
     
@@ -77,6 +85,8 @@ namespace redux {
             void ungetWork( WorkInProgress::Ptr ) override;
             void failWork( WorkInProgress::Ptr ) override;
             void returnResults( WorkInProgress::Ptr ) override;
+            void putCheckpoint( WorkInProgress::Ptr, const char*, uint64_t, bool ) override;
+            void checkpoint( const PatchData& );            //!< (slave) send the solver state of a running patch to the master
 
             void cleanup(void) override;
             bool run( WorkInProgress::Ptr, uint16_t ) override;
@@ -139,6 +149,7 @@ namespace redux {
             Solver::Ptr solver;
             
             redux::util::ProgressWatch progWatch;
+            redux::util::TaskGroup tasks;           // executor-tasks using this job, drained in cleanup()
             
             bool cfgChecked;
             bool dataChecked;
@@ -152,6 +163,8 @@ namespace redux {
             friend struct PatchData;
             friend struct ModeSet;
             friend struct redux::image::Pupil;
+            friend struct testsuite::momfbd::JobTest;          // unit-tests of the (private) patch handling
+            friend struct testsuite::momfbd::SolverTest;       // unit-tests of the line-search on a synthetic setup
 
 
         };
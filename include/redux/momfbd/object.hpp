@@ -86,9 +86,13 @@ namespace redux {
             void addRegGamma(double);
             void addToFT(const complex_t*);
             void addDiffToFT( const complex_t* newFT, const complex_t* oldFT );
-            void addToPQ(const complex_t* pp, const double* qq);
             void addDiffToPQ(const redux::image::FourierTransform&, const redux::util::Array<complex_t>&, const redux::util::Array<complex_t>&);
             void addAllPQ(void);
+            void initPartials(size_t n);                                 //!< Set up n partial P/Q accumulators (one per worker task), slot 0 is P/Q itself
+            complex_t* partialP(size_t i) { return i ? partP.get() + (i-1)*otfSize2 : P.get(); }
+            double* partialQ(size_t i) { return i ? partQ.get() + (i-1)*otfSize2 : Q.get(); }
+            void reducePartials(size_t dst, size_t src, size_t first, size_t last);    //!< Add partial src to partial dst, for otfHalfSupport[first,last)
+            void mirrorPQ(size_t first, size_t last);                   //!< Fill in the mirrored half of P/Q, for otfHalfSupport[first,last)
             void calcHelpers(void);
             void fitAvgPlane( redux::util::Array<float>& plane, const std::vector<uint32_t>& wf );
             void fitAvgPlane(void) { fitAvgPlane( fittedPlane, waveFrontList ); };
@@ -136,6 +140,9 @@ namespace redux {
             std::shared_ptr<double>  ftSum;                                 //! Sum of the norm of all images' fourier-transforms
             std::shared_ptr<double> Q,PS,QS;
             std::shared_ptr<complex_t> P,PQ;
+            std::shared_ptr<double> partQ;
+            std::shared_ptr<complex_t> partP;
+            size_t nPartials;
             redux::util::Array<float> fittedPlane;
             std::shared_ptr<redux::image::Pupil> pupil;
             std::shared_ptr<ModeSet> modes;                                 //!< modes used in this object
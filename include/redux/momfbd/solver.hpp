@@ -7,6 +7,7 @@
 #include "redux/momfbd/wavefront.hpp"
 
 #include "redux/util/gsl.hpp"
+#include "redux/util/numa.hpp"
 #include "redux/util/progresswatch.hpp"
 #include "redux/util/stopwatch.hpp"
 
@@ -37,15 +38,16 @@ namespace redux {
             : public redux::util::TraceObject<TmpStorage>
 #endif
             {
-                TmpStorage() : thisSize(0) {}
+                TmpStorage() : thisSize(0), node(-1) {}
                 TmpStorage( const TmpStorage& ) = delete;
                 TmpStorage( TmpStorage&& ) = delete;
                 ~TmpStorage() { clear(); }
-                static void setSize( uint16_t patchSz, uint16_t pupSz ) {
-                    patchSize=patchSz; pupilSize=pupSz;
+                static void setSize( uint16_t patchSz, uint16_t pupSz, bool sp=false ) {
+                    patchSize=patchSz; pupilSize=pupSz; singlePrecision=sp;
                     currentSize = std::max<size_t>( patchSize, 2*pupilSize ); }
                 void init( void ) {
-                    if( currentSize && (thisSize == currentSize) ) {
+                    node = redux::util::numa::currentNode();
+                    if( currentSize && (thisSize == currentSize) && (bool(batchOTFf) == singlePrecision) ) {
                         return;
                     }
 
@@ -57,6 +59,18 @@ namespace redux {
                         C2 = redux::util::rdx_get_shared<complex_t>( thisSize2 );
                         OTF.init( 2*pupilSize, 2*pupilSize, redux::image::FULLCOMPLEX );
                         FT.init( patchSize, patchSize, redux::image::FULLCOMPLEX );
+                        size_t batchPixels = batchSize*4*pupilSize*pupilSize;
+                        if( singlePrecision ) {
+                            batchOTF.reset();
+                            batchWork.reset();
+                            batchOTFf = redux::util::rdx_get_shared<complexf_t>( batchPixels );
+                            batchWorkf = redux::util::rdx_get_shared<complexf_t>( batchPixels );
+                        } else {
+                            batchOTF = redux::util::rdx_get_shared<complex_t>( batchPixels );
+                            batchWork = redux::util::rdx_get_shared<complex_t>( batchPixels );
+                            batchOTFf.reset();
+                            batchWorkf.reset();
+                        }
                     }
                     thisSize = currentSize;
                  }
@@ -65,15 +79,24 @@ namespace redux {
                     D2.reset();
                     C.reset();
                     C2.reset();
+                    batchOTF.reset();
+                    batchWork.reset();
+                    batchOTFf.reset();
+                    batchWorkf.reset();
                     OTF.init(0,0);
                     FT.init(0,0);
                     thisSize = 0;
                 }
                 size_t thisSize;
+                int node;                               //!< NUMA-node of the owning thread (i.e. where the arrays are first-touched)
                 static size_t currentSize;
                 static uint16_t patchSize, pupilSize;
+                static bool singlePrecision;            //!< autocorrelate the OTFs in single precision (SINGLE_PRECISION)
+                static const size_t batchSize;          //!< max number of OTFs autocorrelated together (see Solver::applyAlpha)
                 std::shared_ptr<double> D,D2;
                 std::shared_ptr<complex_t> C,C2;
+                std::shared_ptr<complex_t> batchOTF,batchWork;  //!< batchSize consecutive blocks of (2*pupilSize)^2, only allocated if singlePrecision is not set
+                std::shared_ptr<complexf_t> batchOTFf,batchWorkf;   //!< same as above, only allocated if singlePrecision is set
                 redux::image::FourierTransform FT,OTF;
             };
     
@@ -106,6 +129,7 @@ namespace redux {
             void my_precalc( const gsl_vector*, const gsl_vector* );
             
             void run(PatchData::Ptr);
+            void saveCheckpoint( PatchData&, uint16_t modeCount, uint16_t iter, uint32_t totalIter, uint16_t failCount, const double* a );
             
             template <typename T>
             void shiftAndInit( const T* a, bool doReset=false );
@@ -114,6 +138,8 @@ namespace redux {
             void alignWavefronts( void );
             void zeroAlphas( void );
             
+            void placeImages( void );
+            void setOTFs( thread::TmpStorage*, const std::vector<std::shared_ptr<SubImage>>&, size_t begIndex, size_t endIndex );
             template <typename T> void applyAlpha( T* a );
             inline void applyAlpha(void) { applyAlpha( alpha.get() ); } ;
             void applyBeta( const gsl_vector* beta );
@@ -130,7 +156,8 @@ namespace redux {
             void initImages( double* a );
             
             double metric(void);
-            double metricAt(double step);       // evaluate metric at alpha + step*grad
+            double metricAt(double step);       // evaluate metric at alpha + step*dir, using the phases stored by my_precalc
+            void accumulatePQ(void);            // sum all subimages into P/Q, using per-task partials (no locking)
             void calcPQ(void);
             void gradient(void);
             void gradient(gsl_vector* out);
@@ -146,9 +173,18 @@ namespace redux {
             const std::vector<std::shared_ptr<Object>>& objects;
             boost::asio::io_context& ioContext;
             
+            struct ImageBatch {                     //!< consecutive subimages of a channel, their OTFs are autocorrelated together
+                std::shared_ptr<Channel> channel;
+                size_t begIndex, endIndex;
+                size_t imageOffset;                 //!< index of the first image among all images (i.e. offset in alpha, in units of nModes)
+            };
+            std::vector<ImageBatch> batches;
+            std::vector< std::pair<std::shared_ptr<Object>,std::shared_ptr<SubImage>> > images;
+            redux::util::numa::NodeQueue<size_t> batchQueue, imageQueue;   //!< indices into batches/images, grouped by NUMA-node
+            
             redux::util::Array<double> window, noiseWindow;
-            redux::util::Array<double> tmpPhi, tmpPhiGrad;
-            redux::util::Array<complex_t> tmpOTF;
+            redux::util::Array<double> tmpPhi, tmpPhiGrad;         //!< phi and the phase-change along the search direction (FAST_LINESEARCH)
+            double lineReg1, lineReg2;                              //!< linear/quadratic coefficients of the REG_ALPHA term along the search direction
             
             uint16_t patchSize;
             uint16_t pupilSize;
@@ -168,6 +204,7 @@ namespace redux {
             size_t patchSize2,pupilSize2,nTotalPixels,otfSize,otfSize2;
             
             grad_t gradientMethod;
+            uint8_t gradientType;                   //!< GM_DIFF/GM_VOGEL, the Vogel gradient is computed for all modes at once.
 
             redux::util::StopWatch timer;
             redux::util::ProgressWatch progWatch;
@@ -52,6 +52,7 @@ namespace redux {
             ~SubImage(void);
             
             void setPatchInfo(uint32_t, const redux::util::PointI&, const redux::util::PointF&, uint16_t, size_t, uint16_t, uint16_t);
+            void allocate( uint16_t pupilSize );        //!< (re-)allocate the pupil/otf-sized arrays, no-op if the size is unchanged.
             void setData( const double* a ) { wfAlpha=a; };
             void getWindowedImg( double* out, float* plane, redux::util::ArrayStats& s, bool rescaled ) const;
             void getWindowedImg( Array<double>& im, redux::util::ArrayStats& s, bool rescaled ) const;
@@ -61,7 +62,6 @@ namespace redux {
             void addFT(redux::util::Array<double>& ftsum) const;
             void addPQ(complex_t* P, double* Q) const { addPQ(OTF.get(),P,Q); };
             void addPQ(const complex_t* otf, complex_t* P, double* Q) const;
-            //void addToPQ(void) const;
             void restore(complex_t* avg_obj, double* norm) const;
             
             double metricChange(const complex_t* newOTF) const;
@@ -80,7 +80,7 @@ namespace redux {
             void alignAgainst( const Ptr& refIm );
 
             void addPhases(const double* a) { addPhases(phi.get(), a); };
-            void addPhases(double* phiPtr, const double* a) const;
+            void addPhases(double* phiPtr, const double* a) const;         //!< Add the modes weighted by a (no tilt-offsets) to phiPtr
             
             void addAlpha(uint16_t m, double a);
             void setAlpha(uint16_t m, double a);
@@ -101,6 +101,10 @@ namespace redux {
             void calcOTF(complex_t* otf, const double* phi) const;
             void calcOTF(void) { calcOTF( OTF.get(), phi.get() ); }
             void calcPFOTF(void);
+            template <typename C> void calcPF( C* otfBlock );   //!< Calculate PF and write the (un-correlated) OTF input into otfBlock (complex_t or complexf_t)
+            void setOTF( const complex_t* otfHalf );            //!< Set OTF from the un-centered half-plane of an autocorrelation (see FourierTransform::autocorrelateHalf)
+            void setOTF( const complexf_t* otfHalf );
+            template <typename C> void calcOTFStep( C* otfBlock, const double* phiPtr, const double* phiDir, double step ) const;    //!< Write the (un-correlated) OTF input for phiPtr+step*phiDir into otfBlock
             
             void addPSF( double* psf ) const;
             void getPSF( double* psf ) const;
@@ -133,6 +137,7 @@ namespace redux {
             void dump( std::string tag ) const;
 
             uint32_t index;
+            int homeNode;                               //<! NUMA-node where the arrays were allocated (-1 if not placed), see Solver::placeImages
             redux::util::PointI initialOffset;          //<! Starting location of the patch in the datablock, this is typically (maxLocalShift, maxLocalShift)
             redux::util::PointF channelResidualOffset;  //<! Remainder after shifting the cutout integer pixels.
             redux::util::PointI currentShift;           //<! How the subimage has been shifted to compensate for large tip/tilt coefficients.
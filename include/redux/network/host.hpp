@@ -2,6 +2,7 @@
 #define REDUX_NETWORK_HOST_HPP
 
 #include "redux/network/tcpconnection.hpp"
+#include "redux/util/codec.hpp"
 #include "redux/util/stringutil.hpp"
 
 #include <atomic>
@@ -39,6 +40,7 @@ namespace redux {
                 uint8_t peerType;
                 uint16_t nCores;
                 uint16_t connectPort;
+                uint32_t codecs;            //!< bitmask of the codecs this host accepts for work/result transfers (0 = uncompressed).
                 boost::posix_time::ptime startedAt;
                 std::string name, os, arch, connectName, user;
                 explicit HostInfo( std::string username="" );
@@ -55,6 +57,8 @@ namespace redux {
                 State state;
                 float load[2];
                 float progress;
+                uint8_t codec;                                      //!< codec used on the link to the master.
+                redux::util::codec::Stats netOut, netIn;            //!< compression statistics for that link.
                 std::string statusString;
                 boost::posix_time::ptime lastSeen;
                 boost::posix_time::ptime lastActive;
@@ -39,6 +39,8 @@ namespace redux {
                                  CMD_INTERACTIVE,
                                  CMD_LISTEN,
                                  CMD_PROXY,
+                                 CMD_PUT_CHECKPOINT,
+                                 CMD_EXSTAT,
                                  CMD_ERR = 255
                                };
                                
@@ -4,6 +4,8 @@
 #include "redux/network/protocol.hpp"
 #include "redux/types.hpp"
 #include "redux/util/arrayutil.hpp"
+#include "redux/util/bufferlist.hpp"
+#include "redux/util/codec.hpp"
 #include "redux/util/trace.hpp"
 
 #include <iostream>
@@ -74,6 +76,23 @@ namespace redux {
             uint64_t receiveN( std::shared_ptr<char> buf, uint64_t N );
             std::shared_ptr<char> receiveBlock( uint64_t& blockSize );
             
+            /*! Scatter/gather transfers: the packed block is followed by the size of the payload and the data-blocks
+             *  of the BufferList (without copying them to a contiguous buffer).
+             */
+            void writeGathered( const char* data, size_t sz, const redux::util::BufferList& );
+            void receivePayload( redux::util::BufferList& );        //!< receive directly into the (pre-allocated) blocks.
+            void skipPayload( void );                               //!< discard the payload (e.g. if unpacking failed).
+            
+            /*! Compression of work/result blocks, the codec is negotiated for each connection when connecting.
+             *  If a codec is set, the payload blocks are compressed by writeGathered/receivePayload, and the packed
+             *  block can be encoded/decoded with encode/decode (hdrSize bytes are reserved in front of the encoded data).
+             */
+            void setCodec( redux::util::codec::Type c ) { codec_ = c; };
+            redux::util::codec::Type getCodec( void ) const { return codec_; };
+            std::shared_ptr<char> encode( const char* data, uint64_t& sz, uint64_t hdrSize=0 );
+            std::shared_ptr<char> decode( const std::shared_ptr<char>& data, uint64_t& sz );
+            const redux::util::codec::Stats& stats( bool out ) const { return out ? txStats : rxStats; };
+            
             size_t readline( std::string& line );
             void writeline( const std::string& line );
             template <class T>
@@ -159,6 +178,8 @@ namespace redux {
             tcp::socket mySocket;
             boost::asio::io_context& ioContext;
             bool swapEndian_;
+            redux::util::codec::Type codec_;
+            redux::util::codec::Stats txStats, rxStats;
             uint8_t urgentData;
             bool urgentActive;
             uint64_t id;
@@ -27,6 +27,7 @@ namespace redux {
         
         
         typedef std::complex<double> complex_t;
+        typedef std::complex<float> complexf_t;           //!< Only used for the single-precision FFT paths
 
         using std::int8_t;
         using std::int16_t;
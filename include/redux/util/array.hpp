@@ -3,14 +3,18 @@
 
 #include "redux/math/functions.hpp"
 #include "redux/util/arrayutil.hpp"
+#include "redux/util/bufferlist.hpp"
 #include "redux/util/datautil.hpp"
 #include "redux/util/trace.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <stdexcept>
+#include <type_traits>
 #include <memory>
 #include <cstddef>
 #include <cstring>
+#include <thread>
 #include <vector>
 #include <iostream>
 #include <sys/mman.h>
@@ -21,6 +25,16 @@ namespace redux {
 
     namespace util {
 
+        namespace expr {    // lazy element-wise expressions, see arrayexpr.hpp
+            template <typename E> struct Base;
+            template <typename T> struct Leaf;
+            const size_t parallelThreshold = (1<<20);
+            inline std::atomic<unsigned int>& maxThreads( void ) {      //!< for evaluating large arrays, 0 = all cores
+                static std::atomic<unsigned int> n(1);
+                return n;
+            }
+        }
+
         /*! @defgroup util Util
          *  @{
          */
@@ -288,10 +302,26 @@ namespace redux {
             
             inline bool empty( void ) const { return (nElements_ == 0); };
             
+            /*! @brief Size of the packed header (blockSize + dimensions), i.e. the packed size without data.
+             */
+            static uint64_t headerSize( size_t nDims ) {
+                return 2*sizeof( uint64_t ) + nDims * sizeof( size_t );
+            }
+            
+            /*! @brief Check if the data should be transferred separately (see BufferList).
+             */
+            bool deferData( void ) const {
+                return nElements_ && std::is_arithmetic<T>::value && ( nElements_*sizeof(T) >= BufferList::minBlockSize );
+            }
+            
             /*! @brief Get the @e packed size of this array
-             *  @details This is only for getting the size needed to store the packed array.
+             *  @details This is only for getting the size needed to store the packed array. With an active BufferList,
+             *  deferred arrays only count their header, the same as pack() writes.
              */
             uint64_t size( void ) const {
+                if( BufferList::active() && deferData() ) {
+                    return headerSize( dimensions().size() );
+                }
                 uint64_t sz = sizeof( uint64_t );                                                          // blockSize
                 if( nElements_ ) {
                     std::vector<size_t> tmp = dimensions();
@@ -306,6 +336,19 @@ namespace redux {
              */
             uint64_t pack( char* dataPtr ) const {
                 using redux::util::pack;
+                BufferList* bl = BufferList::active();
+                if( bl && deferData() ) {       // only the header is packed, the data is sent from the BufferList.
+                    std::vector<size_t> dims = dimensions();
+                    uint64_t count = pack( dataPtr, headerSize(dims.size()) );
+                    count += pack( dataPtr+count, dims );
+                    if(dense_) {
+                        bl->add( reinterpret_cast<char*>(const_cast<T*>(get()+begin_)), nElements_*sizeof(T), sizeof(T), datablock );
+                    } else {
+                        T* dptr = reinterpret_cast<T*>( bl->stage( nElements_*sizeof(T), sizeof(T) ) );
+                        std::transform(begin(), end(), dptr, [](const T& a) { return a; });
+                    }
+                    return count;
+                }
                 uint64_t count = pack( dataPtr, size() );
                 if( nElements_ ) {
                     count += pack( dataPtr+count, dimensions() );
@@ -334,7 +377,11 @@ namespace redux {
                     std::vector<size_t> tmp;
                     count += unpack( dataPtr+count, tmp, swap_endian );
                     resize( tmp );
-                    if( datablock ) {
+                    if( datablock && (sz == headerSize(tmp.size())) ) {     // no data in the block, it is received via a BufferList.
+                        BufferList* bl = BufferList::active();
+                        if( !bl ) throw std::runtime_error("Array unpacking failed, the data was sent separately but no BufferList is active.");
+                        bl->add( reinterpret_cast<char*>(datablock.get()), nElements_*sizeof(T), sizeof(T), datablock );
+                    } else if( datablock ) {
                         count += unpack( dataPtr+count, datablock.get(), nElements_, swap_endian );
                     } else {
                         throw std::runtime_error("Array unpacking failed.");
@@ -393,6 +440,16 @@ namespace redux {
                 }
                 dense_ = true;
             }
+            template <typename ...S>
+            void wrap( const std::shared_ptr<T>& data, S ...sizes ) {     //!< shared version, data is kept alive by the array.
+                setSizes( sizes... );
+                setStrides();
+                countElements();
+                if( dataSize ) {
+                    datablock = data;
+                }
+                dense_ = true;
+            }
             //@}
 
                         
@@ -462,7 +519,8 @@ namespace redux {
                     if( dense_ ) {
                         std::copy( get()+begin_, get()+end_, dptr );
                     } else {
-                        std::transform( begin(), end(), dptr, [](const T& a) { return a; } );
+                        T* out = dptr;
+                        forEachRun( *this, [&out]( const T* p, size_t n ) { out = std::copy( p, p+n, out ); } );
                     }
                 }
                 return dptr;
@@ -476,7 +534,7 @@ namespace redux {
                     //std::transform( get()+begin_, get()+end_, dptr, get()+begin_, [](const T& a, const T& b) { return static_cast<T>(b); } );
                     std::copy( dptr, dptr+nElements_, get()+begin_ );
                 } else {
-                    std::transform( begin(), end(), dptr, begin(), [](const T& a, const T& b) { return static_cast<T>(b); }  );
+                    forEachRun( *this, [&dptr]( T* p, size_t n ) { std::transform( dptr, dptr+n, p, [](const U& b) { return static_cast<T>(b); } ); dptr += n; } );
                 }
             }
 
@@ -488,7 +546,7 @@ namespace redux {
                     std::copy( get()+begin_, get()+end_, dptr );
                     //std::transform( get()+begin_, get()+end_, dptr, get()+begin_, [](const T& a, const T& b) { return static_cast<T>(b); } );
                 } else {
-                    std::transform( begin(), end(), dptr, [](const T& a) { return static_cast<U>(a); }  );
+                    forEachRun( *this, [&dptr]( const T* p, size_t n ) { dptr = std::transform( p, p+n, dptr, [](const T& a) { return static_cast<U>(a); } ); } );
                 }
             }
 
@@ -508,7 +566,7 @@ namespace redux {
                 if( dense_ && out.dense_ ) {
                     std::copy( get()+begin_, get()+end_, out.get()+out.begin_ );
                 } else {
-                    std::transform(begin(), end(), out.begin(), out.begin(), [](const T& a, const T& b) { return a; });
+                    zipRuns( out, *this, []( T* a, const T* b, size_t n ) { std::copy( b, b+n, a ); } );
                 }
             }
 
@@ -520,7 +578,7 @@ namespace redux {
                     std::copy( get()+begin_, get()+end_, out.get()+out.begin_ );
                     //std::transform(out.ptr(), out.ptr()+nElements_, get()+begin_, out.ptr(), redux::math::assign<U,T>());
                 } else {
-                    std::transform(out.begin(), out.end(), begin(), out.begin(), redux::math::assign<U,T>());
+                    zipRuns( out, *this, []( U* a, const T* b, size_t n ) { std::transform( a, a+n, b, a, redux::math::assign<U,T>() ); } );
                 }
             }
 
@@ -611,9 +669,11 @@ namespace redux {
                 if( sameSize( rhs ) ) {
                    if( this != &rhs ) {
                         if(dense_ && rhs.dense_) {
-                            std::transform(rhs.get()+rhs.begin_, rhs.get()+rhs.end_, get()+begin_, get()+begin_, [weight](const T& a, const T& b) { return b*weight; });
+                            std::transform(rhs.get()+rhs.begin_, rhs.get()+rhs.end_, get()+begin_, [weight](const U& b) { return static_cast<T>(b*weight); });
                         } else {
-                            std::transform(begin(), end(), rhs.begin(), begin(), [weight](const T& a, const T& b) { return b*weight; });
+                            zipRuns( *this, rhs, [weight]( T* a, const U* b, size_t n ) {
+                                std::transform( b, b+n, a, [weight](const U& v) { return static_cast<T>(v*weight); } );
+                            });
                         }
                     }
                 }
@@ -629,8 +689,7 @@ namespace redux {
                         if( dense_ && rhs.dense_ ) {
                             std::copy(rhs.get()+rhs.begin_, rhs.get()+rhs.end_, get()+begin_);
                         } else {
-                            //std::copy(rhs.begin(), rhs.end(), begin());
-                            std::transform(begin(), end(), rhs.begin(), begin(), [](const T& a, const T& b) { return b; });
+                            zipRuns( *this, rhs, []( T* a, const T* b, size_t n ) { std::copy( b, b+n, a ); } );
                         }
                     }
                 } else {
@@ -646,7 +705,7 @@ namespace redux {
                        //std::copy(rhs.ptr(),rhs.ptr()+nElements_,get()+begin_);
                        std::transform(get()+begin_, get()+end_, rhs.get()+rhs.begin_, get()+begin_, redux::math::assign<T,U>());
                     } else {
-                        std::transform(begin(), end(), rhs.begin(), begin(), redux::math::assign<T,U>());
+                        zipRuns( *this, rhs, []( T* a, const U* b, size_t n ) { std::transform( a, a+n, b, a, redux::math::assign<T,U>() ); } );
                     }
                 } else {
                     throw std::invalid_argument( "Array<U>::assign:  dimensions does not match: " + printArray(dimensions(),"dims")
@@ -664,8 +723,7 @@ namespace redux {
                 if( dense_ ) {
                     std::fill(get()+begin_, get()+end_, val );
                 } else {
-                    //std::copy(rhs.begin(), rhs.end(), begin());
-                    std::transform(begin(), end(), begin(), [val](const T& a){ return val; } );
+                    forEachRun( *this, [val]( T* p, size_t n ) { std::fill( p, p+n, val ); } );
                 }
             }
             
@@ -674,8 +732,7 @@ namespace redux {
                 if( dense_ ) {
                     std::transform(get()+begin_, get()+end_, get()+begin_, filler );
                 } else {
-                    //std::copy(rhs.begin(), rhs.end(), begin());
-                    std::transform(begin(), end(), begin(), filler);
+                    forEachRun( *this, [filler]( T* p, size_t n ) { std::transform( p, p+n, p, filler ); } );
                 }
             }
             
@@ -710,7 +767,7 @@ namespace redux {
                     if( dense_ ) {
                         std::fill( get()+begin_, get()+end_, rhs );
                     } else {
-                        std::fill( begin(), end(), rhs );
+                        forEachRun( *this, [rhs]( T* p, size_t n ) { std::fill( p, p+n, rhs ); } );
                     }
                 return *this;
             }
@@ -725,7 +782,7 @@ namespace redux {
                     //std::transform(rawPtr, rawPtr+nElements_, rhs.get(), rawPtr, redux::math::assign<T,U>());
                     std::copy(rhs.get()+rhs.begin_, rhs.get()+rhs.end_, get()+begin_);
                } else {
-                    std::transform(begin(), end(), rhs.begin(), begin(), redux::math::assign<T,U>());           // using the (slow) iterators defined above.
+                    zipRuns( *this, rhs, []( T* a, const U* b, size_t n ) { std::transform( a, a+n, b, a, redux::math::assign<T,U>() ); } );
                 }
                 return *this;
             }
@@ -743,7 +800,7 @@ namespace redux {
                 if(dense_) {
                     std::transform(get()+begin_, get()+end_, get()+begin_, [rhs](const T& a) { return a+rhs; });
                 } else {
-                    std::transform(begin(), end(), begin(), [rhs](const T& a) { return a+rhs; });
+                    forEachRun( *this, [rhs]( T* p, size_t n ) { std::transform( p, p+n, p, [rhs](const T& a) { return a+rhs; } ); } );
                 }
                 return *this;
             }
@@ -757,7 +814,7 @@ namespace redux {
                 if(dense_) {
                     std::transform(get()+begin_, get()+end_, get()+begin_, [rhs](const T& a) { return a-rhs; });
                 } else {
-                    std::transform(begin(), end(), begin(), [rhs](const T& a) { return a-rhs; });
+                    forEachRun( *this, [rhs]( T* p, size_t n ) { std::transform( p, p+n, p, [rhs](const T& a) { return a-rhs; } ); } );
                 }
                 return *this;
             }
@@ -771,7 +828,7 @@ namespace redux {
                 if(dense_) {
                     std::transform(get()+begin_, get()+end_, get()+begin_, [rhs](const T& a) { return a*rhs; } );
                 } else {
-                    std::transform(begin(), end(), begin(), [rhs](const T& a) { return a*rhs; } );
+                    forEachRun( *this, [rhs]( T* p, size_t n ) { std::transform( p, p+n, p, [rhs](const T& a) { return a*rhs; } ); } );
                 }
                 return *this;
             }
@@ -782,11 +839,19 @@ namespace redux {
                 return tmp/=rhs;
             }
             const Array<T>& operator/=( const T& rhs ) {
+                if( !std::is_floating_point<T>::value ) {      // the inverse would be truncated for integers
+                    if(dense_) {
+                        std::transform(get()+begin_, get()+end_, get()+begin_, [rhs](const T& a) { return a/rhs; });
+                    } else {
+                        forEachRun( *this, [rhs]( T* p, size_t n ) { std::transform( p, p+n, p, [rhs](const T& a) { return a/rhs; } ); } );
+                    }
+                    return *this;
+                }
                 T rhs_inv = 1.0/rhs;
                 if(dense_) {
                     std::transform(get()+begin_, get()+end_, get()+begin_, [rhs_inv](const T& a) { return a*rhs_inv; });
                 } else {
-                    std::transform(begin(), end(), begin(), [rhs_inv](const T& a) { return a*rhs_inv; });
+                    forEachRun( *this, [rhs_inv]( T* p, size_t n ) { std::transform( p, p+n, p, [rhs_inv](const T& a) { return a*rhs_inv; } ); } );
                 }
                 return *this;
             }
@@ -807,7 +872,7 @@ namespace redux {
                     if(dense_ && rhs.dense_) {
                         std::transform(get()+begin_, get()+end_, rhs.get()+rhs.begin_, get()+begin_, redux::math::add<T,U>());
                     } else {
-                        std::transform(begin(), end(), rhs.begin(), begin(), redux::math::add<T,U>());
+                        zipRuns( *this, rhs, []( T* a, const U* b, size_t n ) { std::transform( a, a+n, b, a, redux::math::add<T,U>() ); } );
                     }
                 }
                 else {
@@ -829,7 +894,7 @@ namespace redux {
                     if(dense_ && rhs.dense_) {
                         std::transform(get()+begin_, get()+end_, rhs.get()+rhs.begin_, get()+begin_, redux::math::subtract<T,U>());
                     } else {
-                        std::transform(begin(), end(), rhs.begin(), begin(), redux::math::subtract<T,U>());
+                        zipRuns( *this, rhs, []( T* a, const U* b, size_t n ) { std::transform( a, a+n, b, a, redux::math::subtract<T,U>() ); } );
                     }
                 }
                 else {
@@ -851,7 +916,7 @@ namespace redux {
                     if(dense_ && rhs.dense_) {
                         std::transform(get()+begin_, get()+end_, rhs.get()+rhs.begin_, get()+begin_, redux::math::multiply<T,U>());
                     } else {
-                        std::transform(begin(), end(), rhs.begin(), begin(), redux::math::multiply<T,U>());
+                        zipRuns( *this, rhs, []( T* a, const U* b, size_t n ) { std::transform( a, a+n, b, a, redux::math::multiply<T,U>() ); } );
                     }
                 }
                 else {
@@ -873,7 +938,7 @@ namespace redux {
                     if(dense_ && rhs.dense_) {
                         std::transform(get()+begin_, get()+end_, rhs.get()+rhs.begin_, get()+begin_, redux::math::divide<T,U>());
                     } else {
-                        std::transform(begin(), end(), rhs.begin(), begin(), redux::math::divide<T,U>());
+                        zipRuns( *this, rhs, []( T* a, const U* b, size_t n ) { std::transform( a, a+n, b, a, redux::math::divide<T,U>() ); } );
                     }
                 }
                 else {
@@ -883,6 +948,36 @@ namespace redux {
                 return *this;
             }
             
+            /*!
+             *  Lazy expressions (see arrayexpr.hpp), evaluated in a single pass.
+             */
+            template <typename E>
+            const Array<T>& operator=( const expr::Base<E>& e ) {
+                if( !fitsNode( e.self(), nElements_ ) ) resize( e.self().dims() );
+                evaluate( e.self(), redux::math::assign<T,typename E::value_type>() );
+                return *this;
+            }
+            template <typename E>
+            const Array<T>& operator+=( const expr::Base<E>& e ) {
+                evaluate( e.self(), redux::math::add<T,typename E::value_type>() );
+                return *this;
+            }
+            template <typename E>
+            const Array<T>& operator-=( const expr::Base<E>& e ) {
+                evaluate( e.self(), redux::math::subtract<T,typename E::value_type>() );
+                return *this;
+            }
+            template <typename E>
+            const Array<T>& operator*=( const expr::Base<E>& e ) {
+                evaluate( e.self(), redux::math::multiply<T,typename E::value_type>() );
+                return *this;
+            }
+            template <typename E>
+            const Array<T>& operator/=( const expr::Base<E>& e ) {
+                evaluate( e.self(), redux::math::divide<T,typename E::value_type>() );
+                return *this;
+            }
+
             template <typename U>
             const Array<T>& safeDivide( const Array<U>& rhs, double eps=0 ) {
                 if( this->sameSize( rhs ) ) {
@@ -890,8 +985,9 @@ namespace redux {
                         std::transform(get()+begin_, get()+end_, rhs.get()+rhs.begin_, get()+begin_,
                                        [eps]( const complex_t& a, const complex_t& b) { if( fabs(b)>eps ) return static_cast<T>(a/b); return T(0); } );
                     } else {
-                        std::transform(begin(), end(), rhs.begin(), begin(),
-                                       [eps]( const complex_t& a, const complex_t& b) { if( fabs(b)>eps ) return static_cast<T>(a/b); return T(0); } );
+                        zipRuns( *this, rhs, [eps]( T* a, const U* b, size_t n ) {
+                            std::transform( a, a+n, b, a, [eps]( const complex_t& a, const complex_t& b) { if( fabs(b)>eps ) return static_cast<T>(a/b); return T(0); } );
+                        });
                     }
                 }
                 else {
@@ -909,9 +1005,7 @@ namespace redux {
             template <typename U, typename V>
             const Array<T>& add( const Array<U>& rhs, const Array<V>& weight ) {
                 if( this->sameSize( rhs ) && this->sameSize( weight )) {
-                    typename Array<U>::const_iterator rhsit = rhs.begin();
-                    typename Array<V>::const_iterator wit = weight.begin();
-                    for( auto & value : *this ) value += (*rhsit++ * *wit++);
+                    evaluate( lazy( rhs ) * weight, [](const T& a, const decltype(U()*V())& b) { return a + b; } );
                 }
                 else {
                     throw std::invalid_argument( "Array::add  dimensions does not match." );
@@ -922,8 +1016,9 @@ namespace redux {
             template <typename U, typename V>
             const Array<T>& add( const Array<U>& rhs, V weight ) {
                 if( this->sameSize( rhs ) ) {
-                    typename Array<U>::const_iterator rhsit = rhs.begin();
-                    for( auto & value : *this ) value += (*rhsit++ * weight);
+                    zipRuns( *this, rhs, [weight]( T* a, const U* b, size_t n ) {
+                        for( size_t i=0; i<n; ++i ) a[i] += b[i]*weight;
+                    });
                 }
                 else {
                     throw std::invalid_argument( "Array::add<U,V>  dimensions does not match." );
@@ -934,8 +1029,9 @@ namespace redux {
             template <typename U, typename V>
             void addTo( Array<U>& rhs, V weight ) const {
                 if( this->sameSize( rhs ) ) {
-                    typename Array<U>::const_iterator it = begin();
-                    for( auto & value : rhs ) value += (*it++ * weight);
+                    zipRuns( rhs, *this, [weight]( U* a, const T* b, size_t n ) {
+                        for( size_t i=0; i<n; ++i ) a[i] += b[i]*weight;
+                    });
                 }
                 else {
                     throw std::invalid_argument( "Array::addTo  dimensions does not match." );
@@ -948,7 +1044,9 @@ namespace redux {
                     if(dense_ && rhs.dense_) {
                         std::transform(get()+begin_, get()+end_, rhs.get()+rhs.begin_, get()+begin_, [weight](const T& a, const U& b) { return a-b*weight; } );
                     } else {
-                        std::transform(begin(), end(), rhs.begin(), begin(), [weight](const T& a, const U& b) { return a-b*weight; } );
+                        zipRuns( *this, rhs, [weight]( T* a, const U* b, size_t n ) {
+                            std::transform( a, a+n, b, a, [weight](const T& a, const U& b) { return a-b*weight; } );
+                        });
                     }
                 }
                 else {
@@ -962,8 +1060,9 @@ namespace redux {
             template <typename U, typename V>
             const Array<T>& mult( const Array<U>& rhs, V weight ) {
                 if( this->sameSize( rhs ) ) {
-                    typename Array<U>::const_iterator rhsit = rhs.begin();
-                    for( auto & value : *this ) value *= (*rhsit++ * weight);
+                    zipRuns( *this, rhs, [weight]( T* a, const U* b, size_t n ) {
+                        for( size_t i=0; i<n; ++i ) a[i] *= b[i]*weight;
+                    });
                 }
                 else {
                     throw std::invalid_argument( "Array::mult  dimensions does not match: " + printArray(dimensions(),"dims")
@@ -984,10 +1083,11 @@ namespace redux {
                 if( dense_ && rhs.dense_ ) {
                     return !std::memcmp( ptr(), rhs.ptr(), sizeof(T)*nElements_ );
                 } else {
-                    const_iterator rhsit = rhs.begin();
-                    for( const auto & value : *this ) {
-                        if( value != *rhsit++ ) return false;
-                    }
+                    bool equal(true);
+                    zipRuns( *this, rhs, [&equal]( const T* a, const T* b, size_t n ) {
+                        if( equal ) equal = std::equal( a, a+n, b );
+                    });
+                    return equal;
                 }
                 return true;
             }
@@ -1227,6 +1327,132 @@ namespace redux {
             
         private:
             
+            /*! Walks the contiguous runs (rows of the fastest dimension) of a sub-array, in the same order as the iterators.
+             *  A dense array is a single run.
+             */
+            struct RowCursor {
+                explicit RowCursor( const Array<T>& a ) : sizes( a.currentSizes.data() ), strides( a.dimStrides.data() ),
+                    base( a.begin_ ), offset( a.begin_ ), length( a.nElements_ ) {
+                    if( !a.dense_ && a.nDims_ > 1 ) {
+                        idx.assign( a.nDims_-1, 0 );
+                        length = a.currentSizes.back();
+                    }
+                }
+                void next( void ) {
+                    for( size_t d = idx.size(); d-- > 0; ) {
+                        offset += strides[d];
+                        if( ++idx[d] < sizes[d] ) return;
+                        offset -= idx[d]*strides[d];
+                        idx[d] = 0;
+                    }
+                }
+                size_t seek( size_t el ) {          // go to the run containing element #el, returns the index within that run.
+                    if( !length ) return 0;
+                    size_t row = el / length;
+                    offset = base;
+                    for( size_t d = idx.size(); d-- > 0; ) {
+                        idx[d] = row % sizes[d];
+                        row /= sizes[d];
+                        offset += idx[d]*strides[d];
+                    }
+                    return el % length;
+                }
+                const size_t* sizes;
+                const size_t* strides;
+                std::vector<size_t> idx;
+                int64_t base, offset;
+                size_t length;
+            };
+            
+            /*! Call f( ptr, n ) for each contiguous run of elements in a (const or not). */
+            template <typename A, typename F>
+            static void forEachRun( A& a, F f ) {
+                typename std::remove_const<A>::type::RowCursor rc( a );
+                auto data = a.get();
+                for( size_t done = 0; done < a.nElements_; done += rc.length, rc.next() ) {
+                    f( data + rc.offset, rc.length );
+                }
+            }
+            
+            /*! Call f( aPtr, bPtr, n ) for matching runs of a and b, i.e. the elements are paired in iteration order.
+             *  The arrays must have the same number of elements, but can have different shapes/strides.
+             */
+            template <typename A, typename B, typename F>
+            static void zipRuns( A& a, B& b, F f ) {
+                size_t left = a.nElements_;
+                if( !left ) return;
+                typename std::remove_const<A>::type::RowCursor ac( a );
+                typename std::remove_const<B>::type::RowCursor bc( b );
+                auto ap = a.get() + ac.offset;
+                auto bp = b.get() + bc.offset;
+                size_t aLeft = ac.length;
+                size_t bLeft = bc.length;
+                while( true ) {
+                    size_t n = std::min( aLeft, bLeft );
+                    f( ap, bp, n );
+                    if( (left -= n) == 0 ) break;
+                    ap += n;
+                    bp += n;
+                    aLeft -= n;
+                    bLeft -= n;
+                    if( !aLeft ) {
+                        ac.next();
+                        ap = a.get() + ac.offset;
+                        aLeft = ac.length;
+                    }
+                    if( !bLeft ) {
+                        bc.next();
+                        bp = b.get() + bc.offset;
+                        bLeft = bc.length;
+                    }
+                }
+            }
+            
+            /*! Evaluate the expression e for all elements, storing f( old, e[i] ). Large arrays are split over
+             *  expr::maxThreads() threads.
+             */
+            template <typename E, typename F>
+            void evaluate( const E& e, F f ) {
+                if( !fitsNode( e, nElements_ ) ) {
+                    throw std::invalid_argument( "Array: expression dimensions does not match: " + printArray(dimensions(),"dims")
+                                                 + printArray(e.dims(),"  rhsdims") );
+                }
+                auto kernel = [this,&e,&f]( size_t first, size_t last ) {
+                    if( first >= last ) return;
+                    E ex( e );
+                    ex.start( first );
+                    RowCursor rc( *this );
+                    size_t i = rc.seek( first );
+                    T* d = get() + rc.offset + i;
+                    size_t dLeft = rc.length - i;
+                    while( true ) {
+                        size_t n = std::min( std::min( dLeft, ex.avail() ), last-first );
+                        for( size_t j=0; j<n; ++j ) d[j] = f( d[j], ex[j] );
+                        if( (first += n) >= last ) break;
+                        ex.advance( n );
+                        d += n;
+                        dLeft -= n;
+                        if( !dLeft ) {
+                            rc.next();
+                            d = get() + rc.offset;
+                            dLeft = rc.length;
+                        }
+                    }
+                };
+                size_t nThreads = expr::maxThreads();
+                if( !nThreads ) nThreads = std::thread::hardware_concurrency();
+                if( nThreads < 2 || nElements_ < expr::parallelThreshold ) {
+                    kernel( 0, nElements_ );
+                    return;
+                }
+                size_t chunk = (nElements_ + nThreads - 1) / nThreads;
+                std::vector<std::thread> threads;
+                for( size_t t=1; t<nThreads; ++t ) {
+                    threads.push_back( std::thread( kernel, std::min( t*chunk, nElements_ ), std::min( (t+1)*chunk, nElements_ ) ) );
+                }
+                kernel( 0, std::min( chunk, nElements_ ) );
+                for( auto& th: threads ) th.join();
+            }
             
             void setSizes( const std::vector<size_t>& sizes ) {
                 begin_ = end_ = nElements_ = dataSize = 0;
@@ -1305,6 +1531,7 @@ namespace redux {
             std::shared_ptr<T> datablock;
 
             template<typename U> friend class Array;
+            template<typename U> friend struct expr::Leaf;
             friend class const_iterator;
             friend class iterator;
 
@@ -1347,5 +1574,7 @@ namespace redux {
 
 }
 
+#include "redux/util/arrayexpr.hpp"
+
 #endif // REDUX_UTIL_ARRAY_HPP
 
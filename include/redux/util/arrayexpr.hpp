@@ -0,0 +1,155 @@
+#ifndef REDUX_UTIL_ARRAYEXPR_HPP
+#define REDUX_UTIL_ARRAYEXPR_HPP
+
+#include "redux/util/array.hpp"
+
+#include <algorithm>
+#include <complex>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace redux {
+
+    namespace util {
+
+        /*! @brief Lazy element-wise Array arithmetic.
+         *  @details An expression like
+         *  @code
+         *      img = (lazy(img) - dark*darkScale) * gain;
+         *  @endcode
+         *  builds a small tree of nodes, which is evaluated in a single pass when assigned to an Array (=, +=, -=, *=, /=),
+         *  instead of one pass, and possibly one temporary, per operator. Sub-arrays are visited row by row with plain
+         *  pointer loops. The nodes only hold references to the arrays, so the expression must be evaluated in the same
+         *  statement as it is created.
+         *  Evaluation of large arrays (>= parallelThreshold elements) is split over expr::maxThreads() threads (declared in
+         *  array.hpp), the default is 1 since most callers already run in parallel.
+         */
+        namespace expr {
+
+            /*! All nodes derive from Base<Node>. A node is read in runs: start(el) positions it on element el, avail()
+             *  is the number of elements that can be read as node[0..avail()-1], and advance(n) moves n elements ahead.
+             */
+            template <typename E>
+            struct Base {
+                const E& self( void ) const { return static_cast<const E&>( *this ); }
+            };
+
+            template <typename T>
+            struct Leaf : public Base<Leaf<T>> {
+                typedef T value_type;
+                explicit Leaf( const Array<T>& a ) : arr( &a ), rc( a ), p( nullptr ), left( 0 ) {}
+                size_t size( void ) const { return arr->nElements_; }
+                std::vector<size_t> dims( void ) const { return arr->dimensions(); }
+                void start( size_t el ) {
+                    size_t i = rc.seek( el );
+                    p = arr->get() + rc.offset + i;
+                    left = rc.length - i;
+                }
+                size_t avail( void ) const { return left; }
+                void advance( size_t n ) {
+                    p += n;
+                    left -= n;
+                    if( !left ) {
+                        rc.next();
+                        p = arr->get() + rc.offset;
+                        left = rc.length;
+                    }
+                }
+                const T& operator[]( size_t i ) const { return p[i]; }
+                const Array<T>* arr;
+                typename Array<T>::RowCursor rc;
+                const T* p;
+                size_t left;
+            };
+
+            template <typename S>
+            struct Scalar : public Base<Scalar<S>> {
+                typedef S value_type;
+                explicit Scalar( const S& v ) : val( v ) {}
+                size_t size( void ) const { return 0; }         // fits any size
+                std::vector<size_t> dims( void ) const { return std::vector<size_t>(); }
+                void start( size_t ) {}
+                size_t avail( void ) const { return std::numeric_limits<size_t>::max(); }
+                void advance( size_t ) {}
+                const S& operator[]( size_t ) const { return val; }
+                S val;
+            };
+
+            template <typename Op, typename L, typename R>
+            struct Binary : public Base<Binary<Op,L,R>> {
+                typedef decltype( Op()( std::declval<typename L::value_type>(), std::declval<typename R::value_type>() ) ) value_type;
+                Binary( const L& l, const R& r ) : lhs( l ), rhs( r ) {}
+                size_t size( void ) const { return lhs.size() ? lhs.size() : rhs.size(); }
+                bool fits( size_t n ) const { return fitsNode( lhs, n ) && fitsNode( rhs, n ); }
+                std::vector<size_t> dims( void ) const {
+                    std::vector<size_t> ret = lhs.dims();
+                    return ret.empty() ? rhs.dims() : ret;
+                }
+                void start( size_t el ) { lhs.start( el ); rhs.start( el ); }
+                size_t avail( void ) const { return std::min( lhs.avail(), rhs.avail() ); }
+                void advance( size_t n ) { lhs.advance( n ); rhs.advance( n ); }
+                value_type operator[]( size_t i ) const { return Op()( lhs[i], rhs[i] ); }
+                L lhs;
+                R rhs;
+            };
+
+            template <typename E> bool fitsNode( const E& e, size_t n ) { return !e.size() || e.size() == n; }
+            template <typename Op, typename L, typename R>
+            bool fitsNode( const Binary<Op,L,R>& e, size_t n ) { return e.fits( n ); }
+
+            struct Add { template <typename A, typename B> auto operator()( const A& a, const B& b ) const -> decltype( a+b ) { return a+b; } };
+            struct Sub { template <typename A, typename B> auto operator()( const A& a, const B& b ) const -> decltype( a-b ) { return a-b; } };
+            struct Mul { template <typename A, typename B> auto operator()( const A& a, const B& b ) const -> decltype( a*b ) { return a*b; } };
+            struct Div { template <typename A, typename B> auto operator()( const A& a, const B& b ) const -> decltype( a/b ) { return a/b; } };
+
+            template <typename E>
+            struct isNode : public std::is_base_of<Base<E>, E> {};
+
+            template <typename S>
+            struct isScalar : public std::is_arithmetic<S> {};
+            template <typename S>
+            struct isScalar<std::complex<S>> : public std::true_type {};
+
+            template <typename E>
+            const E& toNode( const Base<E>& e ) { return e.self(); }
+            template <typename T>
+            Leaf<T> toNode( const Array<T>& a ) { return Leaf<T>( a ); }
+            template <typename S, typename std::enable_if<isScalar<S>::value, int>::type = 0>
+            Scalar<S> toNode( const S& s ) { return Scalar<S>( s ); }
+
+            template <typename X>
+            using node_t = typename std::decay<decltype( toNode( std::declval<const X&>() ) )>::type;
+
+            template <typename A, typename B>
+            using enable_expr = typename std::enable_if<isNode<A>::value || isNode<B>::value, int>::type;
+
+            template <typename A, typename B, enable_expr<A,B> = 0>
+            Binary<Add, node_t<A>, node_t<B>> operator+( const A& a, const B& b ) {
+                return Binary<Add, node_t<A>, node_t<B>>( toNode( a ), toNode( b ) );
+            }
+            template <typename A, typename B, enable_expr<A,B> = 0>
+            Binary<Sub, node_t<A>, node_t<B>> operator-( const A& a, const B& b ) {
+                return Binary<Sub, node_t<A>, node_t<B>>( toNode( a ), toNode( b ) );
+            }
+            template <typename A, typename B, enable_expr<A,B> = 0>
+            Binary<Mul, node_t<A>, node_t<B>> operator*( const A& a, const B& b ) {
+                return Binary<Mul, node_t<A>, node_t<B>>( toNode( a ), toNode( b ) );
+            }
+            template <typename A, typename B, enable_expr<A,B> = 0>
+            Binary<Div, node_t<A>, node_t<B>> operator/( const A& a, const B& b ) {
+                return Binary<Div, node_t<A>, node_t<B>>( toNode( a ), toNode( b ) );
+            }
+
+        }   // expr
+
+        /*! Start a lazy expression, see expr. */
+        template <typename T>
+        expr::Leaf<T> lazy( const Array<T>& a ) { return expr::Leaf<T>( a ); }
+
+    }   // util
+
+}   // redux
+
+
+#endif  // REDUX_UTIL_ARRAYEXPR_HPP
@@ -12,7 +12,7 @@ namespace redux {
 
     namespace util {
 
-        enum StatType { ST_VALUES=1, ST_RMS, ST_NOISE=4, ST_ALL=7 };
+        enum StatType { ST_VALUES=1, ST_RMS, ST_NOISE=4, ST_ALL=7, ST_MEDIAN=8 };       // N.B. ST_ALL does not include the median
 
         struct ArrayStats
 #ifdef RDX_TRACE_ARRAY
@@ -49,6 +49,28 @@ namespace redux {
                 }
             }
             
+            /*! Histogram based median/percentiles (p in [0,1]), using the min/max from getMinMaxMean, which has to be called first.
+             *  Exact for integer data spanning less than histogramBins values, otherwise a second pass over the data collects
+             *  the values in the bins holding the requested ranks, so the result is exact for all types.
+             */
+            template <typename T> void getMedian( const T* data, size_t count );
+            template <typename T> void getMedian( const redux::util::Array<T>& data ) {
+                size_t nEl = data.nElements();
+                if( data.dense() ) getMedian( data.ptr(), nEl );
+                else {
+                    if( nEl ) {
+                        std::unique_ptr<T[]> tmp( new T[ data.nElements() ]);
+                        data.template copyTo<T>( tmp.get() );
+                        getMedian( tmp.get(), nEl );
+                    }
+                }
+            }
+            template <typename T> std::vector<double> getPercentiles( const T* data, size_t count, const std::vector<double>& p ) const;
+            template <typename T> double getPercentile( const T* data, size_t count, double p ) const {
+                return getPercentiles( data, count, std::vector<double>( 1, p ) )[0];
+            }
+            static const size_t histogramBins = 65536;
+            
             template <typename T> void getNoise( const redux::util::Array<T>& data, int smooth=0 );
             void getNoise( const redux::image::FourierTransform& ft );
             
@@ -0,0 +1,62 @@
+#ifndef REDUX_UTIL_BUFFERLIST_HPP
+#define REDUX_UTIL_BUFFERLIST_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace redux {
+
+    namespace util {
+
+        /*! @brief Scatter/gather list for transferring large data-blocks without intermediate pack-buffers.
+         *  @details While a BufferList is active (see BufferList::Scope) for the calling thread, Array::pack() only writes
+         *  the header and adds a reference to its data to the list, and Array::unpack() allocates the array and adds its
+         *  storage to the list. The data-blocks are then sent/received, in order, after the packed (meta-)data.
+         *  Only large, dense arrays of plain numbers are handled this way, everything else is still packed inline.
+         */
+        class BufferList {
+
+        public:
+            struct Block {
+                char* data;
+                uint64_t size;
+                uint8_t elementSize;                //!< needed for swapping the endianess on the receiving side.
+                std::shared_ptr<void> owner;        //!< keeps the storage alive until the transfer is done.
+            };
+
+            static const uint64_t minBlockSize = 64*1024;   //!< smaller blocks are not worth the extra bookkeeping.
+
+            BufferList( void ) : totalSize(0) {}
+
+            void add( char* data, uint64_t sz, uint8_t elementSize, std::shared_ptr<void> owner );
+            char* stage( uint64_t sz, uint8_t elementSize );     //!< allocate a block owned by the list (e.g. to gather a sub-array).
+            void clear( void );
+            void swapEndian( void );
+
+            const std::vector<Block>& blocks( void ) const { return blocks_; }
+            uint64_t size( void ) const { return totalSize; }
+            bool empty( void ) const { return blocks_.empty(); }
+
+            static BufferList* active( void );      //!< the list registered for the calling thread (or nullptr).
+
+            class Scope {           //!< activate a list for the calling thread (nullptr = pack everything inline).
+            public:
+                explicit Scope( BufferList* );
+                ~Scope();
+            private:
+                BufferList* previous;
+            };
+
+        private:
+            std::vector<Block> blocks_;
+            uint64_t totalSize;
+
+        };
+
+    }   // util
+
+}   // redux
+
+
+#endif  // REDUX_UTIL_BUFFERLIST_HPP
@@ -4,13 +4,16 @@
 #include "redux/util/datautil.hpp"
 #include "redux/util/stringutil.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <string>
-
+#include <type_traits>
 #include <vector>
 #include <sys/types.h> 
 #include <unistd.h> 
@@ -34,12 +37,25 @@ namespace redux {
         };
         
         
+        /*! @brief Global storage of shared objects (FFT plans, grids, pupils, modes etc.), one std::map/std::set per type.
+         *  @details Each KeyT/T pair has its own map and mutex, and counts hits/misses. Map-types registered with
+         *  setEvictable() (the value must be a std::shared_ptr) are also time-stamped on every get(), and trim() will
+         *  remove the least recently used of those entries, when the total (estimated) size of the cache exceeds budget().
+         *  Only entries that nobody else references (use_count() <= 1) and that have been idle for minIdle() seconds are
+         *  removed. Evictable entries should be fetched with getOrCreate(), which constructs them under the map lock and
+         *  returns a copy of the shared_ptr, so an entry is pinned while it is used and is never modified behind the back
+         *  of trim(). The size of an entry is taken from a member cacheSize(), or nElements() (i.e. Arrays), otherwise
+         *  sizeof() is used. It is only measured while the entry is unreferenced, the last measured size is used otherwise.
+         */
         class Cache {
 
         public:
             
             typedef std::function<void(void)> void_cb;
             typedef std::function<std::string(void)> string_cb;
+            typedef std::chrono::steady_clock::time_point time_point;
+            typedef std::pair<time_point,size_t> Candidate;         //!< last use & size of an evictable entry
+            struct Stamp { time_point lastUse; size_t size; };      //!< per-entry bookkeeping for evictable entries
 
             struct Info {
                 Info( size_t id, const std::string& name, size_t typeSize=0 );
@@ -51,18 +67,45 @@ namespace redux {
                 std::string name;
                 size_t size;
                 mutable size_t count;
-                mutable size_t totalSize;
+                mutable size_t totalSize;           //!< bytes, from the last trim() (evictable types only).
+                mutable size_t hits, misses, evictions;
+                mutable bool evictable;
                 mutable void_cb clear;
                 mutable void_cb info;
                 mutable void_cb maintenance;
+                mutable std::function<size_t(std::vector<Candidate>&, time_point)> collect;
+                mutable std::function<void(time_point, time_point)> evict;
             };
 
             static void cleanup(void);
+            static void trim(void);                 //!< evict LRU entries until the cache fits in budget()
             static std::string getStats(void);
             static Cache& get(void);
             std::string path(void);
             void setPath(const std::string&);
+            void setBudget( size_t bytes ) { budget_ = bytes; }             //!< 0 means no limit (default)
+            size_t budget(void) const { return budget_; }
+            void setMinIdle( unsigned int s ) { minIdle_ = s; }             //!< default 60 s
+            unsigned int minIdle(void) const { return minIdle_; }
             static pid_t pid(void);
+            template<class KeyT, class T>
+            static bool setEvictable(void) {
+                static_assert( isSharedPtr<T>::value, "Only entries held by a shared_ptr can be evicted." );
+                Cache& c = get();
+                const Info& i = c.getMapInfo<KeyT,T>();
+                c.getMap<KeyT,T>();                     // initialize the map before locking, it will lock mtx when first used.
+                std::unique_lock<std::mutex> lock(c.mtx);
+                auto m = c.getMap<KeyT,T>();
+                if( !i.evictable ) {
+                    auto& lu = lastUse<KeyT,T>();
+                    const time_point now = std::chrono::steady_clock::now();
+                    for( auto& e: m.second ) lu[&e.first] = { now, sizeof(KeyT)+sizeof(T) };
+                    i.collect = std::bind( &Cache::mapCollect<KeyT,T>, &c, std::placeholders::_1, std::placeholders::_2 );
+                    i.evict = std::bind( &Cache::mapEvict<KeyT,T>, &c, std::placeholders::_1, std::placeholders::_2 );
+                    i.evictable = true;
+                }
+                return true;
+            }
             template<class T>
             static int erase(const T& entry) {
                 auto s = get().getSet<T>();
@@ -75,9 +118,12 @@ namespace redux {
             static int erase(const KeyT& key) {
                 auto m = get().getMap<KeyT,T>();
                 static const Info& i = get().getMapInfo<KeyT,T>();
-                int ret = m.second.erase(key);
+                auto it = m.second.find(key);
+                if( it == m.second.end() ) return 0;
+                if( i.evictable ) lastUse<KeyT,T>().erase( &it->first );
+                m.second.erase(it);
                 i.count = m.second.size();
-                return ret;
+                return 1;
             }
             template<class KeyT, class T>
             static T& get(const KeyT& key, const T& val=T()) {
@@ -85,6 +131,47 @@ namespace redux {
                 static const Info& i = get().getMapInfo<KeyT,T>();
                 auto ret = m.second.emplace(key,val);
                 i.count = m.second.size();
+                if( ret.second ) i.misses++;
+                else i.hits++;
+                if( i.evictable ) touch<KeyT,T>( &ret.first->first );
+                return ret.first->second;
+            }
+            /*! Returns a copy of the entry for key, or T() if there is none (without inserting anything).
+             */
+            template<class KeyT, class T>
+            static T find( const KeyT& key ) {
+                auto m = get().getMap<KeyT,T>();
+                static const Info& i = get().getMapInfo<KeyT,T>();
+                auto it = m.second.find( key );
+                if( it == m.second.end() || !it->second ) return T();
+                i.hits++;
+                if( i.evictable ) touch<KeyT,T>( &it->first );
+                return it->second;
+            }
+            /*! Get the entry for key, constructing it with init() (which should return a T, i.e. a shared_ptr) while
+             *  holding the map lock if it is missing, empty, or if replace is set.
+             *  Returns a copy, so for evictable maps the entry is pinned for as long as the caller holds on to it.
+             */
+            template<class KeyT, class T, class F>
+            static T getOrCreate( const KeyT& key, F init, bool replace=false ) {
+                auto m = get().getMap<KeyT,T>();
+                static const Info& i = get().getMapInfo<KeyT,T>();
+                auto ret = m.second.emplace( key, T() );
+                if( ret.second || !ret.first->second ) i.misses++;
+                else i.hits++;
+                if( replace || !ret.first->second ) {
+                    try {
+                        ret.first->second = init();
+                    } catch( ... ) {
+                        if( ret.second ) {
+                            if( i.evictable ) lastUse<KeyT,T>().erase( &ret.first->first );
+                            m.second.erase( ret.first );
+                        }
+                        throw;
+                    }
+                }
+                i.count = m.second.size();
+                if( i.evictable ) touch<KeyT,T>( &ret.first->first );
                 return ret.first->second;
             }
             template<class T>
@@ -93,6 +180,8 @@ namespace redux {
                 static const Info& i = get().getSetInfo<std::shared_ptr<T>, PtrCompare<T>>();
                 auto ret = s.second.emplace(entry);
                 i.count = s.second.size();
+                if( ret.second ) i.misses++;
+                else i.hits++;
                 return *ret.first;
             }
             template<class T>
@@ -101,6 +190,8 @@ namespace redux {
                 static const Info& i = get().getSetInfo<T>();
                 auto ret = s.second.emplace(entry);
                 i.count = s.second.size();
+                if( ret.second ) i.misses++;
+                else i.hits++;
                 return *ret.first;
             }
             template<class KeyT, class T>
@@ -108,6 +199,7 @@ namespace redux {
                 auto m = get().getMap<KeyT,T>();
                 static const Info& i = get().getMapInfo<KeyT,T>();
                 m.second.clear();
+                lastUse<KeyT,T>().clear();
                 i.count = m.second.size();
             }
             template<class T>
@@ -203,7 +295,74 @@ namespace redux {
             }
 
         private:
-            Cache() : path_(""), pid_(getpid()) {};
+            Cache() : path_(""), pid_(getpid()), budget_(0), minIdle_(60) {};
+            template<class T> struct isSharedPtr : std::false_type {};
+            template<class T> struct isSharedPtr<std::shared_ptr<T>> : std::true_type {};
+            struct Rank0 {};
+            struct Rank1 : Rank0 {};
+            struct Rank2 : Rank1 {};
+            template<class T>
+            static auto entrySize( const T& v, Rank2 ) -> decltype( v.cacheSize(), size_t() ) { return v.cacheSize(); }
+            template<class T>
+            static auto entrySize( const T& v, Rank1 ) -> decltype( v.nElements(), size_t() ) {
+                return sizeof(T) + v.nElements()*sizeof(typename T::value_type);
+            }
+            template<class T>
+            static size_t entrySize( const T&, Rank0 ) { return sizeof(T); }
+            template<class T>
+            static size_t entrySize( const std::shared_ptr<T>& p, Rank2 ) { return sizeof(p) + (p ? entrySize( *p, Rank2() ) : 0); }
+            template<class KeyT, class T>
+            static std::map<const KeyT*,Stamp>& lastUse(void) {     // guarded by the mutex in getMap<KeyT,T>
+                static std::map<const KeyT*,Stamp> lu;
+                return lu;
+            }
+            template<class KeyT, class T>
+            static void touch( const KeyT* key ) {      // N.B. the map must be locked
+                auto ret = lastUse<KeyT,T>().emplace( key, Stamp{ std::chrono::steady_clock::now(), sizeof(KeyT)+sizeof(T) } );
+                if( !ret.second ) ret.first->second.lastUse = std::chrono::steady_clock::now();
+            }
+            template<class KeyT, class T>
+            size_t mapCollect( std::vector<Candidate>& candidates, time_point idleBefore ) {
+                auto m = getMap<KeyT,T>();
+                const Info& i = getMapInfo<KeyT,T>();
+                auto& lu = lastUse<KeyT,T>();
+                std::map<const KeyT*,Stamp> tmp;       // rebuilt, in case entries were removed through getMap()
+                const time_point now = std::chrono::steady_clock::now();
+                size_t total(0);
+                for( auto& e: m.second ) {
+                    auto it = lu.find( &e.first );
+                    Stamp st = (it == lu.end()) ? Stamp{ now, sizeof(KeyT)+sizeof(T) } : it->second;
+                    const bool unused = (e.second.use_count() <= 1);
+                    if( unused ) {      // nobody else can modify it, so it is safe to measure it.
+                        std::atomic_thread_fence( std::memory_order_acquire );
+                        st.size = sizeof(KeyT) + entrySize( e.second, Rank2() );
+                    }
+                    tmp.emplace( &e.first, st );
+                    total += st.size;
+                    if( unused && (st.lastUse <= idleBefore) ) {
+                        candidates.push_back( std::make_pair( st.lastUse, st.size ) );
+                    }
+                }
+                lu.swap( tmp );
+                i.totalSize = total;
+                return total;
+            }
+            template<class KeyT, class T>
+            void mapEvict( time_point cutoff, time_point idleBefore ) {
+                auto m = getMap<KeyT,T>();
+                const Info& i = getMapInfo<KeyT,T>();
+                auto& lu = lastUse<KeyT,T>();
+                for( auto it = m.second.begin(); it != m.second.end(); ) {
+                    auto lit = lu.find( &it->first );
+                    if( (lit != lu.end()) && (lit->second.lastUse <= cutoff) && (lit->second.lastUse <= idleBefore) && (it->second.use_count() <= 1) ) {
+                        i.totalSize -= std::min( i.totalSize, lit->second.size );
+                        lu.erase( lit );
+                        it = m.second.erase( it );
+                        i.evictions++;
+                    } else ++it;
+                }
+                i.count = m.second.size();
+            }
             template<class KeyT, class T>
             void mapMaintenance(void) {
                 auto m = getMap<KeyT,T>();
@@ -276,6 +435,8 @@ namespace redux {
             std::mutex mtx;
             std::string path_;
             pid_t pid_;
+            std::atomic<size_t> budget_;
+            std::atomic<unsigned int> minIdle_;
             std::set<Info> caches;
             std::vector<std::function<void(void)>> funcs;
             std::vector<std::function<void(void)>> cleanup_funcs;
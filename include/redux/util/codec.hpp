@@ -0,0 +1,69 @@
+#ifndef REDUX_UTIL_CODEC_HPP
+#define REDUX_UTIL_CODEC_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace redux {
+
+    namespace util {
+
+        /*! @brief Lossless codecs for (network) data-blocks.
+         *  @details zlib is always available, LZ4 and Zstd are used if they were found when building
+         *  (RDX_WITH_LZ4/RDX_WITH_ZSTD). Large blocks are split in chunks that are (de)compressed in parallel.
+         *  For blocks of multi-byte elements (e.g. float images), the bytes are shuffled (all 1st bytes, then all 2nd bytes, etc.)
+         *  before compression, which makes the slowly varying exponent/high bytes compress a lot better.
+         *  A chunk that does not compress is stored as it is, so the encoded size is at most raw size + headers.
+         *
+         *  Encoded layout:   [uint64 rawSize][uint32 nChunks] + nChunks * ( [uint8 type|shuffle][uint8 elementSize][uint32 raw][uint32 enc][data] )
+         */
+        namespace codec {
+
+            enum Type : uint8_t { NONE=0, ZLIB, LZ4, ZSTD, NTYPES };
+
+            static const uint32_t chunkSize = 4*1024*1024;
+
+            uint32_t available( void );                         //!< bitmask of the types compiled in: (1<<type)
+            uint32_t parse( const std::string& );               //!< "auto" / comma-separated list of codec names -> bitmask
+            Type negotiate( uint32_t mine, uint32_t theirs );   //!< the preferred type both sides support (Zstd > LZ4 > zlib).
+            std::string name( Type );
+
+            uint64_t bound( uint64_t rawSize );                 //!< max size of an encoded block.
+            uint64_t rawSize( const char* encoded, bool swap_endian );
+
+            /*! Encode a block, the result is written starting at hdrSize (i.e. space is reserved for the caller's
+             *  header). encodedSize is set to the size excluding hdrSize.
+             */
+            std::shared_ptr<char> encode( Type, const char* in, uint64_t rawSize, uint64_t& encodedSize,
+                                          uint8_t elementSize=1, uint64_t hdrSize=0 );
+            /*! Decode into out (which must be able to hold rawSize(in) bytes). Returns the number of bytes consumed from in.
+             *  N.B. the decoded data is in the byte-order of the sender, swapping the elements is up to the caller.
+             *  Throws std::length_error if the block is truncated or the chunk headers do not add up to exactly rawSize bytes.
+             */
+            uint64_t decode( const char* in, uint64_t encodedSize, char* out, bool swap_endian );
+
+            /*! Accumulated transfer statistics: bytes before/after compression and time spent (de)compressing.
+             */
+            struct Stats {
+                std::atomic<uint64_t> raw, wire, usecs;
+                Stats( void ) : raw(0), wire(0), usecs(0) {}
+                Stats( const Stats& rhs ) : raw(rhs.raw.load()), wire(rhs.wire.load()), usecs(rhs.usecs.load()) {}
+                Stats& operator=( const Stats& );
+                void add( uint64_t r, uint64_t w, uint64_t us ) { raw += r; wire += w; usecs += us; }
+                double ratio( void ) const { return wire ? double(raw)/wire : 1.0; }
+                uint64_t size( void ) const { return 3*sizeof(uint64_t); }
+                uint64_t pack( char* ) const;
+                uint64_t unpack( const char*, bool );
+                std::string print( void ) const;                    //!< e.g. "1.2 GiB @ 2.85x, 3.1 s"
+            };
+
+        }   // codec
+
+    }   // util
+
+}   // redux
+
+
+#endif  // REDUX_UTIL_CODEC_HPP
@@ -0,0 +1,162 @@
+#ifndef REDUX_UTIL_EXECUTOR_HPP
+#define REDUX_UTIL_EXECUTOR_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace redux {
+
+    namespace util {
+
+        /*! @brief Process-wide work-stealing thread-pool with priority lanes.
+         *  @details Tasks are submitted to a lane, and idle workers pick tasks from the lanes in order of priority
+         *  (every 16th pick is done in reverse order, so the low-priority lanes are never completely starved).
+         *  Tasks submitted from a worker thread go to the local queue of that worker (LIFO for the worker itself), other
+         *  workers steal from the opposite end when they run out of work. Tasks submitted from other threads go to a shared
+         *  queue per lane.
+         *  The number of simultaneously running tasks can be limited per lane, e.g. so that a few blocking I/O tasks can not
+         *  occupy all workers and delay the (short) network tasks.
+         */
+        class Executor {
+
+        public:
+            enum Lane : uint8_t { NET=0, IO, PREPROCESS, SOLVE, NLANES };       //!< in order of priority
+
+            struct LaneStats {
+                uint64_t queued, active, completed;
+                uint64_t waitUs, maxWaitUs;         //!< time spent in the queue (total/max)
+                uint64_t runUs;                     //!< total run-time
+            };
+
+            static Executor& get( void );           //!< The daemon-wide instance.
+
+            explicit Executor( size_t nThreads=0 ); //!< 0 = std::thread::hardware_concurrency()
+            Executor( const Executor& ) = delete;
+            ~Executor();
+
+            void submit( Lane, std::function<void(void)> );
+            template <typename F>
+            auto async( Lane lane, F&& f ) -> std::future<decltype(f())> {
+                auto task = std::make_shared<std::packaged_task<decltype(f())(void)>>( std::forward<F>(f) );
+                std::future<decltype(f())> ret = task->get_future();
+                submit( lane, [task](){ (*task)(); } );
+                return ret;
+            }
+
+            /*! Add/remove workers. The queued tasks of removed workers are moved to the shared queues, and removed workers
+             *  exit when their current task is done (without blocking the caller).
+             */
+            void resize( size_t nThreads );
+            size_t nThreads( void ) const;
+            void setLimit( Lane, size_t maxActive );        //!< 0 = no limit
+            void waitIdle( void );                          //!< block until all lanes are empty and no tasks are running.
+
+            LaneStats stats( Lane ) const;
+            std::string print( void ) const;                //!< a small table with queue-depths/latencies, e.g. for rstat.
+            static std::string laneName( Lane );
+
+            /*! Uncaught exceptions from tasks are passed to this handler (e.g. the daemon's logger), default is std::cerr.
+             *  The handler is called with a lock held, so resetting it (nullptr) waits for any ongoing call.
+             */
+            void setErrorHandler( std::function<void(const std::string&)> );
+
+        private:
+            typedef std::chrono::steady_clock clock;
+            struct Task {
+                std::function<void(void)> fn;
+                clock::time_point queued;
+            };
+            struct Worker {
+                std::mutex mtx;
+                std::deque<Task> tasks[NLANES];
+                std::thread thread;
+                std::atomic<bool> exit, finished;
+                Worker( void ) : exit(false), finished(false) {}
+            };
+            struct LaneInfo {
+                std::atomic<size_t> queued, active, limit;
+                std::atomic<size_t> reserved;               // slots taken by workers looking for a task in this lane (>= active)
+                std::atomic<uint64_t> completed, waitUs, maxWaitUs, runUs;
+                LaneInfo( void ) : queued(0), active(0), limit(0), reserved(0), completed(0), waitUs(0), maxWaitUs(0), runUs(0) {}
+            };
+
+            void run( Worker* );
+            bool next( Worker*, Task&, Lane&, size_t& pick );
+            bool reserve( Lane );
+            void done( Lane, const clock::time_point& queued, const clock::time_point& started );
+            void reportError( const std::string& );
+
+            mutable std::shared_timed_mutex workersMtx;     // guards the list of workers (not the workers themselves).
+            std::vector<std::unique_ptr<Worker>> workers;
+            std::mutex retiredMtx;
+            std::vector<std::unique_ptr<Worker>> retired;   // removed workers that might still be running a task.
+            std::mutex globalMtx;
+            std::deque<Task> global[NLANES];
+            LaneInfo lanes[NLANES];
+            std::atomic<size_t> pending, running;
+            std::mutex sleepMtx;
+            std::condition_variable sleepCond, idleCond;
+            std::mutex errorMtx;
+            std::function<void(const std::string&)> errorHandler;
+
+        };
+
+
+        /*! @brief Tracks the tasks an owner (e.g. the Daemon or a Job) has submitted to an Executor.
+         *  @details The Executor is process-wide and outlives its users, so a task capturing a pointer to its owner must
+         *  not run after the owner is gone. The owner submits through its group, calls cancel() when stopping (tasks that
+         *  have not started yet are then skipped) and wait() before tearing down, which blocks until all submitted tasks are
+         *  finished or skipped. Long-running tasks can poll cancelled() to return early.
+         *  wait() called from one of the group's own tasks only waits for the other tasks.
+         */
+        class TaskGroup {
+
+        public:
+            explicit TaskGroup( Executor& ex=Executor::get() );
+            TaskGroup( const TaskGroup& ) = delete;
+            ~TaskGroup();                                   //!< cancel() and wait()
+
+            void submit( Executor::Lane, std::function<void(void)> );
+            template <typename F>
+            auto async( Executor::Lane lane, F&& f ) -> std::future<decltype(f())> {
+                auto task = std::make_shared<std::packaged_task<decltype(f())(void)>>( std::forward<F>(f) );
+                std::future<decltype(f())> ret = task->get_future();
+                submit( lane, [task](){ (*task)(); } );    // a skipped task leaves a broken promise in the future.
+                return ret;
+            }
+
+            void cancel( void );
+            void restart( void );                           //!< accept (and run) new tasks again after cancel().
+            bool cancelled( void ) const;
+            void wait( void );
+            size_t size( void ) const;                      //!< number of submitted tasks that are not finished yet.
+
+        private:
+            struct State {
+                std::mutex mtx;
+                std::condition_variable cond;
+                size_t count;
+                std::atomic<bool> cancelled;
+                State( void ) : count(0), cancelled(false) {}
+            };
+            Executor& ex;
+            std::shared_ptr<State> state;           // shared with the submitted tasks, so it outlives a group that was not waited for.
+
+        };
+
+    }   // util
+
+}   // redux
+
+
+#endif  // REDUX_UTIL_EXECUTOR_HPP
@@ -0,0 +1,99 @@
+#ifndef REDUX_UTIL_NUMA_HPP
+#define REDUX_UTIL_NUMA_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace redux {
+
+    namespace util {
+
+        /*! Minimal NUMA support (Linux only, the topology is read from /sys/devices/system/node).
+         *  Memory placement relies on the kernel's first-touch policy: a page is placed on the node of the
+         *  thread that first writes to it. So if a thread is pinned to a node, everything it allocates and
+         *  initializes will be local to that node.
+         *  If the topology can not be read, a single node containing all CPUs is assumed.
+         */
+        namespace numa {
+
+            struct NodeMem {
+                uint64_t total;         //!< bytes
+                uint64_t free;          //!< bytes
+            };
+
+            void enable( bool );
+            bool enabled( void );                           //!< true if enable(true) was called AND there is more than one node
+
+            size_t nNodes( void );
+            const std::vector<uint32_t>& cpus( size_t node );
+            int nodeOf( uint32_t cpu );                     //!< node of a CPU, -1 if unknown
+            int currentNode( void );                        //!< node of the CPU the calling thread is running on
+
+            /*! Restrict the calling thread to the CPUs of node (slot % nNodes()). Returns the node, or -1 on failure.
+             */
+            int pinThread( size_t slot );
+            void unpinThread( void );                       //!< Allow the calling thread to run on all CPUs again.
+            std::vector<uint32_t> threadCpus( void );       //!< CPUs the calling thread is allowed to run on.
+            bool setThreadCpus( const std::vector<uint32_t>& );
+
+            NodeMem memInfo( size_t node );                 //!< System-wide memory of a node (all processes)
+            std::vector<uint64_t> processMem( void );       //!< Bytes used by this process on each node (from /proc/self/numa_maps)
+            std::string memString( void );                  //!< "node0: process X, system used/total  node1: ..." for status replies
+
+            /*! A set of work-queues, one per node. Items are pushed before processing starts, and then popped
+             *  concurrently by worker tasks. A worker pops from its own node first, and steals from the other nodes
+             *  when that is empty, so all items get processed exactly once even if some node has no workers.
+             *  With NUMA disabled everything goes in queue 0, i.e. it degenerates to a shared atomic counter.
+             */
+            template <typename T>
+            class NodeQueue {
+            public:
+                NodeQueue( void ) : items( nNodes() ), next( new std::atomic<size_t>[nNodes()] ) {
+                    for( size_t n=0; n<items.size(); ++n ) next[n] = 0;
+                }
+                void push( int node, const T& item ) {
+                    if( node < 0 || !enabled() ) node = 0;
+                    items[ node % items.size() ].push_back( item );
+                }
+                void reset( void ) {                        //!< rewind, so that the same items can be processed again.
+                    for( size_t n=0; n<items.size(); ++n ) next[n] = 0;
+                }
+                void clear( void ) {
+                    for( auto& i: items ) i.clear();
+                    reset();
+                }
+                size_t size( void ) const {
+                    size_t ret(0);
+                    for( auto& i: items ) ret += i.size();
+                    return ret;
+                }
+                bool pop( int node, T& item ) {
+                    const size_t nQ = items.size();
+                    if( node < 0 ) node = 0;
+                    for( size_t n=0; n<nQ; ++n ) {
+                        size_t q = (node+n) % nQ;
+                        if( next[q] >= items[q].size() ) continue;
+                        size_t i = next[q]++;
+                        if( i < items[q].size() ) {
+                            item = items[q][i];
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+            private:
+                std::vector< std::vector<T> > items;
+                std::unique_ptr< std::atomic<size_t>[] > next;
+            };
+
+        }   // numa
+
+    }   // util
+
+}   // redux
+
+
+#endif  // REDUX_UTIL_NUMA_HPP
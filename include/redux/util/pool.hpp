@@ -0,0 +1,54 @@
+#ifndef REDUX_UTIL_POOL_HPP
+#define REDUX_UTIL_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace redux {
+
+    namespace util {
+
+        /*! @brief Size-class memory pool behind rdx_get_shared (and thereby Array).
+         *  @details Requests are rounded up to a size-class (64 byte steps up to 256 bytes, then 4 classes per power of
+         *  two, i.e. at most 25% overhead) and all blocks are 64-byte aligned.
+         *  Freed blocks go to a small per-thread cache (classes up to 1 MiB) and from there to a shared depot per class,
+         *  so the temporaries that are created over and over (patch-data, FFT buffers, network blocks) are recycled
+         *  instead of being returned to the system. The cached amount is limited by maxCached(), blocks that do not fit
+         *  and requests larger than the biggest class (256 MiB) go straight back to the system.
+         *  Blocks of 2 MiB or more are mmapped, and advised as transparent hugepages if useHugePages() is enabled.
+         */
+        class MemoryPool {
+
+        public:
+            struct Stats {
+                uint64_t inUse;             //!< bytes handed out (rounded to class size).
+                uint64_t requested;         //!< bytes asked for, inUse-requested is the rounding overhead.
+                uint64_t cached;            //!< bytes kept in the thread-caches and depot.
+                uint64_t system;            //!< bytes currently obtained from the system.
+                uint64_t peakSystem;
+                uint64_t hits, misses;      //!< allocations served from the caches/from the system.
+                uint64_t peakRSS;           //!< bytes, as reported by getrusage.
+            };
+
+            static void* allocate( size_t bytes );                  //!< throws std::bad_alloc
+            static void deallocate( void*, size_t bytes );          //!< bytes must be the same as for allocate()
+
+            static void trim( void );                               //!< return the depot and the caller's thread-cache to the system.
+            static void setMaxCached( size_t bytes );               //!< default = 1/8 of the physical memory.
+            static size_t maxCached( void );
+            static void useHugePages( bool );
+
+            static Stats stats( void );
+            static std::string print( void );                       //!< one-line summary, e.g. for the cacheinfo reply.
+
+            static const size_t alignment = 64;
+
+        };
+
+    }   // util
+
+}   // redux
+
+
+#endif  // REDUX_UTIL_POOL_HPP
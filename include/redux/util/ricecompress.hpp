@@ -13,6 +13,13 @@ namespace redux {
 
         int rice_comp16( const int16_t* in, size_t inSize, uint8_t* out, size_t outSize, size_t blockSize );
         int rice_decomp16( const uint8_t* in, size_t inSize, int16_t* out, size_t outSize, size_t blockSize );
+        
+        /*! Decoders for the Rice format as written by cfitsio (RICE_1 tiles), for 8, 16 and 32-bit data.
+         *  @returns 0 on success, -1 for a truncated/corrupt stream.
+         */
+        int rice_decomp( const uint8_t* in, size_t inSize, uint8_t* out, size_t outSize, size_t blockSize );
+        int rice_decomp( const uint8_t* in, size_t inSize, int16_t* out, size_t outSize, size_t blockSize );
+        int rice_decomp( const uint8_t* in, size_t inSize, int32_t* out, size_t outSize, size_t blockSize );
 
     }   // util
     
@@ -3,7 +3,9 @@
 
 #include "redux/types.hpp"
 #include "redux/util/cache.hpp"
+#include "redux/util/pool.hpp"
 
+#include <type_traits>
 #include <typeinfo>
 
 #define TRACE_BT_BUF_SIZE 100
@@ -120,14 +122,16 @@ namespace redux {
 
         };
         
+        /*! Shared array of n elements from the MemoryPool. Like fftw_malloc, the memory is not initialized unless T has a
+         *  non-trivial destructor, in which case the elements are default-constructed (and destructed on release).
+         */
         template <class T>
         std::shared_ptr<T> rdx_get_shared( size_t n ) {
+            T* tmp = reinterpret_cast<T*>( MemoryPool::allocate( n*sizeof(T) ) );
+            if( !std::is_trivially_destructible<T>::value ) {
+                for( size_t i=0; i<n; ++i ) new( tmp+i ) T();
+            }
 #ifdef RDX_TRACE_MEM
-#ifdef RDX_WITH_FFTW3
-            T* tmp = reinterpret_cast<T*>(fftw_malloc(n*sizeof(T)));
-#else
-            T* tmp = new T[n];
-#endif
             Cache::get<T*,trace::BT>(tmp);
             static Trace::trace_t& tt = Trace::addTraceObject( Cache::getID1<T*,trace::BT>(),
                                     std::bind(TraceObject<T>::getStats),
@@ -136,32 +140,18 @@ namespace redux {
                                     std::bind(TraceObject<T>::getTotalSize)
             );
             tt.totalCount++;
-            return std::shared_ptr<T>( tmp, []( T*& p ){
+#endif
+            return std::shared_ptr<T>( tmp, [n]( T*& p ){
+#ifdef RDX_TRACE_MEM
                 Cache::erase<T*,trace::BT>(p);
                 Trace::removeTraceObject( Cache::getID1<T*,trace::BT>());
-#ifdef RDX_WITH_FFTW3
-                fftw_free(p);
-#else
-                delete[] p;
 #endif
+                if( !std::is_trivially_destructible<T>::value ) {
+                    for( size_t i=0; i<n; ++i ) p[i].~T();
+                }
+                MemoryPool::deallocate( p, n*sizeof(T) );
                 p=nullptr;
             });
-#else
-            return std::shared_ptr<T>(
-#ifdef RDX_WITH_FFTW3
-                reinterpret_cast<T*>(fftw_malloc(n*sizeof(T))),
-#else
-                new T[n],
-#endif
-                []( T*& p ){
-#ifdef RDX_WITH_FFTW3
-                    fftw_free(p);
-#else
-                    delete[] p;
-#endif
-                    p=nullptr; }
-            );
-#endif
         }
 
     }   // util
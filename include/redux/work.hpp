@@ -2,12 +2,14 @@
 #define REDUX_WORK_HPP
 
 #include "redux/network/tcpconnection.hpp"
+#include "redux/util/bufferlist.hpp"
 #include "redux/util/cacheitem.hpp"
 
 #ifdef RDX_TRACE_PARTS
 #   include "redux/util/trace.hpp"
 #endif
 
+#include <deque>
 #include <memory>
 #include <vector>
 
@@ -53,6 +55,8 @@ namespace redux {
         virtual void load(void);
         virtual void unload(void);
         virtual void prePack( bool force=false ) {};
+        virtual double cost( void ) const { return 1.0; }                   //!< Relative processing cost, used when scheduling.
+        virtual double distance( const Part& ) const { return 0.0; }       //!< "Locality" w.r.t. another part of the same job (e.g. neighbouring patches).
         size_t csize(void) const override { return size(); };
         uint64_t cpack(char* p) const override { return pack(p); };
         uint64_t cunpack(const char* p, bool e) override { return unpack(p,e); };
@@ -85,9 +89,11 @@ namespace redux {
         uint64_t unpack(const char*, bool swap_endian=false);
         void reset(void);
         void resetParts(void);
-        uint64_t workSize(void);
-        uint64_t packWork(char*);
-        uint64_t unpackWork(const char*, std::shared_ptr<Job>& tmpJob, bool swap_endian=false );
+        void addParts(const WorkInProgress&);                               //!< append the parts of a prefetched unit
+        bool removeParts(const std::vector<uint64_t>& ids);                 //!< remove returned parts, false (and reset) if no work is left
+        uint64_t workSize(redux::util::BufferList* payload=nullptr);     //!< with a payload list, large arrays only count their headers (see packWork)
+        uint64_t packWork(char*, redux::util::BufferList* payload=nullptr);
+        uint64_t unpackWork(const char*, std::shared_ptr<Job>& tmpJob, bool swap_endian=false, redux::util::BufferList* payload=nullptr );
         void returnResults(void);
         bool operator<(const WorkInProgress& rhs) const;
         std::string print(void);
@@ -101,6 +107,26 @@ namespace redux {
     };
 
 
+    /*! @brief What the manager knows about a slave: the job it holds the global data (modes, pupils, etc.) for, the parts
+     *  most recently sent to it, and how fast it is. Used to pick work for that slave from the queue.
+     */
+    struct HostAffinity {
+        HostAffinity( void ) : jobID(0), secPerCost(0) {}
+        void update( size_t jobID, const WorkInProgress::Ptr& sent=nullptr );
+        void updateSpeed( const WorkInProgress::Ptr& returned, uint16_t hostThreads );
+        /*! Fast hosts get the most expensive parts first (so that no big patch is left for a slow host at the end of a
+         *  job), slow hosts stay with the job they have the global data for and take the cheaper parts. Ties are broken
+         *  by locality, and then by queue-order. With onlyJob, only parts from that job are considered.
+         */
+        std::deque<WorkInProgress::Ptr>::iterator pick( std::deque<WorkInProgress::Ptr>&, bool fastHost,
+                                                        const std::shared_ptr<Job>& onlyJob=nullptr ) const;
+        static bool isFast( double secPerCost, std::vector<double> speeds );     //!< faster than the median of the (measured) speeds
+        size_t jobID;
+        std::vector<Part::Ptr> recent;          //!< parts most recently sent to the slave.
+        double secPerCost;                      //!< measured host-seconds per Part::cost() unit (0 = not measured yet).
+    };
+
+
 
     /*! @} */
 
@@ -5,6 +5,8 @@
 #include "redux/job.hpp"
 #include "redux/work.hpp"
 
+#include <future>
+
 #include <boost/asio.hpp>
 #include <boost/bind/bind.hpp>
 #include <boost/program_options.hpp>
@@ -30,10 +32,13 @@ namespace redux {
 
     private:
 
-        bool fetchWork(void);
+        bool fetchWork( WorkInProgress::Ptr, bool isPrefetch=false );
+        void startPrefetch( void );
+        bool getPrefetched( void );
         
         bool getWork(void);
         void returnWork(void);
+        void sendCheckpoint( std::shared_ptr<char>, uint64_t );
         void returnJob(void);
         void returnResults(void);
         
@@ -46,7 +51,11 @@ namespace redux {
         std::atomic<bool> resetWhenDone_;
         
         WorkInProgress::Ptr wip;
+        WorkInProgress::Ptr prefetchWIP;                //!< the next work-unit, requested while wip is processed.
+        std::future<bool> prefetchResult;
         std::shared_ptr<Job> currentJob;
+        uint16_t unitSize;                              //!< number of parts to request per work-unit.
+        bool prefetch;
 
         Daemon& daemon;
         network::Host& myInfo;
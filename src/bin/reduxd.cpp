@@ -32,6 +32,25 @@ namespace {
         ( "max-running,R", po::value<uint32_t>()->implicit_value( 10 ), "max simultaneous ongoing jobs.")
         ( "max-transfers,T", po::value<uint32_t>()->implicit_value( 20 ), "max simultaneous data transfers.")
         ( "foreground,F", "Do not detach/background process.")
+        ( "fftw-rigor", po::value<string>()->default_value( "measure" ), "FFTW planner rigor (estimate/measure/patient)."
+          " FFTW wisdom is stored in cache-dir (if specified), so the planning cost is only paid once per host-type." )
+        ( "fftw-preplan", po::value<string>()->default_value( "" ), "Comma-separated list of (square) FFT sizes to plan at startup,"
+          " e.g. \"128,256\". Includes the batched OTF plans used by the momfbd solver (i.e. use 2*pupilSize)."
+          " Each size is planned with fftw-rigor, which can delay the startup by minutes for large sizes unless the"
+          " wisdom is already cached." )
+        ( "numa", "NUMA-aware processing: pin worker-threads to nodes and allocate per-thread storage and subimages"
+          " on the node where they are processed." )
+        ( "pool-cache", po::value<uint32_t>(), "Max amount of freed memory (in MiB) kept for re-use by the memory pool."
+          " Default is 1/8 of the physical memory." )
+        ( "hugepages", "Advise large (>= 2 MiB) pool blocks to be backed by transparent hugepages." )
+        ( "cache-budget", po::value<uint32_t>()->default_value( 2048 ), "Size (in MiB) above which unused FFT-plans, grids,"
+          " pupils and modes are evicted from the cache, least recently used first. 0 means no limit." )
+        ( "unit-size,U", po::value<uint16_t>()->default_value( 0 ), "Number of parts (patches) to request from the master per work-unit."
+          " 0 means auto, i.e. scaled with the number of threads." )
+        ( "no-prefetch", "Do not request the next work-unit while the current one is being processed." )
+        ( "codec", po::value<string>()->default_value( "auto" ), "Compression of work/results sent between master and slaves:"
+          " \"auto\" (best available), \"none\", or a comma-separated list of accepted codecs (zstd,lz4,zlib)."
+          " The codec is negotiated for each connection." )
         ;
 
         return options;
@@ -34,6 +34,7 @@ namespace {
         ( "count,c", bpo::value<int>()->implicit_value( 0 ), "List only n first slaves/jobs, and the last." )
         ( "time,t", bpo::value<int>()->implicit_value( 1 ), "Loop and display list every (n) seconds" )
         ( "runtime,r", bpo::value<int>()->implicit_value( 1 ), "Sort slaves according to runtime." )
+        ( "executor,x", "Show queue-depths/latencies of the executor lanes of the master." )
         ;
 
         return options;
@@ -131,6 +132,26 @@ void printJobList( TcpConnection::Ptr conn, int nj ) {
 }
 
 
+void printExecutorStats( TcpConnection::Ptr conn ) {
+
+    uint8_t cmd = CMD_EXSTAT;
+    boost::asio::write(conn->socket(),boost::asio::buffer(&cmd,1));
+
+    uint64_t blockSize;
+    shared_ptr<char> buf = conn->receiveBlock( blockSize );
+
+    if ( !blockSize ) return;
+
+    string stats;
+    uint64_t count = unpack( buf.get(), stats );
+    if( count != blockSize ) {
+        cerr << "printExecutorStats: Parsing of datablock failed, count = " << count << "  blockSize = " << blockSize << "  bytes." << endl;
+    }
+    cout << stats << endl;
+
+}
+
+
 namespace {
     
     enum{ by_name=1, by_runtime };
@@ -238,7 +259,7 @@ int main( int argc, char *argv[] ) {
                 return EXIT_FAILURE;
             }
             int maxItems = 0;
-            int hasFlags = vm.count( "jobs" ) + vm.count( "slaves" );
+            int hasFlags = vm.count( "jobs" ) + vm.count( "slaves" ) + vm.count( "executor" );
             if( vm.count( "count" ) ) maxItems = vm["count"].as<int>();
             int maxJobs = maxItems;
             if( vm.count( "jobs" ) ) maxJobs = vm["jobs"].as<int>();
@@ -250,11 +271,13 @@ int main( int argc, char *argv[] ) {
             if( vm.count( "runtime" ) ) sorting = by_runtime;
             if( vm.count( "slaves" ) ) maxSlaves = vm["slaves"].as<int>();
             if( vm.count( "slaves" ) || !hasFlags ) printPeerList( conn, maxSlaves, sorting );
+            if( vm.count( "executor" ) ) printExecutorStats( conn );
             while( loop ) {
                 sleep(vm["time"].as<int>());
                 if( vm.count( "jobs" ) || !hasFlags ) printJobList( conn, maxJobs );
                 if( hasFlags != 1 ) cout << endl;
                 if( vm.count( "slaves" ) || !hasFlags ) printPeerList( conn, maxSlaves, sorting );
+                if( vm.count( "executor" ) ) printExecutorStats( conn );
             }
         } else {
             cout << "Connection failed: " << vm["master"].as<string>() << ":" << vm["port"].as<string>() << endl;
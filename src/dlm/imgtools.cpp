@@ -7,6 +7,7 @@
 #include "redux/image/image.hpp"
 #include "redux/image/descatter.hpp"
 #include "redux/image/fouriertransform.hpp"
+#include "redux/image/pixelfiller.hpp"
 #include "redux/image/utils.hpp"
 #include "redux/util/array.hpp"
 #include "redux/util/datautil.hpp"
@@ -1496,7 +1497,6 @@ IDL_VPTR rdx_fillpix( int argc, IDL_VPTR* argv, char* argk ) {
     // We now have a mask, so allow all numerical values to be filled as dictated by mask.
     kw.thres = std::numeric_limits<float>::max();
 
-    namespace sp = std::placeholders;
     UCHAR dataType = images->type;
     IDL_VPTR ret;
     char* retData = IDL_MakeTempArray( dataType, images->value.arr->n_dim, images->value.arr->dim, IDL_ARR_INI_NOP, &ret );
@@ -1512,60 +1512,28 @@ IDL_VPTR rdx_fillpix( int argc, IDL_VPTR* argv, char* argk ) {
     
     try {
             
+        PixelFiller filler( ySize, xSize, *mask2D.get() );
+        PixelFiller::Method method = kw.horint ? PixelFiller::HORINT : PixelFiller::IDW;
+        unsigned int nThreads = kw.nthreads;        // already clamped to [1,hardware_concurrency]
         switch( dataType ) {
             case( IDL_TYP_BYTE ): {
-                auto data = reinterpret_cast<UCHAR*>( retData );
-                auto images2D = reshapeArray( data, ySize, xSize );
-                auto arrayPtr = images2D.get();
-                function<double (size_t, size_t) > func = bind (inverseDistanceWeight<UCHAR>, arrayPtr, ySize, xSize, sp::_1, sp::_2);
-                if( kw.horint ) {
-                    func = bind (horizontalInterpolation<UCHAR>, arrayPtr, ySize, xSize, sp::_1, sp::_2);
-                }
-                fillPixels (arrayPtr, ySize, xSize, func, std::bind(std::less_equal<double>(), sp::_1, kw.thres), mask2D.get());
+                filler.fill( reinterpret_cast<UCHAR*>( retData ), kw.thres, method, true, nThreads );
                 break;
             }
             case( IDL_TYP_INT ): {
-                auto data = reinterpret_cast<IDL_INT*>( retData );
-                auto images2D = reshapeArray( data, ySize, xSize );
-                auto arrayPtr = images2D.get();
-                function<double (size_t, size_t) > func = bind (inverseDistanceWeight<IDL_INT>, arrayPtr, ySize, xSize, sp::_1, sp::_2);
-                if( kw.horint ) {
-                    func = bind (horizontalInterpolation<IDL_INT>, arrayPtr, ySize, xSize, sp::_1, sp::_2);
-                }
-                fillPixels (arrayPtr, ySize, xSize, func, std::bind(std::less_equal<double>(), sp::_1, kw.thres), mask2D.get());
+                filler.fill( reinterpret_cast<IDL_INT*>( retData ), kw.thres, method, true, nThreads );
                 break;
             }
             case( IDL_TYP_LONG ): {
-                auto data = reinterpret_cast<IDL_LONG*>( retData );
-                auto images2D = reshapeArray( data, ySize, xSize );
-                auto arrayPtr = images2D.get();
-                function<double (size_t, size_t) > func = bind (inverseDistanceWeight<IDL_LONG>, arrayPtr, ySize, xSize, sp::_1, sp::_2);
-                if( kw.horint ) {
-                    func = bind (horizontalInterpolation<IDL_LONG>, arrayPtr, ySize, xSize, sp::_1, sp::_2);
-                }
-                fillPixels (arrayPtr, ySize, xSize, func, std::bind(std::less_equal<double>(), sp::_1, kw.thres), mask2D.get());
+                filler.fill( reinterpret_cast<IDL_LONG*>( retData ), kw.thres, method, true, nThreads );
                 break;
             }
             case( IDL_TYP_FLOAT ): {
-                auto data = reinterpret_cast<float*>( retData );
-                auto images2D = reshapeArray( data, ySize, xSize );
-                auto arrayPtr = images2D.get();
-                function<double (size_t, size_t) > func = bind (inverseDistanceWeight<float>, arrayPtr, ySize, xSize, sp::_1, sp::_2);
-                if( kw.horint ) {
-                    func = bind (horizontalInterpolation<float>, arrayPtr, ySize, xSize, sp::_1, sp::_2);
-                }
-                fillPixels (arrayPtr, ySize, xSize, func, std::bind(std::less_equal<double>(), sp::_1, kw.thres), mask2D.get());
+                filler.fill( reinterpret_cast<float*>( retData ), kw.thres, method, true, nThreads );
                 break;
             }
             case( IDL_TYP_DOUBLE ): {
-                auto data = reinterpret_cast<double*>( retData );
-                auto images2D = reshapeArray( data, ySize, xSize );
-                auto arrayPtr = images2D.get();
-                function<double (size_t, size_t) > func = bind (inverseDistanceWeight<double>, arrayPtr, ySize, xSize, sp::_1, sp::_2);
-                if( kw.horint ) {
-                    func = bind (horizontalInterpolation<double>, arrayPtr, ySize, xSize, sp::_1, sp::_2);
-                }
-                fillPixels( arrayPtr, ySize, xSize, func, std::bind(std::less_equal<double>(), sp::_1, kw.thres), mask2D.get());
+                filler.fill( reinterpret_cast<double*>( retData ), kw.thres, method, true, nThreads );
                 break;
             }
             default: ;
@@ -6,19 +6,26 @@
 
 #include "redux/logging/logger.hpp"
 #include "redux/momfbd/momfbdjob.hpp"
+#include "redux/momfbd/solver.hpp"
 #include "redux/network/protocol.hpp"
 #include "redux/util/arrayutil.hpp"
+#include "redux/util/codec.hpp"
 #include "redux/util/datautil.hpp"
 #include "redux/util/endian.hpp"
+#include "redux/util/executor.hpp"
+#include "redux/util/numa.hpp"
+#include "redux/util/pool.hpp"
 #include "redux/util/stopwatch.hpp"
 #include "redux/util/stringutil.hpp"
 #include "redux/util/trace.hpp"
 #include "redux/translators.hpp"
 #include "redux/image/cachedfile.hpp"
+#include "redux/image/fouriertransform.hpp"
 #include "redux/revision.hpp"
 #include "redux/version.hpp"
 
 #include <functional>
+#include <limits>
 #include <sys/resource.h> 
 
 #include <boost/asio/time_traits.hpp>
@@ -74,6 +81,32 @@ Daemon::Daemon( po::variables_map& vm ) : Application( vm, LOOP ), params( vm ),
         auto & c = Cache::get();
         c.setPath( params["cache-dir"].as<string>() );
     }
+    
+    initFFTW();
+    
+    if( params.count("codec") ) {
+        try {
+            myInfo.info.codecs = codec::parse( params["codec"].as<string>() );
+        } catch( const exception& e ) {
+            LOG_ERR << e.what() << ", using the default codecs." << ende;
+            myInfo.info.codecs = codec::available();
+        }
+    }
+    
+    if( params.count("numa") ) {
+        numa::enable( true );
+        LOG_DETAIL << "NUMA-mode " << (numa::enabled()?"enabled: ":"requested, but not available: ") << numa::memString() << ende;
+    }
+
+    if( params.count("pool-cache") ) {
+        MemoryPool::setMaxCached( size_t(params["pool-cache"].as<uint32_t>()) << 20 );
+    }
+    if( params.count("hugepages") ) {
+        MemoryPool::useHugePages( true );
+    }
+    if( params.count("cache-budget") ) {
+        Cache::get().setBudget( size_t(params["cache-budget"].as<uint32_t>()) << 20 );
+    }
 
     if( params.count("max-running") ) {
         uint32_t maxRunning = params["max-running"].as<uint32_t>();
@@ -84,9 +117,74 @@ Daemon::Daemon( po::variables_map& vm ) : Application( vm, LOOP ), params( vm ),
 }
 
 
+void Daemon::initFFTW( void ) {
+    
+    using redux::image::FourierTransform;
+    
+    if( params.count("fftw-rigor") ) {
+        try {
+            FourierTransform::Plan::setRigor( params["fftw-rigor"].as<string>() );
+        } catch( const exception& e ) {
+            LOG_ERR << e.what() << ende;
+        }
+    }
+    
+    string cacheDir = Cache::get().path();
+    if( !cacheDir.empty() ) {
+        FourierTransform::Plan::setWisdomDir( cacheDir );
+    }
+    
+    if( params.count("fftw-preplan") ) {
+        vector<uint32_t> sizes;
+        try {
+            sizes = stringToUInts<uint32_t>( params["fftw-preplan"].as<string>() );
+        } catch( const exception& e ) {
+            LOG_ERR << "Failed to parse fftw-preplan: " << e.what() << ende;
+        }
+        if( !sizes.empty() ) {
+            using redux::momfbd::thread::TmpStorage;
+            StopWatch sw;
+            const unsigned rigor = FourierTransform::Plan::rigor();
+            for( auto& sz: sizes ) {
+                if( sz < 2 ) continue;
+                StopWatch sw2;
+                FourierTransform::Plan::get( sz, sz, FourierTransform::Plan::R2C );
+                FourierTransform::Plan::get( sz, sz, FourierTransform::Plan::C2C );
+                // the batched plans used by Solver::setOTFs, full batches are planned with the configured rigor.
+                FourierTransform::Plan::get( sz, sz, FourierTransform::Plan::C2C, 1, TmpStorage::batchSize );
+                FourierTransform::Plan::get( sz, sz, FourierTransform::Plan::R2C, 1, TmpStorage::batchSize );
+#ifdef HAVE_FFTW3F
+                FourierTransform::Plan::get( sz, sz, FourierTransform::Plan::C2C_F, 1, TmpStorage::batchSize );
+                FourierTransform::Plan::get( sz, sz, FourierTransform::Plan::R2C_F, 1, TmpStorage::batchSize );
+#endif
+                // The last batch of a channel can have any size below batchSize. It is only used once per
+                // iteration, and the image count is not known until a job arrives, so just estimate those.
+                FourierTransform::Plan::setRigor( FFTW_ESTIMATE );
+                for( uint32_t nBlocks=1; nBlocks < TmpStorage::batchSize; ++nBlocks ) {
+                    FourierTransform::Plan::get( sz, sz, FourierTransform::Plan::C2C, 1, nBlocks );
+                    FourierTransform::Plan::get( sz, sz, FourierTransform::Plan::R2C, 1, nBlocks );
+#ifdef HAVE_FFTW3F
+                    FourierTransform::Plan::get( sz, sz, FourierTransform::Plan::C2C_F, 1, nBlocks );
+                    FourierTransform::Plan::get( sz, sz, FourierTransform::Plan::R2C_F, 1, nBlocks );
+#endif
+                }
+                FourierTransform::Plan::setRigor( rigor );
+                LOG_DETAIL << "Pre-planned FFTs for size " << sz << " in " << sw2.print() << ende;
+            }
+            FourierTransform::Plan::saveWisdom();
+            LOG_DETAIL << "Pre-planned FFTs, " << printArray( sizes, "sizes" ) << " in " << sw.print() << ende;
+        }
+    }
+    
+}
+
+
 Daemon::~Daemon( void ) {
+    Executor::get().setErrorHandler( nullptr );     // the Executor outlives the logger.
     cleanup();
     Daemon::stop();
+    pool.join_all();
+    if( prepareThread.joinable() ) prepareThread.join();
 }
 
 
@@ -137,7 +235,7 @@ void Daemon::reset( void ) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
         stop_server();
         worker.stop();
-        runMode = RESET;
+        tasks.cancel();
         logger.flushAll();
         if( myMaster.conn && myMaster.conn->socket().is_open() ) {
             *myMaster.conn << CMD_DISCONNECT;
@@ -146,6 +244,7 @@ void Daemon::reset( void ) {
         }
         ioContext.stop();
         pool.interrupt_all();
+        runMode = RESET;        // last: doWork returns, and the daemon is destroyed, after this.
     }).detach();
     
 }
@@ -156,6 +255,7 @@ void Daemon::stop( void ) {
     LOG << "Stopping daemon." << ende;
     stop_server();
     worker.stop();
+    redux::image::FourierTransform::Plan::saveWisdom();
     runMode = EXIT;
     logger.flushAll();
     if( myMaster.conn && myMaster.conn->socket().is_open() ) {
@@ -165,6 +265,8 @@ void Daemon::stop( void ) {
     }
     ioContext.stop();
     pool.interrupt_all();
+    tasks.cancel();
+    tasks.wait();
     
 }
 
@@ -177,6 +279,8 @@ void Daemon::maintenance( void ) {
     updateLoadAvg();
     checkSwapSpace();
     cleanup();
+    Cache::trim();
+    redux::image::FourierTransform::Plan::saveWisdom();        // only writes if new plans were created
     //checkCurrentUsage();
     
 
@@ -197,7 +301,7 @@ void Daemon::maintenance( void ) {
         lock_guard<mutex> qlock( wip_queue_mtx );
         size_t nQ = std::min<size_t>( wip_queue.size(), outTransfers.count() );
         if( nQ ) {
-            boost::asio::post(ioContext,  std::bind( &Daemon::pokeSlaves, this, nQ ));
+            tasks.submit( Executor::NET, std::bind( &Daemon::pokeSlaves, this, nQ ) );
         }
     }
     
@@ -300,7 +404,7 @@ bool Daemon::doWork( void ) {
             
             check_limits();
             
-            std::thread( std::bind( &Daemon::prepareWork, this ) ).detach();
+            prepareThread = std::thread( std::bind( &Daemon::prepareWork, this ) );
 
         } else if( dbg ) {
             uint16_t oport=port;
@@ -315,8 +419,13 @@ bool Daemon::doWork( void ) {
         timer.expires_from_now( boost::posix_time::seconds( 5 ) );
         timer.async_wait( boost::bind( &Daemon::maintenance, this ) );
 
-        // Add some threads for the async work.
-        addThread( thread::hardware_concurrency() );
+        // The io_context only runs the (short) network handlers, blocking/CPU-bound tasks go to the executor.
+        // Split the cores between them, rather than giving each of them a full set of threads.
+        const size_t nCores = std::max<size_t>( thread::hardware_concurrency(), 2 );
+        const size_t nIoThreads = std::max<size_t>( nCores/4, 2 );
+        addThread( nIoThreads+1 );      // +1 for Worker::run, which occupies a thread while processing.
+        resizeExecutor( nCores - std::min( nCores, nIoThreads ) );
+        Executor::get().setErrorHandler( [this]( const string& msg ){ LOG_ERR << msg << ende; } );
         
         LOG_DEBUG << "Initializing worker." << ende;
         if( workerInit() ) {
@@ -324,9 +433,13 @@ bool Daemon::doWork( void ) {
         }
         LOG_DEBUG << "Running the asio service." << ende;
         // 
-        while( (runMode == LOOP) || preparing_local || preparing_remote ) {
+        while( runMode == LOOP ) {
             std::this_thread::sleep_for( std::chrono::milliseconds(100) );
         }
+        if( prepareThread.joinable() ) prepareThread.join();
+        tasks.cancel();
+        tasks.wait();                   // let started preparations finish, queued ones are skipped.
+        preparing_local = preparing_remote = 0;
         pool.join_all();
         myInfo.info.peerType = 0;
         worker.stop();
@@ -428,6 +541,8 @@ void Daemon::connect( network::Host::HostInfo& host, network::TcpConnection::Ptr
                 *conn << myInfo.info;
                 *conn >> tmpHost.info;
                 *conn >> cmd;       // ok or err
+                conn->setCodec( codec::negotiate( myInfo.info.codecs, tmpHost.info.codecs ) );
+                myInfo.status.codec = conn->getCodec();
             }
             if( cmd != CMD_OK ) {
                 LOG_ERR << "Handshake with master failed  (server replied: " << cmd << ")" << ende;
@@ -455,6 +570,8 @@ void Daemon::updateStatus( void ) {
 #ifdef DEBUG_
             LOG_TRACE << "Sending statusupdate to server" << ende;
 #endif
+            myInfo.status.netOut = conn->stats( true );
+            myInfo.status.netIn = conn->stats( false );
             size_t blockSize = myInfo.status.size();
             size_t totSize = blockSize + sizeof( size_t ) + 1;
             shared_ptr<char> buf = rdx_get_shared<char>( totSize );
@@ -600,9 +717,11 @@ void Daemon::processCommand( TcpConnection::Ptr conn, uint8_t cmd, bool urgent )
             case CMD_GET_WORK: sendWork(conn); break;
             case CMD_GET_JOBLIST: sendJobList(conn); break;
             case CMD_PUT_PARTS: putParts(conn); break;
+            case CMD_PUT_CHECKPOINT: putCheckpoint(conn); break;
             case CMD_STAT: updateHostStatus(conn); break;
             case CMD_JSTAT: sendJobStats(conn); break;
             case CMD_PSTAT: sendPeerList(conn); break;
+            case CMD_EXSTAT: sendExecutorStats(conn); break;
             case CMD_LOG_CONNECT: addToLog(conn); break;
             case CMD_DISCONNECT: removeConnection(conn); break;
             case CMD_LISTEN: listen(); break;
@@ -696,10 +815,14 @@ void Daemon::cleanup( void ) {
                 peerWIP.erase(wipit++);            // N.B iterator is invalidated on erase, so the postfix increment is necessary.
             } else ++wipit;
         }
+        for( auto it=hostAffinity.begin(); it != hostAffinity.end(); ) {
+            if( !peers.count( it->first ) ) hostAffinity.erase(it++);
+            else ++it;
+        }
     }
     for( auto& wip: timedOutWIPs ) failedWIP( wip );
     
-    std::thread( [&](){
+    tasks.submit( Executor::IO, [this](){
         vector<Job::JobPtr> deletedJobs;        // will clear/reset jobs when the vector goes out of scope.
         {
             unique_lock<mutex> lock( jobsMutex );
@@ -714,8 +837,8 @@ void Daemon::cleanup( void ) {
             }
             jobs.erase( std::remove_if(jobs.begin(), jobs.end(), [](const shared_ptr<Job>& j){ return !j; }), jobs.end() );
         }
-        // here deletedJobs will be destructed, and the jobs cleaned up. This might take a while, so we do it in a detached thread.
-    }).detach();
+        // here deletedJobs will be destructed, and the jobs cleaned up. This might take a while, so we do it in the IO lane.
+    });
     
     cleanupThreads();
     
@@ -731,7 +854,7 @@ void Daemon::failedWIP( WorkInProgress::Ptr wip ) {
             job->failWork( wip );
             for( auto& part: wip->parts ) {
                 if( part ) {
-                    boost::asio::post(ioContext,  [part](){
+                    Executor::get().submit( Executor::IO, [part](){
                         part->cacheLoad();
                         part->cacheStore(true);
                     });
@@ -938,7 +1061,7 @@ void Daemon::failJobs( string jobString ) {
 
 void Daemon::removeJobs( const vector<size_t>& jobList ) {
 
-    std::thread( [&](){
+    tasks.submit( Executor::IO, [this,jobList](){
         std::set<size_t> jobSet( jobList.begin(), jobList.end() );
         vector<Job::JobPtr> removedJobs;
         unique_lock<mutex> lock( jobsMutex );
@@ -950,8 +1073,8 @@ void Daemon::removeJobs( const vector<size_t>& jobList ) {
                     }
                     return false;
                 }), jobs.end() );
-        // here removedJobs will be destructed, and the jobs cleaned up. This might take a while, so we do it in a detached thread.
-    }).detach();
+        // here removedJobs will be destructed, and the jobs cleaned up. This might take a while, so we do it in the IO lane.
+    });
     
 }
 
@@ -1050,7 +1173,7 @@ void Daemon::removeJobs( TcpConnection::Ptr& conn ) {
         }
 
         if( removedJobs.size() ) {
-            std::thread( [&,removedJobs](){
+            tasks.submit( Executor::NET, [this,removedJobs](){
                 for( auto &j: removedJobs ) {
                     if( !j ) continue;
                     lock_guard<mutex> plock( peerMutex );
@@ -1067,8 +1190,8 @@ void Daemon::removeJobs( TcpConnection::Ptr& conn ) {
                         }
                     }
                 }
-                // here removedJobs will be destructed, and the jobs cleaned up. This might take a while, so we do it in a detached thread.
-            }).detach();
+                // here removedJobs will be destructed, and the jobs cleaned up. This might take a while, so we do it in the executor.
+            });
         }
     }
 
@@ -1371,6 +1494,17 @@ void Daemon::interactiveCB( TcpConnection::Ptr conn ) {
                         server->cleanup();
                     }
                     replyStr = to_string( server->nThreads() );
+                } else if( cmdStr == "executor" ) {
+                    string argStr = popword(line);
+                    if( !argStr.empty() ) {
+                        int nThreads = boost::lexical_cast<int>(argStr);      // N.B. lexical_cast<unsigned> would accept "-1"
+                        const int maxThreads = 16*std::max<int>( thread::hardware_concurrency(), 1 );
+                        if( nThreads < 2 || nThreads > maxThreads ) {
+                            throw out_of_range( "the number of executor threads must be in the range [2," + to_string(maxThreads) + "]" );
+                        }
+                        resizeExecutor( nThreads );
+                    }
+                    replyStr = Executor::get().print();
                 } else if( cmdStr == "ws" ) {
                     string argStr = popword(line);
                     bool details(false);
@@ -1385,6 +1519,8 @@ void Daemon::interactiveCB( TcpConnection::Ptr conn ) {
                         myInfo.status.nThreads = nThreads;
                     }
                     replyStr = to_string( myInfo.status.nThreads );
+                } else if( cmdStr == "numa" ) {
+                    replyStr = numa::memString();
                 } else if( cmdStr == "tracestats" ) {
                     replyStr = Trace::getStats();
                 } else if( cmdStr == "trace-bt" ) {
@@ -1511,6 +1647,31 @@ void Daemon::updateWIP( const network::Host::Ptr& host, WorkInProgress::Ptr& wip
 }
 
 
+void Daemon::mergeWIP( const network::Host::Ptr& host, const WorkInProgress::Ptr& wip ) {
+
+    if( host && wip ) {         // add the parts of a prefetched work-unit to what the host is already working on.
+        unique_lock<mutex> lock( peerMutex );
+        WorkInProgress::Ptr& hostWIP = peerWIP[ host ];
+        if( !hostWIP || hostWIP->parts.empty() ) {
+            hostWIP = wip;
+            return;
+        }
+        hostWIP->addParts( *wip );      // N.B. keeps workStarted, the host is still working on the oldest unit.
+    }
+
+}
+
+
+void Daemon::releaseParts( const WorkInProgress::Ptr& wip, const vector<uint64_t>& ids ) {
+
+    if( wip ) {                 // remove returned parts, the rest (i.e. a prefetched unit) is still being processed by the host.
+        unique_lock<mutex> lock( peerMutex );
+        wip->removeParts( ids );
+    }
+
+}
+
+
 void Daemon::sendWork( TcpConnection::Ptr conn ) {
 
     shared_ptr<char> data;
@@ -1519,33 +1680,58 @@ void Daemon::sendWork( TcpConnection::Ptr conn ) {
     
     THREAD_MARK
     uint32_t oldJobID(0);
-    *conn >> oldJobID;
+    uint16_t unitSize(1);
+    uint8_t prefetch(0);
+    *conn >> oldJobID >> unitSize >> prefetch;
+    if( conn->getSwapEndian() ) {
+        swapEndian( oldJobID );
+        swapEndian( unitSize );
+    }
+    unitSize = std::max<uint16_t>( unitSize, 1 );
     
     WorkInProgress::Ptr wip(nullptr);
+    BufferList payload;                     // image data, sent directly from the arrays after the packed block.
     THREAD_MARK
     Host::Ptr host = getHost( conn );
     THREAD_MARK
     if( host ) {
-        host->limbo();
+        updateAffinity( host, oldJobID );           // the slave holds the global data for this job.
+        Job::JobPtr hostJob;
+        if( prefetch ) {        // the host is still busy, a prefetched unit has to be from the same job.
+            hostJob = getWIP( host )->job.lock();
+        } else host->limbo();
         Semaphore::Scope ss( outTransfers, 5 ); // if we 're not allowed a transfer-slot in 5 secs, idle slave & try later.
-        if( ss && getWork( wip, true ) ) {
+        if( ss && (!prefetch || hostJob) && getWork( wip, true, hostJob, host ) ) {
             host->active();
-            updateWIP( host, wip );
+            Job::JobPtr job = wip->job.lock();
+            if( job ) updateAffinity( host, job->info.id, wip );
+            for( uint16_t i=1; job && (i < unitSize); ++i ) {       // fill up the work-unit with queued parts from the same job.
+                WorkInProgress::Ptr extra(nullptr);
+                if( !getWork( extra, true, job, host ) ) break;
+                updateAffinity( host, job->info.id, extra );
+                for( auto& part: extra->parts ) {
+                    if( part && (std::find( wip->parts.begin(), wip->parts.end(), part ) == wip->parts.end()) ) {
+                        wip->parts.push_back( part );
+                    }
+                }
+                putIdleWIP( extra );
+            }
+            if( prefetch ) mergeWIP( host, wip );
+            else updateWIP( host, wip );
             if( wip ) {
-                Job::JobPtr job = wip->job.lock();
                 if( job ) {
                     wip->jobID = oldJobID;
-                    uint64_t blockSize = wip->workSize() + sizeof(uint64_t);
-                    host->status.statusString = alignLeft(to_string(job->info.id) + ":" + to_string(wip->parts[0]->id),8) + " ...";
+                    uint64_t blockSize = wip->workSize( &payload ) + sizeof(uint64_t);      // only the metadata, the image data is sent from payload
+                    if( !prefetch ) host->status.statusString = alignLeft(to_string(job->info.id) + ":" + to_string(wip->parts[0]->id),8) + " ...";
                     host->active();
                     data = rdx_get_shared<char>( blockSize );
                     char* ptr = data.get()+sizeof(uint64_t);
-                    count += wip->packWork( ptr+count );
-                    std::thread([wip](){
+                    count += wip->packWork( ptr+count, &payload );
+                    Executor::get().submit( Executor::IO, [wip](){
                         for( auto& part: wip->parts ) {
                             part->unload();
                         }
-                    }).detach();
+                    });
                     wip->jobID = job->info.id;
                 }
             } else {
@@ -1556,13 +1742,17 @@ void Daemon::sendWork( TcpConnection::Ptr conn ) {
     THREAD_MARK
         
     if( count ) {
+        uint64_t rawCount = count;
+        if( conn->getCodec() != codec::NONE ) {
+            data = conn->encode( data.get()+sizeof(uint64_t), count, sizeof(uint64_t) );
+        }
         pack( data.get(), count );         // Store actual packed bytecount (something might be compressed)
-        LOG_DETAIL << "Sending work to " << host->info.name << ":" << host->info.pid << "   " << wip->print()
-                   << "  (size=" << count << ")" << ende;
-        conn->syncWrite( data.get(), count+sizeof(uint64_t) );
+        LOG_DETAIL << "Sending " << (prefetch?"prefetched ":"") << "work to " << host->info.name << ":" << host->info.pid
+                   << "   " << wip->print() << "  (size=" << rawCount << "+" << payload.size() << ")" << ende;
+        conn->writeGathered( data.get(), count+sizeof(uint64_t), payload );
     } else {
         conn->syncWrite(count);
-        host->idle();
+        if( host && !prefetch ) host->idle();
     }
     THREAD_UNMARK
 
@@ -1582,33 +1772,60 @@ void Daemon::putParts( TcpConnection::Ptr conn ) {
         if( blockSize ) {
             WorkInProgress::Ptr wip = getWIP( host );
             msg += "   " + wip->print();
-            //std::thread([this,wip,buf,endian,msg](){
-            boost::asio::post(ioContext, [this,wip,buf,endian,msg](){
             THREAD_MARK
-                THREAD_MARK
-                WorkInProgress::Ptr tmpwip = getIdleWIP();
-                WorkInProgress::Ptr wip_bak = getIdleWIP();
-                std::shared_ptr<Job> tmpJob = wip->job.lock();
+            WorkInProgress::Ptr tmpwip = getIdleWIP();
+            WorkInProgress::Ptr wip_bak = getIdleWIP();
+            std::shared_ptr<Job> tmpJob = wip->job.lock();
+            {
+                unique_lock<mutex> lock( peerMutex );       // parts can be added by mergeWIP
                 *wip_bak = *wip;
                 *tmpwip = *wip;
-                wip_bak->job = tmpJob;
-                tmpwip->job = tmpJob;
-                wip->reset();
-                THREAD_MARK
+            }
+            wip_bak->job = tmpJob;
+            tmpwip->job = tmpJob;
+            THREAD_MARK
+            try {
+                // The metadata is unpacked here, so that the image data can be received directly into the arrays.
+                BufferList payload;
                 try {
-                    tmpwip->unpackWork( buf.get(), tmpJob, endian );
-                    tmpwip->returnResults();   // TBD: should this step be async/by manager?
-                    returnWork( tmpwip );
-                    LOG_DETAIL << msg << ende;
-                } catch ( exception& e ) {
-                    LOG_ERR << "putParts:  exception when unpacking results: " << e.what() << ende;
-                    failedWIP( wip_bak );
+                    if( conn->getCodec() != codec::NONE ) {
+                        buf = conn->decode( buf, blockSize );
+                    }
+                    tmpwip->unpackWork( buf.get(), tmpJob, endian, &payload );
+                } catch( ... ) {
+                    conn->skipPayload();                    // keep the connection in sync
+                    throw;
                 }
+                conn->receivePayload( payload );
+                tasks.submit( Executor::IO, [this,host,wip,tmpwip,wip_bak,msg](){
+                    THREAD_MARK
+                    try {
+                        vector<uint64_t> returnedIDs;
+                        for( auto& part: tmpwip->parts ) {
+                            if( part ) returnedIDs.push_back( part->id );
+                        }
+                        updateSpeed( host, tmpwip );
+                        tmpwip->returnResults();   // TBD: should this step be async/by manager?
+                        returnWork( tmpwip );
+                        releaseParts( wip, returnedIDs );      // N.B. the host might still be working on a prefetched unit.
+                        LOG_DETAIL << msg << ende;
+                    } catch ( exception& e ) {
+                        LOG_ERR << "putParts:  exception when storing results: " << e.what() << ende;
+                        failedWIP( wip_bak );
+                        wip->reset();
+                    }
+                    putIdleWIP( tmpwip );
+                    putIdleWIP( wip_bak );
+                    THREAD_UNMARK
+                });
+            } catch ( exception& e ) {
+                LOG_ERR << "putParts:  exception when unpacking results: " << e.what() << ende;
+                failedWIP( wip_bak );
+                wip->reset();
                 putIdleWIP( tmpwip );
                 putIdleWIP( wip_bak );
-            });
-            //}).detach();
-                THREAD_UNMARK
+            }
+            THREAD_UNMARK
         } else {
             LOG_TRACE << "Received unexpected results. The Host/Job probably timed out." << ende;
             //throw logic_error("Received results from unexpected host. It probably timed out.");
@@ -1622,6 +1839,35 @@ void Daemon::putParts( TcpConnection::Ptr conn ) {
 }
 
 
+void Daemon::putCheckpoint( TcpConnection::Ptr conn ) {
+    
+    Command ret = CMD_ERR;
+    Host::Ptr host = server->getHost( conn );
+    size_t blockSize;
+    shared_ptr<char> buf = conn->receiveBlock( blockSize );
+    if( host && blockSize ) {
+        WorkInProgress::Ptr wip = getIdleWIP();
+        WorkInProgress::Ptr hostWIP = getWIP( host );
+        {
+            unique_lock<mutex> lock( peerMutex );       // parts can be added by mergeWIP
+            *wip = *hostWIP;
+        }
+        Job::JobPtr job = hostWIP->job.lock();
+        if( job ) {
+            try {
+                job->putCheckpoint( wip, buf.get(), blockSize, conn->getSwapEndian() );
+                ret = CMD_OK;
+            } catch ( exception& e ) {
+                LOG_ERR << "putCheckpoint:  exception when unpacking checkpoint: " << e.what() << ende;
+            }
+        }
+        putIdleWIP( wip );
+    }
+    *conn << ret;
+    
+}
+
+
 void Daemon::sendJobList( TcpConnection::Ptr& conn ) {
 
     unique_lock<mutex> lock( jobsMutex );
@@ -1742,6 +1988,18 @@ void Daemon::sendPeerList( TcpConnection::Ptr& conn ) {
 }
 
 
+void Daemon::sendExecutorStats( TcpConnection::Ptr& conn ) {
+
+    string stats = Executor::get().print();
+    uint64_t blockSize = stats.length() + 1;
+    shared_ptr<char> buf = rdx_get_shared<char>( blockSize + sizeof( uint64_t ) );
+    uint64_t count = pack( buf.get(), blockSize );
+    count += pack( buf.get()+count, stats );
+    conn->syncWrite( buf.get(), count );
+
+}
+
+
 void Daemon::addToLog( network::TcpConnection::Ptr& conn ) {
 
     try {
@@ -1832,6 +2090,20 @@ size_t Daemon::nSysThreads( void ) {
 }
 
 
+void Daemon::resizeExecutor( size_t n ) {
+
+    // at least 2, since the worker blocks one thread while waiting for prefetched parts.
+    Executor& ex = Executor::get();
+    ex.resize( std::max<size_t>( n, 2 ) );
+    
+    // cap the IO/SOLVE lanes so that there is always a thread for the network tasks.
+    size_t nEx = ex.nThreads();
+    ex.setLimit( Executor::IO, std::max<size_t>( nEx/2, 2 ) );
+    ex.setLimit( Executor::SOLVE, std::max<size_t>( nEx-1, 1 ) );
+
+}
+
+
 void Daemon::threadLoop( void ) {
 
     while( runMode == LOOP ) {
@@ -1944,25 +2216,69 @@ WorkInProgress::Ptr Daemon::getLocalWIP( void ) {
 }
 
 
-WorkInProgress::Ptr Daemon::getRemoteWIP( void ) {
+WorkInProgress::Ptr Daemon::getRemoteWIP( const Job::JobPtr& onlyJob, const network::Host::Ptr& host ) {
+    
+    HostAffinity aff;
+    bool fastHost(true);
+    if( host ) {
+        lock_guard<mutex> lock( peerMutex );
+        auto it = hostAffinity.find( host );
+        if( it != hostAffinity.end() ) aff = it->second;
+        fastHost = isFastHost( aff.secPerCost );
+    }
+    
     WorkInProgress::Ptr ret(nullptr);
     {
         THREAD_MARK
         lock_guard<mutex> qlock( wip_queue_mtx );
         THREAD_MARK
-        if( wip_queue.size() ) {
-            std::swap(ret, wip_queue.front());
-            wip_queue.pop_front();
+        auto best = wip_queue.end();
+        if( !host && !onlyJob ) {       // no preferences, just take the first one.
+            best = std::find_if( wip_queue.begin(), wip_queue.end(), []( const WorkInProgress::Ptr& w ){ return bool(w); } );
+        } else {
+            best = aff.pick( wip_queue, fastHost, onlyJob );
+        }
+        if( best != wip_queue.end() ) {
+            std::swap( ret, *best );
+            wip_queue.erase( best );
         }
     }
     return ret;
+    
 }
 
 
-bool Daemon::getWork( WorkInProgress::Ptr& wip, bool remote ) {
+void Daemon::updateAffinity( const network::Host::Ptr& host, size_t jobID, const WorkInProgress::Ptr& sent ) {
+    
+    if( !host ) return;
+    lock_guard<mutex> lock( peerMutex );
+    hostAffinity[ host ].update( jobID, sent );
+    
+}
+
+
+void Daemon::updateSpeed( const network::Host::Ptr& host, const WorkInProgress::Ptr& returned ) {
+    
+    if( !host || !returned ) return;
+    lock_guard<mutex> lock( peerMutex );
+    hostAffinity[ host ].updateSpeed( returned, host->status.nThreads );
+    
+}
+
+
+bool Daemon::isFastHost( double secPerCost ) {
+    
+    vector<double> speeds;
+    for( auto& ha: hostAffinity ) speeds.push_back( ha.second.secPerCost );
+    return HostAffinity::isFast( secPerCost, speeds );
+    
+}
+
+
+bool Daemon::getWork( WorkInProgress::Ptr& wip, bool remote, const Job::JobPtr& onlyJob, const network::Host::Ptr& host ) {
     THREAD_MARK
     WorkInProgress::Ptr tmp_wip;
-    if( remote ) tmp_wip = getRemoteWIP();
+    if( remote ) tmp_wip = getRemoteWIP( onlyJob, host );
     else tmp_wip = getLocalWIP();
     THREAD_MARK
     
@@ -2071,7 +2387,7 @@ void Daemon::prepareLocalWork( int count ) {
             }
             THREAD_MARK
             
-            std::thread( [this,wip](){
+            tasks.submit( Executor::IO, [this,wip](){
                 THREAD_MARK
                 try {
                     for( auto& part: wip->parts ) {
@@ -2090,7 +2406,7 @@ void Daemon::prepareLocalWork( int count ) {
                 }
                 --preparing_local;
                 THREAD_UNMARK
-            }).detach();
+            });
             THREAD_MARK
             --count;
         }
@@ -2139,13 +2455,12 @@ void Daemon::prepareRemoteWork( int count ) {
             }
             THREAD_MARK
             
-            std::thread( [this,wip](){
+            tasks.submit( Executor::IO, [this,wip](){
                 THREAD_MARK
                 try {
                     for( auto& part: wip->parts ) {
                         if( part ) {
-                            part->load();
-                            part->prePack();
+                            part->load();   // N.B. no prePack(), sendWork sends the data directly from the parts (see BufferList).
                         }
                     }
                     THREAD_MARK
@@ -2160,7 +2475,7 @@ void Daemon::prepareRemoteWork( int count ) {
                 }
                 --preparing_remote;
                 THREAD_UNMARK
-            }).detach();
+            });
             THREAD_MARK
             --count;
         }
@@ -2186,7 +2501,7 @@ void Daemon::prepareWork( void ) {
                 if( nToPrepare > 0 ) {
                     THREAD_MARK
                     preparing_local += nToPrepare;
-                    std::thread( std::bind( &Daemon::prepareLocalWork, this, nToPrepare  ) ).detach();
+                    tasks.submit( Executor::PREPROCESS, std::bind( &Daemon::prepareLocalWork, this, nToPrepare ) );
                 }
             }
             THREAD_MARK
@@ -2195,7 +2510,7 @@ void Daemon::prepareWork( void ) {
             if( nToPrepare > 0 ) {
                 THREAD_MARK
                 preparing_remote += nToPrepare;
-                std::thread( std::bind( &Daemon::prepareRemoteWork, this, nToPrepare ) ).detach();
+                tasks.submit( Executor::PREPROCESS, std::bind( &Daemon::prepareRemoteWork, this, nToPrepare ) );
             }
             THREAD_MARK
         } catch(...){ }
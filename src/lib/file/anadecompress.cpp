@@ -1,5 +1,7 @@
 #include "redux/file/anadecompress.hpp"
 
+#include "redux/util/endian.hpp"
+
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
@@ -970,3 +972,58 @@ int redux::file::anadecrunchrun8(const unsigned char* x, int8_t* array, int slic
 }   /* end of routine */
 
 /*--------------------------------------------------------------------------*/
+
+
+int redux::file::anaskipblocks( const unsigned char* x, size_t nBytes, size_t& offset, int type, int slice, int nx, int nBlocks )
+/* advance offset (in bytes) past nBlocks blocks of a crunched stream, only the bit-lengths of the codes are
+   evaluated, no values are reconstructed */
+{
+    int firstBits, longBits;
+    switch( type ) {
+        case( 0 ): firstBits = 16; longBits = 17; break;
+        case( 1 ): firstBits = 8; longBits = 9; break;
+        case( 4 ): firstBits = 32; longBits = 33; break;
+        default: return -1;     // the run-length variants can not be skipped this way
+    }
+
+    uint64_t r1 = 8*offset;     /* bit-position in the stream */
+    uint64_t bits = 0;          /* the next few bits of the stream, starting at r1 */
+    int nBits = 0;              /* the number of valid bits in "bits" */
+    auto load = [&]( void ) {
+        size_t i = r1 >> 3;
+        bits = 0;
+        if( i + 8 <= nBytes ) memcpy( &bits, x + i, 8 );
+        else if( i < nBytes ) memcpy( &bits, x + i, nBytes - i );
+#if RDX_BYTE_ORDER == RDX_BIG_ENDIAN
+        redux::util::swapEndian( bits );     /* the stream is in little-endian bit-order */
+#endif
+        bits >>= ( r1 & 7 );
+        nBits = 64 - ( r1 & 7 );
+    };
+
+    for( int iy = 0; iy < nBlocks; ++iy ) {
+        r1 += firstBits;
+        nBits = 0;
+        for( int ix = 1; ix < nx; ++ix ) {
+            r1 += slice;        /* skip the fixed part */
+            if( nBits >= slice + 32 ) {
+                bits >>= slice;
+                nBits -= slice;
+            } else load();
+            /* the variable part is terminated by the first set bit, which is never further away than 32 bits */
+            if( !bits ) return -1;
+            int r0 = __builtin_ctzll( bits ) + 1;
+            if( r0 > 32 ) return -1;
+            r1 += r0;
+            bits >>= r0;
+            nBits -= r0;
+            if( r0 == 32 ) {    /* a long one, skip the explicit difference */
+                r1 += longBits;
+                nBits = 0;
+            }
+        }
+        r1 = ( r1 + 7 ) & ~uint64_t( 7 );     /* blocks start on a byte boundary */
+    }
+    offset = r1 >> 3;
+    return ( offset <= nBytes ) ? 1 : -1;
+}
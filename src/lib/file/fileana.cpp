@@ -4,6 +4,11 @@
 #include "redux/file/anadecompress.hpp"
 #include "redux/util/endian.hpp"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/regex.hpp>
 #include <boost/lexical_cast.hpp>
@@ -22,6 +27,7 @@ static const int system_is_big_endian = 1;
 #endif
 
 const uint8_t Ana::typeSizes[] = { 1, 2, 4, 4, 8, 8, 0, 0, 16 };
+unsigned int Ana::maxThreads(0);
 
 namespace {
     template <typename T> Ana::TypeIndex getDatyp( void ) { return Ana::ANA_UNDEF; }
@@ -32,6 +38,170 @@ namespace {
     template <> Ana::TypeIndex getDatyp<double >( void ) { return Ana::ANA_DOUBLE; }
     template <> Ana::TypeIndex getDatyp<int64_t>( void ) { return Ana::ANA_LONGLONG; }
     template <> Ana::TypeIndex getDatyp<complex_t>( void ) { return Ana::ANA_COMPLEX; }
+    
+    const size_t minBytesPerThread = 512*1024;      // (uncompressed) smaller images are (de)compressed in one thread.
+    
+    unsigned int getThreads( size_t nBytes, uint32_t nBlocks ) {
+        size_t n = Ana::maxThreads ? Ana::maxThreads : std::thread::hardware_concurrency();
+        n = std::min<size_t>( n, nBytes/minBytesPerThread );
+        n = std::min<size_t>( n, nBlocks );
+        return std::max<size_t>( n, 1 );
+    }
+    
+    // split nBlocks into a few more chunks than threads, so that uneven compression does not leave threads idle.
+    int getChunkBlocks( int nBlocks, unsigned int nThreads ) {
+        int nChunks = std::min<int>( nBlocks, 4*nThreads );
+        return (nBlocks + nChunks - 1) / nChunks;
+    }
+
+    uint32_t crunch( uint8_t* out, const char* data, uint8_t datyp, int slice, int nx, int ny, uint32_t limit ) {
+        int runlengthflag( 0 );  // runlength unused/untested
+        switch( datyp ) {
+            case( 0 ) : {
+                if( runlengthflag ) return anacrunchrun8( out, reinterpret_cast<const uint8_t*>( data ), slice, nx, ny, limit, system_is_big_endian );
+                else return anacrunch8( out, reinterpret_cast<const uint8_t*>( data ), slice, nx, ny, limit, system_is_big_endian );
+            }
+            case( 1 ) : {
+                if( runlengthflag ) return anacrunchrun( out, reinterpret_cast<const int16_t*>( data ), slice, nx, ny, limit, system_is_big_endian );
+                else return anacrunch( out, reinterpret_cast<const int16_t*>( data ), slice, nx, ny, limit, system_is_big_endian );
+            }
+            case( 2 ) : {
+                if( runlengthflag ) throw invalid_argument( "Ana::compressData: runlength not supported for 32-bit types." );
+                else return anacrunch32( out, reinterpret_cast<const int32_t*>( data ), slice, nx, ny, limit, system_is_big_endian );
+            }
+            default: throw invalid_argument( "Ana::compressData: Unsupported data type." );
+        }
+    }
+
+    /* Each block (row) is encoded independently and starts on a byte boundary, so chunks of rows can be
+     * crunched separately and the streams concatenated. The result is identical to the serial version.
+     * Returns -1 if any chunk failed, the caller then falls back to the serial version.
+     */
+    int crunchParallel( shared_ptr<uint8_t>& out, const char* data, uint8_t datyp, int slice, int nx, int ny,
+                        uint32_t limit, unsigned int nThreads ) {
+
+        const size_t rowBytes = nx * Ana::typeSizes[datyp];
+        const int chunkBlocks = getChunkBlocks( ny, nThreads );
+        const int nChunks = (ny + chunkBlocks - 1) / chunkBlocks;
+        vector<unique_ptr<uint8_t[]>> buffers( nChunks );
+        vector<uint32_t> sizes( nChunks, 0 );
+        atomic<int> nextChunk( 0 );
+        atomic<bool> failed( false );
+        auto worker = [&]( void ) {
+            int c;
+            while( !failed && (c = nextChunk++) < nChunks ) {
+                int nBlocks = std::min( chunkBlocks, ny - c*chunkBlocks );
+                uint32_t chunkLimit = nBlocks * rowBytes;
+                chunkLimit += ( chunkLimit >> 1 ) + 24;
+                buffers[c].reset( new uint8_t[chunkLimit] );
+                uint32_t res = crunch( buffers[c].get(), data + c*chunkBlocks*rowBytes, datyp, slice, nx, nBlocks, chunkLimit );
+                if( res == uint32_t(-1) ) failed = true;
+                else sizes[c] = res - 14;
+            }
+        };
+        vector<thread> threads;
+        for( unsigned int t=1; t<nThreads; ++t ) {
+            threads.push_back( thread( worker ) );
+        }
+        worker();
+        for( auto& th: threads ) th.join();
+
+        uint32_t total = 14;
+        for( auto& sz: sizes ) total += sz;
+        if( failed || (total + 14 > limit) ) return -1;
+        
+        uint8_t* cdata = new uint8_t[ limit ];
+        out.reset( cdata, []( uint8_t * p ) { delete[] p; } );
+        memcpy( cdata, buffers[0].get(), 14 );      // type, slice and block-size are the same for all chunks.
+        Ana::compressed_header* ch = reinterpret_cast<Ana::compressed_header*>( cdata );
+        ch->tsize = total;
+        ch->nblocks = ny;
+        if( system_is_big_endian ) {
+            swapEndian( &( ch->tsize ) );
+            swapEndian( &( ch->nblocks ) );
+        }
+        uint8_t* ptr = cdata + 14;
+        for( int c=0; c<nChunks; ++c ) {
+            memcpy( ptr, buffers[c].get() + 14, sizes[c] );
+            ptr += sizes[c];
+        }
+        return total;
+
+    }
+
+    int decrunch( int type, const uint8_t* x, char* data, int slice, int nx, int ny ) {
+        switch( type ) {
+            case( 0 ): return anadecrunch( x, reinterpret_cast<int16_t*>( data ), slice, nx, ny, !system_is_big_endian );
+            case( 1 ): return anadecrunch8( x, reinterpret_cast<int8_t*>( data ), slice, nx, ny, !system_is_big_endian );
+            case( 2 ): return anadecrunchrun( x, reinterpret_cast<int16_t*>( data ), slice, nx, ny, !system_is_big_endian );
+            case( 3 ): return anadecrunchrun8( x, reinterpret_cast<int8_t*>( data ), slice, nx, ny, !system_is_big_endian );
+            case( 4 ): return anadecrunch32( x, reinterpret_cast<int32_t*>( data ), slice, nx, ny, !system_is_big_endian );
+            default: throw invalid_argument( "Ana::readCompressed(): unrecognized type of compressed data" );
+        }
+    }
+
+    /* The block boundaries are not stored in the file, so the calling thread scans the stream for them
+     * (see anaskipblocks) and the chunks are decoded by all threads as soon as their offset is known.
+     * Returns 0 if the stream can not be split (run-length types), -1 if decoding failed.
+     */
+    int decrunchParallel( int type, const uint8_t* x, size_t nBytes, char* data, int slice, int nx, int ny, unsigned int nThreads ) {
+
+        size_t elementSize;
+        switch( type ) {
+            case( 0 ): elementSize = 2; break;
+            case( 1 ): elementSize = 1; break;
+            case( 4 ): elementSize = 4; break;
+            default: return 0;
+        }
+        const int chunkBlocks = getChunkBlocks( ny, nThreads );
+        const int nChunks = (ny + chunkBlocks - 1) / chunkBlocks;
+        vector<size_t> offsets( nChunks, 0 );
+        int nIndexed( 1 );
+        bool failed( false );
+        mutex mtx;
+        condition_variable cond;
+        atomic<int> nextChunk( 0 );
+        auto worker = [&]( void ) {
+            int c;
+            while( (c = nextChunk++) < nChunks ) {
+                {
+                    unique_lock<mutex> lock( mtx );
+                    cond.wait( lock, [&](){ return failed || (c < nIndexed); } );
+                    if( failed ) return;
+                }
+                int nBlocks = std::min( chunkBlocks, ny - c*chunkBlocks );
+                if( decrunch( type, x + offsets[c], data + c*chunkBlocks*nx*elementSize, slice, nx, nBlocks ) < 0 ) {
+                    lock_guard<mutex> lock( mtx );
+                    failed = true;
+                    cond.notify_all();
+                    return;
+                }
+            }
+        };
+        vector<thread> threads;
+        for( unsigned int t=1; t<nThreads; ++t ) {
+            threads.push_back( thread( worker ) );
+        }
+        size_t offset(0);
+        for( int c=1; c<nChunks; ++c ) {
+            int ret = anaskipblocks( x, nBytes, offset, type, slice, nx, chunkBlocks );
+            lock_guard<mutex> lock( mtx );
+            if( ret < 0 ) {
+                failed = true;
+            } else {
+                offsets[c] = offset;
+                nIndexed = c+1;
+            }
+            cond.notify_all();
+            if( failed ) break;
+        }
+        worker();
+        for( auto& th: threads ) th.join();
+        
+        return failed ? -1 : 1;
+
+    }
+    
 }
 
 Ana::Ana( void ) : hdrSize( 0 ) {
@@ -382,26 +552,15 @@ void redux::file::Ana::readCompressed( ifstream& file, char* data, size_t nEleme
     }
 
     uint8_t slice = hdr->m_CompressedHeader.slice_size;
+    uint8_t type = hdr->m_CompressedHeader.type;
 
     int ret(0);
-    switch( hdr->m_CompressedHeader.type ) {
-        case( 0 ):
-            ret = anadecrunch( tmp.get(), reinterpret_cast<int16_t*>( data ), slice, blockSize, nBlocks, !system_is_big_endian );
-            break;
-        case( 1 ):
-            ret = anadecrunch8( tmp.get(), reinterpret_cast<int8_t*>( data ), slice, blockSize, nBlocks, !system_is_big_endian );
-            break;
-        case( 2 ):
-            ret = anadecrunchrun( tmp.get(), reinterpret_cast<int16_t*>( data ), slice, blockSize, nBlocks, !system_is_big_endian );
-            break;
-        case( 3 ):
-            ret = anadecrunchrun8( tmp.get(), reinterpret_cast<int8_t*>( data ), slice, blockSize, nBlocks, !system_is_big_endian );
-            break;
-        case( 4 ):
-            ret = anadecrunch32( tmp.get(), reinterpret_cast<int32_t*>( data ), slice, blockSize, nBlocks, !system_is_big_endian );
-            break;
-        default:
-            throw invalid_argument( "Ana::readCompressed(): unrecognized type of compressed data" );
+    unsigned int nThreads = getThreads( nElements*typeSizes[hdr->m_Header.datyp], nBlocks );
+    if( nThreads > 1 ) {
+        ret = decrunchParallel( type, tmp.get(), compressedSize, data, slice, blockSize, nBlocks, nThreads );
+    }
+    if( ret <= 0 ) {        // serial, or the stream could not be split: decode it in one go.
+        ret = decrunch( type, tmp.get(), data, slice, blockSize, nBlocks );
     }
     
     if( ret < 0 ) {
@@ -439,31 +598,18 @@ int redux::file::Ana::compressData( shared_ptr<uint8_t>& out, const char* data,
     limit += ( limit >> 1 );
     int nx = hdr->m_Header.dim[0];
     int ny = nElements / nx;
-    int runlengthflag( 0 );  // runlength unused/untested
-    int res;
+    
+    unsigned int nThreads = getThreads( nElements*typeSizes[hdr->m_Header.datyp], ny );
+    if( nThreads > 1 ) {
+        int res = crunchParallel( out, data, hdr->m_Header.datyp, slice, nx, ny, limit, nThreads );
+        if( res > 0 ) return res;
+    }
+    
     uint8_t* cdata = new uint8_t[ limit ]; // allocates +50% size since compression can fail and generate larger data.
     out.reset( cdata, []( uint8_t * p ) { delete[] p; } );
 
-    switch( hdr->m_Header.datyp ) {
-        case( 0 ) : {
-            if( runlengthflag ) res = anacrunchrun8( cdata, reinterpret_cast<const uint8_t*>( data ), slice, nx, ny, limit, system_is_big_endian );
-            else res = anacrunch8( cdata, reinterpret_cast<const uint8_t*>( data ), slice, nx, ny, limit, system_is_big_endian );
-            break;
-        }
-        case( 1 ) : {
-            if( runlengthflag ) res = anacrunchrun( cdata, reinterpret_cast<const int16_t*>( data ), slice, nx, ny, limit, system_is_big_endian );
-            else res = anacrunch( cdata, reinterpret_cast<const int16_t*>( data ), slice, nx, ny, limit, system_is_big_endian );
-            break;
-        }
-        case( 2 ) : {
-            if( runlengthflag ) throw invalid_argument( "Ana::compressData: runlength not supported for 32-bit types." );
-            else res = anacrunch32( cdata, reinterpret_cast<const int32_t*>( data ), slice, nx, ny, limit, system_is_big_endian );
-            break;
-        }
-        default: throw invalid_argument( "Ana::compressData: Unsupported data type." );
-    }
-
-    return res;
+    return crunch( cdata, data, hdr->m_Header.datyp, slice, nx, ny, limit );
+    
 }
 
 
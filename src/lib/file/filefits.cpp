@@ -7,10 +7,20 @@
 #include "redux/util/ricecompress.hpp"
 #include "redux/util/stringutil.hpp"
 
+#include <atomic>
+#include <cmath>
 #include <fstream>
 #include <functional>
+#include <limits>
 #include <mutex>
 #include <numeric>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
 
 #include <boost/filesystem.hpp>
 #include <boost/regex.hpp>
@@ -33,6 +43,8 @@ static const int system_is_big_endian = 1;
 #endif
 
 const uint8_t Fits::typeSizes[] = { 1, 2, 4, 4, 8, 8, 0, 0, 16 };
+unsigned int Fits::maxThreads(0);
+std::atomic<uint64_t> Fits::nativeTiles(0);
 
 namespace {
     
@@ -113,6 +125,221 @@ namespace {
     }
     
     
+    /* Read-only view of the heap of a binary table, memory-mapped from the file. Only for plain disk-files, for anything
+     * else (e.g. a .gz file that cfitsio unpacks in memory) data will be null.
+     */
+    struct HeapView {
+        HeapView( fitsfile* fP ) : data(nullptr), size(0), map(nullptr), mapSize(0) {
+            FITSfile* fptr = fP->Fptr;
+            LONGLONG start = fptr->datastart + fptr->heapstart;
+            size = fptr->heapsize;
+            int status(0);
+            char urlType[FLEN_FILENAME];
+            if( fits_url_type( fP, urlType, &status ) == 0 && string(urlType) == "file://" ) {
+                int fd = ::open( fptr->filename, O_RDONLY );
+                struct stat st;
+                if( fd >= 0 && fstat( fd, &st ) == 0 && st.st_size >= (start+size) ) {
+                    LONGLONG pageSize = sysconf( _SC_PAGESIZE );
+                    LONGLONG mapStart = start - (start % pageSize);
+                    mapSize = start + size - mapStart;
+                    map = mmap( nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, mapStart );
+                    if( map == MAP_FAILED ) {
+                        map = nullptr;
+                    } else {
+                        data = reinterpret_cast<const uint8_t*>( map ) + (start - mapStart);
+                        madvise( map, mapSize, MADV_WILLNEED );
+                    }
+                }
+                if( fd >= 0 ) ::close( fd );
+            }
+        }
+        ~HeapView() { if( map ) munmap( map, mapSize ); }
+        const uint8_t* data;
+        LONGLONG size;
+    private:
+        void* map;
+        size_t mapSize;
+    };
+    
+    
+    bool gunzipTile( const uint8_t* in, size_t inSize, uint8_t* out, size_t outSize ) {
+        z_stream strm;
+        memset( &strm, 0, sizeof(strm) );
+        if( inflateInit2( &strm, 15+32 ) != Z_OK ) return false;       // +32 = detect zlib/gzip header
+        strm.next_in = const_cast<uint8_t*>( in );
+        strm.avail_in = inSize;
+        strm.next_out = out;
+        strm.avail_out = outSize;
+        int ret = inflate( &strm, Z_FINISH );
+        bool ok = (ret == Z_STREAM_END) && (strm.total_out == outSize);
+        inflateEnd( &strm );
+        return ok;
+    }
+    
+    
+    template <typename T>
+    bool decodeTile( int compressType, const uint8_t* in, size_t inSize, T* out, size_t nElements, size_t blockSize, vector<uint8_t>& tmp ) {
+        if( compressType == RICE_1 ) {
+            return rice_decomp( in, inSize, out, nElements, blockSize ) == 0;
+        }
+        const size_t nBytes = nElements*sizeof(T);
+        if( compressType == GZIP_2 && sizeof(T) > 1 ) {       // the bytes were shuffled: all MSBs first, etc.
+            tmp.resize( nBytes );
+            if( !gunzipTile( in, inSize, tmp.data(), nBytes ) ) return false;
+            uint8_t* outPtr = reinterpret_cast<uint8_t*>( out );
+            for( size_t b=0; b<sizeof(T); ++b ) {
+                const uint8_t* tPtr = tmp.data() + b*nElements;
+                for( size_t i=0; i<nElements; ++i ) outPtr[i*sizeof(T)+b] = tPtr[i];
+            }
+        } else if( !gunzipTile( in, inSize, reinterpret_cast<uint8_t*>( out ), nBytes ) ) {
+            return false;
+        }
+        if( !system_is_big_endian ) swapEndian( out, nElements );      // stored as big-endian
+        return true;
+    }
+    
+    
+    /* Convert stored values to physical ones (stored*BSCALE + BZERO, rounded and clipped to the output type O, which has
+     * the same size as T), in place. Pixels equal to blank are set to 0, the same as fits_read_img does for compressed images.
+     */
+    template <typename T, typename O>
+    void scaleTile( T* data, size_t n, double bscale, double bzero, bool checkBlank, int64_t blank ) {
+        O* out = reinterpret_cast<O*>( data );
+        const double lo = std::numeric_limits<O>::lowest();
+        const double hi = std::numeric_limits<O>::max();
+        for( size_t i=0; i<n; ++i ) {
+            const T v = data[i];
+            if( checkBlank && (v == blank) ) {
+                out[i] = 0;
+            } else {
+                out[i] = static_cast<O>( std::min( std::max( std::round( v*bscale + bzero ), lo ), hi ) );
+            }
+        }
+    }
+    
+    
+    /* Native reader for tile-compressed images with 8/16/32-bit integer data and RICE_1/GZIP_1/GZIP_2 compression.
+     * The descriptor table is read with one call, and the heap is mapped once (see HeapView), after that the tiles
+     * are decoded in parallel without any further calls to cfitsio.
+     * BSCALE/BZERO and a (constant) ZBLANK are applied per tile, the output type is the one getDataType gives, i.e. unsigned
+     * for the standard BZERO offsets of signed types (and signed for 8-bit data with BZERO=-128).
+     * Returns false if the HDU uses something not supported here (quantized floats, uncompressed tiles, a ZBLANK column, etc.),
+     * the caller should then let cfitsio read it.
+     */
+    template <typename T>
+    bool readTiles( fitsfile* fP, T* data, unsigned int nThreads ) {
+        
+        FITSfile* fptr = fP->Fptr;
+        const int compressType = fptr->compress_type;
+        if( (compressType != RICE_1) && (compressType != GZIP_1) && (compressType != GZIP_2) ) return false;
+        if( (compressType == RICE_1) && (fptr->rice_bytepix != sizeof(T)) ) return false;
+        if( fptr->cn_zscale || fptr->cn_zzero || (fptr->zndim < 1) ) return false;      // quantized (float) data
+        if( fptr->cn_zblank > 0 ) return false;         // per-tile null values
+        
+        typedef typename std::conditional< std::is_signed<T>::value, typename std::make_unsigned<T>::type,
+                                           typename std::make_signed<T>::type >::type Flipped;
+        const double bscale = fptr->cn_bscale;
+        const double bzero = fptr->cn_bzero;
+        const bool checkBlank = (fptr->cn_zblank == -1);
+        const int64_t blank = fptr->zblank;
+        const bool flip = std::is_signed<T>::value ? (bzero == static_cast<double>( uint64_t(1) << (8*sizeof(T)-1) )) : (bzero == -128.0);
+        std::function<void(T*,size_t)> scale;
+        if( checkBlank || (bscale != 1.0) || (bzero != 0.0) ) {
+            if( flip ) scale = std::bind( scaleTile<T,Flipped>, std::placeholders::_1, std::placeholders::_2, bscale, bzero, checkBlank, blank );
+            else scale = std::bind( scaleTile<T,T>, std::placeholders::_1, std::placeholders::_2, bscale, bzero, checkBlank, blank );
+        }
+
+        const int nDims = fptr->zndim;
+        vector<size_t> dims( nDims ), tileDims( nDims ), nTiles( nDims );
+        size_t totalTiles(1);
+        for( int d=0; d<nDims; ++d ) {
+            dims[d] = fptr->znaxis[d];
+            tileDims[d] = std::max<LONGLONG>( fptr->tilesize[d], 1 );
+            nTiles[d] = (dims[d] + tileDims[d] - 1) / tileDims[d];
+            totalTiles *= nTiles[d];
+        }
+        if( totalTiles != static_cast<size_t>( fptr->numrows ) ) return false;
+        
+        int status(0);
+        vector<LONGLONG> lengths( totalTiles ), offsets( totalTiles );
+        if( fits_read_descriptsll( fP, fptr->cn_compressed, 1, totalTiles, lengths.data(), offsets.data(), &status ) ) {
+            return false;
+        }
+        for( auto& l: lengths ) {
+            if( l == 0 ) return false;      // stored in the (gzip-)uncompressed column
+        }
+        
+        HeapView heap( fP );
+        if( !heap.data ) return false;      // not a disk-file
+        
+        atomic<size_t> nextTile( 0 );
+        atomic<bool> failed( false );
+        auto worker = [&]( void ) {
+            vector<T> tileBuffer;
+            vector<uint8_t> tmp;
+            vector<size_t> start( nDims ), size( nDims ), rc( nDims );
+            size_t t;
+            while( !failed && (t = nextTile++) < totalTiles ) {
+                if( (offsets[t] + lengths[t]) > heap.size ) {
+                    cerr << "This file has a corrupt index-table for the compressed data. Tile #" << (t+1) << " will be skipped!" << endl;
+                    continue;
+                }
+                size_t idx(t), tileSize(1), offset(0), stride(1);
+                size_t highDim(0);
+                for( int d=0; d<nDims; ++d ) {      // location/size of this tile in the image
+                    start[d] = (idx % nTiles[d]) * tileDims[d];
+                    idx /= nTiles[d];
+                    size[d] = std::min( tileDims[d], dims[d]-start[d] );
+                    tileSize *= size[d];
+                    offset += start[d]*stride;
+                    stride *= dims[d];
+                    if( size[d] > 1 ) highDim = d;
+                }
+                bool contiguous(true);
+                for( size_t d=0; d<highDim; ++d ) {
+                    if( size[d] != dims[d] ) contiguous = false;
+                }
+                T* tilePtr = data + offset;
+                if( !contiguous ) {
+                    tileBuffer.resize( tileSize );
+                    tilePtr = tileBuffer.data();
+                }
+                if( !decodeTile( compressType, heap.data + offsets[t], lengths[t], tilePtr, tileSize, fptr->rice_blocksize, tmp ) ) {
+                    cerr << "Failed to decompress tile #" << (t+1) << endl;
+                    failed = true;
+                    break;
+                }
+                if( scale ) scale( tilePtr, tileSize );
+                Fits::nativeTiles++;
+                if( !contiguous ) {         // copy the tile into the image, row by row.
+                    std::fill( rc.begin(), rc.end(), 0 );
+                    for( size_t r=0; r<tileSize/size[0]; ++r ) {
+                        size_t o(start[0]);
+                        stride = dims[0];
+                        for( int d=1; d<nDims; ++d ) {
+                            o += (start[d]+rc[d])*stride;
+                            stride *= dims[d];
+                        }
+                        std::copy_n( tilePtr + r*size[0], size[0], data + o );
+                        for( int d=1; (d<nDims) && (++rc[d] == size[d]); ++d ) rc[d] = 0;
+                    }
+                }
+            }
+        };
+        
+        nThreads = std::max<size_t>( 1, std::min<size_t>( nThreads, totalTiles ) );
+        vector<thread> threads;
+        for( unsigned int i=1; i<nThreads; ++i ) {
+            threads.push_back( thread( worker ) );
+        }
+        worker();
+        for( auto& th: threads ) th.join();
+        
+        return !failed;
+        
+    }
+    
+    
     template <typename T> int getBitpix(void) { return 0; }
     template<> int getBitpix<uint8_t>(void) { return 8; }
     template<> int getBitpix<int16_t>(void) { return 16; }
@@ -1533,58 +1760,19 @@ void Fits::read( shared_ptr<redux::file::Fits>& hdr, char* data ) {
             throwStatusError( "Fits::read(hdr,data) moving to cHDU.", status );
         }
 
-        char* dataPtr = data;
-        auto fP = hdr->fitsPtr_;
-        FITSfile* fptr = fP->Fptr;
-        if( fptr->zbitpix == 16 ) {      // only support int16_t at the moment
-            size_t imgSize = fptr->maxtilelen;
-            size_t blockSize = fptr->rice_blocksize;
-            std::mutex fMtx;
-            LONGLONG rowIndex(1);
-            struct rowInfo {
-                rowInfo() : offset(0), sz(0), idx(0) {}
-                rowInfo(LONGLONG o, LONGLONG s, LONGLONG i ) : offset(o), sz(s), idx(i) {}
-                LONGLONG offset, sz, idx;
-                bool operator<( const struct rowInfo& rhs ) const { return offset < rhs.offset; }
-            };
-            std::function<bool(void)> readTile = [&status,&dataPtr,&rowIndex,&fMtx,imgSize,blockSize,fP,fptr](){
-                LONGLONG rSize, rOffset;
-                int16_t* dP;
-                LONGLONG thisI;
-                shared_ptr<uint8_t> tmp;
-                {
-                    std::lock_guard<mutex> fLock( fMtx );
-                    dP = reinterpret_cast<int16_t*>(dataPtr);
-                    dataPtr += imgSize * 2;
-                    thisI = rowIndex++;
-                    if( thisI > fptr->numrows ) return false;
-                    if( fits_read_descriptll( fP, fptr->cn_compressed, thisI, &rSize, &rOffset, &status ) ) {
-                        printStatusError( "Fits::read(hdr,data), getting row("+to_string(thisI)+") info.", status );
-                    }
-                    if( (rOffset+rSize) > fptr->heapsize ) {
-                        cerr << "This file has a corrupt index-table for the compressed data. Tile #" << thisI << " will be skipped!" << endl; 
-                        return true;
-                    }
-
-                    tmp.reset( new uint8_t[rSize], []( uint8_t*& p ) { delete[] p; } );
-                    if( fits_read_col( fP, TBYTE, fptr->cn_compressed, thisI, 1, rSize, NULL, tmp.get(), NULL, &status ) ) {
-                        printStatusError( "Fits::read(hdr,data), reading row("+to_string(thisI)+").", status );
-                    }
-                }
-                rice_decomp16( tmp.get(), rSize, dP, imgSize, blockSize );
-                std::lock_guard<mutex> fLock( fMtx );
-                return true;
-            };
-            vector<thread> threads;
-            int nT = std::min<int>( 4, std::thread::hardware_concurrency() );
-            for( int t(0); t<nT; ++t ) {
-                threads.push_back( thread([&](){ while( readTile() ); }));
-            }
-            for( auto &t: threads ) t.join();
-            if( fptr->cn_bzero ) {
-                double bz = fptr->cn_bzero;
-                int16_t* dP = reinterpret_cast<int16_t*>(data);
-                std::for_each( dP, dP+hdr->nElements(), [&](int16_t &i){i -= bz;});
+        fitsfile* fP = hdr->fitsPtr_;
+        unsigned int nThreads = Fits::maxThreads ? Fits::maxThreads : std::thread::hardware_concurrency();
+        bool done(false);
+        switch( fP->Fptr->zbitpix ) {
+            case( 8 ):  done = readTiles( fP, reinterpret_cast<uint8_t*>( data ), nThreads ); break;
+            case( 16 ): done = readTiles( fP, reinterpret_cast<int16_t*>( data ), nThreads ); break;
+            case( 32 ): done = readTiles( fP, reinterpret_cast<int32_t*>( data ), nThreads ); break;
+            default: ;
+        }
+        if( !done ) {       // not supported by the native reader, let cfitsio handle it.
+            status = 0;
+            if( fits_read_img( fP, hdr->primaryHDU.dataType, 1, hdr->nElements(), 0, data, &anynull, &status ) ) {
+                throwStatusError( "Fits::read(hdr,data) reading compressed image.", status );
             }
         }
         return;
@@ -3,6 +3,13 @@
 #include <iostream>
 #include <cmath>     // NAN
 #include <cstdlib>     // atof
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 
 using namespace redux::file;
@@ -18,6 +25,52 @@ static const int system_is_big_endian = 1;
 #endif
 
 
+namespace {
+
+    /* Get nBlocks blocks of blockSize floats, each preceded by "skip" bytes (the type-byte of diversities/modes), starting
+     * at offset pos of the mapped file. The mapping is wrapped when possible, otherwise the field is copied/converted.
+     */
+    template <typename ...S>
+    Array<float> mappedField( const shared_ptr<char>& mapping, size_t mappingSize, int64_t pos, size_t nBlocks, size_t blockSize,
+                              size_t skip, bool swapNeeded, S ...sizes ) {
+
+        if( !mapping ) {
+            throw logic_error( "FileMomfbd: the file has not been mapped, call map() first." );
+        }
+
+        Array<float> ret;
+        if( pos <= 0 || !nBlocks || !blockSize ) return ret;
+
+        const size_t nBytes = nBlocks * (blockSize*sizeof(float) + skip);
+        if( size_t(pos) + nBytes > mappingSize ) {
+            throw ios_base::failure( "FileMomfbd: data at offset " + to_string( pos ) + " extends beyond the end of the file." );
+        }
+
+        const char* src = mapping.get() + pos;
+        if( !skip && !swapNeeded && !(reinterpret_cast<uintptr_t>( src ) % alignof(float)) ) {
+            // aliasing constructor: the view shares ownership of the mapping.
+            ret.wrap( shared_ptr<float>( mapping, reinterpret_cast<float*>( mapping.get() + pos ) ), sizes... );
+            return ret;
+        }
+
+        ret.resize( sizes... );
+        float* dst = ret.get();
+        for( size_t b=0; b<nBlocks; ++b ) {
+            src += skip;
+            memcpy( dst, src, blockSize*sizeof(float) );
+            src += blockSize*sizeof(float);
+            dst += blockSize;
+        }
+        if( swapNeeded ) {
+            swapEndian( ret.get(), nBlocks*blockSize );
+        }
+        return ret;
+
+    }
+
+}
+
+
 uint8_t FileMomfbd::PatchInfo::parse ( ifstream& file, const bool& swapNeeded, const double& version ) {
 
     int64_t tmpSize, patchSize ( 0 );
@@ -477,7 +530,7 @@ void FileMomfbd::PatchInfo::write ( ofstream& file, const char* data, const doub
 
 FileMomfbd::FileMomfbd( void ) : version(0), pix2cf(NAN), cf2pix(NAN), modifiedTime(bpx::not_a_date_time), region{0,0,0,0},
     nChannels(0), nFileNames(0), nPH(0), nModes(0), nPatchesX(0), nPatchesY(0), nPoints(0), phOffset(0),
-    modesOffset(0), filenameOffset(0), patchDataSize(0), headerSize(0), dataMask(0), swapNeeded(false), patches()  {
+    modesOffset(0), filenameOffset(0), patchDataSize(0), headerSize(0), dataMask(0), swapNeeded(false), patches(), mappingSize(0)  {
 
 }
 
@@ -485,7 +538,7 @@ FileMomfbd::FileMomfbd( void ) : version(0), pix2cf(NAN), cf2pix(NAN), modifiedT
 FileMomfbd::FileMomfbd( const std::string& filename ) : version(0), pix2cf(NAN), cf2pix(NAN),
     modifiedTime(bpx::not_a_date_time), region{0,0,0,0}, nChannels(0), nFileNames(0), nPH(0),
     nModes(0), nPatchesX(0), nPatchesY(0), nPoints(0), phOffset(-1), modesOffset(-1), 
-    filenameOffset(-1), patchDataSize(0), headerSize(0), dataMask(0), swapNeeded(false), patches() {
+    filenameOffset(-1), patchDataSize(0), headerSize(0), dataMask(0), swapNeeded(false), patches(), mappingSize(0) {
 
     read ( filename );
     
@@ -557,6 +610,8 @@ void FileMomfbd::clear(void) {
     clipStartX = clipEndX = clipStartY = clipEndY = 0;
 
     patches.resize();
+    mapping.reset();
+    mappingSize = 0;
     
 }
 
@@ -900,11 +955,10 @@ size_t FileMomfbd::load ( ifstream& file, char* ptr, uint8_t loadMask, int verbo
             }
             for (int i=0; i< nModes; ++i ) {
                 file.seekg ( 1, ios_base::cur ); // FIXME: skip first byte for now.
-                size_t n = readOrThrow ( file, fPtr, nPH * nPH, "MomfbdData:modes" );
+                size_t n = readOrThrow ( file, fPtr+i*nPH*nPH, nPH * nPH, "MomfbdData:modes" );
                 if( n != (nPH * nPH * sizeof(float))) {
                     cout << "FileMomfbd:modes:  size mismatch: " << n << " != " << (nPH * nPH * sizeof(float)) << endl;
                 }
-                fPtr += nPH * nPH;
             }
             if ( swapNeeded ) {
                 swapEndian ( fPtr, nModes * nPH * nPH );
@@ -964,6 +1018,75 @@ size_t FileMomfbd::load ( ifstream& file, char* ptr, uint8_t loadMask, int verbo
 
 
 
+void FileMomfbd::map( const std::string& filename ) {
+
+    read( filename );
+    
+    int fd = ::open( filename.c_str(), O_RDONLY );
+    if( fd < 0 ) {
+        throw ios_base::failure( "FileMomfbd::map: failed to open " + filename );
+    }
+    
+    struct stat st;
+    void* m = MAP_FAILED;
+    if( fstat( fd, &st ) == 0 && st.st_size > 0 ) {
+        // private & writable: the returned views can be modified (copy-on-write), the file is never touched.
+        m = mmap( nullptr, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0 );
+    }
+    ::close( fd );
+    if( m == MAP_FAILED ) {
+        throw ios_base::failure( "FileMomfbd::map: failed to map " + filename );
+    }
+    
+    madvise( m, st.st_size, MADV_RANDOM );      // patches are accessed in any order, read-ahead would mostly be wasted.
+    mappingSize = st.st_size;
+    const size_t sz = mappingSize;
+    mapping.reset( reinterpret_cast<char*>( m ), [sz]( char* p ) { munmap( p, sz ); } );
+    
+}
+
+
+Array<float> FileMomfbd::getPatchData( int y, int x, uint8_t field ) const {
+
+    if( y < 0 || y >= nPatchesY || x < 0 || x >= nPatchesX ) {
+        throw out_of_range( "FileMomfbd::getPatchData: patch (" + to_string( y ) + "," + to_string( x ) + ") is outside the "
+                            + to_string( nPatchesY ) + "x" + to_string( nPatchesX ) + " patch-grid." );
+    }
+    
+    const PatchInfo& p = *patches.ptr( y, x );
+    const size_t nxny = p.nPixelsX * p.nPixelsY;
+    
+    switch( field ) {
+        case MOMFBD_IMG:   return mappedField( mapping, mappingSize, p.imgPos, 1, nxny, 0, swapNeeded, p.nPixelsY, p.nPixelsX );
+        case MOMFBD_PSF:   return mappedField( mapping, mappingSize, p.psfPos, p.npsf, nxny, 0, swapNeeded, p.npsf, p.nPixelsY, p.nPixelsX );
+        case MOMFBD_OBJ:   return mappedField( mapping, mappingSize, p.objPos, p.nobj, nxny, 0, swapNeeded, p.nobj, p.nPixelsY, p.nPixelsX );
+        case MOMFBD_RES:   return mappedField( mapping, mappingSize, p.resPos, p.nres, nxny, 0, swapNeeded, p.nres, p.nPixelsY, p.nPixelsX );
+        case MOMFBD_ALPHA: return mappedField( mapping, mappingSize, p.alphaPos, p.nalpha, p.nm, 0, swapNeeded, p.nalpha, p.nm );
+        case MOMFBD_DIV: {
+            size_t skip = (version >= 20110916.0) ? 1 : 0;        // byte with diversity-type.
+            return mappedField( mapping, mappingSize, p.diversityPos, p.ndiv, p.nphy*p.nphx, skip, swapNeeded, p.ndiv, p.nphy, p.nphx );
+        }
+        default: throw invalid_argument( "FileMomfbd::getPatchData: field should be one of MOMFBD_IMG/PSF/OBJ/RES/ALPHA/DIV." );
+    }
+    
+}
+
+
+Array<float> FileMomfbd::getPupil( void ) const {
+
+    return mappedField( mapping, mappingSize, phOffset, 1, nPH*nPH, 0, swapNeeded, nPH, nPH );
+
+}
+
+
+Array<float> FileMomfbd::getModes( void ) const {
+
+    size_t skip = (version >= 20120201.0) ? 1 : 0;        // byte with mode-type.
+    return mappedField( mapping, mappingSize, modesOffset, nModes, nPH*nPH, skip, swapNeeded, nModes, nPH, nPH );
+
+}
+
+
 std::shared_ptr<FileMomfbd> redux::file::readMomfbdInfo ( const std::string& filename ) {
 
     std::shared_ptr<FileMomfbd> hdr ( new FileMomfbd ( filename ) );
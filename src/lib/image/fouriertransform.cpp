@@ -3,18 +3,63 @@
 #include "redux/util/cache.hpp"
 
 #include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <map>
 #include <mutex>
 #include <set>
 
+#include <unistd.h>
+
+#include <boost/algorithm/string.hpp>
+
 using namespace redux::image;
 using namespace redux::util;
 using namespace redux;
 using namespace std;
 
+namespace {
+
+    string cpuKey( void ) {      // CPU model, sanitized for use in a filename
+        string model;
+        ifstream cpuinfo( "/proc/cpuinfo" );
+        string line;
+        while( getline( cpuinfo, line ) ) {
+            if( line.compare( 0, 10, "model name" ) == 0 ) {
+                size_t pos = line.find( ':' );
+                if( pos != string::npos ) model = line.substr( pos+1 );
+                break;
+            }
+        }
+        boost::trim( model );
+        if( model.empty() ) model = "unknown";
+        for( auto& c: model ) {
+            if( !isalnum(c) && c != '.' && c != '-' ) c = '_';
+        }
+        return model;
+    }
+
+    // N.B. should be called with pc.mtx locked
+    void exportWisdom( const string& filename ) {
+        if( filename.empty() ) return;
+        string tmpName = filename + ".tmp" + to_string( getpid() );     // write + rename, other daemons might share the directory.
+        if( fftw_export_wisdom_to_filename( tmpName.c_str() ) ) {
+            std::rename( tmpName.c_str(), filename.c_str() );
+        }
+#ifdef HAVE_FFTW3F
+        tmpName = filename + "f.tmp" + to_string( getpid() );
+        if( fftwf_export_wisdom_to_filename( tmpName.c_str() ) ) {
+            std::rename( tmpName.c_str(), (filename+"f").c_str() );
+        }
+#endif
+    }
+
+}
+
 FourierTransform::PlansContainer FourierTransform::Plan::pc;
 
-FourierTransform::Plan::Index::Index (const std::vector<size_t>& dims, TYPE t, uint8_t nt) : tp (t), nThreads (nt), sizes (dims) {
+FourierTransform::Plan::Index::Index (const std::vector<size_t>& dims, TYPE t, uint8_t nt, uint32_t hm)
+    : tp (t), nThreads (nt), howMany(std::max<uint32_t>(hm,1)), sizes (dims) {
     sizes.erase( remove_if( sizes.begin(), sizes.end(), [](size_t i){ return i <= 1;}), sizes.end());
     if ( sizes.empty() ) {
         throw std::logic_error ("FT::Plan constructed with no non-trivial dimensions:  " + printArray (dims, "in"));
@@ -22,7 +67,8 @@ FourierTransform::Plan::Index::Index (const std::vector<size_t>& dims, TYPE t, u
 }
 
 
-FourierTransform::Plan::Index::Index (size_t sizeY, size_t sizeX, TYPE t, uint8_t nt) : tp (t), nThreads (nt), sizes({sizeY,sizeX}) {
+FourierTransform::Plan::Index::Index (size_t sizeY, size_t sizeX, TYPE t, uint8_t nt, uint32_t hm)
+    : tp (t), nThreads (nt), howMany(std::max<uint32_t>(hm,1)), sizes({sizeY,sizeX}) {
     sizes.erase( remove_if( sizes.begin(), sizes.end(), [](size_t i){ return i <= 1;}), sizes.end() );
     if ( sizes.empty() ) {
         throw std::logic_error ("FT::Plan constructed with no non-trivial dimensions:  ["
@@ -35,59 +81,114 @@ bool FourierTransform::Plan::Index::operator< (const Index& rhs) const {
 
     if (tp == rhs.tp) {
         if (nThreads == rhs.nThreads) {
-            return (sizes < rhs.sizes);
+            if (howMany == rhs.howMany) {
+                return (sizes < rhs.sizes);
+            } else return (howMany < rhs.howMany);
         } else return (nThreads < rhs.nThreads);
     } else return tp < rhs.tp;
 
 }
 
 
-FourierTransform::Plan::Plan ( const Index& i ) : id(i) {
+FourierTransform::Plan::Plan ( const Index& i ) : id(i), forward_plan(nullptr), backward_plan(nullptr),
+    forward_plan_f(nullptr), backward_plan_f(nullptr) {
     init();
 }
 
 
 FourierTransform::Plan::~Plan() {
+    unique_lock<mutex> lock(pc.mtx);        // the FFTW planner is not thread-safe, and plans may be evicted from any thread.
     if (! id.sizes.empty()) {
-        fftw_destroy_plan (forward_plan);
-        fftw_destroy_plan (backward_plan);
+        if( forward_plan ) fftw_destroy_plan (forward_plan);
+        if( backward_plan ) fftw_destroy_plan (backward_plan);
+#ifdef HAVE_FFTW3F
+        if( forward_plan_f ) fftwf_destroy_plan (forward_plan_f);
+        if( backward_plan_f ) fftwf_destroy_plan (backward_plan_f);
+#endif
     }
 }
 
 
 void FourierTransform::Plan::init (void) {
     
-    fftw_plan_with_nthreads(id.nThreads);
-    
     size_t nPix(1);
     for( auto& n: id.sizes ) nPix *= n;
     
-    std::shared_ptr<complex_t> tmp1 = rdx_get_shared<complex_t>(nPix);
-    std::shared_ptr<complex_t> tmp2 = rdx_get_shared<complex_t>(nPix);
+    vector<int> n( id.sizes.begin(), id.sizes.end() );
+    int rank = n.size();
+    int dist = nPix;
+    int halfDist = (nPix/n.back())*(n.back()/2+1);      // r2c output: the last dimension is n/2+1
+    
+    if( id.tp == C2C_F || id.tp == R2C_F ) {      // single precision, always planned as "many"-plans (howMany=1 is fine)
+#ifndef HAVE_FFTW3F
+        throw std::logic_error("FT::Plan: single precision plans requested, but redux was built without fftw3f.");
+#else
+        fftwf_plan_with_nthreads(id.nThreads);
+        std::shared_ptr<complexf_t> tmp1 = rdx_get_shared<complexf_t>(nPix*id.howMany);
+        std::shared_ptr<complexf_t> tmp2 = rdx_get_shared<complexf_t>(nPix*id.howMany);
+        fftwf_complex* ptrC1 = reinterpret_cast<fftwf_complex*>(tmp1.get());
+        fftwf_complex* ptrC2 = reinterpret_cast<fftwf_complex*>(tmp2.get());
+        float* ptrF = reinterpret_cast<float*>(tmp1.get());
+        if( id.tp == C2C_F ) {
+            forward_plan_f = fftwf_plan_many_dft( rank, n.data(), id.howMany, ptrC1, nullptr, 1, dist,
+                                                  ptrC2, nullptr, 1, dist, FFTW_FORWARD, pc.rigor );
+            backward_plan_f = fftwf_plan_many_dft( rank, n.data(), id.howMany, ptrC2, nullptr, 1, dist,
+                                                   ptrC1, nullptr, 1, dist, FFTW_BACKWARD, pc.rigor );
+        } else {
+            forward_plan_f = fftwf_plan_many_dft_r2c( rank, n.data(), id.howMany, ptrF, nullptr, 1, dist,
+                                                      ptrC2, nullptr, 1, halfDist, pc.rigor );
+            backward_plan_f = fftwf_plan_many_dft_c2r( rank, n.data(), id.howMany, ptrC2, nullptr, 1, halfDist,
+                                                       ptrF, nullptr, 1, dist, pc.rigor );
+        }
+        return;
+#endif
+    }
+    
+    fftw_plan_with_nthreads(id.nThreads);
+    
+    std::shared_ptr<complex_t> tmp1 = rdx_get_shared<complex_t>(nPix*id.howMany);
+    std::shared_ptr<complex_t> tmp2 = rdx_get_shared<complex_t>(nPix*id.howMany);
     fftw_complex* ptrC1 = reinterpret_cast<fftw_complex*>(tmp1.get());
     fftw_complex* ptrC2 = reinterpret_cast<fftw_complex*>(tmp2.get());
     double* ptrD = reinterpret_cast<double*>(tmp1.get());
     
+    if( id.howMany > 1 ) {      // batched plan: howMany consecutive, densely packed, transforms of the same size.
+        if( id.tp == C2C ) {
+            forward_plan = fftw_plan_many_dft( rank, n.data(), id.howMany, ptrC1, nullptr, 1, dist,
+                                               ptrC2, nullptr, 1, dist, FFTW_FORWARD, pc.rigor );
+            backward_plan = fftw_plan_many_dft( rank, n.data(), id.howMany, ptrC2, nullptr, 1, dist,
+                                                ptrC1, nullptr, 1, dist, FFTW_BACKWARD, pc.rigor );
+        } else if( id.tp == R2C ) {
+            forward_plan = fftw_plan_many_dft_r2c( rank, n.data(), id.howMany, ptrD, nullptr, 1, dist,
+                                                   ptrC2, nullptr, 1, halfDist, pc.rigor );
+            backward_plan = fftw_plan_many_dft_c2r( rank, n.data(), id.howMany, ptrC2, nullptr, 1, halfDist,
+                                                    ptrD, nullptr, 1, dist, pc.rigor );
+        } else {
+            throw std::logic_error ("FT::Plan::init() batched plans are only implemented for C2C/R2C.");
+        }
+        return;
+    }
+    
     if (id.tp == R2C) {
         if (id.sizes.size() == 2) {
-            forward_plan = fftw_plan_dft_r2c_2d( id.sizes[0], id.sizes[1], ptrD, ptrC2, FFTW_MEASURE );
-            backward_plan = fftw_plan_dft_c2r_2d( id.sizes[0], id.sizes[1], ptrC2, ptrD, FFTW_MEASURE );
+            forward_plan = fftw_plan_dft_r2c_2d( id.sizes[0], id.sizes[1], ptrD, ptrC2, pc.rigor );
+            backward_plan = fftw_plan_dft_c2r_2d( id.sizes[0], id.sizes[1], ptrC2, ptrD, pc.rigor );
         } else
             if (id.sizes.size() == 1) {
-                forward_plan = fftw_plan_dft_r2c_1d( nPix, ptrD, ptrC2, FFTW_MEASURE);
-                backward_plan = fftw_plan_dft_c2r_1d( nPix, ptrC2, ptrD, FFTW_MEASURE);
+                forward_plan = fftw_plan_dft_r2c_1d( nPix, ptrD, ptrC2, pc.rigor);
+                backward_plan = fftw_plan_dft_c2r_1d( nPix, ptrC2, ptrD, pc.rigor);
             } else {
                 throw std::logic_error ("FT::Plan::init() is only implemented for 1/2 dimensions, add more when/if needed: " + printArray (id.sizes, "dims"));
             }
     } else {
         if (id.tp == C2C) {
             if (id.sizes.size() == 2) {
-                forward_plan = fftw_plan_dft_2d( id.sizes[0], id.sizes[1], ptrC1, ptrC2, FFTW_FORWARD, FFTW_MEASURE );
-                backward_plan = fftw_plan_dft_2d( id.sizes[0], id.sizes[1], ptrC2, ptrC1, FFTW_BACKWARD, FFTW_MEASURE );
+                forward_plan = fftw_plan_dft_2d( id.sizes[0], id.sizes[1], ptrC1, ptrC2, FFTW_FORWARD, pc.rigor );
+                backward_plan = fftw_plan_dft_2d( id.sizes[0], id.sizes[1], ptrC2, ptrC1, FFTW_BACKWARD, pc.rigor );
             } else {
                 if (id.sizes.size() == 1) {
-                    forward_plan = fftw_plan_dft_1d( nPix, ptrC1, ptrC2, FFTW_FORWARD, FFTW_MEASURE);
-                    backward_plan =  fftw_plan_dft_1d( nPix, ptrC2, ptrC1, FFTW_BACKWARD, FFTW_MEASURE);
+                    forward_plan = fftw_plan_dft_1d( nPix, ptrC1, ptrC2, FFTW_FORWARD, pc.rigor);
+                    backward_plan =  fftw_plan_dft_1d( nPix, ptrC2, ptrC1, FFTW_BACKWARD, pc.rigor);
                 } else {
                     throw std::logic_error ("FT::Plan::init() is only implemented for 1/2 dimensions, add more when/if needed: " + printArray (id.sizes, "dims"));
                 }
@@ -115,45 +216,205 @@ void FourierTransform::Plan::backward( fftw_complex* __restrict__ in, double* __
 }
 
 
-FourierTransform::Plan::Ptr FourierTransform::Plan::get(const std::vector<size_t>& dims, Plan::TYPE tp, uint8_t nThreads) {
+FourierTransform::Plan::Ptr FourierTransform::Plan::get(const std::vector<size_t>& dims, Plan::TYPE tp, uint8_t nThreads, uint32_t howMany) {
 
-    Plan::Index id(dims, tp, nThreads);
-    Plan::Ptr& plan = Cache::get< Plan::Index, Plan::Ptr >( id, nullptr );
+    Plan::Index id(dims, tp, nThreads, howMany);
+    static const bool evictable RDX_UNUSED = Cache::setEvictable< Plan::Index, Plan::Ptr >();
+    Plan::Ptr plan = Cache::find< Plan::Index, Plan::Ptr >( id );
+    if( !plan ) {
+        // N.B. plan outside the map lock, so lookups of other sizes are not blocked while FFTW is measuring.
+        Plan* raw(nullptr);
+        {
+            unique_lock<mutex> lock(pc.mtx);
+            raw = new Plan(id);
+            pc.wisdomDirty = true;          // exported by saveWisdom()
+        }
+        plan.reset( raw );                  // ~Plan locks pc.mtx, so not in the scope above.
+        plan = Cache::getOrCreate< Plan::Index, Plan::Ptr >( id, [&plan](){ return plan; } );     // keeps a plan inserted by another thread
+    }
+    return plan;
 
-    unique_lock<mutex> lock(pc.mtx);
+}
 
-    if( !plan ) {  // insertion successful, i.e. new plan -> initialize it
-        plan.reset( new Plan(id ) );
-    }
 
-    return plan;
+FourierTransform::Plan::Ptr FourierTransform::Plan::get( size_t sizeY, size_t sizeX, Plan::TYPE tp, uint8_t nThreads, uint32_t howMany ) {
+
+    return get( std::vector<size_t>({sizeY, sizeX}), tp, nThreads, howMany );
+
+}
+
+void FourierTransform::Plan::clear( void ) {
 
+    Cache::clear<Plan::Index, Plan::Ptr >();
 
 }
 
 
-FourierTransform::Plan::Ptr FourierTransform::Plan::get( size_t sizeY, size_t sizeX, Plan::TYPE tp, uint8_t nThreads ) {
+void FourierTransform::Plan::setRigor( const string& r ) {
+    
+    if( boost::iequals( r, "estimate" ) ) setRigor( FFTW_ESTIMATE );
+    else if( boost::iequals( r, "measure" ) ) setRigor( FFTW_MEASURE );
+    else if( boost::iequals( r, "patient" ) ) setRigor( FFTW_PATIENT );
+    else throw std::logic_error( "FT::Plan::setRigor() unknown rigor: \"" + r + "\"  (valid: estimate/measure/patient)" );
+    
+}
 
-    Plan::Index id(sizeY, sizeX, tp, nThreads);
-    Plan::Ptr& plan = Cache::get< Plan::Index, Plan::Ptr >( id, nullptr );
 
+void FourierTransform::Plan::setRigor( unsigned fftwFlag ) {
+    
     unique_lock<mutex> lock(pc.mtx);
+    pc.rigor = fftwFlag;
+    
+}
+
+
+unsigned FourierTransform::Plan::rigor( void ) {
+    
+    unique_lock<mutex> lock(pc.mtx);
+    return pc.rigor;
+    
+}
 
-    if( !plan ) {  // insertion successful, i.e. new plan -> initialize it
-        plan.reset( new Plan(id ) );
+
+void FourierTransform::Plan::setWisdomDir( const string& dir ) {
+    
+    unique_lock<mutex> lock(pc.mtx);
+    if( dir.empty() ) {
+        pc.wisdomFile.clear();
+        return;
     }
+    pc.wisdomFile = dir + "/fftw_wisdom_" + cpuKey();
+    fftw_import_wisdom_from_filename( pc.wisdomFile.c_str() );            // fails quietly if it does not exist (yet)
+#ifdef HAVE_FFTW3F
+    fftwf_import_wisdom_from_filename( (pc.wisdomFile+"f").c_str() );
+#endif
+    
+}
 
-    return plan;
 
+void FourierTransform::Plan::saveWisdom( void ) {
+    
+    unique_lock<mutex> lock(pc.mtx);
+    if( !pc.wisdomDirty ) return;
+    exportWisdom( pc.wisdomFile );
+    pc.wisdomDirty = false;
+    
 }
 
-void FourierTransform::Plan::clear( void ) {
 
-    Cache::clear<Plan::Index, Plan::Ptr >();
 
+void FourierTransform::autocorrelate( complex_t* inout, complex_t* work, size_t nY, size_t nX, size_t nBlocks, uint8_t nThreads ) {
+    
+    if( !inout || !work || !nBlocks ) return;
+    if( inout == work ) {
+        throw std::logic_error("FourierTransform::autocorrelate (batched) can not have the same in/work pointers.");
+    }
+
+    const size_t nPix = nY*nX;
+    const size_t N = nPix*nBlocks;
+    const double nrm = 1.0/nPix;
+    Plan::Ptr plan = Plan::get( nY, nX, Plan::C2C, nThreads, nBlocks );
+    
+    fftw_execute_dft( plan->forward_plan, reinterpret_cast<fftw_complex*>(inout), reinterpret_cast<fftw_complex*>(work) );
+    std::transform( work, work+N, work, [nrm](const complex_t&a){ return std::norm(a)*nrm; } );
+    fftw_execute_dft( plan->backward_plan, reinterpret_cast<fftw_complex*>(work), reinterpret_cast<fftw_complex*>(inout) );
+    
+}
+
+
+#ifdef HAVE_FFTW3F
+void FourierTransform::autocorrelate( complexf_t* inout, complexf_t* work, size_t nY, size_t nX, size_t nBlocks, uint8_t nThreads ) {
+    
+    if( !inout || !work || !nBlocks ) return;
+    if( inout == work ) {
+        throw std::logic_error("FourierTransform::autocorrelate (batched) can not have the same in/work pointers.");
+    }
+
+    const size_t nPix = nY*nX;
+    const size_t N = nPix*nBlocks;
+    const float nrm = 1.0/nPix;
+    Plan::Ptr plan = Plan::get( nY, nX, Plan::C2C_F, nThreads, nBlocks );
+    
+    fftwf_execute_dft( plan->forward_plan_f, reinterpret_cast<fftwf_complex*>(inout), reinterpret_cast<fftwf_complex*>(work) );
+    std::transform( work, work+N, work, [nrm](const complexf_t&a){ return std::norm(a)*nrm; } );
+    fftwf_execute_dft( plan->backward_plan_f, reinterpret_cast<fftwf_complex*>(work), reinterpret_cast<fftwf_complex*>(inout) );
+    
+}
+#endif
+
+
+namespace {
+    
+    // N.B. "in" is used as scratch (the squared modulus is stored as real values at the start of each block)
+    template <typename T, typename P, typename E>
+    void autocorrelateHalfImpl( std::complex<T>* in, std::complex<T>* out, size_t nY, size_t nX, size_t nBlocks, P c2c, P r2c, E exec ) {
+
+        const size_t nPix = nY*nX;
+        const size_t N = nPix*nBlocks;
+        const size_t halfPix = nY*(nX/2+1);
+        const T nrm = 1.0/nPix;
+        
+        exec.c2c( c2c, in, out );
+        T* sqPtr = reinterpret_cast<T*>(in);        // dense nBlocks*nPix real array, fits in the first half of in
+        std::transform( out, out+N, sqPtr, [nrm](const std::complex<T>&a){ return std::norm(a)*nrm; } );
+        exec.r2c( r2c, sqPtr, out );
+        // backward transform of a real array = conj( forward r2c )
+        std::transform( out, out+halfPix*nBlocks, out, [](const std::complex<T>&a){ return std::conj(a); } );
+        
+    }
+    
+    struct ExecD {
+        void c2c( fftw_plan p, complex_t* in, complex_t* out ) const {
+            fftw_execute_dft( p, reinterpret_cast<fftw_complex*>(in), reinterpret_cast<fftw_complex*>(out) );
+        }
+        void r2c( fftw_plan p, double* in, complex_t* out ) const {
+            fftw_execute_dft_r2c( p, in, reinterpret_cast<fftw_complex*>(out) );
+        }
+    };
+
+#ifdef HAVE_FFTW3F
+    struct ExecF {
+        void c2c( fftwf_plan p, complexf_t* in, complexf_t* out ) const {
+            fftwf_execute_dft( p, reinterpret_cast<fftwf_complex*>(in), reinterpret_cast<fftwf_complex*>(out) );
+        }
+        void r2c( fftwf_plan p, float* in, complexf_t* out ) const {
+            fftwf_execute_dft_r2c( p, in, reinterpret_cast<fftwf_complex*>(out) );
+        }
+    };
+#endif
+    
+}
+
+
+void FourierTransform::autocorrelateHalf( complex_t* in, complex_t* out, size_t nY, size_t nX, size_t nBlocks, uint8_t nThreads ) {
+    
+    if( !in || !out || !nBlocks ) return;
+    if( in == out ) {
+        throw std::logic_error("FourierTransform::autocorrelateHalf can not have the same in/out pointers.");
+    }
+
+    Plan::Ptr c2c = Plan::get( nY, nX, Plan::C2C, nThreads, nBlocks );
+    Plan::Ptr r2c = Plan::get( nY, nX, Plan::R2C, nThreads, nBlocks );
+    autocorrelateHalfImpl( in, out, nY, nX, nBlocks, c2c->forward_plan, r2c->forward_plan, ExecD() );
+    
 }
 
 
+#ifdef HAVE_FFTW3F
+void FourierTransform::autocorrelateHalf( complexf_t* in, complexf_t* out, size_t nY, size_t nX, size_t nBlocks, uint8_t nThreads ) {
+    
+    if( !in || !out || !nBlocks ) return;
+    if( in == out ) {
+        throw std::logic_error("FourierTransform::autocorrelateHalf can not have the same in/out pointers.");
+    }
+
+    Plan::Ptr c2c = Plan::get( nY, nX, Plan::C2C_F, nThreads, nBlocks );
+    Plan::Ptr r2c = Plan::get( nY, nX, Plan::R2C_F, nThreads, nBlocks );
+    autocorrelateHalfImpl( in, out, nY, nX, nBlocks, c2c->forward_plan_f, r2c->forward_plan_f, ExecF() );
+    
+}
+#endif
+
 
 void FourierTransform::init( size_t ySize, size_t xSize, int flags, uint8_t nT ) {
     
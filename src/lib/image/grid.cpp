@@ -3,19 +3,11 @@
 #include "redux/util/arrayutil.hpp"
 #include "redux/util/cache.hpp"
 
-#include <mutex>
-
 using namespace redux::image;
 using namespace redux::util;
 
 using namespace std;
 
-namespace {
-    
-    mutex mtx;
-    
-}
-
 Grid::ID::ID(uint32_t nPoints) : size(nPoints, nPoints), origin (nPoints / 2, nPoints / 2) {
     if (! (nPoints % 2)) {  // for nPoints even, place origin between mid-points
         origin.x += 0.5;
@@ -73,14 +65,13 @@ shared_ptr<Grid> Grid::get( const Grid::ID& id ) {
         throw logic_error("Grid::ID::size can not be 0!");
     }
     
-    shared_ptr<Grid>& grid = Cache::get<ID,shared_ptr<Grid>>( id, nullptr );
-    unique_lock<mutex> lock(mtx);
-    if( !grid ) grid.reset( new Grid() );
-    if( grid->id.size == 0 ) {
+    static const bool evictable RDX_UNUSED = Cache::setEvictable<ID,shared_ptr<Grid>>();
+    return Cache::getOrCreate<ID,shared_ptr<Grid>>( id, [&id](){
+        shared_ptr<Grid> grid( new Grid() );
         grid->id = id;
         grid->init();
-    }
-    return grid;
+        return grid;
+    });
 }
 
 
@@ -0,0 +1,170 @@
+#include "redux/image/pixelfiller.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+using namespace redux::image;
+using namespace std;
+
+
+namespace {
+
+    const int64_t md = PixelFiller::maxDistance;
+    const int64_t wn = 2*md+1;
+
+    // weight for pixel (dy,dx) is at w[(dy+md)*wn + dx+md], same values as the distance-map in utils.cpp
+    const double* getWeights( void ) {
+        static const vector<double> w = [](){
+            vector<double> tmp( wn*wn );
+            for( int64_t dy=-md; dy<=md; ++dy ) {
+                for( int64_t dx=-md; dx<=md; ++dx ) {
+                    tmp[(dy+md)*wn + dx+md] = pow( dy*dy + dx*dx + 4.0, -2.0 );
+                }
+            }
+            return tmp;
+        }();
+        return w.data();
+    }
+
+    template <typename T>
+    inline double idw( const T* img, int64_t sy, int64_t sx, int64_t posY, int64_t posX ) {
+
+        const double* const weights = getWeights();
+
+        const int64_t beginX = std::max<int64_t>( 0, posX-md );
+        const int64_t endX = std::min<int64_t>( sx, posX+md+1 );
+        const int64_t beginY = std::max<int64_t>( 0, posY-md );
+        const int64_t endY = std::min<int64_t>( sy, posY+md+1 );
+
+        double normalization(0), weightedSum(0);
+        for( int64_t y=beginY; y<endY; ++y ) {
+            const T* row = img + y*sx + beginX;
+            const double* wRow = weights + (y-posY+md)*wn + (beginX-posX+md);
+            for( int64_t x=0; x<endX-beginX; ++x ) {
+                if( row[x] ) {
+                    weightedSum += wRow[x] * row[x];
+                    normalization += wRow[x];
+                }
+            }
+        }
+        if( normalization ) {
+            return weightedSum / normalization;
+        }
+        return 0.0;
+
+    }
+
+    template <typename T>
+    inline double horint( const T* img, int64_t sy, int64_t sx, int64_t posY, int64_t posX ) {
+
+        const T* ptr = img + posY*sx;
+
+        //map the 5 pixel surrounding as bits in a byte
+        int val = 0;
+        if( posX > 1 ) val |= ( (ptr[posX - 2] > 0) << 4 );
+        if( posX > 0 ) val |= ( (ptr[posX - 1] > 0) << 3 );
+        if( posX+1 < sx ) val |= ( (ptr[posX + 1] > 0) << 1 );
+        if( posX+2 < sx ) val |= ( ptr[posX + 2] > 0 );
+        switch( val ) {
+            case( 10 ):     // = 0 1 x 1 0
+            case( 11 ):     // = 0 1 x 1 1
+            case( 26 ):     // = 1 1 x 1 0
+            case( 27 ):     // = 1 1 x 1 1
+                return (ptr[posX-1] + ptr[posX+1]) / 2;
+            case( 18 ):     // = 1 0 x 1 0
+            case( 19 ):     // = 1 0 x 1 1
+                return (ptr[posX-2] + 2 * ptr[posX+1]) / 3;
+            case( 9 ):      // = 0 1 x 0 1
+            case( 25 ):     // = 1 1 x 0 1
+                return (2 * ptr[posX-1] + ptr[posX+2]) / 3;
+            default:
+                return idw( img, sy, sx, posY, posX );
+        }
+
+    }
+
+}
+
+
+PixelFiller::PixelFiller( size_t y, size_t x, const uint8_t* mask ) {
+
+    init( y, x, mask );
+
+}
+
+
+void PixelFiller::init( size_t y, size_t x, const uint8_t* mask ) {
+
+    sy = y;
+    sx = x;
+    hasMask = (mask != nullptr);
+    candidates.clear();
+    if( hasMask ) {
+        const size_t nPixels = sy*sx;
+        for( size_t o=0; o<nPixels; ++o ) {
+            if( mask[o] ) candidates.push_back( o );
+        }
+    }
+
+}
+
+
+template <typename T>
+size_t PixelFiller::fill( T* img, double threshold, Method m, bool useMask, unsigned int nThreads ) const {
+
+    if( !img || !sy || !sx ) return 0;
+
+    vector<size_t> bad;
+    if( useMask && hasMask ) {
+        for( auto& o: candidates ) {
+            if( img[o] <= threshold ) bad.push_back( o );
+        }
+    } else {
+        const size_t nPixels = sy*sx;
+        for( size_t o=0; o<nPixels; ++o ) {
+            if( img[o] <= threshold ) bad.push_back( o );
+        }
+    }
+    if( bad.empty() ) return 0;
+
+    // compute all replacement values before writing any of them back.
+    vector<double> values( bad.size() );
+    const size_t nBad = bad.size();
+    const size_t chunkSize = 64;        // consecutive offsets, i.e. pixels close to each other, to share cached rows.
+    atomic<size_t> nextChunk(0);
+    auto worker = [&]( void ) {
+        size_t c;
+        while( (c = nextChunk++)*chunkSize < nBad ) {
+            size_t end = std::min( (c+1)*chunkSize, nBad );
+            for( size_t i=c*chunkSize; i<end; ++i ) {
+                int64_t y = bad[i] / sx;
+                int64_t x = bad[i] % sx;
+                values[i] = (m == HORINT) ? horint( img, sy, sx, y, x ) : idw( img, sy, sx, y, x );
+            }
+        }
+    };
+
+    nThreads = std::max<size_t>( 1, std::min<size_t>( nThreads, nBad/chunkSize ) );
+    vector<thread> threads;
+    for( unsigned int t=1; t<nThreads; ++t ) {
+        threads.push_back( thread( worker ) );
+    }
+    worker();
+    for( auto& th: threads ) th.join();
+
+    for( size_t i=0; i<nBad; ++i ) {
+        img[bad[i]] = static_cast<T>( values[i] );
+    }
+
+    return nBad;
+
+}
+template size_t PixelFiller::fill( uint8_t*, double, Method, bool, unsigned int ) const;
+template size_t PixelFiller::fill( int16_t*, double, Method, bool, unsigned int ) const;
+template size_t PixelFiller::fill( uint16_t*, double, Method, bool, unsigned int ) const;
+template size_t PixelFiller::fill( int32_t*, double, Method, bool, unsigned int ) const;
+template size_t PixelFiller::fill( uint32_t*, double, Method, bool, unsigned int ) const;
+template size_t PixelFiller::fill( float*, double, Method, bool, unsigned int ) const;
+template size_t PixelFiller::fill( double*, double, Method, bool, unsigned int ) const;
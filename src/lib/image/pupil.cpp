@@ -4,6 +4,7 @@
 #include "redux/file/fileio.hpp"
 #include "redux/image/fouriertransform.hpp"
 #include "redux/image/grid.hpp"
+#include "redux/image/pupilkernels.hpp"
 #include "redux/image/utils.hpp"
 #include "redux/util/stringutil.hpp"
 #include "redux/util/arraystats.hpp"
@@ -110,14 +111,18 @@ Pupil::Pupil( uint16_t pixels, double pupilRadius )
 Pupil::Pupil(Pupil&& rhs) : redux::util::Array<double>(std::move(reinterpret_cast<redux::util::Array<double>&>(rhs))),
     info( std::move(rhs.info) ), nPixels(std::move(rhs.nPixels)), radius(std::move(rhs.radius)),
     co_radius(std::move(rhs.co_radius)), area(std::move(rhs.area)), pupilSupport(std::move(rhs.pupilSupport)),
-    otfSupport(std::move(rhs.otfSupport)), pupilInOTF(std::move(rhs.pupilInOTF)) {
+    otfSupport(std::move(rhs.otfSupport)), pupilInOTF(std::move(rhs.pupilInOTF)), pupilIndex(std::move(rhs.pupilIndex)),
+    otfIndex(std::move(rhs.otfIndex)), pupilWeight(std::move(rhs.pupilWeight)), otfHalfSupport(std::move(rhs.otfHalfSupport)),
+    otfHalfMirror(std::move(rhs.otfHalfMirror)), otfHalfWeight(std::move(rhs.otfHalfWeight)) {
 
 }
 
 
 Pupil::Pupil(const Pupil& rhs) : redux::util::Array<double>(reinterpret_cast<const redux::util::Array<double>&>(rhs)),
     info(rhs.info), nPixels(rhs.nPixels), radius(rhs.radius), co_radius(rhs.co_radius), area(rhs.area),
-    pupilSupport(rhs.pupilSupport), otfSupport(rhs.otfSupport), pupilInOTF(rhs.pupilInOTF)  {
+    pupilSupport(rhs.pupilSupport), otfSupport(rhs.otfSupport), pupilInOTF(rhs.pupilInOTF),
+    pupilIndex(rhs.pupilIndex), otfIndex(rhs.otfIndex), pupilWeight(rhs.pupilWeight), otfHalfSupport(rhs.otfHalfSupport),
+    otfHalfMirror(rhs.otfHalfMirror), otfHalfWeight(rhs.otfHalfWeight) {
     
 }
 
@@ -167,6 +172,7 @@ uint64_t Pupil::unpack( const char* data, bool swap_endian ) {
         count += unpack(data+count,index.first,swap_endian);
         count += unpack(data+count,index.second,swap_endian);
     }
+    generateIndexArrays();
     return count;
 }
 
@@ -267,13 +273,55 @@ void Pupil::generateSupport(double threshold){
     
     FourierTransform::autocorrelate(OTF,true);                           // auto-correlate the pupil to generate the support of the OTF.
 
+    // The autocorrelation of a real pupil is point-symmetric, but round-off in the transform can put a point and its
+    // mirror on different sides of the threshold (e.g. for a loaded pupil-file with soft edges). The support is
+    // symmetrized by including both if either is above threshold, the half-plane accumulation relies on this.
     double* tmpPtr = OTF.get();
     for (size_t index = 0; index < OTF.nElements(); ++index) {           // map indices where the OTF-mask (auto-correlated pupil-mask) is non-zero.
-        if (fabs(tmpPtr[index]) > threshold) {
+        if( (fabs(tmpPtr[index]) > threshold) || (fabs(tmpPtr[otfMirror(index)]) > threshold) ) {
             otfSupport.push_back(index);
         }
     }
     
+    generateIndexArrays();
+    
+}
+
+
+void Pupil::generateIndexArrays(void) {
+    
+    otfHalfSupport.clear();
+    otfHalfMirror.clear();
+    otfHalfWeight.clear();
+    for( const size_t& ind: otfSupport ) {
+        size_t mirror = otfMirror( ind );
+        if( ind <= mirror ) {
+            otfHalfSupport.push_back( ind );
+            otfHalfMirror.push_back( mirror );
+            otfHalfWeight.push_back( (ind == mirror) ? 1.0 : 2.0 );
+        }
+    }
+    
+    size_t n = pupilInOTF.size();
+    size_t nPadded = ((n+kernels::simdWidth-1)/kernels::simdWidth)*kernels::simdWidth;
+    pupilIndex.resize( nPadded );
+    otfIndex.resize( nPadded );
+    pupilWeight.resize( nPadded );
+    if( !n ) return;
+    
+    const double* pupilPtr = get();
+    for( size_t i(0); i<n; ++i ) {
+        pupilIndex[i] = pupilInOTF[i].first;
+        otfIndex[i] = pupilInOTF[i].second;
+        pupilWeight[i] = pupilPtr[pupilInOTF[i].first];
+    }
+    
+    for( size_t i(n); i<nPadded; ++i ) {        // pad by repeating the last element, so that padded writes are harmless
+        pupilIndex[i] = pupilIndex[n-1];
+        otfIndex[i] = otfIndex[n-1];
+        pupilWeight[i] = pupilWeight[n-1];
+    }
+    
 }
 
 
@@ -352,6 +400,12 @@ Pupil& Pupil::operator=( const Pupil& rhs ) {
     pupilSupport = rhs.pupilSupport;
     otfSupport = rhs.otfSupport;
     pupilInOTF = rhs.pupilInOTF;
+    pupilIndex = rhs.pupilIndex;
+    otfIndex = rhs.otfIndex;
+    pupilWeight = rhs.pupilWeight;
+    otfHalfSupport = rhs.otfHalfSupport;
+    otfHalfMirror = rhs.otfHalfMirror;
+    otfHalfWeight = rhs.otfHalfWeight;
     return *this;
 }
 
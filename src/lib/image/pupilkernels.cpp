@@ -0,0 +1,294 @@
+#include "redux/image/pupilkernels.hpp"
+
+#include <algorithm>
+#include <complex>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   define RDX_PUPILKERNELS_AVX2
+#   include <immintrin.h>
+#endif
+
+using namespace redux::image;
+using namespace redux;
+using namespace std;
+
+
+namespace {
+
+    namespace scalar {
+
+        // C is the element type of the OTF output (complex_t or complexf_t), the phases are always evaluated in double.
+        template <typename C>
+        void polar( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n, const double* phi,
+                    complex_t* pf, C* otf, double otfScale ) {
+            for( size_t i(0); i<n; ++i ) {
+                const complex_t tmp = std::polar( w[i], phi[pIdx[i]] );
+                if( pf ) pf[pIdx[i]] = tmp;
+                if( otf ) otf[oIdx[i]] = otfScale*tmp;
+            }
+        }
+
+        template <typename C>
+        void polarOffset( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n, const double* phi,
+                          const double* phiOffset, double scale, C* out, double outScale ) {
+            for( size_t i(0); i<n; ++i ) {
+                out[oIdx[i]] = std::polar( outScale*w[i], phi[pIdx[i]]+scale*phiOffset[pIdx[i]] );
+            }
+        }
+
+        double gatherDot( const int32_t* idx, size_t n, const double* a, const double* b ) {
+            double sum(0);
+            for( size_t i(0); i<n; ++i ) {
+                sum += a[idx[i]]*b[idx[i]];
+            }
+            return sum;
+        }
+
+        void vogel( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n,
+                    const complex_t* pf, const complex_t* otf, double* out ) {
+            for( size_t i(0); i<n; ++i ) {
+                out[pIdx[i]] = imag( conj(pf[pIdx[i]])*otf[oIdx[i]] )*w[i];
+            }
+        }
+
+    }
+
+#ifdef RDX_PUPILKERNELS_AVX2
+    namespace avx2 {
+
+        // Cephes-style sin/cos: reduction by pi/4 (3-part Cody-Waite) and degree 6 minimax polynomials.
+        const double FOPI = 1.27323954473516268615;         // 4/pi
+        const double DP1 = 7.85398125648498535156E-1;
+        const double DP2 = 3.77489470793079817668E-8;
+        const double DP3 = 2.69515142907905952645E-15;
+        const double sincof[] = {  1.58962301576546568060E-10, -2.50507477628578072866E-8,  2.75573136213857245213E-6,
+                                  -1.98412698295895385996E-4,   8.33333333332211858878E-3, -1.66666666666666307295E-1 };
+        const double coscof[] = { -1.13585365213876817300E-11,  2.08757008419747316778E-9, -2.75573141792967388112E-7,
+                                   2.48015872888517045348E-5,  -1.38888888888730564116E-3,  4.16666666666665929218E-2 };
+
+        __attribute__((target("avx2,fma")))
+        inline __m256d maskToPd( __m128i m ) {
+            return _mm256_castsi256_pd( _mm256_cvtepi32_epi64( m ) );
+        }
+
+        __attribute__((target("avx2,fma")))
+        inline __m256d gather( const double* base, __m128i idx ) {      // masked version avoids an undefined source operand
+            return _mm256_mask_i32gather_pd( _mm256_setzero_pd(), base, idx, _mm256_castsi256_pd( _mm256_set1_epi64x(-1) ), 8 );
+        }
+
+        __attribute__((target("avx2,fma")))
+        inline void sincos( __m256d x, __m256d& s, __m256d& c ) {
+
+            const __m256d signMask = _mm256_set1_pd( -0.0 );
+            const __m256d sinSign = _mm256_and_pd( x, signMask );
+            const __m256d ax = _mm256_andnot_pd( signMask, x );
+
+            __m128i j = _mm256_cvttpd_epi32( _mm256_mul_pd( ax, _mm256_set1_pd( FOPI ) ) );
+            j = _mm_and_si128( _mm_add_epi32( j, _mm_set1_epi32(1) ), _mm_set1_epi32(~1) );     // make j even
+            const __m256d y = _mm256_cvtepi32_pd( j );
+
+            const __m128i two = _mm_set1_epi32(2);
+            const __m128i four = _mm_set1_epi32(4);
+            const __m256d swapPoly = maskToPd( _mm_cmpeq_epi32( _mm_and_si128( j, two ), two ) );
+            const __m256d sinFlip = _mm256_and_pd( maskToPd( _mm_cmpeq_epi32( _mm_and_si128( j, four ), four ) ), signMask );
+            const __m256d cosFlip = _mm256_and_pd( maskToPd( _mm_cmpeq_epi32( _mm_and_si128( _mm_add_epi32( j, two ), four ), four ) ), signMask );
+
+            __m256d z = _mm256_fnmadd_pd( y, _mm256_set1_pd( DP1 ), ax );
+            z = _mm256_fnmadd_pd( y, _mm256_set1_pd( DP2 ), z );
+            z = _mm256_fnmadd_pd( y, _mm256_set1_pd( DP3 ), z );
+            const __m256d zz = _mm256_mul_pd( z, z );
+
+            __m256d ps = _mm256_set1_pd( sincof[0] );
+            __m256d pc = _mm256_set1_pd( coscof[0] );
+            for( int i(1); i<6; ++i ) {
+                ps = _mm256_fmadd_pd( ps, zz, _mm256_set1_pd( sincof[i] ) );
+                pc = _mm256_fmadd_pd( pc, zz, _mm256_set1_pd( coscof[i] ) );
+            }
+            const __m256d sinP = _mm256_fmadd_pd( _mm256_mul_pd( z, zz ), ps, z );
+            const __m256d cosP = _mm256_fmadd_pd( _mm256_mul_pd( zz, zz ), pc,
+                                                  _mm256_fnmadd_pd( _mm256_set1_pd( 0.5 ), zz, _mm256_set1_pd( 1.0 ) ) );
+
+            s = _mm256_xor_pd( _mm256_blendv_pd( sinP, cosP, swapPoly ), _mm256_xor_pd( sinFlip, sinSign ) );
+            c = _mm256_xor_pd( _mm256_blendv_pd( cosP, sinP, swapPoly ), cosFlip );
+
+        }
+
+        template <typename C>
+        __attribute__((target("avx2,fma")))
+        void polar( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n, const double* phi,
+                    complex_t* pf, C* otf, double otfScale ) {
+            alignas(32) double re[4], im[4];
+            size_t i(0);
+            for( ; i+4<=n; i+=4 ) {
+                const __m128i pi = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pIdx+i) );
+                const __m256d wv = _mm256_loadu_pd( w+i );
+                __m256d s, c;
+                sincos( gather( phi, pi ), s, c );
+                _mm256_store_pd( re, _mm256_mul_pd( wv, c ) );
+                _mm256_store_pd( im, _mm256_mul_pd( wv, s ) );
+                if( pf ) {
+                    for( int k(0); k<4; ++k ) {
+                        pf[pIdx[i+k]] = complex_t( re[k], im[k] );
+                    }
+                }
+                if( otf ) {
+                    for( int k(0); k<4; ++k ) {
+                        otf[oIdx[i+k]] = C( otfScale*re[k], otfScale*im[k] );
+                    }
+                }
+            }
+            if( i < n ) scalar::polar( pIdx+i, oIdx+i, w+i, n-i, phi, pf, otf, otfScale );
+        }
+
+        template <typename C>
+        __attribute__((target("avx2,fma")))
+        void polarOffset( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n, const double* phi,
+                          const double* phiOffset, double scale, C* out, double outScale ) {
+            alignas(32) double re[4], im[4];
+            const __m256d sv = _mm256_set1_pd( scale );
+            const __m256d osv = _mm256_set1_pd( outScale );
+            size_t i(0);
+            for( ; i+4<=n; i+=4 ) {
+                const __m128i pi = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pIdx+i) );
+                const __m256d wv = _mm256_mul_pd( osv, _mm256_loadu_pd( w+i ) );
+                const __m256d ph = _mm256_fmadd_pd( sv, gather( phiOffset, pi ), gather( phi, pi ) );
+                __m256d s, c;
+                sincos( ph, s, c );
+                _mm256_store_pd( re, _mm256_mul_pd( wv, c ) );
+                _mm256_store_pd( im, _mm256_mul_pd( wv, s ) );
+                for( int k(0); k<4; ++k ) {
+                    out[oIdx[i+k]] = C( re[k], im[k] );
+                }
+            }
+            if( i < n ) scalar::polarOffset( pIdx+i, oIdx+i, w+i, n-i, phi, phiOffset, scale, out, outScale );
+        }
+
+        __attribute__((target("avx2,fma")))
+        double gatherDot( const int32_t* idx, size_t n, const double* a, const double* b ) {
+            __m256d acc = _mm256_setzero_pd();
+            size_t i(0);
+            for( ; i+4<=n; i+=4 ) {
+                const __m128i iv = _mm_loadu_si128( reinterpret_cast<const __m128i*>(idx+i) );
+                acc = _mm256_fmadd_pd( gather( a, iv ), gather( b, iv ), acc );
+            }
+            alignas(32) double tmp[4];
+            _mm256_store_pd( tmp, acc );
+            double sum = (tmp[0]+tmp[1]) + (tmp[2]+tmp[3]);
+            if( i < n ) sum += scalar::gatherDot( idx+i, n-i, a, b );
+            return sum;
+        }
+
+        __attribute__((target("avx2,fma")))
+        void vogel( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n,
+                    const complex_t* pf, const complex_t* otf, double* out ) {
+            alignas(32) double res[4];
+            const double* pfD = reinterpret_cast<const double*>(pf);
+            const double* otfD = reinterpret_cast<const double*>(otf);
+            size_t i(0);
+            for( ; i+4<=n; i+=4 ) {
+                const __m128i pi = _mm_slli_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>(pIdx+i) ), 1 );
+                const __m128i oi = _mm_slli_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>(oIdx+i) ), 1 );
+                const __m256d pRe = gather( pfD, pi );
+                const __m256d pIm = gather( pfD+1, pi );
+                const __m256d oRe = gather( otfD, oi );
+                const __m256d oIm = gather( otfD+1, oi );
+                const __m256d v = _mm256_fmsub_pd( pRe, oIm, _mm256_mul_pd( pIm, oRe ) );      // imag(conj(p)*o)
+                _mm256_store_pd( res, _mm256_mul_pd( v, _mm256_loadu_pd( w+i ) ) );
+                for( int k(0); k<4; ++k ) {
+                    out[pIdx[i+k]] = res[k];
+                }
+            }
+            if( i < n ) scalar::vogel( pIdx+i, oIdx+i, w+i, n-i, pf, otf, out );
+        }
+
+    }
+#endif
+
+    kernels::KERNEL_LEVEL detectLevel( void ) {
+#ifdef RDX_PUPILKERNELS_AVX2
+        __builtin_cpu_init();
+        if( __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ) return kernels::KL_AVX2;
+#endif
+        return kernels::KL_SCALAR;
+    }
+
+    const kernels::KERNEL_LEVEL maxKernelLevel = detectLevel();
+    kernels::KERNEL_LEVEL currentKernelLevel = maxKernelLevel;
+
+}
+
+
+kernels::KERNEL_LEVEL kernels::maxLevel( void ) {
+    return maxKernelLevel;
+}
+
+
+kernels::KERNEL_LEVEL kernels::level( void ) {
+    return currentKernelLevel;
+}
+
+
+void kernels::setLevel( KERNEL_LEVEL l ) {
+    currentKernelLevel = std::min( l, maxKernelLevel );
+}
+
+
+string kernels::levelName( void ) {
+    switch( currentKernelLevel ) {
+        case KL_AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+
+void kernels::polar( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n, const double* phi,
+                     complex_t* pf, complex_t* otf, double otfScale ) {
+#ifdef RDX_PUPILKERNELS_AVX2
+    if( currentKernelLevel == KL_AVX2 ) return avx2::polar( pIdx, oIdx, w, n, phi, pf, otf, otfScale );
+#endif
+    scalar::polar( pIdx, oIdx, w, n, phi, pf, otf, otfScale );
+}
+
+
+void kernels::polar( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n, const double* phi,
+                     complex_t* pf, complexf_t* otf, double otfScale ) {
+#ifdef RDX_PUPILKERNELS_AVX2
+    if( currentKernelLevel == KL_AVX2 ) return avx2::polar( pIdx, oIdx, w, n, phi, pf, otf, otfScale );
+#endif
+    scalar::polar( pIdx, oIdx, w, n, phi, pf, otf, otfScale );
+}
+
+
+void kernels::polarOffset( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n, const double* phi,
+                           const double* phiOffset, double scale, complex_t* out, double outScale ) {
+#ifdef RDX_PUPILKERNELS_AVX2
+    if( currentKernelLevel == KL_AVX2 ) return avx2::polarOffset( pIdx, oIdx, w, n, phi, phiOffset, scale, out, outScale );
+#endif
+    scalar::polarOffset( pIdx, oIdx, w, n, phi, phiOffset, scale, out, outScale );
+}
+
+
+void kernels::polarOffset( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n, const double* phi,
+                           const double* phiOffset, double scale, complexf_t* out, double outScale ) {
+#ifdef RDX_PUPILKERNELS_AVX2
+    if( currentKernelLevel == KL_AVX2 ) return avx2::polarOffset( pIdx, oIdx, w, n, phi, phiOffset, scale, out, outScale );
+#endif
+    scalar::polarOffset( pIdx, oIdx, w, n, phi, phiOffset, scale, out, outScale );
+}
+
+
+double kernels::gatherDot( const int32_t* idx, size_t n, const double* a, const double* b ) {
+#ifdef RDX_PUPILKERNELS_AVX2
+    if( currentKernelLevel == KL_AVX2 ) return avx2::gatherDot( idx, n, a, b );
+#endif
+    return scalar::gatherDot( idx, n, a, b );
+}
+
+
+void kernels::vogel( const int32_t* pIdx, const int32_t* oIdx, const double* w, size_t n,
+                     const complex_t* pf, const complex_t* otf, double* out ) {
+#ifdef RDX_PUPILKERNELS_AVX2
+    if( currentKernelLevel == KL_AVX2 ) return avx2::vogel( pIdx, oIdx, w, n, pf, otf, out );
+#endif
+    scalar::vogel( pIdx, oIdx, w, n, pf, otf, out );
+}
@@ -12,6 +12,7 @@
 #include "redux/util/convert.hpp"
 #include "redux/util/datautil.hpp"
 #include "redux/util/endian.hpp"
+#include "redux/util/numa.hpp"
 #include "redux/util/stringutil.hpp"
 #include "redux/util/trace.hpp"
 #include "redux/application.hpp"
@@ -53,6 +54,7 @@ namespace {
 
     std::map<boost::thread::id,boost::thread*> thread_map;
     std::set<boost::thread::id> old_threads;
+    std::atomic<size_t> threadSlot(0);     // used for distributing the worker-threads over the NUMA-nodes
     
 #ifdef DBG_JOB_
     static atomic<int> jobCounter(0);
@@ -522,6 +524,11 @@ void Job::cleanupThreads( void ) {
 
 void Job::threadLoop( void ) {
 
+    if( numa::enabled() ) {         // pin before anything is allocated, so that thread-local storage is first-touched on this node.
+        int node = numa::pinThread( threadSlot++ );
+        LOG_TRACE << "Job: thread pinned to NUMA-node " << node << ende;
+    }
+
     while( true ) {
         try {
             boost::this_thread::interruption_point();
@@ -1,400 +1,648 @@
-#include "redux/logging/logger.hpp"
-
-#include "redux/file/fileio.hpp"
-#include "redux/logging/logtofile.hpp"
-#include "redux/logging/logtostream.hpp"
-#include "redux/logging/logtonetwork.hpp"
-#include "redux/network/protocol.hpp"
-#include "redux/util/datautil.hpp"
-#include "redux/util/stringutil.hpp"
-
-#include <boost/filesystem.hpp>
-
-namespace bfs = boost::filesystem;
-
-using namespace redux::file;
-using namespace redux::logging;
-using namespace redux::network;
-using namespace redux::util;
-using namespace std;
-
-uint8_t Logger::defaultLevelMask = LOG_UPTO(LOG_LEVEL_NORMAL);
-thread_local LogItem Logger::threadItem;
-
-int Logger::getDefaultLevel( void ) {
-    if( defaultLevelMask == 0 ) return 0;
-    int cnt(1);
-    uint8_t tmp = defaultLevelMask;
-    while( (tmp>>=1) ) cnt++;
-    return cnt;
-}
-
-
-pair<string, string> Logger::customParser( const string& s ) { // custom parser to handle multiple -q/-v flags (e.g. -vvvv)
-
-    if( s.find( "-v" ) == 0 || s.find( "--verbose" ) == 0 ) { //
-        int count = std::count( s.begin(), s.end(), 'v' );
-        while( count-- ) defaultLevelMask = (defaultLevelMask<<1)+1;
-    }
-    else if( s.find( "-q" ) == 0 || s.find( "--quiet" ) == 0 ) { //
-        int count = std::count( s.begin(), s.end(), 'q' );
-        while( count-- ) defaultLevelMask >>= 1;
-    }
-    return make_pair( string(), string() );                 // no need to return anything, we handle the verbosity directly.
-}
-
-
-string Logger::environmentMap( const string &envName ) {
-
-    static map<string, string> vmap;
-    if( vmap.empty() ) {
-//        vmap["RDX_LOGFILE"] = "log-file";
-        vmap["RDX_VERBOSITY"] = "verbosity";
-    }
-    map<string, string>::const_iterator ci = vmap.find( envName );
-    if( ci == vmap.end() ) {
-        return "";
-    } else {
-        return ci->second;
-    }
-}
-
-bpo::options_description Logger::getOptions( const string& application_name ) {
-
-    bpo::options_description logging( "Logging Options" );
-    logging.add_options()
-    ( "verbosity", bpo::value< int >(), "Specify verbosity level (0-8, 0 means no output)."
-      " The environment variable RDX_VERBOSITY will be used as default if it exists." )
-    ( "verbose,v", bpo::value<vector<string>>()->implicit_value( vector<string>( 1, "1" ), "" )
-      ->composing(), "More output. (ignored if --verbosity is specified)" )
-    ( "quiet,q", bpo::value<vector<string>>()->implicit_value( vector<string>( 1, "-1" ), "" )
-      ->composing(), "Less output. (ignored if --verbosity is specified)" )
-
-    ( "log-file,L", bpo::value< vector<string> >()->implicit_value( vector<string>( 1, "" ), "" )
-      ->composing(),
-      "Print output to file."
-      /*" The environment variable RDX_LOGFILE will be used as default if it exists."*/ )
-    ( "log-stdout,d", "Debug mode. Will write output from all channels to stdout."
-      " --log-file can not be used together with this option." )
-    ;
-
-    return logging;
-}
-
-
-
-Logger::Logger( bpo::variables_map& vm ) : LogOutput( defaultLevelMask, 1 ) {
-
-    if( vm.count( "verbosity" ) > 0 ) {         // if --verbosity N is specified, use it.
-        defaultLevelMask = LOG_UPTO(vm["verbosity"].as<int>());
-    }
-    
-    mask = defaultLevelMask;
-    
-    if( vm.count( "log-stdout" ) ) {
-        addStream( cout, mask );
-    }
-    else if( vm.count( "log-file" ) ) {
-        vector<string> logfiles = vm["log-file"].as<vector<string>>();
-        bool hasDefault = false;
-        for( auto & filename : logfiles ) {
-            if( filename == "" ) {
-                if( hasDefault ) {
-                    continue;
-                }
-                filename = vm["appname"].as<string>() + ".log";
-                hasDefault = true;
-            }
-            addFile( filename, mask, false );
-        }
-    }
-
-
-}
-
-
-
-Logger::Logger(void) : LogOutput(defaultLevelMask,1) {
-
-}
-
-
-Logger::~Logger() {
-    
-    unique_lock<mutex> lock( outputMutex );
-    for( auto& c: connections ) {
-        if( c.first ) {
-            c.first->setErrorCallback(nullptr);
-            c.first->setCallback(nullptr);
-            c.first->socket().close();
-        }
-    }
-    connections.clear();
-    lock.unlock();
-    
-    this->flushAll();
-    
-    // clear them now so that the flushBuffer call from the LogOutput destructor does not attempt to access deleted items.
-    outputs.clear();
-
-}
-
-
-void Logger::append( LogItem &i ) {
-    
-    if( !mask || !(i.entry.getMask() & mask) ) {
-        return;
-    }
-
-    LogItemPtr tmpItem( new LogItem() );
-    tmpItem->setLogger( this );
-    tmpItem->entry = i.entry;
-    tmpItem->context = i.context;
-    
-    addItem( tmpItem );
-
-}
-
-
-void Logger::flushBuffer( void ) {
-
-    unique_lock<mutex> lock( queueMutex );
-    vector<LogItemPtr> tmpQueue( itemQueue.begin(), itemQueue.end() );
-    itemQueue.clear();
-    itemCount = 0;
-    lock.unlock();
-
-    unique_lock<mutex> lock2( outputMutex );
-    for( auto &it: outputs ) {
-        it.second->addItems( tmpQueue );
-    }
-    
-}
-
-
-void Logger::flushAll( void ) {
-
-    flushBuffer();
-
-    unique_lock<mutex> lock( outputMutex );
-    for( auto &it: outputs ) {
-        it.second->flushBuffer();
-    }
-
-    
-}
-
-
-LogOutput::Ptr Logger::addLogger( Logger& out ) {
-    
-    LogOutput::Ptr ret;
-    if( &out == this ) return ret;              // avoid infinite loop
-    out.removeOutput( hexString(this) );        // avoid infinite loop
-    
-    string name = hexString(&out);
-    unique_lock<mutex> lock( outputMutex );
-    OutputMap::iterator it = outputs.find( name );
-    if( it == outputs.end() ) {
-        ret.reset( &out, []( LogOutput* ){} );
-        outputs.insert(make_pair(name,ret));
-    }
-    return ret;
-}
-
-
-LogOutput::Ptr Logger::addStream( ostream& strm, uint8_t m, unsigned int flushPeriod ) {
-    
-    LogOutput::Ptr ret;
-    if( m == 0 ) {
-        m = getMask();
-    }
-    string name = hexString(&strm);
-    unique_lock<mutex> lock( outputMutex );
-    OutputMap::iterator it = outputs.find( name );
-    if( it == outputs.end() ) {
-        ret.reset( new LogToStream( strm, m, flushPeriod) );
-        outputs.insert(make_pair(name,ret));
-    }
-    return ret;
-}
-
-
-LogOutput::Ptr Logger::addFile( const std::string &filename, uint8_t m, bool replace, unsigned int flushPeriod ) {
-    LogOutput::Ptr ret;
-    if( m == 0 ) {
-        m = getMask();
-    }
-    bfs::path tmpPath = cleanPath( filename );
-    string name = tmpPath.string().c_str();
-    unique_lock<mutex> lock( outputMutex );
-    OutputMap::iterator it = outputs.find( name );
-    if( it == outputs.end() ) {
-        ret.reset( new LogToFile( name, m, replace, flushPeriod) );
-        outputs.insert(make_pair(name,ret));
-
-    }
-    return ret;
-}
-
-
-LogOutput::Ptr Logger::addNetwork( boost::asio::io_context& ioContext, const Host::Ptr host, uint32_t id, uint8_t m, unsigned int flushPeriod ) {
-    
-    LogOutput::Ptr ret;
-    if( host->info.connectName.empty() || !host->info.connectPort ) {
-        return ret;
-    }
-    
-    string name = host->info.connectName + ":" + to_string( host->info.connectPort ) + ":" + to_string( id );
-
-    if( m == 0 ) {
-        m = getMask();
-    }
-    
-    try {
-        unique_lock<mutex> lock( outputMutex );
-        OutputMap::iterator it = outputs.find( name );
-        if( it != outputs.end() ) return ret;
-        ret.reset( new LogToNetwork( ioContext, host, id, m, flushPeriod ) );
-        outputs.insert(make_pair( name, ret ));
-    } catch ( std::exception& e ) {
-        getItem(LOG_MASK_ERROR) << "Logger::addNetwork exception: " << e.what() << ende;
-        throw;
-    }
-    return ret;
-}
-
-
-void Logger::removeOutput( const string& name ) {
-    
-    unique_lock<mutex> lock( outputMutex );
-    OutputMap::iterator it = outputs.find( name );
-    if( it != outputs.end() ) {
-        it->second->flushBuffer();
-        outputs.erase(it);
-    }
-}
-
-
-void Logger::removeAllOutputs( void ) {
-
-    unique_lock<mutex> lockq( queueMutex );
-    unique_lock<mutex> lock( outputMutex );
-    for( auto &op: outputs ) {
-        op.second->flushBuffer();
-    }
-    outputs.clear();
-
-}
-
-
-void Logger::addConnection( TcpConnection::Ptr conn, network::Host::Ptr host ) {
-    
-    conn->setCallback( bind( &Logger::netReceive, this, std::placeholders::_1 ) );
-    conn->setErrorCallback( bind( &Logger::removeConnection, this, std::placeholders::_1 ) );
-    unique_lock<mutex> lock( outputMutex );
-    connections.insert( make_pair(conn, host) );
-    
-}
-
-
-void Logger::removeConnection( TcpConnection::Ptr conn ) {
-    
-    unique_lock<mutex> lock( outputMutex );
-    try {
-        auto it = connections.find( conn );
-        if( it != connections.end() ) {
-            connections.erase( it );
-        }
-        if( conn ) {
-            conn->setErrorCallback(nullptr);
-            conn->setCallback(nullptr);
-            conn->socket().close();
-            //conn->idle();
-        }
-    } catch( std::exception& e ) {
-        getItem(LOG_MASK_ERROR) << "Exception caught while removing a connection: " << e.what() << ende; 
-    }
-    
-}
-
-
-void Logger::netReceive( TcpConnection::Ptr conn ) {
-    
-    Command cmd = CMD_ERR;
-    try {
-        *conn >> cmd;
-        if( cmd != CMD_PUT_LOG ) {
-            throw std::runtime_error("Unexpected input.");
-        }
-    } catch( const std::exception& e ) {      // disconnected or wrong first byte -> remove connection and return.  TODO narrower catch
-        //cout << "netReceive() exception: " << e.what() << endl;
-        removeConnection(conn);
-        return;
-    } catch( ... ) {      // disconnected or wrong first byte -> remove connection and return.  TODO narrower catch
-        //cout << "netReceive() uncaught exception. " << hexString(conn.get()) << endl;
-        removeConnection(conn);
-        return;
-    }
-
-    
-    unique_lock<mutex> lock( outputMutex );
-    auto it = connections.find( conn );
-    string hostname = "client";
-    if( it != connections.end() ) {
-        if( it->second ) {
-            it->second->touch();
-            hostname = it->second->info.name;
-            size_t pos = hostname.find_first_of(". ");
-            if( pos != string::npos) {
-                hostname.erase( pos );
-            }
-        }
-    }
-    lock.unlock();
-    
-    try {
-        auto test RDX_UNUSED = conn->socket().remote_endpoint();  // check if endpoint exists
-        if( !conn->socket().is_open() ) {
-            throw runtime_error("Connection closed.");
-        }
-
-        size_t blockSize;
-        shared_ptr<char> buf = conn->receiveBlock( blockSize );               // reply
-        *conn << CMD_OK;
-
-        if( blockSize ) {
-            vector<LogItemPtr> tmpQueue;
-            uint64_t count(0);
-            char* ptr = buf.get();
-            while( count < blockSize ) {
-                LogItemPtr tmpItem( new LogItem() );
-                tmpItem->setLogger( this );
-                if( tmpItem->context.empty() ) {
-                    tmpItem->context = hostname;
-                }
-                count += tmpItem->unpack( ptr+count, conn->getSwapEndian() );
-                tmpQueue.push_back( tmpItem );
-            }
-            addItems(tmpQueue);
-        }
-
-    } catch ( const std::exception& e ) {
-        getItem(LOG_MASK_WARNING) << "Exception caught while receiving log messages from " << hostname
-            << ": " << e.what() << ende; 
-        removeConnection(conn);
-        return;
-    }
-    
-    conn->idle();
-
-}
-
-void Logger::setLevel( uint8_t l ) {
-    mask = LOG_UPTO(l);
-    unique_lock<mutex> lockq( queueMutex );
-    unique_lock<mutex> lock( outputMutex );
-    for( auto &op: outputs ) {
-        if( op.second ) op.second->mask = mask;
-    }
-    
-}
+#include "redux/logging/logger.hpp"
+
+#include "redux/file/fileio.hpp"
+#include "redux/logging/logtofile.hpp"
+#include "redux/logging/logtostream.hpp"
+#include "redux/logging/logtonetwork.hpp"
+#include "redux/network/protocol.hpp"
+#include "redux/util/datautil.hpp"
+#include "redux/util/stringutil.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+
+namespace bfs = boost::filesystem;
+namespace bpx = boost::posix_time;
+
+using namespace redux::file;
+using namespace redux::logging;
+using namespace redux::network;
+using namespace redux::util;
+using namespace std;
+
+uint8_t Logger::defaultLevelMask = LOG_UPTO(LOG_LEVEL_NORMAL);
+thread_local LogItem Logger::threadItem;
+
+
+namespace {
+
+    const size_t ringSlots = 256;                   // per thread and Logger
+    const size_t slotSize = 256;
+    const size_t ringBytes = ringSlots*slotSize;
+    const size_t maxRecordSlots = ringSlots/4;      // longer records bypass the ring (see Logger::append)
+    const size_t maxContextLength = slotSize;
+
+    const uint8_t severeMask = LOG_MASK_FATAL|LOG_MASK_ERROR|LOG_MASK_WARNING;
+
+    const bpx::ptime epoch( boost::gregorian::date( 1970, 1, 1 ) );
+
+    // A record is this header followed by the context and the message, it occupies nSlots consecutive slots.
+    struct RecordHeader {
+        int64_t time;               // microseconds since epoch
+        uint32_t msgLength;
+        uint16_t ctxLength;
+        uint8_t mask;
+        uint8_t nSlots;
+    };
+
+    atomic<uint64_t> loggerCount(0);
+
+}
+
+
+/*! Single-producer/single-consumer ring: head is only advanced by the owning thread, tail only by a thread holding
+ *  the drainMutex of the Logger.
+ */
+struct Logger::Ring {
+
+    Ring( void ) : head(0), tail(0), closed(false), orphaned(false) {}
+
+    void put( uint64_t pos, const void* src, size_t n ) {
+        const size_t o = pos % ringBytes;
+        const size_t n1 = std::min( n, ringBytes-o );
+        memcpy( data+o, src, n1 );
+        if( n1 < n ) memcpy( data, static_cast<const char*>(src)+n1, n-n1 );
+    }
+
+    void get( uint64_t pos, void* dest, size_t n ) const {
+        const size_t o = pos % ringBytes;
+        const size_t n1 = std::min( n, ringBytes-o );
+        memcpy( dest, data+o, n1 );
+        if( n1 < n ) memcpy( static_cast<char*>(dest)+n1, data, n-n1 );
+    }
+
+    alignas(64) atomic<uint64_t> head;      // slots written
+    alignas(64) atomic<uint64_t> tail;      // slots read
+    atomic<bool> closed;                    // the owning thread has exited
+    atomic<bool> orphaned;                  // the Logger has been destroyed
+    char data[ringBytes];
+
+};
+
+
+int Logger::getDefaultLevel( void ) {
+    if( defaultLevelMask == 0 ) return 0;
+    int cnt(1);
+    uint8_t tmp = defaultLevelMask;
+    while( (tmp>>=1) ) cnt++;
+    return cnt;
+}
+
+
+pair<string, string> Logger::customParser( const string& s ) { // custom parser to handle multiple -q/-v flags (e.g. -vvvv)
+
+    if( s.find( "-v" ) == 0 || s.find( "--verbose" ) == 0 ) { //
+        int count = std::count( s.begin(), s.end(), 'v' );
+        while( count-- ) defaultLevelMask = (defaultLevelMask<<1)+1;
+    }
+    else if( s.find( "-q" ) == 0 || s.find( "--quiet" ) == 0 ) { //
+        int count = std::count( s.begin(), s.end(), 'q' );
+        while( count-- ) defaultLevelMask >>= 1;
+    }
+    return make_pair( string(), string() );                 // no need to return anything, we handle the verbosity directly.
+}
+
+
+string Logger::environmentMap( const string &envName ) {
+
+    static map<string, string> vmap;
+    if( vmap.empty() ) {
+//        vmap["RDX_LOGFILE"] = "log-file";
+        vmap["RDX_VERBOSITY"] = "verbosity";
+    }
+    map<string, string>::const_iterator ci = vmap.find( envName );
+    if( ci == vmap.end() ) {
+        return "";
+    } else {
+        return ci->second;
+    }
+}
+
+bpo::options_description Logger::getOptions( const string& application_name ) {
+
+    bpo::options_description logging( "Logging Options" );
+    logging.add_options()
+    ( "verbosity", bpo::value< int >(), "Specify verbosity level (0-8, 0 means no output)."
+      " The environment variable RDX_VERBOSITY will be used as default if it exists." )
+    ( "verbose,v", bpo::value<vector<string>>()->implicit_value( vector<string>( 1, "1" ), "" )
+      ->composing(), "More output. (ignored if --verbosity is specified)" )
+    ( "quiet,q", bpo::value<vector<string>>()->implicit_value( vector<string>( 1, "-1" ), "" )
+      ->composing(), "Less output. (ignored if --verbosity is specified)" )
+
+    ( "log-file,L", bpo::value< vector<string> >()->implicit_value( vector<string>( 1, "" ), "" )
+      ->composing(),
+      "Print output to file."
+      /*" The environment variable RDX_LOGFILE will be used as default if it exists."*/ )
+    ( "log-stdout,d", "Debug mode. Will write output from all channels to stdout."
+      " --log-file can not be used together with this option." )
+    ;
+
+    return logging;
+}
+
+
+
+Logger::Logger( bpo::variables_map& vm ) : LogOutput( defaultLevelMask, 1 ), id( ++loggerCount ), running(true),
+    wakeRequested(false), overflowPolicy(OVERFLOW_DROP), dropped(0), reportedDropped(0) {
+
+    if( vm.count( "verbosity" ) > 0 ) {         // if --verbosity N is specified, use it.
+        defaultLevelMask = LOG_UPTO(vm["verbosity"].as<int>());
+    }
+    
+    mask = defaultLevelMask;
+    
+    if( vm.count( "log-stdout" ) ) {
+        addStream( cout, mask );
+    }
+    else if( vm.count( "log-file" ) ) {
+        vector<string> logfiles = vm["log-file"].as<vector<string>>();
+        bool hasDefault = false;
+        for( auto & filename : logfiles ) {
+            if( filename == "" ) {
+                if( hasDefault ) {
+                    continue;
+                }
+                filename = vm["appname"].as<string>() + ".log";
+                hasDefault = true;
+            }
+            addFile( filename, mask, false );
+        }
+    }
+
+
+}
+
+
+
+Logger::Logger(void) : LogOutput(defaultLevelMask,1), id( ++loggerCount ), running(true), wakeRequested(false),
+    overflowPolicy(OVERFLOW_DROP), dropped(0), reportedDropped(0) {
+
+}
+
+
+Logger::~Logger() {
+    
+    unique_lock<mutex> rlock( ringMutex );
+    running = false;
+    rlock.unlock();
+    wake();
+    if( flushThread.joinable() ) {
+        flushThread.join();
+    }
+    
+    unique_lock<mutex> lock( outputMutex );
+    for( auto& c: connections ) {
+        if( c.first ) {
+            c.first->setErrorCallback(nullptr);
+            c.first->setCallback(nullptr);
+            c.first->socket().close();
+        }
+    }
+    connections.clear();
+    lock.unlock();
+    
+    this->flushAll();
+    
+    rlock.lock();
+    for( auto& r: rings ) {
+        r->orphaned = true;         // let the threads release their ring.
+    }
+    rings.clear();
+    rlock.unlock();
+
+    // clear them now so that the flushBuffer call from the LogOutput destructor does not attempt to access deleted items.
+    outputs.clear();
+
+}
+
+
+void Logger::append( LogItem &i ) {
+    
+    const uint8_t m = i.entry.getMask();
+    if( !mask || !(m & mask) ) {
+        return;
+    }
+
+    Ring* r = getRing();
+    const size_t ctxLength = i.context.length();
+    const size_t msgLength = i.entry.getMessageLength();
+    if( !r || (ctxLength > maxContextLength) || (sizeof(RecordHeader) + ctxLength + msgLength > maxRecordSlots*slotSize) ) {
+        // called while the thread is exiting, or too long for the ring: use the (locking) queue instead, which keeps the full context.
+        LogItemPtr tmpItem( new LogItem() );
+        tmpItem->setLogger( this );
+        tmpItem->entry = i.entry;
+        tmpItem->context = i.context;
+        addItem( tmpItem );
+        if( r ) wake();
+        return;
+    }
+
+    RecordHeader hdr;
+    hdr.time = (i.entry.getTime() - epoch).total_microseconds();
+    hdr.mask = m;
+    hdr.ctxLength = ctxLength;
+    hdr.msgLength = msgLength;
+    hdr.nSlots = (sizeof(RecordHeader) + hdr.ctxLength + msgLength + slotSize - 1) / slotSize;
+    
+    const bool severe = (m & severeMask);
+    uint64_t h = r->head.load( memory_order_relaxed );
+    while( h + hdr.nSlots - r->tail.load( memory_order_acquire ) > ringSlots ) {
+        if( !severe && (overflowPolicy == OVERFLOW_DROP) ) {
+            dropped++;
+            wake();
+            return;
+        }
+        flushBuffer();          // make room by draining the rings from this thread.
+    }
+
+    uint64_t pos = h*slotSize;
+    r->put( pos, &hdr, sizeof(RecordHeader) );
+    pos += sizeof(RecordHeader);
+    r->put( pos, i.context.data(), hdr.ctxLength );
+    pos += hdr.ctxLength;
+    r->put( pos, i.entry.getMessage(), msgLength );
+    r->head.store( h + hdr.nSlots, memory_order_release );
+    
+    if( flushPeriod <= 1 ) {        // synchronous, the entry has reached the outputs when append returns.
+        flushBuffer();
+    } else if( severe || (h + hdr.nSlots - r->tail.load( memory_order_relaxed ) > ringSlots/2) ) {
+        wake();
+    }
+
+}
+
+
+Logger::Ring* Logger::getRing( void ) {
+    
+    static thread_local bool exiting(false);
+    thread_local struct ThreadRings {
+        vector<pair<uint64_t, shared_ptr<Ring>>> rings;
+        ~ThreadRings() {
+            exiting = true;
+            for( auto& r: rings ) r.second->closed = true;
+        }
+    } local;
+    
+    if( exiting ) return nullptr;
+    
+    for( auto it = local.rings.begin(); it != local.rings.end(); ) {
+        if( it->first == id ) return it->second.get();
+        if( it->second->orphaned ) {
+            it = local.rings.erase( it );
+        } else ++it;
+    }
+    
+    shared_ptr<Ring> ring = make_shared<Ring>();
+    local.rings.push_back( make_pair( id, ring ) );
+    lock_guard<mutex> lock( ringMutex );
+    rings.push_back( ring );
+    if( running && !flushThread.joinable() ) {
+        flushThread = std::thread( &Logger::flushLoop, this );
+    }
+    return ring.get();
+    
+}
+
+
+size_t Logger::drainRings( vector<LogItemPtr>& items ) {
+    
+    const size_t nItems = items.size();
+    unique_lock<mutex> lock( ringMutex );
+    vector<shared_ptr<Ring>> tmpRings = rings;
+    lock.unlock();
+    
+    bool removeClosed(false);
+    for( auto& r: tmpRings ) {
+        const bool closed = r->closed;
+        uint64_t t = r->tail.load( memory_order_relaxed );
+        const uint64_t h = r->head.load( memory_order_acquire );
+        while( t < h ) {
+            RecordHeader hdr;
+            uint64_t pos = t*slotSize;
+            r->get( pos, &hdr, sizeof(RecordHeader) );
+            pos += sizeof(RecordHeader);
+            LogItemPtr item( new LogItem() );
+            item->setLogger( this );
+            item->context.resize( hdr.ctxLength );
+            r->get( pos, &item->context[0], hdr.ctxLength );
+            pos += hdr.ctxLength;
+            string msg( hdr.msgLength, 0 );
+            r->get( pos, &msg[0], hdr.msgLength );
+            item->entry = LogEntry( static_cast<LogMask>(hdr.mask), msg );
+            item->entry.setTime( epoch + bpx::microseconds( hdr.time ) );
+            items.push_back( item );
+            t += hdr.nSlots;
+        }
+        r->tail.store( t, memory_order_release );
+        removeClosed |= closed;
+    }
+    
+    if( removeClosed ) {        // rings of exited threads are removed once they are empty
+        lock.lock();
+        rings.erase( std::remove_if( rings.begin(), rings.end(), []( const shared_ptr<Ring>& r ) {
+            return r->closed && (r->head == r->tail);
+        }), rings.end() );
+        lock.unlock();
+    }
+    
+    // the rings are drained one at a time, restore the order between threads.
+    std::stable_sort( items.begin()+nItems, items.end(), []( const LogItemPtr& a, const LogItemPtr& b ) {
+        return a->entry.getTime() < b->entry.getTime();
+    });
+
+    uint64_t d = dropped;
+    if( d > reportedDropped ) {
+        LogItemPtr item( new LogItem() );
+        item->setLogger( this );
+        item->context = context;
+        item->entry = LogEntry( LOG_MASK_WARNING, "Logger: " + to_string( d-reportedDropped ) + " entries dropped (buffer full)." );
+        item->entry.now();
+        items.push_back( item );
+        reportedDropped = d;
+    }
+    
+    return items.size() - nItems;
+    
+}
+
+
+void Logger::wake( void ) {
+    
+    if( !wakeRequested.exchange( true ) ) {
+        lock_guard<mutex> lock( wakeMutex );
+        wakeCond.notify_one();
+    }
+    
+}
+
+
+void Logger::flushLoop( void ) {
+    
+    while( running ) {
+        unique_lock<mutex> lock( wakeMutex );
+        wakeCond.wait_for( lock, chrono::milliseconds( flushInterval ), [this](){ return wakeRequested || !running; } );
+        lock.unlock();
+        wakeRequested = false;
+        flushBuffer();
+    }
+    
+}
+
+
+void Logger::flushBuffer( void ) {
+
+    unique_lock<mutex> dlock( drainMutex );         // held until the outputs got the items, to keep the order.
+    vector<LogItemPtr> tmpQueue;
+    drainRings( tmpQueue );
+    
+    unique_lock<mutex> lock( queueMutex );
+    if( !itemQueue.empty() ) {      // entries that bypassed the rings, put them in time-order with the rest.
+        tmpQueue.insert( tmpQueue.end(), itemQueue.begin(), itemQueue.end() );
+        std::stable_sort( tmpQueue.begin(), tmpQueue.end(), []( const LogItemPtr& a, const LogItemPtr& b ) {
+            return a->entry.getTime() < b->entry.getTime();
+        });
+    }
+    itemQueue.clear();
+    itemCount = 0;
+    lock.unlock();
+
+    if( tmpQueue.empty() ) return;
+    
+    unique_lock<mutex> lock2( outputMutex );
+    for( auto &it: outputs ) {
+        it.second->addItems( tmpQueue );
+    }
+    
+}
+
+
+void Logger::flushAll( void ) {
+
+    flushBuffer();
+
+    unique_lock<mutex> lock( outputMutex );
+    for( auto &it: outputs ) {
+        it.second->flushBuffer();
+    }
+
+    
+}
+
+
+LogOutput::Ptr Logger::addLogger( Logger& out ) {
+    
+    LogOutput::Ptr ret;
+    if( &out == this ) return ret;              // avoid infinite loop
+    out.removeOutput( hexString(this) );        // avoid infinite loop
+    
+    string name = hexString(&out);
+    unique_lock<mutex> lock( outputMutex );
+    OutputMap::iterator it = outputs.find( name );
+    if( it == outputs.end() ) {
+        ret.reset( &out, []( LogOutput* ){} );
+        outputs.insert(make_pair(name,ret));
+    }
+    return ret;
+}
+
+
+LogOutput::Ptr Logger::addStream( ostream& strm, uint8_t m, unsigned int flushPeriod ) {
+    
+    LogOutput::Ptr ret;
+    if( m == 0 ) {
+        m = getMask();
+    }
+    string name = hexString(&strm);
+    unique_lock<mutex> lock( outputMutex );
+    OutputMap::iterator it = outputs.find( name );
+    if( it == outputs.end() ) {
+        ret.reset( new LogToStream( strm, m, flushPeriod) );
+        outputs.insert(make_pair(name,ret));
+    }
+    return ret;
+}
+
+
+LogOutput::Ptr Logger::addFile( const std::string &filename, uint8_t m, bool replace, unsigned int flushPeriod ) {
+    LogOutput::Ptr ret;
+    if( m == 0 ) {
+        m = getMask();
+    }
+    bfs::path tmpPath = cleanPath( filename );
+    string name = tmpPath.string().c_str();
+    unique_lock<mutex> lock( outputMutex );
+    OutputMap::iterator it = outputs.find( name );
+    if( it == outputs.end() ) {
+        ret.reset( new LogToFile( name, m, replace, flushPeriod) );
+        outputs.insert(make_pair(name,ret));
+
+    }
+    return ret;
+}
+
+
+LogOutput::Ptr Logger::addNetwork( boost::asio::io_context& ioContext, const Host::Ptr host, uint32_t id, uint8_t m, unsigned int flushPeriod ) {
+    
+    LogOutput::Ptr ret;
+    if( host->info.connectName.empty() || !host->info.connectPort ) {
+        return ret;
+    }
+    
+    string name = host->info.connectName + ":" + to_string( host->info.connectPort ) + ":" + to_string( id );
+
+    if( m == 0 ) {
+        m = getMask();
+    }
+    
+    try {
+        unique_lock<mutex> lock( outputMutex );
+        OutputMap::iterator it = outputs.find( name );
+        if( it != outputs.end() ) return ret;
+        ret.reset( new LogToNetwork( ioContext, host, id, m, flushPeriod ) );
+        outputs.insert(make_pair( name, ret ));
+    } catch ( std::exception& e ) {
+        getItem(LOG_MASK_ERROR) << "Logger::addNetwork exception: " << e.what() << ende;
+        throw;
+    }
+    return ret;
+}
+
+
+void Logger::removeOutput( const string& name ) {
+    
+    unique_lock<mutex> lock( outputMutex );
+    OutputMap::iterator it = outputs.find( name );
+    if( it != outputs.end() ) {
+        it->second->flushBuffer();
+        outputs.erase(it);
+    }
+}
+
+
+void Logger::removeAllOutputs( void ) {
+
+    unique_lock<mutex> lockq( queueMutex );
+    unique_lock<mutex> lock( outputMutex );
+    for( auto &op: outputs ) {
+        op.second->flushBuffer();
+    }
+    outputs.clear();
+
+}
+
+
+void Logger::addConnection( TcpConnection::Ptr conn, network::Host::Ptr host ) {
+    
+    conn->setCallback( bind( &Logger::netReceive, this, std::placeholders::_1 ) );
+    conn->setErrorCallback( bind( &Logger::removeConnection, this, std::placeholders::_1 ) );
+    unique_lock<mutex> lock( outputMutex );
+    connections.insert( make_pair(conn, host) );
+    
+}
+
+
+void Logger::removeConnection( TcpConnection::Ptr conn ) {
+    
+    unique_lock<mutex> lock( outputMutex );
+    try {
+        auto it = connections.find( conn );
+        if( it != connections.end() ) {
+            connections.erase( it );
+        }
+        if( conn ) {
+            conn->setErrorCallback(nullptr);
+            conn->setCallback(nullptr);
+            conn->socket().close();
+            //conn->idle();
+        }
+    } catch( std::exception& e ) {
+        getItem(LOG_MASK_ERROR) << "Exception caught while removing a connection: " << e.what() << ende; 
+    }
+    
+}
+
+
+void Logger::netReceive( TcpConnection::Ptr conn ) {
+    
+    Command cmd = CMD_ERR;
+    try {
+        *conn >> cmd;
+        if( cmd != CMD_PUT_LOG ) {
+            throw std::runtime_error("Unexpected input.");
+        }
+    } catch( const std::exception& e ) {      // disconnected or wrong first byte -> remove connection and return.  TODO narrower catch
+        //cout << "netReceive() exception: " << e.what() << endl;
+        removeConnection(conn);
+        return;
+    } catch( ... ) {      // disconnected or wrong first byte -> remove connection and return.  TODO narrower catch
+        //cout << "netReceive() uncaught exception. " << hexString(conn.get()) << endl;
+        removeConnection(conn);
+        return;
+    }
+
+    
+    unique_lock<mutex> lock( outputMutex );
+    auto it = connections.find( conn );
+    string hostname = "client";
+    if( it != connections.end() ) {
+        if( it->second ) {
+            it->second->touch();
+            hostname = it->second->info.name;
+            size_t pos = hostname.find_first_of(". ");
+            if( pos != string::npos) {
+                hostname.erase( pos );
+            }
+        }
+    }
+    lock.unlock();
+    
+    try {
+        auto test RDX_UNUSED = conn->socket().remote_endpoint();  // check if endpoint exists
+        if( !conn->socket().is_open() ) {
+            throw runtime_error("Connection closed.");
+        }
+
+        size_t blockSize;
+        shared_ptr<char> buf = conn->receiveBlock( blockSize );               // reply
+        *conn << CMD_OK;
+
+        if( blockSize ) {
+            vector<LogItemPtr> tmpQueue;
+            uint64_t count(0);
+            char* ptr = buf.get();
+            while( count < blockSize ) {
+                LogItemPtr tmpItem( new LogItem() );
+                tmpItem->setLogger( this );
+                if( tmpItem->context.empty() ) {
+                    tmpItem->context = hostname;
+                }
+                count += tmpItem->unpack( ptr+count, conn->getSwapEndian() );
+                tmpQueue.push_back( tmpItem );
+            }
+            addItems(tmpQueue);
+        }
+
+    } catch ( const std::exception& e ) {
+        getItem(LOG_MASK_WARNING) << "Exception caught while receiving log messages from " << hostname
+            << ": " << e.what() << ende; 
+        removeConnection(conn);
+        return;
+    }
+    
+    conn->idle();
+
+}
+
+void Logger::setLevel( uint8_t l ) {
+    mask = LOG_UPTO(l);
+    unique_lock<mutex> lockq( queueMutex );
+    unique_lock<mutex> lock( outputMutex );
+    for( auto &op: outputs ) {
+        if( op.second ) op.second->mask = mask;
+    }
+    
+}
@@ -23,10 +23,13 @@
 #include "redux/util/projective.hpp"
 #include "redux/util/trace.hpp"
 
+#include <atomic>
 #include <functional>
 #include <math.h>
+#include <mutex>
 #include <numeric>
 #include <string>
+#include <thread>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/format.hpp>
@@ -595,8 +598,9 @@ void Channel::loadCalib( boost::asio::io_context& ioc ) {     // load through ca
 
     if( !gainFile.empty() ) {
         CachedFile::load<float>( gain, gainFile );
-        gainMask = rdx_get_shared<uint8_t>(imgSize.y*imgSize.x);
+        shared_ptr<uint8_t> gainMask = rdx_get_shared<uint8_t>(imgSize.y*imgSize.x);
         make_mask( gain.get(), gainMask.get(), imgSize.y, imgSize.x, 0, 8, true, true ); // filter away larger features than ~8 pixels
+        pixelFiller.init( imgSize.y, imgSize.x, gainMask.get() );
     }
 
 
@@ -644,6 +648,23 @@ void Channel::loadCalib( boost::asio::io_context& ioc ) {     // load through ca
 }
 
 
+struct Channel::Pipeline {
+    static constexpr size_t readAhead = 2;          //!< number of files being read simultaneously.
+    Pipeline( size_t n, bool saveFF ) : nFiles(n), saveFFData(saveFF), nextFile(0), failed(false),
+        maxPending( std::max<size_t>( 4*std::thread::hardware_concurrency(), 16 ) ), pending(0), parked(0),
+        remaining(n), offsets(n,0) { }
+    const size_t nFiles;
+    const bool saveFFData;
+    std::atomic<size_t> nextFile;
+    std::atomic<bool> failed;
+    std::mutex mtx;
+    const size_t maxPending;                    //!< max frames read but not yet preprocessed, before the readers pause.
+    size_t pending, parked;                     // guarded by mtx
+    std::vector<std::atomic<size_t>> remaining; //!< frames left to preprocess, per file.
+    std::vector<size_t> offsets;                //!< index of the first frame of each file.
+};
+
+
 void Channel::loadData( boost::asio::io_context& ioc, redux::util::Array<PatchData::Ptr>& patches ) {
 
     size_t nFiles = std::max<size_t>( 1, fileNumbers.size() );       // If no numbers, load template as single file
@@ -688,48 +709,123 @@ void Channel::loadData( boost::asio::io_context& ioc, redux::util::Array<PatchDa
         }
     }
     
-    size_t nPreviousFrames(0);
+    // Streaming pipeline: a few readers (bounded readahead) load the files, every frame that has been read is then
+    // calibrated/filled/measured as a separate task, so that reading the next file overlaps with the preprocessing.
+    // The calibration data is shared by the frame-tasks, so any adjustment has to be done before they start.
+    if( ccdResponse.valid() && (ccdResponse.dimSize(0) != imgSize.y || ccdResponse.dimSize(1) != imgSize.x) ) {
+        LOG_WARN << boost::format ("Dimensions of ccd-response (%s) does not match the images (%dx%d), will not be used !!")
+                % printArray (ccdResponse.dimensions(), "") % imgSize.y % imgSize.x << ende;
+        ccdResponse.clear();
+    }
+    auto pipe = make_shared<Pipeline>( nFiles, saveFFData );
     for( size_t i=0; i<nFiles; ++i ) {
-        boost::asio::post( ioc, [&,i,nPreviousFrames,saveFFData](){
-            try {
-                loadFile(i,nPreviousFrames);
-                if( imgSize.y < 1 || imgSize.x < 1 ) throw logic_error("Image size is zero.");
-                size_t nF = nFrames[i];
-                for( size_t j=0; j<nF; ++j ) {
-                    preprocessImage( nPreviousFrames+j );
-                    //service.post(std::bind( &Channel::preprocessImage, this, nPreviousFrames+j) );
-                }
-                if( saveFFData ) {
-                    bfs::path fn;
-                    try {
-                        fn = bfs::path (myJob.info.outputDir) / bfs::path (boost::str (boost::format (imageTemplate) % fileNumbers[i])).filename();
-                        bfs::path ext = fn.extension();
-                        if(ext.string().empty() || ext.string().length() > 5 ) {     // we assume the filename does not have a proper extenstion, add a temporary dummy
-                            fn = bfs::path( fn.string() + ".ext" );
-                        }
-                        fn.replace_extension(".cor.f0");
-                        LOG_DEBUG << boost::format("Saving dark/flat corrected data (%d:%d:%d) as %s.") % myObject.ID % ID % i % fn.string() << ende;
-                        Image<float> view( images, nPreviousFrames, nPreviousFrames+nF-1, 0, imgSize.y-1, 0, imgSize.x-1 );
-                        redux::file::Ana::write( fn.string(), view.copy() );   // TODO: other formats
-                    } catch ( const std::exception& e ) {
-                        LOG_ERR << "Failed to save corrected file: " << fn << "  reason: " << e.what() << ende;
-                    }
-                    ++myObject.progWatch;
-                }
-                ++progWatch;
-                return;
-            } catch ( const std::exception& e ) {
-                LOG_ERR << "Failed to load/preprocess file. reason: " << e.what() << ende;
-            } catch ( ... ) {
-                LOG_ERR << "Failed to load/preprocess file for unknown reason." << ende;
+        if( i ) pipe->offsets[i] = pipe->offsets[i-1] + nFrames[i-1];
+        pipe->remaining[i] = nFrames[i];
+    }
+    size_t nReaders = std::min<size_t>( nFiles, Pipeline::readAhead );
+    for( size_t i=0; i<nReaders; ++i ) {
+        boost::asio::post( ioc, std::bind( &Channel::readStage, this, std::ref(ioc), pipe ) );
+    }
+
+}
+
+
+void Channel::readStage( boost::asio::io_context& ioc, shared_ptr<Pipeline> pipe ) {
+
+    if( pipe->failed ) return;
+    {
+        lock_guard<mutex> lock( pipe->mtx );
+        if( pipe->pending >= pipe->maxPending ) {      // enough frames waiting to be processed, resumed by frameStage.
+            pipe->parked++;
+            return;
+        }
+    }
+    
+    size_t i = pipe->nextFile++;
+    if( i >= pipe->nFiles ) return;
+    
+    size_t nF = nFrames[i];
+    try {
+        loadFile( i, pipe->offsets[i] );
+        if( imgSize.y < 1 || imgSize.x < 1 ) throw logic_error("Image size is zero.");
+    } catch ( const std::exception& e ) {
+        LOG_ERR << "Failed to load/preprocess file. reason: " << e.what() << ende;
+        pipe->failed = true;
+    } catch ( ... ) {
+        LOG_ERR << "Failed to load/preprocess file for unknown reason." << ende;
+        pipe->failed = true;
+    }
+    if( pipe->failed ) {
+        Job::moveTo( &myJob, Job::JSTATE_ERR );
+        myJob.progWatch.clear();
+        progWatch.clear();
+        myJob.updateProgressString();
+        return;
+    }
+    
+    if( nF ) {
+        {
+            lock_guard<mutex> lock( pipe->mtx );
+            pipe->pending += nF;
+        }
+        for( size_t j=0; j<nF; ++j ) {
+            boost::asio::post( ioc, std::bind( &Channel::frameStage, this, std::ref(ioc), pipe, i, j ) );
+        }
+    } else {
+        finishFile( *pipe, i );
+    }
+    boost::asio::post( ioc, std::bind( &Channel::readStage, this, std::ref(ioc), pipe ) );      // read ahead
+
+}
+
+
+void Channel::frameStage( boost::asio::io_context& ioc, shared_ptr<Pipeline> pipe, size_t fileIndex, size_t frame ) {
+
+    if( !pipe->failed ) {
+        preprocessImage( pipe->offsets[fileIndex]+frame );
+        if( --pipe->remaining[fileIndex] == 0 ) {
+            finishFile( *pipe, fileIndex );
+        }
+    }
+    
+    bool resume(false);
+    {
+        lock_guard<mutex> lock( pipe->mtx );
+        pipe->pending--;
+        if( pipe->parked && (pipe->pending < pipe->maxPending) ) {
+            pipe->parked--;
+            resume = true;
+        }
+    }
+    if( resume ) {
+        boost::asio::post( ioc, std::bind( &Channel::readStage, this, std::ref(ioc), pipe ) );
+    }
+
+}
+
+
+void Channel::finishFile( Pipeline& pipe, size_t i ) {
+
+    if( pipe.saveFFData ) {
+        bfs::path fn;
+        size_t nF = nFrames[i];
+        size_t offset = pipe.offsets[i];
+        try {
+            fn = bfs::path (myJob.info.outputDir) / bfs::path (boost::str (boost::format (imageTemplate) % fileNumbers[i])).filename();
+            bfs::path ext = fn.extension();
+            if(ext.string().empty() || ext.string().length() > 5 ) {     // we assume the filename does not have a proper extenstion, add a temporary dummy
+                fn = bfs::path( fn.string() + ".ext" );
             }
-            Job::moveTo( &myJob, Job::JSTATE_ERR );
-            myJob.progWatch.clear();
-            progWatch.clear();
-            myJob.updateProgressString();
-        });
-        nPreviousFrames += nFrames[i];
+            fn.replace_extension(".cor.f0");
+            LOG_DEBUG << boost::format("Saving dark/flat corrected data (%d:%d:%d) as %s.") % myObject.ID % ID % i % fn.string() << ende;
+            Image<float> view( images, offset, offset+nF-1, 0, imgSize.y-1, 0, imgSize.x-1 );
+            redux::file::Ana::write( fn.string(), view.copy() );   // TODO: other formats
+        } catch ( const std::exception& e ) {
+            LOG_ERR << "Failed to save corrected file: " << fn << "  reason: " << e.what() << ende;
+        }
+        ++myObject.progWatch;
     }
+    ++progWatch;
 
 }
 
@@ -744,6 +840,7 @@ void Channel::unloadCalib(void) {               // unload what was accessed thro
     modulationMatrix.clear();
     xOffset.clear();
     yOffset.clear();
+    pixelFiller = PixelFiller();
 
     if (!darkTemplate.empty()) {
         size_t nWild = std::count (darkTemplate.begin(), darkTemplate.end(), '%');
@@ -1100,6 +1197,93 @@ void Channel::loadFile( size_t fileIndex, size_t offset ) {
 }
 
 
+bool Channel::calibrateImage( Array<double>& tmpImg, size_t i ) {
+
+    if (! tmpImg.sameSize (dark)) {
+        LOG_ERR << boost::format ("Dimensions of dark (%s) does not match this image (%s), skipping flatfielding !!")
+                % printArray (dark.dimensions(), "") % printArray (tmpImg.dimensions(), "") << ende;
+        return false;
+    }
+    if (! tmpImg.sameSize (gain)) {
+        LOG_ERR << boost::format ("Dimensions of gain (%s) does not match this image (%s), skipping flatfielding !!")
+                % printArray (gain.dimensions(), "") % printArray (tmpImg.dimensions(), "") << ende;
+        return false;
+    }
+    const bool response = ccdResponse.valid() && tmpImg.sameSize (ccdResponse);     // N.B. checked in loadData, don't modify it here.
+    
+    double darkScale(1.0);
+    double n;
+    if(dark.meta && ((n=dark.meta->getNumberOfFrames()) > 1)) {
+        darkScale = 1.0/n;
+    }
+    
+    bool descatter = (ccdScattering.valid() && psf.valid());
+    if( !descatter ) {      // single pass over the data, instead of one per calibration step.
+        if( response ) {
+            tmpImg = (lazy( tmpImg ) - lazy( dark )*darkScale) * ccdResponse * gain;
+        } else {
+            tmpImg = (lazy( tmpImg ) - lazy( dark )*darkScale) * gain;
+        }
+        return true;
+    }
+    
+    if( response ) {   // correct for the detector response (this should not contain the gain correction and must be done before descattering)
+        tmpImg = (lazy( tmpImg ) - lazy( dark )*darkScale) * ccdResponse;
+    } else {
+        tmpImg.subtract( dark, darkScale );
+    }
+
+    if( descatter ) {           // apply backscatter correction
+        if (tmpImg.sameSize (ccdScattering) && tmpImg.sameSize (psf)) {
+            LOG_DEBUG << boost::format("Applying correction for CCD transparency for image (%d:%d:%d)") % myObject.ID % ID % i << ende;
+            redux::image::descatter( tmpImg, ccdScattering, psf );
+        } else {
+            LOG_ERR << boost::format ("Dimensions of ccdScattering (%s) or psf (%s) does not match this image (%s), skipping flatfielding !!")
+                    % printArray (ccdScattering.dimensions(), "") % printArray (psf.dimensions(), "") % printArray (tmpImg.dimensions(), "") << ende;
+        }
+    }
+
+    tmpImg *= gain;
+    
+    return true;
+
+}
+
+
+void Channel::fillImage( Array<double>& tmpImg ) {
+
+    size_t sy = tmpImg.dimSize(0);
+    size_t sx = tmpImg.dimSize(1);
+    const PixelFiller* filler = &pixelFiller;
+    PixelFiller unmasked;
+    if( !pixelFiller.valid( sy, sx ) ) {       // no (matching) gain-mask, consider all pixels.
+        unmasked.init( sy, sx );
+        filler = &unmasked;
+    }
+    
+    // N.B. the frames are already processed in parallel (see frameStage), so only one thread per frame here.
+    switch (myJob.fillpixMethod) {
+        case FPM_HORINT: {
+            filler->fill( tmpImg.ptr(), myJob.badPixelThreshold, PixelFiller::HORINT );
+            break;
+        }
+        case FPM_MEDIAN: {
+            // TODO: median method
+            break;
+        }
+        case FPM_INVDISTWEIGHT:       // inverse distance weighting is the default method, so fall through
+        default: {
+            filler->fill( tmpImg.ptr(), myJob.badPixelThreshold, PixelFiller::IDW );
+        }
+    }
+
+    // Fill larger features that the mask will exclude. This will fill e.g. black borders.
+    // TBD: Should this be skipped and force the user to be stricter with the clip/ROI instead?
+    filler->fill( tmpImg.ptr(), myJob.badPixelThreshold, PixelFiller::IDW, false );
+
+}
+
+
 void Channel::preprocessImage( size_t i ) {
 
     try {
@@ -1126,86 +1310,9 @@ void Channel::preprocessImage( size_t i ) {
             modified = true;
         }*/
 
-        if (dark.valid() && gain.valid()) {
-            if (! tmpImg.sameSize (dark)) {
-                LOG_ERR << boost::format ("Dimensions of dark (%s) does not match this image (%s), skipping flatfielding !!")
-                        % printArray (dark.dimensions(), "") % printArray (tmpImg.dimensions(), "") << ende;
-                return;
-            }
-            if (! tmpImg.sameSize (gain)) {
-                LOG_ERR << boost::format ("Dimensions of gain (%s) does not match this image (%s), skipping flatfielding !!")
-                        % printArray (gain.dimensions(), "") % printArray (tmpImg.dimensions(), "") << ende;
-                return;
-            }
-            if (ccdResponse.valid() && !tmpImg.sameSize (ccdResponse)) {
-                LOG_WARN << boost::format ("Dimensions of ccd-response (%s) does not match this image (%s), will not be used !!")
-                        % printArray (ccdResponse.dimensions(), "") % printArray (tmpImg.dimensions(), "") << ende;
-                ccdResponse.resize();
-            }
-            
-            double n;
-            if(dark.meta && ((n=dark.meta->getNumberOfFrames()) > 1)) {
-                tmpImg.subtract(dark,1.0/n);
-            } else {
-                tmpImg -= dark;
-            }
-            
-            if (ccdResponse.valid()) {   // correct for the detector response (this should not contain the gain correction and must be done before descattering)
-                tmpImg *= ccdResponse;
-            }
-
-            if (ccdScattering.valid() && psf.valid()) {           // apply backscatter correction
-                if (tmpImg.sameSize (ccdScattering) && tmpImg.sameSize (psf)) {
-                    LOG_DEBUG << boost::format("Applying correction for CCD transparency for image (%d:%d:%d)") % myObject.ID % ID % i << ende;
-                    redux::image::descatter( tmpImg, ccdScattering, psf );
-                } else {
-                    LOG_ERR << boost::format ("Dimensions of ccdScattering (%s) or psf (%s) does not match this image (%s), skipping flatfielding !!")
-                            % printArray (ccdScattering.dimensions(), "") % printArray (psf.dimensions(), "") % printArray (tmpImg.dimensions(), "") << ende;
-                }
-            }
-
-            tmpImg *= gain;
-    //         fn = bfs::path (boost::str (boost::format (imageTemplate) % i));
-    //         fn = bfs::path(fn.leaf().string() + ".dg");
-    //         redux::file::Ana::write( fn.string(), tmpImg );   // TODO: other formats
-
-            namespace sp = std::placeholders;
-            size_t sy = tmpImg.dimSize(0);
-            size_t sx = tmpImg.dimSize(1);
-
-            shared_ptr<double*> array = tmpImg.reshape(sy,sx);
-            shared_ptr<uint8_t*> mask2D;
-            if( gainMask ) {
-                mask2D = reshapeArray( gainMask.get(), sy, sx );
-            }
-            double** arrayPtr = array.get();
-            switch (myJob.fillpixMethod) {
-                case FPM_HORINT: {
-                    //LOG_DETAIL << "Filling bad pixels using horizontal interpolation." << ende;
-                    function<double (size_t, size_t) > func = bind( horizontalInterpolation<double>, arrayPtr, sy, sx, sp::_1, sp::_2);
-                    fillPixels (arrayPtr, sy, sx, func, std::bind( std::less_equal<double>(), sp::_1, myJob.badPixelThreshold), mask2D.get());
-                    break;
-                }
-                case FPM_MEDIAN: {
-                    // TODO: median method
-                    break;
-                }
-                case FPM_INVDISTWEIGHT:       // inverse distance weighting is the default method, so fall through
-                default: {
-                    //LOG_DETAIL << "Filling bad pixels using inverse distance weighted average." << ende;
-                    function<double (size_t, size_t) > func = bind( inverseDistanceWeight<double>, arrayPtr, sy, sx, sp::_1, sp::_2);
-                    fillPixels (arrayPtr, sy, sx, func, std::bind( std::less_equal<double>(), sp::_1, myJob.badPixelThreshold), mask2D.get());
-                }
-            }
-
-            // Fill larger features that the mask will exclude. This will fill e.g. black borders.
-            // TBD: Should this be skipped and force the user to be stricter with the clip/ROI instead?
-            function<double (size_t, size_t) > func = bind( inverseDistanceWeight<double>, arrayPtr, sy, sx, sp::_1, sp::_2);
-            fillPixels (arrayPtr, sy, sx, func, std::bind( std::less_equal<double>(), sp::_1, myJob.badPixelThreshold));
-            
-            // FIXME: This is a hack to create truncated values as the old code!!
-            //for(size_t i=0; i<sy*sx; ++i) arrayPtr[0][i] = (int)arrayPtr[0][i];
-            
+        if( dark.valid() && gain.valid() ) {
+            if( !calibrateImage( tmpImg, i ) ) return;
+            fillImage( tmpImg );
         }
 
         view.assign(tmpImg);                            // copy back to image
@@ -1232,20 +1339,7 @@ void Channel::preprocessImage( size_t i ) {
         }
         
         imageStats[i].reset( new ArrayStats() );
-        imageStats[i]->getStats( tmpImg );    // get stats for corrected data
-        
-        // compute median value
-        double* tmpPtr = tmpImg.ptr();
-        size_t nEl = tmpImg.nElements();
-        size_t halfEl = (nEl>>1) - !(nEl&1);
-        double* mid = tmpPtr + halfEl;
-        std::nth_element( tmpPtr, mid, tmpPtr+nEl);
-        imageStats[i]->median = *mid;
-        if( !(nEl&1) ) {
-            std::nth_element( mid, mid+1, tmpPtr+nEl );
-            imageStats[i]->median += *(mid+1);
-            imageStats[i]->median /= 2;
-        }
+        imageStats[i]->getStats( tmpImg, ST_ALL|ST_MEDIAN );    // get stats for corrected data
     } catch ( const std::exception& e ) {
         LOG_ERR << boost::format("Failed to preprocess image (%d:%d:%d)  %s") % myObject.ID % ID % i % printArray(images.dimensions(),"dims")
                 << ".  reason: " << e.what() << ende;
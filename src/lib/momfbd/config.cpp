@@ -628,7 +628,7 @@ bool ObjectCfg::operator==( const ObjectCfg& rhs ) const {
 
 GlobalCfg::GlobalCfg() : runFlags( 0), modeBasis(ZERNIKE), klMinMode( 2), klMaxMode( 2000), klCutoff( 1E-3),
     nInitialModes( 5), nModeIncrement(5), nModes(0),
-    telescopeD(0), telescopeCO(0), minIterations(5), maxIterations(500), targetIterations(3),
+    telescopeD(0), telescopeCO(0), minIterations(5), maxIterations(500), targetIterations(3), checkpointInterval(0),
     fillpixMethod(FPM_INVDISTWEIGHT), gradientMethod(GM_DIFF), getstepMethod(GSM_BFGS_inv),
     normType(NORM_OBJ_MAX_MEAN), apodizationSize(-1),
     badPixelThreshold(1E-5), filterCutoff(0.9), FTOL(1E-3), EPS(1E-10), reg_alpha(0), graddiff_step(1E-2), trace(false),
@@ -650,6 +650,7 @@ void GlobalCfg::parseProperties( bpt::ptree& tree, Logger& logger, const Channel
 
     if( getValue<bool>( tree, "CALIBRATE", false ) )            runFlags |= RF_CALIBRATE;
     if( getValue<bool>( tree, "DONT_MATCH_IMAGE_NUMS", false )) runFlags |= RF_DONT_MATCH_IMAGE_NUMS;
+    if( getValue<bool>( tree, "FAST_LINESEARCH", false ) )      runFlags |= RF_FAST_LINESEARCH;
     if( getValue<bool>( tree, "FAST_QR", false ) )              runFlags |= RF_FAST_QR;
     if( getValue<bool>( tree, "FIT_PLANE", false ) )            runFlags |= RF_FIT_PLANE;
     if( getValue<bool>( tree, "FLATFIELD", false ) )            runFlags |= RF_FLATFIELD;
@@ -661,6 +662,7 @@ void GlobalCfg::parseProperties( bpt::ptree& tree, Logger& logger, const Channel
     if( getValue<bool>( tree, "NO_FILTER", false ) )            runFlags |= RF_NO_FILTER;
     if( getValue<bool>( tree, "OLD_NS", false ) )               runFlags |= RF_OLD_NS;
     if( getValue<bool>( tree, "OVERWRITE", false ) )            runFlags |= RF_FORCE_WRITE;
+    if( getValue<bool>( tree, "SINGLE_PRECISION", false ) )     runFlags |= RF_SINGLE_PRECISION;
     if( getValue<bool>( tree, "SORT_MODES", false ) )           runFlags |= RF_SORT_MODES;
     
     trace = tree.get<bool>( "TRACE", defaults.trace );
@@ -716,6 +718,7 @@ void GlobalCfg::parseProperties( bpt::ptree& tree, Logger& logger, const Channel
     minIterations = getValue( tree, "MIN_ITER", defaults.minIterations );
     maxIterations = getValue( tree, "MAX_ITER", defaults.maxIterations );
     targetIterations = getValue( tree, "N_DONE_ITER", defaults.targetIterations );
+    checkpointInterval = getValue( tree, "CHECKPOINT", defaults.checkpointInterval );
     fillpixMethod = defaults.fillpixMethod;
     string tmpString = getValue<string>( tree, "FPMETHOD", "" );
     int tmpInt;
@@ -829,6 +832,7 @@ void GlobalCfg::getProperties( bpt::ptree& tree, const ChannelCfg& def, bool sho
     uint16_t diff = runFlags ^ defaults.runFlags;
     if( diff & RF_CALIBRATE ) tree.put( "CALIBRATE", bool( runFlags & RF_CALIBRATE ) );
     if( diff & RF_DONT_MATCH_IMAGE_NUMS ) tree.put( "DONT_MATCH_IMAGE_NUMS", bool( runFlags & RF_DONT_MATCH_IMAGE_NUMS ) );
+    if( diff & RF_FAST_LINESEARCH ) tree.put( "FAST_LINESEARCH", bool( runFlags & RF_FAST_LINESEARCH ) );
     if( diff & RF_FAST_QR ) tree.put( "FAST_QR", bool( runFlags & RF_FAST_QR ) );
     if( diff & RF_FIT_PLANE ) tree.put( "FIT_PLANE", bool( runFlags & RF_FIT_PLANE ) );
     if( diff & RF_FLATFIELD ) tree.put( "FLATFIELD", bool( runFlags & RF_FLATFIELD ) );
@@ -840,6 +844,7 @@ void GlobalCfg::getProperties( bpt::ptree& tree, const ChannelCfg& def, bool sho
     if( diff & RF_FORCE_WRITE ) tree.put( "OVERWRITE", bool( runFlags & RF_FORCE_WRITE ) );
     if( diff & RF_NOSWAP ) tree.put( "NOSWAP", bool( runFlags & RF_NOSWAP ) );
     if( diff & RF_OLD_NS ) tree.put( "OLD_NS", bool( runFlags & RF_OLD_NS ) );
+    if( diff & RF_SINGLE_PRECISION ) tree.put( "SINGLE_PRECISION", bool( runFlags & RF_SINGLE_PRECISION ) );
     if( diff & RF_SORT_MODES ) tree.put( "SORT_MODES", bool( runFlags & RF_SORT_MODES ) );
 
     if( showAll || trace != defaults.trace ) tree.put( "TRACE", trace );
@@ -858,6 +863,7 @@ void GlobalCfg::getProperties( bpt::ptree& tree, const ChannelCfg& def, bool sho
     if( showAll || minIterations != defaults.minIterations ) tree.put( "MIN_ITER", minIterations );
     if( showAll || maxIterations != defaults.maxIterations ) tree.put( "MAX_ITER", maxIterations );
     if( showAll || targetIterations != defaults.targetIterations ) tree.put( "N_DONE_ITER", targetIterations );
+    if( showAll || checkpointInterval != defaults.checkpointInterval ) tree.put( "CHECKPOINT", checkpointInterval );
     if( showAll || fillpixMethod != defaults.fillpixMethod ) tree.put( "FPMETHOD", fpmTags[fillpixMethod%4] );
     if( showAll || gradientMethod != defaults.gradientMethod ) tree.put( "GRADIENT", gmTags[gradientMethod%3] );
     if( showAll || getstepMethod != defaults.getstepMethod ) tree.put( "GETSTEP", gsmTags[getstepMethod%5] );
@@ -893,7 +899,7 @@ uint64_t GlobalCfg::size( void ) const {
                  + sizeof( modeBasis ) + sizeof( nInitialModes ) + sizeof( nModeIncrement ) + sizeof( nModes )
                  + sizeof( outputFileType ) + sizeof( outputDataType ) + sizeof( reg_alpha ) + sizeof( runFlags )
                  + sizeof( sequenceNumber ) + sizeof( targetIterations ) + sizeof( telescopeCO )
-                 + sizeof( telescopeD ) + sizeof( trace );
+                 + sizeof( telescopeD ) + sizeof( trace ) + sizeof( checkpointInterval );
     uint64_t sz = ssz + ObjectCfg::size();
     // strings
     sz += observationTime.length() + observationDate.length() + tmpDataDir.length() + 3;
@@ -936,6 +942,7 @@ uint64_t GlobalCfg::pack( char* ptr ) const {
     count += pack( ptr+count, trace );
     count += pack( ptr+count, normType );
     count += pack( ptr+count, apodizationSize );
+    count += pack( ptr+count, checkpointInterval );
     // strings
     count += pack( ptr+count, observationDate );
     count += pack( ptr+count, observationTime );
@@ -981,6 +988,7 @@ uint64_t GlobalCfg::unpack( const char* ptr, bool swap_endian ) {
     count += unpack( ptr+count, trace );
     count += unpack( ptr+count, normType );
     count += unpack( ptr+count, apodizationSize, swap_endian );
+    count += unpack( ptr+count, checkpointInterval, swap_endian );
     // strings
     count += unpack( ptr+count, observationDate );
     count += unpack( ptr+count, observationTime );
@@ -1016,6 +1024,7 @@ bool GlobalCfg::operator==( const GlobalCfg& rhs ) const {
            ( telescopeCO == rhs.telescopeCO ) &&
            ( minIterations == rhs.minIterations ) &&
            ( maxIterations == rhs.maxIterations ) &&
+           ( checkpointInterval == rhs.checkpointInterval ) &&
            ( fillpixMethod == rhs.fillpixMethod ) &&
            ( gradientMethod == rhs.gradientMethod ) &&
            ( getstepMethod == rhs.getstepMethod ) &&
@@ -8,6 +8,8 @@
 #include "redux/file/fileana.hpp"
 #include "redux/image/utils.hpp"
 
+#include <limits>
+
 using namespace redux::file;
 using namespace redux::logging;
 using namespace redux::momfbd;
@@ -383,6 +385,74 @@ void WavefrontData::dump( const string& tag ) const {
 }
 
 
+void SolverCheckpoint::clear( void ) {
+    
+    modeCount = iteration = failCount = 0;
+    totalIterations = 0;
+    alpha.clear();
+    metrics.clear();
+    
+}
+
+
+uint64_t SolverCheckpoint::size( void ) const {
+    uint64_t sz = sizeof(modeCount) + sizeof(iteration) + sizeof(totalIterations) + sizeof(failCount);
+    sz += alpha.size()*sizeof(double) + metrics.size()*sizeof(float) + 2*sizeof(uint64_t);
+    return sz;
+}
+
+
+uint64_t SolverCheckpoint::pack( char* ptr ) const {
+    using redux::util::pack;
+    uint64_t count = pack( ptr, modeCount );
+    count += pack( ptr+count, iteration );
+    count += pack( ptr+count, totalIterations );
+    count += pack( ptr+count, failCount );
+    count += pack( ptr+count, alpha );
+    count += pack( ptr+count, metrics );
+    return count;
+}
+
+
+uint64_t SolverCheckpoint::unpack( const char* ptr, bool swap_endian ) {
+    using redux::util::unpack;
+    uint64_t count = unpack( ptr, modeCount, swap_endian );
+    count += unpack( ptr+count, iteration, swap_endian );
+    count += unpack( ptr+count, totalIterations, swap_endian );
+    count += unpack( ptr+count, failCount, swap_endian );
+    count += unpack( ptr+count, alpha, swap_endian );
+    count += unpack( ptr+count, metrics, swap_endian );
+    return count;
+}
+
+
+uint64_t SolverCheckpoint::packedSize( const char* ptr, uint64_t maxSize, bool swap_endian ) {
+    using redux::util::unpack;
+    uint64_t count = sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint16_t);   // modeCount..failCount
+    for( size_t elementSize: { sizeof(double), sizeof(float) } ) {      // alpha, metrics
+        uint64_t n(0);
+        if( maxSize < count+sizeof(uint64_t) ) return 0;
+        count += unpack( ptr+count, n, swap_endian );
+        if( n > (maxSize-count)/elementSize ) return 0;
+        count += n*elementSize;
+    }
+    return count;
+}
+
+
+SolverCheckpoint& SolverCheckpoint::operator=( const SolverCheckpoint& rhs ) {
+
+    modeCount = rhs.modeCount;
+    iteration = rhs.iteration;
+    totalIterations = rhs.totalIterations;
+    failCount = rhs.failCount;
+    alpha = rhs.alpha;
+    metrics = rhs.metrics;
+    return *this;
+    
+}
+
+
 PatchData::PatchData( MomfbdJob& j, uint16_t yid, uint16_t xid) : myJob(j), index(yid,xid), finalMetric(0.0) {
     vector<shared_ptr<Object>> objs = myJob.getObjects();
 #ifdef DBG_PD_
@@ -404,6 +474,7 @@ PatchData::~PatchData() {
 void PatchData::setPath(const std::string& path) {
     string mypath = path+"/patch_"+(string)index;
     CacheItem::setPath(mypath);
+    checkpoint.setPath(mypath+"_checkpoint");
 }
 
 
@@ -453,6 +524,30 @@ void PatchData::unload( void ) {
     
 }
 
+double PatchData::cost( void ) const {
+    
+    double ret(0);
+    for( const auto& obj: objects ) {
+        if( obj && obj->myObject ) {
+            double ps = obj->myObject->patchSize;
+            ret += obj->myObject->nImages() * ps * ps;
+        }
+    }
+    double nModes = std::max<size_t>( std::max<size_t>( myJob.modeList.size(), myJob.nModes ), 1 );
+    return ret * nModes;
+    
+}
+
+
+double PatchData::distance( const Part& rhs ) const {
+    
+    const PatchData* pd = dynamic_cast<const PatchData*>( &rhs );
+    if( !pd || (&pd->myJob != &myJob) ) return std::numeric_limits<double>::max();
+    return std::max( std::abs( index.x - pd->index.x ), std::abs( index.y - pd->index.y ) );
+    
+}
+
+
 void PatchData::prePack( bool force ) {
     
     if( packed.packedSize && !force ) {
@@ -492,13 +587,14 @@ uint64_t PatchData::size( void ) const {
         if(td) sz += td->size();
     }
     sz += waveFronts.size();
+    sz += checkpoint.size();
     return sz;
 }
 
 
 uint64_t PatchData::pack( char* ptr ) const {
     
-    if( packed.packedSize ) {
+    if( packed.packedSize && !BufferList::active() ) {     // with a BufferList the images are sent directly from the arrays.
         memcpy( ptr, packed.data.get(), packed.packedSize );
         return packed.packedSize;
     }
@@ -526,6 +622,7 @@ uint64_t PatchData::pack( char* ptr ) const {
             }
         }
     }
+    count += checkpoint.pack( ptr+count );
 
     return count;
     
@@ -554,6 +651,7 @@ uint64_t PatchData::unpack( const char* ptr, bool swap_endian ) {
         tobj.reset( new ObjectData() );
         count += tobj->unpack( ptr+count, swap_endian );
     }
+    count += checkpoint.unpack( ptr+count, swap_endian );
 
     return count;
 }
@@ -591,6 +689,7 @@ PatchData& PatchData::operator=( const PatchData& rhs ) {
     roi = rhs.roi;
     finalMetric = rhs.finalMetric;
     metrics = rhs.metrics;
+    checkpoint = rhs.checkpoint;
 
     for( size_t i=0; i<objects.size(); ++i ) {
         objects[i] = rhs.objects[i];
@@ -618,6 +717,7 @@ void PatchData::copyResults( const PatchData& rhs ) {
 
     finalMetric = rhs.finalMetric;
     metrics = rhs.metrics;
+    checkpoint = rhs.checkpoint;        // normally empty, the slave clears it when the patch is completed.
     nThreads = rhs.nThreads;
     runtime_wall = rhs.runtime_wall;
     runtime_cpu = rhs.runtime_cpu;
@@ -665,14 +765,13 @@ shared_ptr<ModeSet> GlobalData::get( const ModeInfo& mi, double scale, const sha
     if( sit == scaled_modes.end() ) {        
         auto it = modes.find( mi );     // get the unscalled ModeSet
         if( it == modes.end() ) {
-            shared_ptr<ModeSet>& ret = redux::util::Cache::get<ModeInfo,shared_ptr<ModeSet>>( mi, ms );
-            if( !ret ) {
-                ret.reset( new ModeSet() );
-             }
+            shared_ptr<ModeSet> ret = redux::util::Cache::getOrCreate<ModeInfo,shared_ptr<ModeSet>>( mi, [&ms](){
+                return ms ? ms : shared_ptr<ModeSet>( new ModeSet() );
+            });
             ret->info = mi;
             it = modes.emplace(mi, ret).first;
         }
-        shared_ptr<ModeSet>& ret = redux::util::Cache::get< ScaledModeInfo, shared_ptr<ModeSet>>( id, it->second );
+        shared_ptr<ModeSet> ret = redux::util::Cache::getOrCreate< ScaledModeInfo, shared_ptr<ModeSet>>( id, [&it](){ return it->second; } );
         if( ret ) {       // First use of this ModeSet/scale, so copy/rescale it
             sit = scaled_modes.emplace(id, ret).first;
             ret->info = id.first;
@@ -691,8 +790,9 @@ shared_ptr<ModeSet> GlobalData::get(const ModeInfo& id, const shared_ptr<ModeSet
     unique_lock<mutex> lock(mtx);
     auto it = modes.find(id);
     if( it == modes.end() ){
-        shared_ptr<ModeSet>& ret = redux::util::Cache::get<ModeInfo,shared_ptr<ModeSet>>(id, ms);
-        if( !ret ) ret.reset( new ModeSet() );
+        shared_ptr<ModeSet> ret = redux::util::Cache::getOrCreate<ModeInfo,shared_ptr<ModeSet>>( id, [&ms](){
+            return ms ? ms : shared_ptr<ModeSet>( new ModeSet() );
+        });
         it = modes.emplace(id, ret).first;
     }
     return it->second;
@@ -705,8 +805,9 @@ shared_ptr<Pupil> GlobalData::get(const PupilInfo& id, const shared_ptr<Pupil>&
     unique_lock<mutex> lock(mtx);
     auto it = pupils.find(id);
     if( it == pupils.end() ){
-        shared_ptr<Pupil>& ret = redux::util::Cache::get<PupilInfo,shared_ptr<Pupil>>(id, ms);
-        if( !ret ) ret.reset( new Pupil() );
+        shared_ptr<Pupil> ret = redux::util::Cache::getOrCreate<PupilInfo,shared_ptr<Pupil>>( id, [&ms](){
+            return ms ? ms : shared_ptr<Pupil>( new Pupil() );
+        });
         it = pupils.emplace(id, ret).first;
     }
     return it->second;
@@ -716,6 +817,9 @@ shared_ptr<Pupil> GlobalData::get(const PupilInfo& id, const shared_ptr<Pupil>&
 
 GlobalData::GlobalData(MomfbdJob& j ) : constraints(j) {
      partType = PT_GLOBAL;
+     static const bool evictable RDX_UNUSED = Cache::setEvictable<ModeInfo,shared_ptr<ModeSet>>()
+                                           && Cache::setEvictable<ScaledModeInfo,shared_ptr<ModeSet>>()
+                                           && Cache::setEvictable<PupilInfo,shared_ptr<Pupil>>();
 #ifdef DBG_GD_
     cout << "Constructing GlobalData: (" << hexString(this) << ") new instance count = " << (gdCounter.fetch_add(1)+1) << endl;
 #endif
@@ -741,6 +845,8 @@ bool GlobalData::verify( void ) const {
 
 uint64_t GlobalData::size( void ) const {
     
+    BufferList::Scope inlineOnly( nullptr );        // always packed inline, see pack()
+    
     uint64_t sz = 2*sizeof(uint16_t); // nModes & nPupils
     for( auto& mode: modes ) {
         sz += mode.first.size();
@@ -761,6 +867,7 @@ uint64_t GlobalData::pack( char* ptr ) const {
     
     unique_lock<mutex> lock(mtx);
     using redux::util::pack;
+    BufferList::Scope inlineOnly( nullptr );        // modes/pupils are post-processed in unpack, so never defer their data.
     
     if( packed.packedSize ) {
         memcpy( ptr, packed.data.get(), packed.packedSize );
@@ -786,6 +893,7 @@ uint64_t GlobalData::pack( char* ptr ) const {
 uint64_t GlobalData::unpack( const char* ptr, bool swap_endian ) {
     using redux::util::unpack;
     unique_lock<mutex> lock(mtx);
+    BufferList::Scope inlineOnly( nullptr );
     uint16_t tmp;
     uint64_t count = unpack(ptr,tmp,swap_endian);
     if(tmp) {
@@ -793,8 +901,9 @@ uint64_t GlobalData::unpack( const char* ptr, bool swap_endian ) {
         modes.clear();
         while( tmp-- > 0 ) {
             count += id.unpack(ptr+count,swap_endian);
-            shared_ptr<ModeSet>& ms = redux::util::Cache::get<ModeInfo,shared_ptr<ModeSet>>(id);
-            if( !ms ) ms.reset( new ModeSet() );
+            shared_ptr<ModeSet> ms = redux::util::Cache::getOrCreate<ModeInfo,shared_ptr<ModeSet>>( id, [](){
+                return shared_ptr<ModeSet>( new ModeSet() );
+            });
             count += ms->unpack(ptr+count,swap_endian);
             modes.emplace(id, ms);
         }
@@ -805,8 +914,9 @@ uint64_t GlobalData::unpack( const char* ptr, bool swap_endian ) {
         pupils.clear();
         while( tmp-- > 0 ) {
             count += id.unpack(ptr+count,swap_endian);
-            shared_ptr<Pupil>& pup = redux::util::Cache::get<PupilInfo,shared_ptr<Pupil>>(id);
-            if( !pup ) pup.reset( new Pupil() );
+            shared_ptr<Pupil> pup = redux::util::Cache::getOrCreate<PupilInfo,shared_ptr<Pupil>>( id, [](){
+                return shared_ptr<Pupil>( new Pupil() );
+            });
             count += pup->unpack(ptr+count,swap_endian);
             pupils.emplace(id, pup);
         }
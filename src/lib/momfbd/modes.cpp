@@ -26,6 +26,24 @@ using namespace std;
 namespace bfs = boost::filesystem;
 
 
+namespace {
+    
+    // N.B. the mode is generated outside the map lock, since a K-L mode fetches its Zernike components from the same map.
+    template <typename F>
+    PupilMode::Ptr cachedMode( const ModeInfo& info, F generate, bool force=false ) {
+        static const bool evictable RDX_UNUSED = Cache::setEvictable< ModeInfo, PupilMode::Ptr >();
+        PupilMode::Ptr mode;
+        if( !force ) mode = Cache::find< ModeInfo, PupilMode::Ptr >( info );
+        if( !mode ) {
+            mode = generate();
+            mode = Cache::getOrCreate< ModeInfo, PupilMode::Ptr >( info, [&mode](){ return mode; }, force );
+        }
+        return mode;
+    }
+
+}
+
+
 ModeInfo::ModeInfo( const string& filename, uint16_t nPixels, bool norm )
     : firstMode(0), lastMode(0), modeNumber(0), nPupilPixels(nPixels),
       pupilRadius(0), angle(0), cutoff(0), filename(filename), normalize(norm) {
@@ -177,10 +195,9 @@ PupilMode::PupilMode(uint16_t firstZernike, uint16_t lastZernike, uint16_t klMod
         double c = weight.second;
         if(fabs(c) >= cutoff) {
             z_info.modeNumber = weight.first;
-            auto& mode = redux::util::Cache::get< ModeInfo, PupilMode::Ptr >( z_info, PupilMode::Ptr() );
-            if( !mode ) {
-                mode.reset( new PupilMode( weight.first, nPoints, r_c, angle, flags ) );    // generate Zernike
-            }
+            PupilMode::Ptr mode = cachedMode( z_info, [&](){       // generate Zernike
+                return PupilMode::Ptr( new PupilMode( weight.first, nPoints, r_c, angle, flags ) );
+            });
             this->add(*mode, c);
         }
     }
@@ -205,14 +222,15 @@ PupilMode::PupilMode(uint16_t firstZernike, uint16_t lastZernike, uint16_t klMod
 }
 
 
-ModeSet::ModeSet() : info(""), J_T_xy{{0}}, J_xy_T{{0}}, tiltMode(-1,-1) {
+ModeSet::ModeSet() : info(""), J_T_xy{{0}}, J_xy_T{{0}}, tiltMode(-1,-1), supportSize(0) {
     
 }
 
 
 ModeSet::ModeSet(ModeSet&& rhs) : redux::util::Array<double>(std::move(reinterpret_cast<redux::util::Array<double>&>(rhs))),
     info(std::move(rhs.info)), tiltMode(std::move(rhs.tiltMode)), modeList(std::move(rhs.modeList)),
-    modePointers(std::move(rhs.modePointers)), atm_rms(std::move(rhs.atm_rms)) {
+    modePointers(std::move(rhs.modePointers)), atm_rms(std::move(rhs.atm_rms)),
+    supportModes(std::move(rhs.supportModes)), supportSize(rhs.supportSize) {
         
     memcpy( J_T_xy, rhs.J_T_xy, sizeof(J_T_xy) );
     memcpy( J_xy_T, rhs.J_xy_T, sizeof(J_xy_T) );
@@ -222,7 +240,7 @@ ModeSet::ModeSet(ModeSet&& rhs) : redux::util::Array<double>(std::move(reinterpr
 
 ModeSet::ModeSet(const ModeSet& rhs) : redux::util::Array<double>(reinterpret_cast<const redux::util::Array<double>&>(rhs)),
     info(rhs.info), tiltMode(rhs.tiltMode), modeList(rhs.modeList), modePointers(rhs.modePointers),
-    atm_rms(rhs.atm_rms) {
+    atm_rms(rhs.atm_rms), supportModes(rhs.supportModes), supportSize(rhs.supportSize) {
         
     memcpy( J_T_xy, rhs.J_T_xy, sizeof(J_T_xy) );
     memcpy( J_xy_T, rhs.J_xy_T, sizeof(J_xy_T) );
@@ -283,6 +301,8 @@ ModeSet& ModeSet::operator=( const ModeSet& rhs ) {
     atm_rms = rhs.atm_rms;
     norms = rhs.norms;
     modePointers = rhs.modePointers;
+    supportModes = rhs.supportModes;
+    supportSize = rhs.supportSize;
     tiltMode = rhs.tiltMode;
     memcpy( J_T_xy, rhs.J_T_xy, sizeof(J_T_xy) );
     memcpy( J_xy_T, rhs.J_xy_T, sizeof(J_xy_T) );
@@ -382,10 +402,9 @@ void ModeSet::generate( uint16_t pixels, double radius, double angle, const Mode
         } else {
             forced.insert(nm);
         }
-        auto& mode = redux::util::Cache::get< ModeInfo, PupilMode::Ptr >( minfo );
-        if( !mode || (tmp_flags&Zernike::FORCE) ) {
-            mode.reset( new PupilMode( minfo.modeNumber, pixels, radius, angle, tmp_flags ) );    // Zernike
-        }
+        PupilMode::Ptr mode = cachedMode( minfo, [&](){       // Zernike
+            return PupilMode::Ptr( new PupilMode( minfo.modeNumber, pixels, radius, angle, tmp_flags ) );
+        }, (tmp_flags&Zernike::FORCE) );
 
         view.assign( reinterpret_cast<const redux::util::Array<double>&>(*mode) );
         modePointers.push_back(view.ptr(0,0,0));
@@ -421,14 +440,12 @@ void ModeSet::generate( uint16_t pixels, double radius, double angle, uint16_t f
             info.firstMode = info.lastMode = 0;
             it.type = ZERNIKE;
         }
-        auto& mode = redux::util::Cache::get< ModeInfo, PupilMode::Ptr >( info );
-        if( !mode || (flags&Zernike::FORCE) ) {
+        PupilMode::Ptr mode = cachedMode( info, [&](){
             if( it.type == ZERNIKE ) {     // force use of Zernike modes for all tilts
-                mode.reset( new PupilMode( info.modeNumber, pixels, radius, angle, flags ) );    // Zernike
-            } else {
-                mode.reset( new PupilMode( firstZernike, lastZernike, info.modeNumber, pixels, radius, angle, cutoff, flags ) );    // K-L
+                return PupilMode::Ptr( new PupilMode( info.modeNumber, pixels, radius, angle, flags ) );    // Zernike
             }
-        }
+            return PupilMode::Ptr( new PupilMode( firstZernike, lastZernike, info.modeNumber, pixels, radius, angle, cutoff, flags ) );    // K-L
+        }, (flags&Zernike::FORCE) );
 
         view.assign( reinterpret_cast<const redux::util::Array<double>&>(*mode) );
         modePointers.push_back(view.ptr(0,0,0));
@@ -532,4 +549,29 @@ void ModeSet::normalize( double scale ) {
         norms[i] = mode_scale;
     }
     
+    supportModes.clear();       // invalidate, the compacted modes have to be re-generated.
+    supportSize = 0;
+    
+}
+
+
+void ModeSet::compactSupport( const Pupil& pupil ) {
+    
+    unique_lock<mutex> lock(mtx);
+    
+    const size_t nSupport = pupil.pupilInOTF.size();
+    const size_t nModes = modePointers.size();
+    if( supportSize == nSupport && supportModes.size() == nModes*nSupport ) return;
+    
+    supportModes.resize( nModes*nSupport );
+    const int32_t* indexPtr = pupil.pupilIndex.data();
+    for( size_t m(0); m<nModes; ++m ) {
+        const double* modePtr = modePointers[m];
+        double* outPtr = supportModes.data() + m*nSupport;
+        for( size_t i(0); i<nSupport; ++i ) {
+            outPtr[i] = modePtr[indexPtr[i]];
+        }
+    }
+    supportSize = nSupport;
+    
 }
@@ -10,6 +10,7 @@
 #include "redux/file/fileana.hpp"
 #include "redux/util/bitoperations.hpp"
 #include "redux/util/cache.hpp"
+#include "redux/util/executor.hpp"
 #include "redux/util/fileutil.hpp"
 #include "redux/util/stringutil.hpp"
 #include "redux/util/trace.hpp"
@@ -68,13 +69,19 @@ MomfbdJob::~MomfbdJob( void ) {
 
 uint64_t MomfbdJob::packParts( char* ptr, WorkInProgress::Ptr wip  ) const {
     
-    using redux::util::pack;
     if( !wip ) throw job_error( info.name + ": Can not pack parts without a valid WIP instance."  );
-    if( wip->parts.empty() ) throw job_error( info.name + ": Can not pack an empty list of parts."  );
     THREAD_MARK
-    wip->parts.resize(1);
+    vector<Part::Ptr> patchParts;           // a work-unit can contain several patches, but globalData is appended below (if needed)
+    for( auto& part: wip->parts ) {
+        if( part && (part != globalData) ) patchParts.push_back( part );
+    }
+    if( patchParts.empty() ) throw job_error( info.name + ": Can not pack an empty list of parts."  );
+    wip->parts = std::move( patchParts );
     THREAD_MARK
-    uint64_t count = wip->parts[0]->pack( ptr );
+    uint64_t count(0);
+    for( auto& part: wip->parts ) {
+        count += part->pack( ptr+count );
+    }
     THREAD_MARK
     if( wip->jobID != info.id ) {           // First part from this job, so we need to send the global info
         THREAD_MARK
@@ -95,19 +102,21 @@ uint64_t MomfbdJob::packParts( char* ptr, WorkInProgress::Ptr wip  ) const {
 
 uint64_t MomfbdJob::unpackParts( const char* ptr, WorkInProgress::Ptr wip, bool swap_endian ) {
     
-    using redux::util::unpack;
     if( !wip ) throw job_error( info.name + ": Can not unpack parts without a valid WIP instance."  );
 
     wip->parts.clear();
     uint64_t count(0);
-    if( wip->nParts ) {
+    bool hasGlobal = (wip->jobID != info.id);   // same condition as in packParts, wip->jobID is the one that was packed.
+    uint16_t nPatches = wip->nParts;
+    if( hasGlobal && nPatches ) nPatches--;
+    for( uint16_t i=0; i<nPatches; ++i ) {
         PatchData* tmpPD = new PatchData(*this);
-        count += tmpPD->unpack( ptr+count, swap_endian );
-        if( wip->nParts > 1 ) {
-            globalData.reset( new GlobalData(*this) );
-            count += globalData->unpack( ptr+count, swap_endian );
-        }
         wip->parts.push_back( Part::Ptr(tmpPD) );
+        count += tmpPD->unpack( ptr+count, swap_endian );
+    }
+    if( hasGlobal && (wip->nParts > nPatches) ) {
+        globalData.reset( new GlobalData(*this) );
+        count += globalData->unpack( ptr+count, swap_endian );
     }
     return count;
     
@@ -372,7 +381,7 @@ bool MomfbdJob::getWork( WorkInProgress::Ptr wip, uint16_t nThreads, const map<J
                         wip->parts.push_back( globalData );
                     }
                     ret = true;
-                    break;// only 1 part at a time for MomfbdJob
+                    break;// only 1 patch per queued WIP, Daemon::sendWork combines them into work-units.
                 }
             }
             THREAD_MARK
@@ -466,7 +475,12 @@ void MomfbdJob::returnResults( WorkInProgress::Ptr wip ) {
         for( auto& part : wip->parts ) {
             auto tmpPatch = static_pointer_cast<PatchData>( part );
             PatchData::Ptr patch = patches( tmpPatch->index.y, tmpPatch->index.x );
+            if( patch->step == JSTEP_POSTPROCESS ) {    // already returned (e.g. it timed out and was re-sent to another slave)
+                LOG_DETAIL << "returnResults(): Patch " << (string)patch->index << " has already been returned, ignoring duplicate." << ende;
+                continue;
+            }
             patch->copyResults(*tmpPatch);         // copies the returned results without overwriting other variables.
+            patch->checkpoint.cacheRemove();
             patch->step = JSTEP_POSTPROCESS;
             ++progWatch;
         }
@@ -484,8 +498,67 @@ void MomfbdJob::returnResults( WorkInProgress::Ptr wip ) {
 }
 
 
+void MomfbdJob::checkpoint( const PatchData& pd ) {
+    
+    if( !checkpointCallback ) return;
+    
+    using redux::util::pack;
+    uint64_t sz = sizeof(uint64_t) + pd.index.size() + pd.checkpoint.size();
+    shared_ptr<char> buf = rdx_get_shared<char>(sz);
+    uint64_t count = pack( buf.get(), pd.id );
+    count += pd.index.pack( buf.get()+count );
+    count += pd.checkpoint.pack( buf.get()+count );
+    checkpointCallback( buf, count );
+    LOG_DEBUG << "Checkpoint for patch " << (string)pd.index << " sent:  modes=" << pd.checkpoint.modeCount
+              << "  iterations=" << pd.checkpoint.totalIterations << ende;
+    
+}
+
+
+void MomfbdJob::putCheckpoint( WorkInProgress::Ptr wip, const char* ptr, uint64_t sz, bool swap_endian ) {
+
+    using redux::util::unpack;
+    uint64_t partID;
+    Point16 index;
+    if( sz < sizeof(partID) + index.size() ) {      // N.B. check everything before unpacking, the block comes from the network.
+        throw job_error( "Checkpoint data is truncated." );
+    }
+    uint64_t count = unpack( ptr, partID, swap_endian );
+    count += index.unpack( ptr+count, swap_endian );
+    if( !SolverCheckpoint::packedSize( ptr+count, sz-count, swap_endian ) ) {
+        throw job_error( "Checkpoint data is truncated." );
+    }
+    
+    auto lock = getLock();
+    PatchData::Ptr patch;
+    if( (index.y < patches.dimSize(0)) && (index.x < patches.dimSize(1)) ) {
+        patch = patches( index.y, index.x );
+    }
+    bool inWIP(false);      // N.B. both the ID and the index come from the network, they have to refer to the same assigned patch.
+    for( auto& part: wip->parts ) {
+        if( patch && (part == patch) && (patch->id == partID) ) inWIP = true;
+    }
+    if( !inWIP ) {
+        throw job_error( "Received checkpoint for a patch that is not assigned to this host." );
+    }
+    if( patch->step != JSTEP_RUNNING ) {       // late arrival, the patch has already been returned/requeued.
+        return;
+    }
+    count += patch->checkpoint.unpack( ptr+count, swap_endian );
+    patch->checkpoint.cacheStore();
+    LOG_DETAIL << "Checkpoint for patch " << (string)index << ":  modes=" << patch->checkpoint.modeCount
+               << "  iterations=" << patch->checkpoint.totalIterations << ende;
+    
+}
+
+
 void MomfbdJob::cleanup(void) {
     
+    THREAD_MARK;
+    tasks.cancel();
+    tasks.wait();           // before getLock(), the tasks take it too.
+    tasks.restart();
+    
     THREAD_MARK;
     clearPatches();
     
@@ -574,7 +647,7 @@ bool MomfbdJob::run( WorkInProgress::Ptr wip, uint16_t maxThreads ) {
             }
 
             if( !solver ) solver.reset( new Solver(*this, ioContext, maxThreads) );
-            for( auto& part : wip->parts ) {      // momfbd jobs will only get 1 part at a time, this is just to keep things generic.
+            for( auto& part : wip->parts ) {      // a work-unit from the master can contain several patches.
                 logger.setContext( "job "+to_string(info.id)+":"+to_string(part->id) );
                 // Run main processing
                 auto data = static_pointer_cast<PatchData>(part);
@@ -1418,7 +1491,7 @@ bool MomfbdJob::check(void) {
         case JSTEP_SUBMIT: {    // When checking is delegated to the manager.
             moveTo( this, JSTEP_CHECKING );
             updateProgressString();
-            std::thread([this]() {
+            tasks.submit( Executor::PREPROCESS, [this]() {
                 THREAD_MARK
                 auto lock = getLock();
                 bool all_ok =  (cfgChecked || checkCfg());
@@ -1432,11 +1505,11 @@ bool MomfbdJob::check(void) {
                 }
                 stopLog();
 //                THREAD_UNMARK;
-            }).detach();
+            });
             break;
         }
         case JSTEP_RUNNING: {    // this check should find orphan parts etc.
-            std::thread( std::bind(&MomfbdJob::checkParts,this) ).detach();
+            tasks.submit( Executor::PREPROCESS, std::bind(&MomfbdJob::checkParts,this) );
             break;
         }
         case JSTEP_CHECKING:
@@ -49,7 +49,7 @@ namespace {
     
 }
 
-Object::Object( MomfbdJob& j, uint16_t id ): ObjectCfg(j), myJob(j), logger(j.logger), currentMetric(0), reg_gamma(0),
+Object::Object( MomfbdJob& j, uint16_t id ): ObjectCfg(j), myJob(j), logger(j.logger), nPartials(0), currentMetric(0), reg_gamma(0),
     frequencyCutoff(0),pupilRadiusInPixels(0), patchSize2(0), otfSize(0), otfSize2(0),
     ID(id), traceID(-1), normalizeTo(0), imgSize(0), nObjectImages(0),
     startT(bpx::not_a_date_time), endT(bpx::not_a_date_time) {
@@ -58,7 +58,7 @@ Object::Object( MomfbdJob& j, uint16_t id ): ObjectCfg(j), myJob(j), logger(j.lo
 
 
 Object::Object( const Object& rhs, uint16_t id, int tid ) : ObjectCfg(rhs), myJob(rhs.myJob), logger(rhs.logger),
-    channels(rhs.channels), currentMetric(rhs.currentMetric), reg_gamma(rhs.reg_gamma),
+    channels(rhs.channels), nPartials(0), currentMetric(rhs.currentMetric), reg_gamma(rhs.reg_gamma),
     frequencyCutoff(rhs.frequencyCutoff), pupilRadiusInPixels(rhs.pupilRadiusInPixels),
     patchSize2(rhs.patchSize2), otfSize(rhs.otfSize), otfSize2(rhs.otfSize2),
     ID (id), traceID(tid), normalizeTo(rhs.normalizeTo), imgSize(rhs.imgSize), nObjectImages(rhs.nObjectImages),
@@ -175,6 +175,9 @@ void Object::cleanup(void ){
     PQ.reset();
     PS.reset();
     QS.reset();
+    partP.reset();
+    partQ.reset();
+    nPartials = 0;
     fittedPlane.clear( );
     pupil.reset( );
     modes.reset( );
@@ -260,6 +263,7 @@ void Object::initProcessing( Solver& ws ){
     
         modes->tiltMode = -1;   // FIXME: Why do we need to force a recalc? Jacobian should be sent from master.
         modes->measureJacobian( *pupil, wavelength*(0.5*frequencyCutoff)/util::pix2cf( arcSecsPerPixel, myJob.telescopeD ) );
+        modes->compactSupport( *pupil );
 
     } else {
         LOG_ERR << "Object patchSize is 0 !!!" << ende;
@@ -498,33 +502,77 @@ void Object::addDiffToPQ(const redux::image::FourierTransform& ft, const Array<c
     const complex_t *otfPtr = otf.get( );
     const complex_t *ootfPtr = oldotf.get( );
 
-    for( auto& ind: pupil->otfSupport ){
+    const size_t nHalf = pupil->otfHalfSupport.size();
+    const size_t* indPtr = pupil->otfHalfSupport.data();
+    for( size_t i=0; i<nHalf; ++i ){
+        const size_t ind = indPtr[i];
         qPtr[ind] += norm(otfPtr[ind] )- norm(ootfPtr[ind] );
         pPtr[ind] += conj(ftPtr[ind] )*( otfPtr[ind] - ootfPtr[ind] );
     }
+    mirrorPQ( 0, nHalf );
+    
 }
 
 
-void Object::addToPQ(const complex_t* pp, const double* qq ){
-
+void Object::addAllPQ(void ){
+    for( auto& ch : channels ){
+        for( auto& im : ch->subImages ){
+            lock_guard<mutex> lock( mtx );
+            im->addPQ( P.get(),Q.get() );
+        }
+    }
     lock_guard<mutex> lock( mtx );
+    mirrorPQ( 0, pupil->otfHalfSupport.size() );
+}
+
+
+void Object::mirrorPQ( size_t first, size_t last ){
+    
+    last = std::min( last, pupil->otfHalfSupport.size() );
+    const size_t* indPtr = pupil->otfHalfSupport.data();
+    const size_t* mirrorPtr = pupil->otfHalfMirror.data();
     double *qPtr = Q.get( );
     complex_t *pPtr = P.get( );
-    for( auto& ind: pupil->otfSupport ){
-        qPtr[ind] += qq[ind];
-        pPtr[ind] += pp[ind];
+    for( size_t i=first; i<last; ++i ){
+        qPtr[mirrorPtr[i]] = qPtr[indPtr[i]];
+        pPtr[mirrorPtr[i]] = conj( pPtr[indPtr[i]] );
     }
     
 }
 
 
-void Object::addAllPQ(void ){
-    for( auto& ch : channels ){
-        for( auto& im : ch->subImages ){
-            lock_guard<mutex> lock( mtx );
-            im->addPQ( P.get(),Q.get() );
-        }
+void Object::initPartials( size_t n ){
+    
+    // The first task accumulates directly into P/Q, so only n-1 extra buffers are needed.
+    lock_guard<mutex> lock( mtx );
+    if( n == nPartials ) return;
+    partP.reset();
+    partQ.reset();
+    nPartials = n;
+    if( n > 1 ) {
+        partP = rdx_get_shared<complex_t>((n-1)*otfSize2);
+        partQ = rdx_get_shared<double>((n-1)*otfSize2);
     }
+    
+}
+
+
+void Object::reducePartials( size_t dst, size_t src, size_t first, size_t last ){
+    
+    // N.B. no locking: this is called in parallel for different pairs and/or non-overlapping ranges of the (half) otf-support.
+    last = std::min( last, pupil->otfHalfSupport.size() );
+    if( first >= last || dst == src || std::max( dst, src ) >= nPartials ) return;
+    const size_t* indPtr = pupil->otfHalfSupport.data();
+    double *qPtr = partialQ(dst);
+    complex_t *pPtr = partialP(dst);
+    const double* pqPtr = partialQ(src);
+    const complex_t* ppPtr = partialP(src);
+    for( size_t i=first; i<last; ++i ){
+        const size_t ind = indPtr[i];
+        qPtr[ind] += pqPtr[ind];
+        pPtr[ind] += ppPtr[ind];
+    }
+    
 }
 
 
@@ -541,10 +589,16 @@ void Object::calcHelpers(void ){
     double *psPtr = PS.get( );
     double *qsPtr = QS.get( );
 
-    for( auto& ind: pupil->otfSupport ){
+    const size_t nHalf = pupil->otfHalfSupport.size();
+    for( size_t i=0; i<nHalf; ++i ){
+        const size_t ind = pupil->otfHalfSupport[i];
+        const size_t mirror = pupil->otfHalfMirror[i];
         pqPtr[ind] = pPtr[ind] * qPtr[ind];
         psPtr[ind] = norm( pPtr[ind] );
         qsPtr[ind] = qPtr[ind] * qPtr[ind];
+        pqPtr[mirror] = conj( pqPtr[ind] );
+        psPtr[mirror] = psPtr[ind];
+        qsPtr[mirror] = qsPtr[ind];
     }
     
 }
@@ -606,8 +660,10 @@ void Object::calcMetric( void ){
     currentMetric = 0;
     //size_t N = 4*pupilPixels*pupilPixels;
     //for( size_t ind=0; ind<N; ++ind ){
-    for( auto & ind : pupil->otfSupport ){
-        currentMetric +=( ftsPtr[ind] - norm( pPtr[ind] )/ qPtr[ind] );
+    const size_t nHalf = pupil->otfHalfSupport.size();
+    for( size_t i=0; i<nHalf; ++i ){       // symmetric terms, so sum over the half-support
+        const size_t ind = pupil->otfHalfSupport[i];
+        currentMetric += pupil->otfHalfWeight[i]*( ftsPtr[ind] - norm( pPtr[ind] )/ qPtr[ind] );
     }
 
     currentMetric /=( patchSize*patchSize );
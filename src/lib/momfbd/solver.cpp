@@ -30,6 +30,8 @@ namespace sp=std::placeholders;
 size_t redux::momfbd::thread::TmpStorage::currentSize = 0;
 uint16_t redux::momfbd::thread::TmpStorage::patchSize = 0;
 uint16_t redux::momfbd::thread::TmpStorage::pupilSize = 0;
+bool redux::momfbd::thread::TmpStorage::singlePrecision = false;
+const size_t redux::momfbd::thread::TmpStorage::batchSize = 8;
 
 //#define DEBUG_
 //#define MASSIVE_DEBUG_
@@ -62,9 +64,9 @@ redux::momfbd::thread::TmpStorage* Solver::tmp( bool force ) {
 }
 
 Solver::Solver( MomfbdJob& j, boost::asio::io_context& ioc, uint16_t t ) : job(j), myInfo( network::Host::myInfo() ),
-    logger(j.logger), objects( j.getObjects() ), ioContext(ioc), maxThreads(t), nFreeParameters(0), nTotalImages(0),
+    logger(j.logger), objects( j.getObjects() ), ioContext(ioc), lineReg1(0), lineReg2(0), maxThreads(t), nFreeParameters(0), nTotalImages(0),
     beta(nullptr), grad_beta(nullptr), search_dir(nullptr), tmp_beta(nullptr),
-    regAlphaWeights(nullptr), patchSize2(0), pupilSize2(0), nTotalPixels(0), otfSize(0), otfSize2(0) {
+    regAlphaWeights(nullptr), patchSize2(0), pupilSize2(0), nTotalPixels(0), otfSize(0), otfSize2(0), gradientType(GM_DIFF) {
 
     init();
 
@@ -127,9 +129,10 @@ void Solver::init( void ) {
     
     //redux::image::apodizeInPlace( noiseWindow, patchSize / 16);     // FIXME: old code specifies md/16, but applies it after "window", so it is actually the product...
     
-    tmpPhi.resize( nTotalImages, pupilSize, pupilSize );
-    tmpPhiGrad.resize( nTotalImages, pupilSize, pupilSize );
-    tmpOTF.resize( nTotalImages, otfSize, otfSize );
+    if( job.runFlags & RF_FAST_LINESEARCH ) {
+        tmpPhi.resize( nTotalImages, pupilSize, pupilSize );
+        tmpPhiGrad.resize( nTotalImages, pupilSize, pupilSize );
+    }
 
     enabledModes = rdx_get_shared<bool>(nModes);
     
@@ -147,6 +150,7 @@ void Solver::init( void ) {
     double* raPtr = regAlphaWeights.get();
     for( auto & object : objects ) {
         object->initProcessing( *this );
+        object->initPartials( std::min<size_t>( maxThreads, object->nImages() ) );
         double scale = job.reg_alpha/object->wavelength;
         scale *= nTotalPixels;      // FIXME the other term in the metric should be normalized instead
         for( size_t i=0; i<object->nImages(); ++i ) {
@@ -163,7 +167,14 @@ void Solver::init( void ) {
         offset += nModes;
     }
     
-    thread::TmpStorage::setSize( patchSize, pupilSize );
+    bool singlePrecision = (job.runFlags & RF_SINGLE_PRECISION);
+#ifndef HAVE_FFTW3F
+    if( singlePrecision ) {
+        LOG_WARN << "SINGLE_PRECISION is ignored, this build does not have single precision FFTW3 (fftw3f)." << ende;
+        singlePrecision = false;
+    }
+#endif
+    thread::TmpStorage::setSize( patchSize, pupilSize, singlePrecision );
     tmp(true)->init();     // temp-storage for the main thread.
     set<std::thread::id> initDone;
     while(true) {
@@ -179,6 +190,62 @@ void Solver::init( void ) {
         unique_lock<mutex> lock(mtx);
         if( initDone.size() == maxThreads ) break;
     }
+    
+    placeImages();
+
+}
+
+
+void Solver::placeImages( void ) {
+    
+    // Group the subimages into batches (see applyAlpha), and distribute the batches round-robin over the NUMA-nodes.
+    // Without NUMA-mode, everything ends up in a single queue and this is just a fixed work-list.
+    batches.clear();
+    images.clear();
+    batchQueue.clear();
+    imageQueue.clear();
+    
+    vector<int> nodes(1,0);
+    if( numa::enabled() ) {
+        nodes.clear();
+        for( size_t n=0; n<numa::nNodes(); ++n ) {
+            if( !numa::cpus(n).empty() ) nodes.push_back(n);    // skip memory-only nodes
+        }
+    }
+    
+    size_t offset(0);
+    for( const auto& o: objects ) {
+        for( const auto& c: o->getChannels() ) {
+            const vector< shared_ptr<SubImage> >& imgs = c->getSubImages();
+            size_t begIndex(0);
+            while( begIndex < imgs.size() ) {
+                size_t endIndex = std::min( begIndex + thread::TmpStorage::batchSize, imgs.size() );
+                int node = nodes[ batches.size() % nodes.size() ];
+                batchQueue.push( node, batches.size() );
+                batches.push_back( { c, begIndex, endIndex, offset } );
+                for( size_t i=begIndex; i<endIndex; ++i ) {
+                    imgs[i]->homeNode = node;
+                    imageQueue.push( node, images.size() );
+                    images.push_back( make_pair( o, imgs[i] ) );
+                }
+                offset += endIndex-begIndex;
+                begIndex = endIndex;
+            }
+        }
+    }
+    
+    if( numa::enabled() ) {     // first-touch the subimage arrays from a thread running on their home-node.
+        vector<uint32_t> myCpus = numa::threadCpus();
+        for( auto& n: nodes ) {
+            if( numa::pinThread(n) != n ) continue;
+            for( auto& im: images ) {
+                if( im.second->homeNode == n ) im.second->allocate( pupilSize );
+            }
+        }
+        numa::setThreadCpus( myCpus );
+        LOG_DETAIL << "NUMA: " << batches.size() << " batches (" << images.size() << " images) placed on "
+                   << nodes.size() << " nodes.  " << numa::memString() << ende;
+    }
 
 }
 
@@ -243,48 +310,46 @@ void Solver::my_fdf( const gsl_vector* b, void* params, double* f, gsl_vector* d
 }
 
 
-void Solver::my_precalc( const gsl_vector* b, const gsl_vector* b_grad ) {
+void Solver::my_precalc( const gsl_vector* b, const gsl_vector* b_dir ) {
     
-    progWatch.set(3);
-    boost::asio::post(ioContext, [this] { tmpPhiGrad.zero(); ++progWatch; } );
+    // Called once per line-search: store phi(b) and the phase-change along the search direction (in tmpPhi/tmpPhiGrad),
+    // so that each trial step in metricAt() only needs an OTF update and a metric evaluation.
+    progWatch.set(2);
     boost::asio::post(ioContext, [this, b] { job.globalData->constraints.reverseAndAdd( b->data, alpha_offset.get(), alpha.get() ); ++progWatch; });
-    boost::asio::post(ioContext, [this, b_grad] { job.globalData->constraints.reverse( b_grad->data, grad_alpha.get() ); ++progWatch; });
+    boost::asio::post(ioContext, [this, b_dir] { job.globalData->constraints.reverse( b_dir->data, grad_alpha.get() ); ++progWatch; });
     progWatch.wait();
 
-    size_t nElements = pupilSize*pupilSize;
-    double* alphaPtr = alpha.get();
-    double* phiPtr = tmpPhi.get();
-    progWatch.set( 2*nTotalImages );
-    for( const auto& o: objects ) {
-        //if( o->weight > 0 ) {
-            for( const auto& c: o->getChannels() ) {
-                for( const auto& im: c->getSubImages() ) {
-                    boost::asio::post(ioContext, [this,&im, alphaPtr, phiPtr] {    // use a lambda to ensure these calls are sequential
-                        im->calcPhi( alphaPtr, phiPtr );
-                        ++progWatch;
-                    });
-                    alphaPtr += nModes;
-                    phiPtr += nElements;
-                }
-            }
-        //}
+    lineReg1 = lineReg2 = 0;
+    if( job.reg_alpha > 0 ) {       // the regularization term is quadratic in step, metric() already includes the constant part.
+        const double* alphaPtr = alpha.get();
+        const double* dirPtr = grad_alpha.get();
+        const double* rawPtr = regAlphaWeights.get();
+        for( size_t i=0; i<nParameters; ++i ) {
+            lineReg1 += alphaPtr[i]*dirPtr[i]*rawPtr[i];
+            lineReg2 += 0.5*dirPtr[i]*dirPtr[i]*rawPtr[i];
+        }
     }
-    
-    alphaPtr = grad_alpha.get();
-    phiPtr = tmpPhiGrad.get();
+
+    const double* alphaPtr = alpha.get();
+    const double* dirPtr = grad_alpha.get();
+    double* phiPtr = tmpPhi.get();
+    double* phiDirPtr = tmpPhiGrad.get();
+    progWatch.set( nTotalImages );
     for( const auto& o: objects ) {
-        //if( o->weight > 0 ) {
-            for( const auto& c: o->getChannels() ) {
-                for( const auto& im: c->getSubImages() ) {
-                    boost::asio::post(ioContext, [this,&im, alphaPtr, phiPtr] {    // use a lambda to ensure these calls are sequential
-                        im->addToPhi( alphaPtr, phiPtr );
-                        ++progWatch;
-                    });
-                    alphaPtr += nModes;
-                    phiPtr += nElements;
-                }
+        for( const auto& c: o->getChannels() ) {
+            for( const auto& im: c->getSubImages() ) {
+                boost::asio::post(ioContext, [this, &im, alphaPtr, dirPtr, phiPtr, phiDirPtr] {
+                    im->calcPhi( alphaPtr, phiPtr );
+                    memset( phiDirPtr, 0, pupilSize2*sizeof(double) );
+                    im->addPhases( phiDirPtr, dirPtr );
+                    ++progWatch;
+                });
+                alphaPtr += nModes;
+                dirPtr += nModes;
+                phiPtr += pupilSize2;
+                phiDirPtr += pupilSize2;
             }
-        //}
+        }
     }
     progWatch.wait();
     
@@ -293,36 +358,35 @@ void Solver::my_precalc( const gsl_vector* b, const gsl_vector* b_grad ) {
 
 double Solver::metricAt( double step ) {
     
-    complex_t* otfPtr = tmpOTF.get();
-    double* phiPtr = tmpPhi.get();
-    double* phiGradPtr = tmpPhiGrad.get();
+    // Same batching as in applyAlpha, but the phases are taken from tmpPhi + step*tmpPhiGrad (see my_precalc).
+    // N.B. phi/PF of the subimages are not updated, the minimizer will call my_df (i.e. applyBeta) at the final position.
+    const double* phiPtr = tmpPhi.get();
+    const double* phiDirPtr = tmpPhiGrad.get();
     progWatch.set( nTotalImages );
-    for( const auto& o: objects ) {
-        //if( o->weight > 0 ) {
-            double normalization = sqrt(1.0 / (o->pupil->area*otfSize2));
-            for( const auto& c: o->getChannels() ) {
-                for( const auto& im RDX_UNUSED: c->getSubImages() ) {
-                    boost::asio::post(ioContext,  [this, &o, normalization, step, otfPtr, phiPtr, phiGradPtr] {
-                        const double* pupilPtr = o->pupil->get();
-                        for( const auto& ind: o->pupil->pupilInOTF ) {
-                            otfPtr[ind.second] = polar(pupilPtr[ind.first]*normalization, phiPtr[ind.first]+step*phiGradPtr[ind.first]);
-                        }
-                        //im->tmpOTF.ft(otfPtr); FIXME: broke with thread_local
-                        //im->tmpOTF.norm();
-                        //im->tmpOTF.getIFT(im->OTF.get());
-                        //FourierTransform::reorder( im->OTF.get(), im->OTF.dimSize(0), im->OTF.dimSize(1) );
-                        ++progWatch;
-                    });
-                    otfPtr += otfSize2;
-                    phiPtr += pupilSize2;
-                    phiGradPtr += pupilSize2;
+    batchQueue.reset();
+    for( size_t b=0; b<batches.size(); ++b ) {
+        boost::asio::post(ioContext, [step,phiPtr,phiDirPtr,this] {
+            thread::TmpStorage* ts = tmp();
+            size_t bi;
+            if( !batchQueue.pop( ts->node, bi ) ) return;
+            const ImageBatch& batch = batches[bi];
+            const vector< shared_ptr<SubImage> >& imgs = batch.channel->getSubImages();
+            for( size_t i=batch.begIndex; i<batch.endIndex; ++i ) {
+                size_t offset = (batch.imageOffset+i-batch.begIndex)*pupilSize2;
+                size_t blockOffset = (i-batch.begIndex)*otfSize2;
+                if( thread::TmpStorage::singlePrecision ) {
+                    imgs[i]->calcOTFStep( ts->batchOTFf.get() + blockOffset, phiPtr+offset, phiDirPtr+offset, step );
+                } else {
+                    imgs[i]->calcOTFStep( ts->batchOTF.get() + blockOffset, phiPtr+offset, phiDirPtr+offset, step );
                 }
             }
-        //}
+            setOTFs( ts, imgs, batch.begIndex, batch.endIndex );
+            progWatch.increase( batch.endIndex-batch.begIndex );
+        });
     }
     progWatch.wait();
 
-    return metric();
+    return metric() + step*(lineReg1 + step*lineReg2);
     
 }
 
@@ -344,9 +408,11 @@ void Solver::run( PatchData::Ptr data ) {
                      std::bind( &Solver::my_fdf, this, sp::_1, sp::_2, sp::_3 , sp::_4)
                    );
     
-    // TODO: Tweak the new method calls/storage, it is only a marginal speedup at the moment
-//      my_func.setPreCalc( std::bind( &Solver::my_precalc, this, sp::_1, sp::_2 ),
-//                          std::bind( &Solver::metricAt, this, sp::_1 ) );
+    bool fastLineSearch = (job.runFlags & RF_FAST_LINESEARCH);
+    if( fastLineSearch ) {      // only used by multimin_fdfminimizer_conjugate_rdx, the other minimizers ignore it.
+        my_func.setPreCalc( std::bind( &Solver::my_precalc, this, sp::_1, sp::_2 ),
+                            std::bind( &Solver::metricAt, this, sp::_1 ) );
+    }
     
     double init_step = 1E-4*max_wavelength; //   TODO tweak solver parameters
     double init_tol = 1E-6;
@@ -383,6 +449,7 @@ void Solver::run( PatchData::Ptr data ) {
 
     //gradientMethod = gradientMethods[job.gradientMethod];
     gradientMethod = gradientMethods[GM_DIFF];   // FIXME: old code just uses the cfg-setting the first iteration, then switches to Vogel.
+    gradientType = GM_DIFF;
     
     gsl_multimin_fdfminimizer *s = gsl_multimin_fdfminimizer_alloc( minimizerType, nFreeParameters );
 
@@ -410,13 +477,34 @@ void Solver::run( PatchData::Ptr data ) {
     timer.start();
     logger.flushAll();
     loadInit( data, alpha_offset.get() );
+    
+    // If this patch was interrupted on another slave, continue from the saved state.
+    SolverCheckpoint& cp = data->checkpoint;
+    bool resume = cp.valid() && (cp.alpha.size() == nParameters) && (cp.modeCount <= nModes);
+    if( resume ) {
+        std::copy( cp.alpha.begin(), cp.alpha.end(), alpha_offset.get() );
+        totalIterations = cp.totalIterations;
+        failCount = cp.failCount;
+    }
     shiftAndInit( alpha_offset.get(), true );     // force initialization
     
     data->metrics.clear();
     data->metrics.reserve(10000);     // should be more than enough
     double initialMetric = GSL_MULTIMIN_FN_EVAL_F( &my_func, beta_init );
-    data->metrics.push_back(initialMetric);
-    LOG << "Patch" << (string)data->index << ":  Initial metric = " << initialMetric << ende;
+    if( resume && !cp.metrics.empty() ) {
+        data->metrics = cp.metrics;
+        LOG << "Patch" << (string)data->index << ":  Resuming from checkpoint, " << cp.totalIterations << " iterations using "
+            << cp.modeCount << "/" << nModes << " modes,  metric = " << initialMetric << ende;
+        initialMetric = cp.metrics.front();
+    } else {
+        data->metrics.push_back(initialMetric);
+        LOG << "Patch" << (string)data->index << ":  Initial metric = " << initialMetric << ende;
+    }
+    double lastCheckpoint = timer.getSeconds();
+    auto checkpointDue = [&](void) {
+        return job.checkpointInterval && ((timer.getSeconds()-lastCheckpoint) >= job.checkpointInterval);
+    };
+    vector<double> cpAlpha( nParameters );
 
     double gradScale = 1.0/(nTotalPixels*nTotalPixels);
     
@@ -424,7 +512,7 @@ void Solver::run( PatchData::Ptr data ) {
 
     bool exitLoop(false);
 
-    for( uint16_t modeCount=job.nInitialModes; !exitLoop; modeCount += job.nModeIncrement ) {
+    for( uint16_t modeCount=(resume?cp.modeCount:job.nInitialModes); !exitLoop; modeCount += job.nModeIncrement ) {
         
         modeCount = min<uint16_t>(modeCount,nModes);
 
@@ -446,6 +534,11 @@ void Solver::run( PatchData::Ptr data ) {
         gsl_multimin_fdfminimizer_set( s, static_cast<gsl_multimin_function_fdf*>(&my_func), beta_init, init_step, init_tol );
 
         size_t iter = 0;
+        if( resume ) {
+            iter = cp.iteration;
+            totalIterations -= iter;        // the iterations for this modeCount are added after the inner loop.
+            resume = false;
+        }
         int successCount(0);
         bool done(false);
       
@@ -476,6 +569,7 @@ void Solver::run( PatchData::Ptr data ) {
             }
             
             gradientMethod = gradientMethods[GM_VOGEL];   // FIXME: old code just uses the cfg-setting the first iteration, then switches to Vogel.
+            gradientType = GM_VOGEL;
             
             if( status == GSL_ENOPROG ) {
                 LOG_TRACE << "iteration: " << (totalIterations+iter) << "  GSL reports no progress." << ende;
@@ -516,6 +610,12 @@ void Solver::run( PatchData::Ptr data ) {
             }
 
             previousMetric = thisMetric;
+            
+            if( checkpointDue() ) {
+                job.globalData->constraints.reverseAndAdd( s->x->data, alpha_offset.get(), cpAlpha.data() );
+                saveCheckpoint( *data, modeCount, iter, totalIterations+iter, failCount, cpAlpha.data() );
+                lastCheckpoint = timer.getSeconds();
+            }
         }
 //        } while( (!done || iter < job.minIterations) && iter < maxIterations );
 
@@ -533,11 +633,19 @@ void Solver::run( PatchData::Ptr data ) {
         if( !exitLoop ) {
             shiftAndInit();
             memcpy( alpha_offset.get(), alpha.get(), nParameters*sizeof(double) );          // store current solution
+            if( checkpointDue() ) {
+                saveCheckpoint( *data, min<uint16_t>(modeCount+job.nModeIncrement,nModes), 0, totalIterations, failCount, alpha_offset.get() );
+                lastCheckpoint = timer.getSeconds();
+            }
         }
     }       // end for-loop
     
+    cp.clear();     // completed, no need to send the state back.
+    
+    double elapsed = timer.getSeconds();
     LOG << "Patch" << (string)data->index << ":  After " << totalIterations << " iterations:  metric=" << thisMetric
-        << "  (relative=" << (thisMetric/initialMetric) << ")  " << timer.print() << ende;
+        << "  (relative=" << (thisMetric/initialMetric) << ")  " << timer.print()
+        << "  (" << (elapsed>0?(totalIterations/elapsed):0.0) << " it/s" << (fastLineSearch?", fast line-search)":")") << ende;
     myInfo.status.statusString = patchString + " completed";
     
 
@@ -580,6 +688,20 @@ void Solver::run( PatchData::Ptr data ) {
 }
 
 
+void Solver::saveCheckpoint( PatchData& pd, uint16_t modeCount, uint16_t iter, uint32_t totalIter, uint16_t failCount, const double* a ) {
+    
+    SolverCheckpoint& cp = pd.checkpoint;
+    cp.modeCount = modeCount;
+    cp.iteration = iter;
+    cp.totalIterations = totalIter;
+    cp.failCount = failCount;
+    cp.alpha.assign( a, a+nParameters );
+    cp.metrics = pd.metrics;
+    job.checkpoint( pd );
+    
+}
+
+
 template <typename T>
 void Solver::shiftAndInit( const T* a, bool doReset ) {
     
@@ -636,21 +758,61 @@ void Solver::zeroAlphas( void ) {
 }
 
 
+void Solver::setOTFs( thread::TmpStorage* ts, const vector<shared_ptr<SubImage>>& imgs, size_t begIndex, size_t endIndex ) {
+    
+    // Autocorrelate the OTF inputs in ts->batchOTF/batchOTFf (written by calcPF/calcOTFStep) and store them in the subimages.
+    // The OTFs are Hermitian, so only the half-planes are computed (r2c), and then expanded by setOTF.
+    size_t nBlocks = endIndex-begIndex;
+    size_t halfSize = otfSize*(otfSize/2+1);
+#ifdef HAVE_FFTW3F
+    if( thread::TmpStorage::singlePrecision ) {     // FFTs in float, P/Q and the metric are still accumulated in double.
+        complexf_t* halff = ts->batchWorkf.get();
+        FourierTransform::autocorrelateHalf( ts->batchOTFf.get(), halff, otfSize, otfSize, nBlocks );
+        for( size_t i=begIndex; i<endIndex; ++i ) {
+            imgs[i]->setOTF( halff + (i-begIndex)*halfSize );
+        }
+    } else
+#endif
+    {
+        complex_t* half = ts->batchWork.get();
+        FourierTransform::autocorrelateHalf( ts->batchOTF.get(), half, otfSize, otfSize, nBlocks );
+        for( size_t i=begIndex; i<endIndex; ++i ) {
+            imgs[i]->setOTF( half + (i-begIndex)*halfSize );
+        }
+    }
+    
+}
+
+
 template <typename T> 
 void Solver::applyAlpha( T* a ) {
 
+    // The subimages of each channel are processed in batches, so that the OTFs of up to
+    // TmpStorage::batchSize images are autocorrelated by a single (batched) FFTW plan.
+    // The tasks are not bound to a batch, each one pops the next batch from its own NUMA-node (see placeImages).
     progWatch.set( nTotalImages );
-    for( const auto& o: objects ) {
-        for( const auto& c: o->getChannels() ) {
-            for( const auto& im: c->getSubImages() ) {
-                boost::asio::post(ioContext, [&im,a,this] {    // use a lambda to ensure these calls are sequential
-                    im->calcPhi( a );
-                    im->calcPFOTF();
-                    ++progWatch;
-                });
-                a += nModes;
+    batchQueue.reset();
+    for( size_t b=0; b<batches.size(); ++b ) {
+        boost::asio::post(ioContext, [a,this] {
+            thread::TmpStorage* ts = tmp();
+            size_t bi;
+            if( !batchQueue.pop( ts->node, bi ) ) return;
+            const ImageBatch& batch = batches[bi];
+            const vector< shared_ptr<SubImage> >& imgs = batch.channel->getSubImages();
+            T* aa = a + batch.imageOffset*nModes;
+            for( size_t i=batch.begIndex; i<batch.endIndex; ++i ) {
+                size_t blockOffset = (i-batch.begIndex)*otfSize2;
+                imgs[i]->calcPhi( aa );
+                if( thread::TmpStorage::singlePrecision ) {
+                    imgs[i]->calcPF( ts->batchOTFf.get() + blockOffset );
+                } else {
+                    imgs[i]->calcPF( ts->batchOTF.get() + blockOffset );
+                }
+                aa += nModes;
             }
-        }
+            setOTFs( ts, imgs, batch.begIndex, batch.endIndex );
+            progWatch.increase( batch.endIndex-batch.begIndex );
+        });
     }
     progWatch.wait();
 
@@ -753,56 +915,120 @@ void Solver::initImages( double* a ) {
 }
 
 
-namespace {
-    
-    const size_t nMaxImages = 30;
+void Solver::accumulatePQ(void) {
 
+    // Each task owns one partial P/Q accumulator, and pops subimages (preferably from its own NUMA-node) until
+    // none remain. The partials are then summed pairwise, as a tree, into slot 0 (which is P/Q itself).
+    struct ObjectWork {
+        shared_ptr<Object> obj;
+        vector< shared_ptr<SubImage> > images;
+        numa::NodeQueue<size_t> queue;
+        size_t nTasks;
+    };
+    vector< shared_ptr<ObjectWork> > work;
+    int nTasks(0);
+    for( const shared_ptr<Object>& o : objects ) {
+        o->initPQ();
+        shared_ptr<ObjectWork> ow = make_shared<ObjectWork>();
+        ow->obj = o;
+        for( const shared_ptr<Channel>& c: o->getChannels() ) {
+            for( const shared_ptr<SubImage>& im: c->getSubImages() ) {
+                ow->queue.push( im->homeNode, ow->images.size() );
+                ow->images.push_back( im );
+            }
+        }
+        ow->nTasks = std::min<size_t>( ow->images.size(), o->nPartials );
+        nTasks += ow->nTasks;
+        work.push_back( ow );
+    }
+    
+    if( !nTasks ) return;
+    
+    progWatch.set( nTasks );
+    for( const auto& ow: work ) {
+        for( size_t k=0; k<ow->nTasks; ++k ) {
+            boost::asio::post(ioContext, [ow,k,this] {
+                complex_t* pPtr = ow->obj->partialP(k);
+                double* qPtr = ow->obj->partialQ(k);
+                if( k ) {       // slot 0 is P/Q, already initialized by initPQ
+                    std::fill_n( pPtr, otfSize2, complex_t(0) );
+                    std::fill_n( qPtr, otfSize2, 0.0 );
+                }
+                const int node = tmp()->node;
+                size_t i;
+                while( ow->queue.pop( node, i ) ) {
+                    ow->images[i]->addPQ( pPtr, qPtr );
+                }
+                ++progWatch;
+            } );
+        }
+    }
+    progWatch.wait();
+    
+    // log2(nTasks) levels, the pairs of each level (and disjoint ranges of the half otf-support) are summed in parallel.
+    for( size_t stride=1; ; stride *= 2 ) {
+        vector< pair<shared_ptr<ObjectWork>,size_t> > pairs;     // (object,dst), the source is dst+stride
+        for( const auto& ow: work ) {
+            for( size_t k=0; k+stride<ow->nTasks; k += 2*stride ) {
+                pairs.push_back( make_pair( ow, k ) );
+            }
+        }
+        if( pairs.empty() ) break;
+        const size_t nRanges = std::max<size_t>( 1, maxThreads/pairs.size() );
+        progWatch.set( pairs.size()*nRanges );
+        for( const auto& p: pairs ) {
+            const size_t nSupport = p.first->obj->pupil->otfHalfSupport.size();
+            const size_t rangeSize = (nSupport+nRanges-1)/nRanges;
+            for( size_t r=0; r<nRanges; ++r ) {
+                boost::asio::post(ioContext, [p,r,rangeSize,stride,this] {
+                    p.first->obj->reducePartials( p.second, p.second+stride, r*rangeSize, (r+1)*rangeSize );
+                    ++progWatch;
+                } );
+            }
+        }
+        progWatch.wait();
+    }
+    
+    nTasks = 0;
+    for( const auto& ow: work ) {
+        if( ow->nTasks ) nTasks += maxThreads;
+    }
+    progWatch.set( nTasks );
+    for( const auto& ow: work ) {
+        if( !ow->nTasks ) continue;
+        const size_t nSupport = ow->obj->pupil->otfHalfSupport.size();
+        const size_t rangeSize = (nSupport+maxThreads-1)/maxThreads;
+        for( size_t r=0; r<maxThreads; ++r ) {
+            boost::asio::post(ioContext, [ow,r,rangeSize,this] {
+                ow->obj->mirrorPQ( r*rangeSize, (r+1)*rangeSize );
+                ++progWatch;
+            } );
+        }
+    }
+    progWatch.wait();
+    
 }
 
 
 double Solver::metric(void) {
     
-
-    double sum(0);
+    accumulatePQ();
+    
     progWatch.set( objects.size() );
     for( const shared_ptr<Object>& o : objects ) {
-        //if( o->weight > 0 ) {
-            o->initPQ();
-            o->progWatch.set( o->nImages() );
-            o->progWatch.setHandler( [o,&sum,this](){
-                o->calcMetric();
-                lock_guard<mutex> lock(mtx);
-                sum += o->metric();
-                ++progWatch;
-            });
-            for( const shared_ptr<Channel>& c: o->getChannels() ) {
-                size_t nImgs = c->getSubImages().size();
-                size_t begIndex(0);
-                while( begIndex < nImgs ) {
-                    size_t endIndex = begIndex + nMaxImages;
-                    if( endIndex > nImgs ) endIndex = nImgs;
-                    o->progWatch.increaseTarget();
-                    boost::asio::post(ioContext,  [o,c,begIndex,endIndex,this] {
-                        const vector< shared_ptr<SubImage> >& imgs = c->getSubImages();
-                        double* tmpD = tmp()->D.get();
-                        complex_t* tmpC = tmp()->C.get();
-                        std::fill_n( tmpD, otfSize2, 0.0 );
-                        std::fill_n( tmpC, otfSize2, complex_t(0) );
-                        for( size_t i=begIndex; i<endIndex; ++i ) {
-                            imgs[i]->addPQ( tmpC, tmpD );
-                            ++o->progWatch;
-                        }
-                        o->addToPQ( tmpC, tmpD );
-                        ++o->progWatch;
-                    } );
-                    begIndex = endIndex;
-                }
-            }
-        //}
+        boost::asio::post(ioContext, [o,this] {
+            o->calcMetric();
+            ++progWatch;
+        } );
     }
+    progWatch.wait();
 
+    double sum(0);
+    for( const shared_ptr<Object>& o : objects ) {
+        sum += o->metric();
+    }
+    
     if( job.reg_alpha > 0 ) {
-        lock_guard<mutex> lock(mtx);
         double* alphaPtr = alpha.get();
         double* rawPtr = regAlphaWeights.get();
         for( size_t i=0; i<nParameters; ++i ) {
@@ -810,8 +1036,6 @@ double Solver::metric(void) {
         }
     }
     
-    progWatch.wait();
-
     return sum; ///nTotalPixels;
     
 }
@@ -819,39 +1043,15 @@ double Solver::metric(void) {
 
 void Solver::calcPQ(void) {
 
+    accumulatePQ();
+    
     progWatch.set( objects.size() );
     for( const shared_ptr<Object>& o : objects ) {
-        o->initPQ();
-        o->progWatch.set( o->nImages() );
-        o->progWatch.setHandler( [o,this](){
+        boost::asio::post(ioContext, [o,this] {
             o->calcHelpers();
             ++progWatch;
-        });
-        for( const shared_ptr<Channel>& c: o->getChannels() ) {
-            size_t nImgs = c->getSubImages().size();
-            size_t begIndex(0);
-            while( begIndex < nImgs ) {
-                size_t endIndex = begIndex + nMaxImages;
-                if( endIndex > nImgs ) endIndex = nImgs;
-                o->progWatch.increaseTarget();
-                boost::asio::post(ioContext,  [o,c,begIndex,endIndex,this] {
-                    const vector< shared_ptr<SubImage> >& imgs = c->getSubImages();
-                    double* tmpD = tmp()->D.get();
-                    complex_t* tmpC = tmp()->C.get();
-                    std::fill_n( tmpD, otfSize2, 0.0 );
-                    std::fill_n( tmpC, otfSize2, complex_t(0) );
-                    for( size_t i=begIndex; i<endIndex; ++i ) {
-                        imgs[i]->addPQ( tmpC, tmpD );
-                        ++o->progWatch;
-                    }
-                    o->addToPQ( tmpC, tmpD );
-                    ++o->progWatch;
-                } );
-                begIndex = endIndex;
-            }
-        }
+        } );
     }
-
     progWatch.wait();
     
 }
@@ -869,25 +1069,33 @@ void Solver::gradient(void) {
     }
 
     bool* eM = enabledModes.get();
-    progWatch.set(nTotalImages );
-    for( const shared_ptr<Object>& o: objects ) {
-        //if( o->weight > 0 ) {
-            for( const shared_ptr<Channel>& c: o->getChannels() ) {
-                for( const shared_ptr<SubImage>& im: c->getSubImages() ) {
-                    boost::asio::post(ioContext, [this, eM, o, im, gAlphaPtr] {    // use a lambda to ensure these calls are sequential
-                        im->calcVogelWeight( o->PQ.get(), o->PS.get(), o->QS.get() );
-                        for ( uint16_t m=0; m<nModes; ++m ) {
-                            if( eM[m] ) {
-                                gAlphaPtr[m] = o->weight*gradientMethod(*im, m );
-                            }
-                        }
-                        ++progWatch;
-                    });
-                    alphaPtr += nModes;
-                    gAlphaPtr += nModes;
+    progWatch.set( images.size() );
+    imageQueue.reset();
+    for( size_t j=0; j<images.size(); ++j ) {
+        boost::asio::post(ioContext, [this, eM] {    // use a lambda to ensure these calls are sequential
+            size_t j;      // N.B. one task is posted per image, so this never fails.
+            if( !imageQueue.pop( tmp()->node, j ) ) return;
+            const shared_ptr<Object>& o = images[j].first;
+            const shared_ptr<SubImage>& im = images[j].second;
+            double* gAlphaPtr = grad_alpha.get() + j*nModes;
+            im->calcVogelWeight( o->PQ.get(), o->PS.get(), o->QS.get() );
+            if( gradientType == GM_VOGEL ) {        // all modes in one pass (matrix-vector product over the pupil-support)
+                for ( uint16_t m=0; m<nModes; ++m ) {
+                    if( eM[m] ) gAlphaPtr[m] = 0;
+                }
+                im->gradientVogel2( gAlphaPtr, eM );
+                for ( uint16_t m=0; m<nModes; ++m ) {
+                    if( eM[m] ) gAlphaPtr[m] *= o->weight;
+                }
+            } else {
+                for ( uint16_t m=0; m<nModes; ++m ) {
+                    if( eM[m] ) {
+                        gAlphaPtr[m] = o->weight*gradientMethod(*im, m );
+                    }
                 }
             }
-        //}
+            ++progWatch;
+        });
     }
     progWatch.wait();
 
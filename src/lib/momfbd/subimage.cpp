@@ -3,12 +3,15 @@
 #include "redux/momfbd/momfbdjob.hpp"
 
 #include "redux/file/fileana.hpp"
+#include "redux/image/pupilkernels.hpp"
 #include "redux/logging/logger.hpp"
 #include "redux/util/datautil.hpp"
 #include "redux/util/stringutil.hpp"
 
 #include <algorithm>
 
+#include <gsl/gsl_blas.h>
+
 using namespace redux::file;
 using namespace redux::logging;
 using namespace redux::momfbd;
@@ -56,7 +59,7 @@ namespace {
 }
 
 SubImage::SubImage (Object& obj, const Channel& ch, const Array<double>& wind, const Array<double>& nwind)
-    : imgSize(0), pupilSize(0), nModes(0), rowStride(0), imgSize2(0), oldRG(0), grad_step(0), object (obj), channel(ch), logger(ch.logger), modes(obj.modes),
+    : index(0), homeNode(-1), imgSize(0), pupilSize(0), nModes(0), rowStride(0), imgSize2(0), oldRG(0), grad_step(0), object (obj), channel(ch), logger(ch.logger), modes(obj.modes),
       window (wind), noiseWindow(nwind) {
 #ifdef USE_LUT
     static int dummy RDX_UNUSED = initSineLUT(); 
@@ -79,6 +82,17 @@ void SubImage::setPatchInfo( uint32_t i, const PointI& pos, const PointF& resOff
     imgSize = patchSize;
     imgSize2 = imgSize*imgSize;
     
+    allocate( pupSz );
+    
+    nModes = nM;
+    grad_step = object.myJob.graddiff_step * object.wavelength;
+
+}
+
+
+void SubImage::allocate( uint16_t pupSz ) {
+    
+    // N.B. the arrays are zeroed here, so with NUMA-mode they will be placed on the node of the calling thread (first-touch).
     if( pupSz != pupilSize ) {
         pupilSize = pupSz;
         pupilSize2 = pupilSize*pupilSize;
@@ -97,9 +111,6 @@ void SubImage::setPatchInfo( uint32_t i, const PointI& pos, const PointF& resOff
         vogel.zero();
     }
     
-    nModes = nM;
-    grad_step = object.myJob.graddiff_step * object.wavelength;
-
 }
 
 
@@ -225,8 +236,9 @@ void SubImage::addFT(Array<double>& ftsum) const {
 
 void SubImage::addPQ (const complex_t* otf, complex_t* P, double* Q) const {
 
+    // N.B. P is Hermitian and Q symmetric, so only the half-support is accumulated, see Object::reducePartials/mirrorPQ
     const complex_t* ftPtr = imgFT.get();
-    for( const size_t& ind: object.pupil->otfSupport ) {
+    for( const size_t& ind: object.pupil->otfHalfSupport ) {
         Q[ind] += norm(otf[ind]);                    // Q += sj.re^2 + sj.im^2 = norm(sj)
         P[ind] += conj(ftPtr[ind]) * otf[ind];       // P += conj(ft)*sj            c.f. Vogel
     }
@@ -234,11 +246,6 @@ void SubImage::addPQ (const complex_t* otf, complex_t* P, double* Q) const {
 }
 
 
-// void SubImage::addToPQ(void) const {
-//     object.addToPQ( imgFT.get(), OTF.get() );
-// }
-
-
 void SubImage::restore( complex_t* obj, double* obj_norm ) const {
 
 //     bool no_restore(false);         // TODO: implement NO_RESTORE cfg flag
@@ -265,14 +272,19 @@ double SubImage::metricChange( const complex_t* newOTF ) const {
     const complex_t* ftPtr = imgFT.get();
     const double* q = object.Q.get();
     
+    const Pupil& pupil = *object.pupil;
+    const size_t nHalf = pupil.otfHalfSupport.size();
+    const size_t* indPtr = pupil.otfHalfSupport.data();
+    const double* wPtr = pupil.otfHalfWeight.data();
     complex_t dp, dsj;
     double dl(0.0);
-    for( size_t& ind: object.pupil->otfSupport ) {
+    for( size_t i=0; i<nHalf; ++i ) {               // all terms are symmetric, so sum over the half-support
+        const size_t ind = indPtr[i];
         dsj = newOTF[ind] - oldOTF[ind];            // change in sj
         dp = conj(ftPtr[ind]) * dsj;                // change p and q
         double dq = 2.0 * (oldOTF[ind].real() * dsj.real() + oldOTF[ind].imag() * dsj.imag()) + norm (dsj);
         double dn = 2.0 * (dp.real() * p[ind].real() + dp.imag() * p[ind].imag()) + norm (dp);
-        dl -= (q[ind] * dn - dq * (norm (p[ind]))) / (q[ind] * (q[ind]+dq));
+        dl -= wPtr[i] * (q[ind] * dn - dq * (norm (p[ind]))) / (q[ind] * (q[ind]+dq));
     }
     return dl / otfSize2;
 }
@@ -313,13 +325,11 @@ double SubImage::gradientVogel(uint16_t modeIndex ) {
 
     if( object.weight == 0 ) return 0;
     
-    double ret = 0;
+    const Pupil& pupil = *object.pupil;
     const double* modePtr = modes->modePointers[modeIndex];
     const double* vogPtr = vogel.get();
-    double scale = -2.0 * object.pupil->area / otfSize2;
-    for( auto & ind : object.pupil->pupilSupport ) {
-        ret += scale * vogPtr[ind] * modePtr[ind];
-    }
+    double scale = -2.0 * pupil.area / otfSize2;
+    double ret = scale * kernels::gatherDot( pupil.pupilIndex.data(), pupil.pupilInOTF.size(), vogPtr, modePtr );
 
     return ret*object.weight;
     
@@ -330,15 +340,35 @@ void SubImage::gradientVogel2( double* agrad, const bool* enabledModes ) {
 
     if( object.weight == 0 ) return;
     
+    const Pupil& pupil = *object.pupil;
     const double* vogPtr = vogel.get();
-    double scale = -2.0 * object.pupil->area / otfSize2 * object.weight;
+    double scale = -2.0 * pupil.area / otfSize2 * object.weight;
+    const size_t nSupport = pupil.pupilInOTF.size();
+    const size_t nRows = modes->modePointers.size();
+    
+    if( nSupport && (modes->supportSize == nSupport) && (nRows >= nModes) ) {
+        // Gather vogel onto the support, and calculate the gradient for all modes with a single matrix-vector product.
+        auto tmp = Solver::tmp();
+        double* vogSupport = tmp->D.get();
+        double* modeGrad = tmp->D2.get();
+        const int32_t* indexPtr = pupil.pupilIndex.data();
+        for( size_t i(0); i<nSupport; ++i ) {
+            vogSupport[i] = vogPtr[indexPtr[i]];
+        }
+        gsl_matrix_const_view M = gsl_matrix_const_view_array( modes->supportModes.data(), nRows, nSupport );
+        gsl_vector_const_view v = gsl_vector_const_view_array( vogSupport, nSupport );
+        gsl_vector_view g = gsl_vector_view_array( modeGrad, nRows );
+        gsl_blas_dgemv( CblasNoTrans, scale, &M.matrix, &v.vector, 0.0, &g.vector );
+        for( uint16_t m=0; m<nModes; ++m ) {
+            if( enabledModes[m] ) agrad[m] += modeGrad[m];
+        }
+        return;
+    }
+    
     for( uint16_t m=0; m<nModes; ++m ) {
         if( enabledModes[m] ) {
             const double* modePtr = modes->modePointers[m];
-            double tmp(0);
-            for( auto & ind : object.pupil->pupilSupport ) {
-                tmp += vogPtr[ind] * modePtr[ind];
-            }
+            double tmp = kernels::gatherDot( pupil.pupilIndex.data(), nSupport, vogPtr, modePtr );
             agrad[m] += tmp*scale;
         }
     }
@@ -365,8 +395,12 @@ void SubImage::calcVogelWeight( complex_t* pq, double* ps, double* qs ) {
 
     tmp->OTF.ift(hjPtr);       // normalize by otfSize2 below
     tmp->OTF.zero();
-    for( const size_t& ind: object.pupil->otfSupport ) {
+    const Pupil& pupil = *object.pupil;
+    const size_t nHalf = pupil.otfHalfSupport.size();
+    for( size_t i=0; i<nHalf; ++i ) {               // Hermitian, so compute the half-support and mirror
+        const size_t ind = pupil.otfHalfSupport[i];
         tmpOtfPtr[ind] = (pq[ind]*ftPtr[ind] - ps[ind]*otfPtr[ind]) / qs[ind];
+        tmpOtfPtr[pupil.otfHalfMirror[i]] = conj( tmpOtfPtr[ind] );
     }
 
     FourierTransform::reorder( tmpOtfPtr, otfSize, otfSize );
@@ -381,11 +415,8 @@ void SubImage::calcVogelWeight( complex_t* pq, double* ps, double* qs ) {
 
     FourierTransform::reorder( tmpOtfPtr, otfSize, otfSize );
 
-    double* vogPtr = vogel.get();
-    const double* pupilPtr = object.pupil->get();
-    for( auto & ind : object.pupil->pupilInOTF ) {
-        vogPtr[ind.first] = imag(conj(pfPtr[ind.first])*tmpOtfPtr[ind.second])*pupilPtr[ind.first];
-    }
+    kernels::vogel( pupil.pupilIndex.data(), pupil.otfIndex.data(), pupil.pupilWeight.data(), pupil.pupilIndex.size(),
+                    pfPtr, tmpOtfPtr, vogel.get() );
 
 }
 
@@ -506,6 +537,17 @@ void SubImage::addToPhi( double* phiPtr, const double* modePtr, double w ) const
 
 }
 
+void SubImage::addPhases( double* phiPtr, const double* a ) const {
+
+    for( int mi(0); mi <nModes; ++mi ) {
+        if( fabs(a[mi]) > ALPHA_CUTOFF ) {
+            addToPhi( phiPtr, modes->modePointers[mi], a[mi] );
+        }
+    }
+
+}
+
+
 template <typename T>
 void SubImage::addToPhi( const T* a, double* phiPtr ) const {
 
@@ -549,15 +591,17 @@ template void SubImage::calcPhi( const float* a, double* phiPtr ) const;
 void SubImage::calcOTF(complex_t* otfPtr, const double* phiOffset, double scale) {
 
     const double* phiPtr = phi.get();
+#ifdef USE_LUT
     const double* pupilPtr = object.pupil->get();
     
     for (auto & ind : object.pupil->pupilInOTF) {
-#ifdef USE_LUT
         otfPtr[ind.second] = getPolar( pupilPtr[ind.first]*channel.otfNormalization, phiPtr[ind.first]+scale*phiOffset[ind.first]);
+    }
 #else
-        otfPtr[ind.second] = polar(pupilPtr[ind.first]*channel.otfNormalization, phiPtr[ind.first]+scale*phiOffset[ind.first]);
+    const Pupil& pupil = *object.pupil;
+    kernels::polarOffset( pupil.pupilIndex.data(), pupil.otfIndex.data(), pupil.pupilWeight.data(), pupil.pupilIndex.size(),
+                          phiPtr, phiOffset, scale, otfPtr, channel.otfNormalization );
 #endif
-    }
 
    Solver::tmp()->OTF.autocorrelate( otfPtr, true );
 
@@ -568,15 +612,17 @@ void SubImage::calcOTF( complex_t* otfPtr, const double* phiPtr ) const {
 
     std::fill_n( otfPtr, otfSize2, complex_t(0) );
 
+#ifdef USE_LUT
     const double* pupilPtr = object.pupil->get();
 
     for( auto& ind : object.pupil->pupilInOTF ) {
-#ifdef USE_LUT
         otfPtr[ind.second] = getPolar( pupilPtr[ind.first]*channel.otfNormalization, phiPtr[ind.first]);
+    }
 #else
-        otfPtr[ind.second] = polar(pupilPtr[ind.first]*channel.otfNormalization, phiPtr[ind.first]);
+    const Pupil& pupil = *object.pupil;
+    kernels::polar( pupil.pupilIndex.data(), pupil.otfIndex.data(), pupil.pupilWeight.data(), pupil.pupilIndex.size(),
+                    phiPtr, nullptr, otfPtr, channel.otfNormalization );
 #endif
-    }
 
     Solver::tmp()->OTF.autocorrelate( otfPtr, true );
 
@@ -589,27 +635,74 @@ void SubImage::calcPFOTF(void) {
     LOG_TRACE << "SubImage::calcPFOTF(" << hexString(this) << ")   indexSize=" << object.pupil->pupilInOTF.size() << ende;
 #endif
 
-    complex_t* pfPtr = PF.get();
     complex_t* otfPtr = OTF.get();
+    calcPF( otfPtr );
+    Solver::tmp()->OTF.autocorrelate( otfPtr, true );
+
+}
+
+
+template <typename C>
+void SubImage::calcPF( C* otfBlock ) {
+    
+    complex_t* pfPtr = PF.get();
     const double* phiPtr = phi.get();
 
     std::fill_n( pfPtr, pupilSize2, complex_t(0) );
-    std::fill_n( otfPtr, otfSize2, complex_t(0) );
+    std::fill_n( otfBlock, otfSize2, C(0) );
     
+#ifdef USE_LUT
     const double* pupilPtr = object.pupil->get();
     
     for( const auto& ind: object.pupil->pupilInOTF ) {
-#ifdef USE_LUT
         pfPtr[ind.first] = getPolar( pupilPtr[ind.first], phiPtr[ind.first]);
+        otfBlock[ind.second] = channel.otfNormalization*pfPtr[ind.first];
+    }
 #else
-        pfPtr[ind.first] = polar(pupilPtr[ind.first], phiPtr[ind.first]);
+    const Pupil& pupil = *object.pupil;
+    kernels::polar( pupil.pupilIndex.data(), pupil.otfIndex.data(), pupil.pupilWeight.data(), pupil.pupilIndex.size(),
+                    phiPtr, pfPtr, otfBlock, channel.otfNormalization );
 #endif
-        otfPtr[ind.second] = channel.otfNormalization*pfPtr[ind.first];
-    }
 
-    Solver::tmp()->OTF.autocorrelate( otfPtr, true );
+}
+template void SubImage::calcPF( complex_t* );
+template void SubImage::calcPF( complexf_t* );
+
+
+void SubImage::setOTF( const complex_t* otfHalf ) {
+    
+    FourierTransform::reorderHalfInto( otfHalf, otfSize, otfSize, OTF.get() );
+
+}
+
+
+void SubImage::setOTF( const complexf_t* otfHalf ) {
+    
+    FourierTransform::reorderHalfInto( otfHalf, otfSize, otfSize, OTF.get() );
+
+}
+
+
+template <typename C>
+void SubImage::calcOTFStep( C* otfBlock, const double* phiPtr, const double* phiDir, double step ) const {
+    
+    std::fill_n( otfBlock, otfSize2, C(0) );
+    
+#ifdef USE_LUT
+    const double* pupilPtr = object.pupil->get();
+    
+    for( const auto& ind: object.pupil->pupilInOTF ) {
+        otfBlock[ind.second] = getPolar( pupilPtr[ind.first]*channel.otfNormalization, phiPtr[ind.first]+step*phiDir[ind.first] );
+    }
+#else
+    const Pupil& pupil = *object.pupil;
+    kernels::polarOffset( pupil.pupilIndex.data(), pupil.otfIndex.data(), pupil.pupilWeight.data(), pupil.pupilIndex.size(),
+                          phiPtr, phiDir, step, otfBlock, channel.otfNormalization );
+#endif
 
 }
+template void SubImage::calcOTFStep( complex_t*, const double*, const double*, double ) const;
+template void SubImage::calcOTFStep( complexf_t*, const double*, const double*, double ) const;
 
 
 void SubImage::addPSF( double* outPSF ) const {
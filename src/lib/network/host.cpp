@@ -52,7 +52,7 @@ namespace {
     
 }
 
-Host::HostInfo::HostInfo( string username ) : peerType(0), connectPort(0), user(username) {
+Host::HostInfo::HostInfo( string username ) : peerType(0), connectPort(0), codecs(0), user(username) {
 
     int one = 1;
     littleEndian = *(char*)&one;
@@ -74,7 +74,7 @@ Host::HostInfo::HostInfo( string username ) : peerType(0), connectPort(0), user(
 
 
 Host::HostStatus::HostStatus( void ) : currentJob( 0 ), maxThreads( std::thread::hardware_concurrency() ), listenPort(0),
-    state( ST_IDLE ), progress( 0 ), statusString("idle") {
+    state( ST_IDLE ), progress( 0 ), codec( codec::NONE ), statusString("idle") {
         
     lastSeen = boost::posix_time::second_clock::universal_time(); 
     lastActive = boost::posix_time::second_clock::universal_time();
@@ -174,7 +174,7 @@ std::string Host::printHeader( int verbosity ) {
     string hdr = alignRight("ID",5) + alignCenter("NAME",25) + alignCenter("PID",7) + alignCenter("THREADS",10);
     hdr += alignLeft("VERSION",10) + alignLeft("Usage/Load",12) + alignCenter("Uptime",12) + alignCenter("Runtime",12);
     hdr += alignLeft("STATUS",18);
-    if( verbosity ) hdr +=  alignCenter("port",6);
+    if( verbosity ) hdr +=  alignCenter("port",6) + alignLeft("  NETWORK (codec  out | in)",40);
     return hdr;
 }
 
@@ -194,6 +194,10 @@ std::string Host::print( int verbosity ) {
     if( verbosity ) {
         if( id && status.listenPort ) {
             ret += alignRight( to_string(status.listenPort), 6 );
+        } else ret += string( 6, ' ' );
+        if( status.netOut.raw || status.netIn.raw ) {
+            ret += "  " + codec::name( static_cast<codec::Type>(status.codec) ) + "  "
+                 + status.netOut.print() + " | " + status.netIn.print();
         }
     }
     return ret;
@@ -235,7 +239,7 @@ Host& Host::operator=( const Host& rhs ) {
 */
 
 uint64_t Host::HostInfo::size(void) const {
-    uint64_t sz = sizeof(littleEndian) + sizeof(reduxVersion) + sizeof(pid) + sizeof(peerType) + sizeof(nCores);
+    uint64_t sz = sizeof(littleEndian) + sizeof(reduxVersion) + sizeof(pid) + sizeof(peerType) + sizeof(nCores) + sizeof(codecs);
     sz += sizeof(time_t);   // startedAt is converted and transferred as time_t
     sz += name.length() + os.length() + arch.length() + user.size() + 4;
     return sz;
@@ -252,6 +256,7 @@ uint64_t Host::HostInfo::pack( char* ptr ) const {
     count += pack(ptr+count,pid);
     count += pack(ptr+count,peerType);
     count += pack(ptr+count,nCores);
+    count += pack(ptr+count,codecs);
     count += pack(ptr+count,redux::util::to_time_t( startedAt ));
     count += pack(ptr+count,name);
     count += pack(ptr+count,os);
@@ -273,6 +278,7 @@ uint64_t Host::HostInfo::unpack( const char* ptr, bool swap_endian ) {
     count += unpack(ptr+count,pid,swap_endian);
     count += unpack(ptr+count,peerType, swap_endian);
     count += unpack(ptr+count,nCores, swap_endian);
+    count += unpack(ptr+count,codecs, swap_endian);
     time_t timestamp;
     count += unpack(ptr+count,timestamp,swap_endian);
     startedAt = boost::posix_time::from_time_t( timestamp );
@@ -294,6 +300,7 @@ bool Host::HostInfo::operator==(const HostInfo& rhs) const {
 uint64_t Host::HostStatus::size(void) const {
     uint64_t sz = sizeof(currentJob) + sizeof(nThreads) + sizeof(maxThreads) + sizeof(listenPort);
     sz += sizeof(state) + sizeof(load) + sizeof(progress) + 2*sizeof(time_t);
+    sz += sizeof(codec) + netOut.size() + netIn.size();
     sz += statusString.length() + 1;
     return sz;
 }
@@ -310,6 +317,9 @@ uint64_t Host::HostStatus::pack( char* ptr ) const {
     count += pack(ptr+count,currentJob);
     count += pack(ptr+count,load,2);
     count += pack(ptr+count,progress);
+    count += pack(ptr+count,codec);
+    count += netOut.pack(ptr+count);
+    count += netIn.pack(ptr+count);
     count += pack(ptr+count,statusString);
     time_t tmpT(0);
     if( !lastSeen.is_not_a_date_time() ) tmpT = redux::util::to_time_t( lastSeen );
@@ -337,6 +347,9 @@ uint64_t Host::HostStatus::unpack( const char* ptr, bool swap_endian ) {
     count += unpack(ptr+count,currentJob, swap_endian);
     count += unpack(ptr+count,load, 2, swap_endian);
     count += unpack(ptr+count,progress, swap_endian);
+    count += unpack(ptr+count,codec, swap_endian);
+    count += netOut.unpack(ptr+count, swap_endian);
+    count += netIn.unpack(ptr+count, swap_endian);
     count += unpack(ptr+count,statusString, swap_endian);
     time_t timestamp;
     count += unpack(ptr+count,timestamp,swap_endian);
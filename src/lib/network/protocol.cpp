@@ -26,6 +26,8 @@ uint8_t redux::network::cmdFromString( const string& str ) {
     if( contains(str, "GET_WORK", true ) ) return CMD_GET_WORK;
     if( contains(str, "GET_JOBLIST", true ) ) return CMD_GET_JOBLIST;
     if( contains(str, "PUT_PARTS", true ) ) return CMD_PUT_PARTS;
+    if( contains(str, "PUT_CHECKPOINT", true ) ) return CMD_PUT_CHECKPOINT;
+    if( contains(str, "EXSTAT", true ) ) return CMD_EXSTAT;
     if( contains(str, "JSTAT", true ) ) return CMD_JSTAT;
     if( contains(str, "PSTAT", true ) ) return CMD_PSTAT;
     if( contains(str, "STAT", true ) ) return CMD_STAT;
@@ -60,9 +62,11 @@ string redux::network::cmdToString( uint8_t cmd ) {
         case CMD_GET_WORK: return "CMD_GET_WORK";
         case CMD_GET_JOBLIST: return "CMD_GET_JOBLIST";
         case CMD_PUT_PARTS: return "CMD_PUT_PARTS";
+        case CMD_PUT_CHECKPOINT: return "CMD_PUT_CHECKPOINT";
         case CMD_STAT: return "CMD_STAT";
         case CMD_JSTAT: return "CMD_JSTAT";
         case CMD_PSTAT: return "CMD_PSTAT";
+        case CMD_EXSTAT: return "CMD_EXSTAT";
         case CMD_SLV_CFG: return "CMD_SLV_CFG";
         case CMD_SLV_IO: return "CMD_SLV_IO";
         case CMD_SLV_RES: return "CMD_SLV_RES";
@@ -4,6 +4,7 @@
 #include "redux/util/datautil.hpp"
 #include "redux/util/stringutil.hpp"
 
+#include <chrono>
 #include <thread>
 
 namespace ba = boost::asio;
@@ -11,6 +12,7 @@ namespace ba = boost::asio;
 using namespace redux::util;
 using namespace redux::network;
 using namespace std;
+using std::chrono::steady_clock;
 
 #ifdef DEBUG_
 //#define DBG_NET_
@@ -44,7 +46,7 @@ namespace {
 
 TcpConnection::TcpConnection( ba::io_context& ioc )
     : activityCallback( nullptr ), urgentCallback( nullptr ), errorCallback( nullptr ), mySocket( ioc ),
-    ioContext( ioc ), swapEndian_(false), urgentData(0), urgentActive(false), id( getID() ) {
+    ioContext( ioc ), swapEndian_(false), codec_(codec::NONE), urgentData(0), urgentActive(false), id( getID() ) {
 #ifdef DBG_NET_
     LOG_DEBUG << "Constructing TcpConnection: (" << hexString(this) << ")  ID: " << id << "/" << idCount() << ende;
 #endif
@@ -126,6 +128,147 @@ shared_ptr<char> TcpConnection::receiveBlock( uint64_t& received ) {
 }
 
 
+void TcpConnection::writeGathered( const char* data, size_t sz, const BufferList& payload ) {
+
+    if( !mySocket.is_open() ) return;
+    
+    uint64_t payloadSize = payload.size();
+    size_t nBlocks = payload.blocks().size();
+    vector<ba::const_buffer> bufs;
+    bufs.reserve( 2*nBlocks + 2 );
+    bufs.push_back( ba::buffer( data, sz ) );
+    bufs.push_back( ba::buffer( &payloadSize, sizeof(uint64_t) ) );
+    vector<shared_ptr<char>> encoded;           // keeps the compressed blocks alive until they are written.
+    vector<uint64_t> encodedSizes( nBlocks );
+    if( codec_ != codec::NONE ) encoded.reserve( nBlocks );
+    for( size_t i=0; i<nBlocks; ++i ) {
+        const auto& b = payload.blocks()[i];
+        if( codec_ == codec::NONE ) {
+            bufs.push_back( ba::buffer( b.data, b.size ) );
+            continue;
+        }
+        auto t0 = steady_clock::now();
+        encoded.push_back( codec::encode( codec_, b.data, b.size, encodedSizes[i], b.elementSize ) );
+        txStats.add( b.size, encodedSizes[i]+sizeof(uint64_t),
+                     chrono::duration_cast<chrono::microseconds>( steady_clock::now()-t0 ).count() );
+        bufs.push_back( ba::buffer( &encodedSizes[i], sizeof(uint64_t) ) );
+        bufs.push_back( ba::buffer( encoded.back().get(), encodedSizes[i] ) );
+    }
+    ba::write( mySocket, bufs );
+
+}
+
+
+void TcpConnection::receivePayload( BufferList& payload ) {
+
+    uint64_t payloadSize(0);
+    *this >> payloadSize;
+    if( swapEndian_ ) swapEndian( payloadSize );
+    
+    if( payloadSize != payload.size() ) {       // mismatch, discard the data to keep the connection in sync.
+        vector<char> tmp( 1<<20 );
+        auto discard = [&]( uint64_t remaining ) {
+            while( remaining ) {
+                uint64_t n = std::min<uint64_t>( remaining, tmp.size() );
+                ba::read( mySocket, ba::buffer( tmp.data(), n ) );
+                remaining -= n;
+            }
+        };
+        if( codec_ == codec::NONE ) {
+            discard( payloadSize );
+        } else {
+            uint64_t remaining = payloadSize;
+            while( remaining ) {
+                uint64_t encSize(0), rawSize(0);
+                *this >> encSize;
+                if( swapEndian_ ) swapEndian( encSize );
+                if( encSize < codec::bound(0) ) {      // N.B. bound(0) is the size of the block header.
+                    throw length_error( "TcpConnection::receivePayload(): encoded block smaller than its header." );
+                }
+                ba::read( mySocket, ba::buffer( tmp.data(), sizeof(uint64_t) ) );     // the raw size is the first field of the header.
+                rawSize = codec::rawSize( tmp.data(), swapEndian_ );
+                if( !rawSize || (rawSize > remaining) || (encSize > codec::bound( rawSize )) ) {
+                    throw length_error( "TcpConnection::receivePayload(): corrupt block header while discarding a payload." );
+                }
+                discard( encSize-sizeof(uint64_t) );
+                remaining -= std::min( rawSize, remaining );
+            }
+        }
+        throw length_error( "TcpConnection::receivePayload(): size mismatch, expected " + to_string( payload.size() )
+                          + " bytes, but " + to_string( payloadSize ) + " were sent." );
+    }
+    
+    if( codec_ == codec::NONE ) {
+        vector<ba::mutable_buffer> bufs;
+        bufs.reserve( payload.blocks().size() );
+        for( const auto& b: payload.blocks() ) {
+            bufs.push_back( ba::buffer( b.data, b.size ) );
+        }
+        if( ba::read( mySocket, bufs ) != payload.size() ) {
+            throw ios_base::failure( "TcpConnection::receivePayload(): failed to receive data." );
+        }
+    } else {
+        for( const auto& b: payload.blocks() ) {
+            uint64_t encSize(0);
+            *this >> encSize;
+            if( swapEndian_ ) swapEndian( encSize );
+            if( (encSize < codec::bound(0)) || (encSize > codec::bound( b.size )) ) {     // don't allocate whatever the peer claims.
+                throw length_error( "TcpConnection::receivePayload(): invalid encoded size " + to_string( encSize )
+                                  + " for a block of " + to_string( b.size ) + " bytes." );
+            }
+            shared_ptr<char> tmp = rdx_get_shared<char>( encSize );
+            if( ba::read( mySocket, ba::buffer( tmp.get(), encSize ) ) != encSize ) {
+                throw ios_base::failure( "TcpConnection::receivePayload(): failed to receive data." );
+            }
+            if( codec::rawSize( tmp.get(), swapEndian_ ) != b.size ) {
+                throw length_error( "TcpConnection::receivePayload(): block-size mismatch." );
+            }
+            auto t0 = steady_clock::now();
+            codec::decode( tmp.get(), encSize, b.data, swapEndian_ );
+            rxStats.add( b.size, encSize+sizeof(uint64_t),
+                         chrono::duration_cast<chrono::microseconds>( steady_clock::now()-t0 ).count() );
+        }
+    }
+    if( swapEndian_ ) payload.swapEndian();
+
+}
+
+
+void TcpConnection::skipPayload( void ) {
+
+    BufferList none;
+    try {
+        receivePayload( none );
+    } catch( const length_error& ) { }
+
+}
+
+
+shared_ptr<char> TcpConnection::encode( const char* data, uint64_t& sz, uint64_t hdrSize ) {
+
+    auto t0 = steady_clock::now();
+    uint64_t encSize(0);
+    shared_ptr<char> ret = codec::encode( codec_, data, sz, encSize, 1, hdrSize );
+    txStats.add( sz, encSize, chrono::duration_cast<chrono::microseconds>( steady_clock::now()-t0 ).count() );
+    sz = encSize;
+    return ret;
+
+}
+
+
+shared_ptr<char> TcpConnection::decode( const shared_ptr<char>& data, uint64_t& sz ) {
+
+    auto t0 = steady_clock::now();
+    uint64_t rawSize = codec::rawSize( data.get(), swapEndian_ );
+    shared_ptr<char> ret = rdx_get_shared<char>( rawSize );
+    codec::decode( data.get(), sz, ret.get(), swapEndian_ );
+    rxStats.add( rawSize, sz, chrono::duration_cast<chrono::microseconds>( steady_clock::now()-t0 ).count() );
+    sz = rawSize;
+    return ret;
+
+}
+
+
 namespace {
     const string delimiter = "\r\n";
 }
@@ -264,6 +264,7 @@ void TcpServer::onAccept( TcpConnection::Ptr conn,
                 *conn << CMD_CFG;           // request handshake
                 *conn >> rhi;
                 *conn << hi.info;
+                conn->setCodec( redux::util::codec::negotiate( hi.info.codecs, rhi.codecs ) );
                 if( do_auth ) {                       // TODO simple authentication. (key exchange ?)
                     *conn << CMD_AUTH;
                     // if auth fails => return, else continue and do the callback
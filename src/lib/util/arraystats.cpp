@@ -2,13 +2,113 @@
 
 #include "redux/image/utils.hpp"    // apodize
 
+#include <algorithm>
 #include <limits>
+#include <type_traits>
 
 using namespace redux::image;
 using namespace redux::util;
 using namespace std;
 
 
+namespace {
+
+    struct Moments {
+        double min, max, sum, sqr_sum, norm;
+        size_t count;               // number of finite values
+        bool hasInfinity;
+    };
+    
+    // 8/16-bit integers are histogrammed over the full range of the type, in the same pass as the moments.
+    template <typename T> struct FullRange {
+        static const bool value = std::is_integral<T>::value && (sizeof(T) <= 2);
+        static const size_t nBins = (size_t(1) << (8*std::min<size_t>( sizeof(T), 2 )));
+    };
+    
+    // Single pass over the data, 4 independent accumulators so that the compiler can keep them in vector registers.
+    // For floating-point data a non-finite sum means there are NaN/Inf values in the data, in which case the (slower)
+    // loop excluding them is used.
+    template <typename T>
+    Moments moments( const T* data, size_t n, uint32_t* hist ) {
+        
+        Moments ret = { std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(), 0, 0, 0, n, false };
+        double mn[4], mx[4], s[4] = {0,0,0,0}, sq[4] = {0,0,0,0}, nm[4] = {0,0,0,0};
+        std::fill_n( mn, 4, ret.min );
+        std::fill_n( mx, 4, ret.max );
+        const T lowest = std::numeric_limits<T>::lowest();
+        size_t i(0);
+        for( ; i+4 <= n; i+=4 ) {
+            for( int k=0; k<4; ++k ) {
+                double v = static_cast<double>( data[i+k] );
+                mn[k] = (v < mn[k]) ? v : mn[k];
+                mx[k] = (v > mx[k]) ? v : mx[k];
+                s[k] += v;
+                sq[k] += v*v;
+                nm[k] += std::abs(v);
+            }
+            if( FullRange<T>::value && hist ) {
+                for( int k=0; k<4; ++k ) hist[ static_cast<size_t>( data[i+k]-lowest ) ]++;
+            }
+        }
+        for( ; i < n; ++i ) {
+            double v = static_cast<double>( data[i] );
+            mn[0] = (v < mn[0]) ? v : mn[0];
+            mx[0] = (v > mx[0]) ? v : mx[0];
+            s[0] += v;
+            sq[0] += v*v;
+            nm[0] += std::abs(v);
+            if( FullRange<T>::value && hist ) hist[ static_cast<size_t>( data[i]-lowest ) ]++;
+        }
+        for( int k=0; k<4; ++k ) {
+            ret.min = std::min( ret.min, mn[k] );
+            ret.max = std::max( ret.max, mx[k] );
+            ret.sum += s[k];
+            ret.sqr_sum += sq[k];
+            ret.norm += nm[k];
+        }
+        
+        if( std::is_floating_point<T>::value && !std::isfinite( ret.sum + ret.sqr_sum ) ) {
+            ret.sum = ret.sqr_sum = ret.norm = 0;
+            ret.count = 0;
+            for( i=0; i<n; ++i ) {
+                double v = static_cast<double>( data[i] );
+                if( std::isfinite( v ) ) {
+                    ret.sum += v;
+                    ret.norm += std::abs(v);
+                    ret.sqr_sum += v*v;
+                    ret.count++;
+                } else ret.hasInfinity = true;
+            }
+        }
+        
+        return ret;
+        
+    }
+    
+    // value at the fractional rank r (0-based) from a histogram where each bin holds a single value (lo+b).
+    template <typename C>
+    double fromHistogram( const C* hist, size_t nBins, double lo, double r ) {
+        
+        auto orderStat = [&]( uint64_t k ) {
+            uint64_t cum(0);
+            size_t b(0);
+            while( b < nBins-1 && (cum + hist[b]) <= k ) cum += hist[b++];
+            return lo + b;
+        };
+        
+        uint64_t k = static_cast<uint64_t>( r );
+        double frac = r - k;
+        double ret = orderStat( k );
+        if( frac > 0 ) {
+            ret += frac*( orderStat( k+1 ) - ret );
+        }
+        return ret;
+        
+    }
+
+}
+
+
 namespace redux {
     
     namespace util {
@@ -16,31 +116,16 @@ namespace redux {
         template <typename T>
         void ArrayStats::getMinMaxMean( const T* data, size_t n ) {
             
-            min = std::numeric_limits<double>::max();
-            max = std::numeric_limits<double>::lowest();
-            sum = 0;
-            sqr_sum = 0;
-            norm = 0;
-            hasInfinity = false;
-            const T* ptr = data + n;
-            size_t count(0);
-            while( ptr-- > data ) {
-                double tmp = static_cast<double>( *ptr );
-                if( tmp > max ) {
-                    max = tmp;
-                } else if( tmp < min ) {
-                    min = tmp;
-                }
-                if ( isfinite( tmp ) ) { // will exclude NaN
-                    sum += tmp;
-                    norm += abs(tmp);
-                    sqr_sum += tmp*tmp;
-                    count++;
-                } else hasInfinity = true;
-            }
+            Moments m = moments( data, n, nullptr );
+            min = m.min;
+            max = m.max;
+            sum = m.sum;
+            sqr_sum = m.sqr_sum;
+            norm = m.norm;
+            hasInfinity = m.hasInfinity;
             mean = sum;
-            if( count ) {
-                mean /= count;
+            if( m.count ) {
+                mean /= m.count;
             }
         }
         template void ArrayStats::getMinMaxMean( const char*, size_t );
@@ -93,6 +178,116 @@ namespace redux {
         template void ArrayStats::getRmsStddev( const double*, size_t );
 
 
+        template <typename T>
+        std::vector<double> ArrayStats::getPercentiles( const T* data, size_t n, const std::vector<double>& p ) const {
+            
+            std::vector<double> ret( p.size(), min );
+            if( !n || !(max > min) ) return ret;
+            
+            if( !std::isfinite( max-min ) ) {           // no sensible binning possible, sort the finite values instead.
+                std::vector<double> tmp;
+                tmp.reserve( n );
+                for( size_t i=0; i<n; ++i ) {
+                    double v = static_cast<double>( data[i] );
+                    if( std::isfinite( v ) ) tmp.push_back( v );
+                }
+                if( tmp.empty() ) return ret;
+                std::sort( tmp.begin(), tmp.end() );
+                for( size_t i=0; i<p.size(); ++i ) {
+                    double r = std::min( std::max( p[i], 0.0 ), 1.0 ) * (tmp.size()-1);
+                    size_t k = static_cast<size_t>( r );
+                    ret[i] = tmp[k];
+                    if( k+1 < tmp.size() ) ret[i] += (r-k)*(tmp[k+1]-tmp[k]);
+                }
+                return ret;
+            }
+            
+            bool exact = std::is_integral<T>::value && ((max-min) < histogramBins);
+            size_t nBins = exact ? static_cast<size_t>(max-min) + 1 : histogramBins;
+            double width = exact ? 1.0 : (max-min)/nBins;
+            double scale = 1.0/width;
+            std::vector<uint64_t> hist( nBins, 0 );
+            uint64_t nValid(0);
+            for( size_t i=0; i<n; ++i ) {
+                double v = static_cast<double>( data[i] );
+                if( v >= min && v <= max ) {            // excludes NaN
+                    hist[ std::min( static_cast<size_t>( (v-min)*scale ), nBins-1 ) ]++;
+                    nValid++;
+                }
+            }
+            if( !nValid ) return ret;
+            
+            std::vector<double> r( p.size() );
+            for( size_t i=0; i<p.size(); ++i ) {
+                r[i] = std::min( std::max( p[i], 0.0 ), 1.0 ) * (nValid-1);
+            }
+            if( exact ) {
+                for( size_t i=0; i<p.size(); ++i ) {
+                    ret[i] = fromHistogram( hist.data(), nBins, min, r[i] );
+                }
+                return ret;
+            }
+            
+            // Otherwise the histogram only locates the bins holding the needed ranks, a second pass collects the
+            // values in those bins, and the exact order statistics are picked from them.
+            std::vector<uint64_t> cum( nBins+1, 0 );
+            for( size_t b=0; b<nBins; ++b ) cum[b+1] = cum[b] + hist[b];
+            auto binOf = [&cum]( uint64_t k ) {
+                return static_cast<size_t>( std::upper_bound( cum.begin()+1, cum.end(), k ) - cum.begin() ) - 1;
+            };
+            std::vector<int32_t> slot( nBins, -1 );
+            std::vector< std::vector<double> > values;
+            for( size_t i=0; i<p.size(); ++i ) {
+                uint64_t k = static_cast<uint64_t>( r[i] );
+                for( uint64_t kk: { k, std::min( k+1, nValid-1 ) } ) {
+                    size_t b = binOf( kk );
+                    if( slot[b] < 0 ) {
+                        slot[b] = values.size();
+                        values.emplace_back();
+                        values.back().reserve( hist[b] );
+                    }
+                }
+            }
+            for( size_t i=0; i<n; ++i ) {
+                double v = static_cast<double>( data[i] );
+                if( v >= min && v <= max ) {
+                    int32_t s = slot[ std::min( static_cast<size_t>( (v-min)*scale ), nBins-1 ) ];
+                    if( s >= 0 ) values[s].push_back( v );
+                }
+            }
+            for( auto& v: values ) std::sort( v.begin(), v.end() );
+            auto orderStat = [&]( uint64_t k ) {
+                size_t b = binOf( k );
+                return values[ slot[b] ][ k-cum[b] ];
+            };
+            for( size_t i=0; i<p.size(); ++i ) {
+                uint64_t k = static_cast<uint64_t>( r[i] );
+                ret[i] = orderStat( k );
+                if( k+1 < nValid ) ret[i] += (r[i]-k)*( orderStat( k+1 ) - ret[i] );
+            }
+            return ret;
+            
+        }
+        
+        
+        template <typename T>
+        void ArrayStats::getMedian( const T* data, size_t n ) {
+            
+            median = getPercentile( data, n, 0.5 );
+            
+        }
+        template void ArrayStats::getMedian( const int8_t*, size_t );
+        template void ArrayStats::getMedian( const uint8_t*, size_t );
+        template void ArrayStats::getMedian( const int16_t*, size_t );
+        template void ArrayStats::getMedian( const uint16_t*, size_t );
+        template void ArrayStats::getMedian( const int32_t*, size_t );
+        template void ArrayStats::getMedian( const uint32_t*, size_t );
+        template void ArrayStats::getMedian( const int64_t*, size_t );
+        template void ArrayStats::getMedian( const uint64_t*, size_t );
+        template void ArrayStats::getMedian( const float*, size_t );
+        template void ArrayStats::getMedian( const double*, size_t );
+
+
         void ArrayStats::getNoise( const redux::image::FourierTransform& ft ) {
             
             noise = ft.noise( clip, cutoff );
@@ -122,12 +317,36 @@ namespace redux {
         template <typename T>
         void ArrayStats::getStats( const T* data, size_t count, int flags ) {
 
-            getMinMaxMean<T>( data, count );
+            // For 8/16-bit data the (exact) median comes from a histogram filled in the same pass as the moments,
+            // otherwise a second pass is needed, since the binning depends on min/max.
+            const bool fused = FullRange<T>::value && (flags & ST_MEDIAN);
+            std::vector<uint32_t> hist( fused ? FullRange<T>::nBins : 0, 0 );
+            if( fused && (count > std::numeric_limits<uint32_t>::max()) ) hist.clear();
             
-            // TODO: median
+            Moments m = moments( data, count, hist.empty() ? nullptr : hist.data() );
+            min = m.min;
+            max = m.max;
+            sum = m.sum;
+            sqr_sum = m.sqr_sum;
+            norm = m.norm;
+            hasInfinity = m.hasInfinity;
+            mean = sum;
+            if( m.count ) {
+                mean /= m.count;
+            }
             
-            if( flags & ST_RMS ) {
-                getRmsStddev( data, count );
+            if( (flags & ST_RMS) && m.count ) {
+                rms = sqr_sum/m.count;
+                stddev = sqrt( std::max( rms - mean*mean, 0.0 ) );
+                rms = sqrt(rms);
+            }
+            
+            if( flags & ST_MEDIAN ) {
+                if( !hist.empty() ) {
+                    if( count ) median = fromHistogram( hist.data(), hist.size(), std::numeric_limits<T>::lowest(), 0.5*(count-1) );
+                } else {
+                    getMedian( data, count );
+                }
             }
 
         }
@@ -146,12 +365,12 @@ namespace redux {
         template <typename T>
         void ArrayStats::getStats( const Array<T>& data, int flags ) {
 
-            getMinMaxMean( data );
-            
-            // TODO: median
-            
-            if( flags & ST_RMS ) {
-                getRmsStddev(data);
+            size_t nEl = data.nElements();
+            if( data.dense() ) getStats( data.ptr(), nEl, flags );
+            else if( nEl ) {
+                std::unique_ptr<T[]> tmp( new T[ nEl ]);
+                data.template copyTo<T>( tmp.get() );
+                getStats( tmp.get(), nEl, flags );
             }
             
             if( flags & ST_NOISE ) {
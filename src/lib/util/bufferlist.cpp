@@ -0,0 +1,78 @@
+#include "redux/util/bufferlist.hpp"
+
+#include "redux/util/endian.hpp"
+#include "redux/util/trace.hpp"
+
+#include <stdexcept>
+
+using namespace redux::util;
+using namespace std;
+
+
+namespace {
+
+    thread_local BufferList* activeList(nullptr);
+
+}
+
+
+void BufferList::add( char* data, uint64_t sz, uint8_t elementSize, shared_ptr<void> owner ) {
+
+    if( !data || !sz ) return;
+    blocks_.push_back( { data, sz, elementSize, owner } );
+    totalSize += sz;
+
+}
+
+
+char* BufferList::stage( uint64_t sz, uint8_t elementSize ) {
+
+    shared_ptr<char> buf = rdx_get_shared<char>( sz );
+    add( buf.get(), sz, elementSize, buf );
+    return buf.get();
+
+}
+
+
+void BufferList::clear( void ) {
+
+    blocks_.clear();
+    totalSize = 0;
+
+}
+
+
+void BufferList::swapEndian( void ) {
+
+    for( auto& b: blocks_ ) {
+        switch( b.elementSize ) {
+            case 2: redux::util::swapEndian( reinterpret_cast<uint16_t*>(b.data), b.size/2 ); break;
+            case 4: redux::util::swapEndian( reinterpret_cast<uint32_t*>(b.data), b.size/4 ); break;
+            case 8: redux::util::swapEndian( reinterpret_cast<uint64_t*>(b.data), b.size/8 ); break;
+            case 1: break;
+            default: throw logic_error( "BufferList::swapEndian(): unsupported element-size: " + to_string(b.elementSize) );
+        }
+    }
+
+}
+
+
+BufferList* BufferList::active( void ) {
+
+    return activeList;
+
+}
+
+
+BufferList::Scope::Scope( BufferList* bl ) : previous( activeList ) {
+
+    activeList = bl;
+
+}
+
+
+BufferList::Scope::~Scope() {
+
+    activeList = previous;
+
+}
@@ -1,27 +1,34 @@
 #include "redux/util/cache.hpp"
 
 #include "redux/file/fileio.hpp"
+#include "redux/util/pool.hpp"
 
 #include <iostream>
 #include <memory>
 
+#include <boost/format.hpp>
+
 
 using namespace redux::file;
 using namespace redux::util;
 using namespace std;
 
 
-Cache::Info::Info( size_t i, const string& n, size_t s ) : id1(i), id2(0), name(n), size(s), count(0), totalSize(0) {
+Cache::Info::Info( size_t i, const string& n, size_t s ) : id1(i), id2(0), name(n), size(s), count(0), totalSize(0),
+    hits(0), misses(0), evictions(0), evictable(false) {
 
 }
 
-Cache::Info::Info( size_t i1, size_t i2, const string& n, size_t s ) : id1(i1), id2(i2), name(n), size(s), count(0), totalSize(0) {
+Cache::Info::Info( size_t i1, size_t i2, const string& n, size_t s ) : id1(i1), id2(i2), name(n), size(s), count(0), totalSize(0),
+    hits(0), misses(0), evictions(0), evictable(false) {
 
 }
 
 
 std::string Cache::Info::getInfo(void) const {
-    return alignLeft(to_string(count),12) + alignLeft(to_string(count*size),14) + name;
+    size_t sz = (evictable && totalSize) ? totalSize : count*size;
+    return alignLeft(to_string(count),12) + alignLeft(to_string(sz),14) + alignLeft(to_string(hits),12)
+           + alignLeft(to_string(misses),12) + alignLeft(evictable?to_string(evictions):"-",12) + name;
     
 /*              map:   return  std::string(typeid(KeyT).name()) + " -> " + std::string(typeid(T).name())
                     + "   count: " + std::to_string(m.second.size());
@@ -35,17 +42,60 @@ void Cache::cleanup(void) {
     for( auto& c: get().caches ) {
         c.clear();
     }
+    MemoryPool::trim();
+}
+
+
+void Cache::trim(void) {
+    
+    Cache& c = get();
+    const size_t budget = c.budget_;
+    if( !budget ) return;
+    
+    lock_guard<mutex> lock(c.mtx);
+    const time_point idleBefore = chrono::steady_clock::now() - chrono::seconds( c.minIdle_ );
+    vector<Candidate> candidates;
+    size_t total(0);
+    for( auto& i: c.caches ) {
+        if( i.evictable && i.collect ) {
+            total += i.collect( candidates, idleBefore );
+        } else {
+            total += i.count*i.size;
+        }
+    }
+    if( total <= budget || candidates.empty() ) return;
+
+    // find the time-stamp such that evicting everything older brings us below the budget
+    std::sort( candidates.begin(), candidates.end() );
+    const size_t excess = total - budget;
+    size_t freed(0);
+    time_point cutoff = candidates.front().first;
+    for( auto& cand: candidates ) {
+        cutoff = cand.first;
+        freed += cand.second;
+        if( freed >= excess ) break;
+    }
+    
+    for( auto& i: c.caches ) {
+        if( i.evictable && i.evict ) {
+            i.evict( cutoff, idleBefore );
+        }
+    }
+    
 }
 
 std::string Cache::getStats(void) {
     string ret;
-    static const string hdr = "Items       Size          Type\n";
+    static const string hdr = "Items       Size          Hits        Misses      Evicted     Type\n";
     lock_guard<mutex> lock(get().mtx);
     for( auto& c: get().caches ) {
         ret += c.getInfo() + "\n";
     }
-    if( ret.empty() ) return ret;
-    return hdr+ret;
+    if( !ret.empty() ) ret = hdr + ret;
+    if( get().budget_ ) {
+        ret += boost::str( boost::format( "Cache budget: %.1f MiB\n" ) % (get().budget_ / 1048576.0) );
+    }
+    return ret + MemoryPool::print();
 }
 
 Cache& Cache::get(void) {
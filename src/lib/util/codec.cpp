@@ -0,0 +1,358 @@
+#include "redux/util/codec.hpp"
+
+#include "redux/util/datautil.hpp"
+#include "redux/util/stringutil.hpp"
+#include "redux/util/trace.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>
+#ifdef RDX_WITH_LZ4
+#include <lz4.h>
+#endif
+#ifdef RDX_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+
+using namespace redux::util;
+using namespace std;
+
+
+namespace {
+
+    const uint8_t shuffleFlag = 0x80;
+    const uint64_t blockHdrSize = sizeof(uint64_t) + sizeof(uint32_t);
+    const uint64_t chunkHdrSize = 2 + 2*sizeof(uint32_t);
+
+    const string typeNames[] = { "none", "zlib", "lz4", "zstd" };
+    const codec::Type preferred[] = { codec::ZSTD, codec::LZ4, codec::ZLIB };
+
+    // generous enough for all the supported codecs (zlib: n+n/4096+..., lz4: n+n/255+16, zstd: n+n/256+...)
+    uint64_t chunkBound( uint64_t n ) { return n + n/128 + 1024; }
+
+    uint64_t nChunks( uint64_t rawSize ) { return (rawSize + codec::chunkSize - 1) / codec::chunkSize; }
+
+    void shuffle( const char* in, char* out, uint64_t n, uint8_t es ) {
+        const uint64_t nEl = n / es;
+        for( uint8_t b=0; b<es; ++b ) {
+            char* optr = out + b*nEl;
+            const char* iptr = in + b;
+            for( uint64_t i=0; i<nEl; ++i ) optr[i] = iptr[i*es];
+        }
+        memcpy( out+nEl*es, in+nEl*es, n-nEl*es );        // trailing bytes (if n is not a multiple of es)
+    }
+
+    void unshuffle( const char* in, char* out, uint64_t n, uint8_t es ) {
+        const uint64_t nEl = n / es;
+        for( uint8_t b=0; b<es; ++b ) {
+            const char* iptr = in + b*nEl;
+            char* optr = out + b;
+            for( uint64_t i=0; i<nEl; ++i ) optr[i*es] = iptr[i];
+        }
+        memcpy( out+nEl*es, in+nEl*es, n-nEl*es );
+    }
+
+    // returns the compressed size, or 0 if it failed/did not fit in cap.
+    uint64_t compressChunk( codec::Type t, const char* in, uint64_t n, char* out, uint64_t cap ) {
+        switch( t ) {
+            case codec::ZLIB: {
+                uLongf sz = cap;
+                if( compress2( reinterpret_cast<Bytef*>(out), &sz, reinterpret_cast<const Bytef*>(in), n, Z_BEST_SPEED ) == Z_OK ) return sz;
+                break;
+            }
+#ifdef RDX_WITH_LZ4
+            case codec::LZ4: {
+                int sz = LZ4_compress_default( in, out, n, cap );
+                if( sz > 0 ) return sz;
+                break;
+            }
+#endif
+#ifdef RDX_WITH_ZSTD
+            case codec::ZSTD: {
+                size_t sz = ZSTD_compress( out, cap, in, n, 1 );
+                if( !ZSTD_isError( sz ) ) return sz;
+                break;
+            }
+#endif
+            default: ;
+        }
+        return 0;
+    }
+
+    void decompressChunk( codec::Type t, const char* in, uint64_t n, char* out, uint64_t rawSz ) {
+        bool ok(false);
+        switch( t ) {
+            case codec::ZLIB: {
+                uLongf sz = rawSz;
+                ok = (uncompress( reinterpret_cast<Bytef*>(out), &sz, reinterpret_cast<const Bytef*>(in), n ) == Z_OK) && (sz == rawSz);
+                break;
+            }
+#ifdef RDX_WITH_LZ4
+            case codec::LZ4: ok = (LZ4_decompress_safe( in, out, n, rawSz ) == static_cast<int>(rawSz)); break;
+#endif
+#ifdef RDX_WITH_ZSTD
+            case codec::ZSTD: ok = (ZSTD_decompress( out, rawSz, in, n ) == rawSz); break;
+#endif
+            default: throw invalid_argument( "codec::decode(): unsupported codec: " + to_string(int(t)) );
+        }
+        if( !ok ) throw runtime_error( "codec::decode(): failed to decompress " + codec::name(t) + " chunk." );
+    }
+
+    // run f(i) for i in [0,n), in parallel if there is more than one item.
+    template <typename F>
+    void forEachChunk( uint64_t n, F f ) {
+        if( n < 2 ) {
+            if( n ) f( 0 );
+            return;
+        }
+        atomic<uint64_t> next(0);
+        std::exception_ptr err;
+        mutex emtx;
+        auto worker = [&](){
+            uint64_t i;
+            while( (i = next++) < n ) {
+                try {
+                    f( i );
+                } catch( ... ) {
+                    lock_guard<mutex> lock( emtx );
+                    err = std::current_exception();
+                }
+            }
+        };
+        uint64_t nThreads = std::min<uint64_t>( n, std::max<unsigned>( std::thread::hardware_concurrency(), 1 ) );
+        vector<thread> threads;
+        for( uint64_t t=1; t<nThreads; ++t ) threads.push_back( thread( worker ) );
+        worker();
+        for( auto& th: threads ) th.join();
+        if( err ) std::rethrow_exception( err );
+    }
+
+}
+
+
+uint32_t codec::available( void ) {
+
+    uint32_t ret = (1<<ZLIB);
+#ifdef RDX_WITH_LZ4
+    ret |= (1<<LZ4);
+#endif
+#ifdef RDX_WITH_ZSTD
+    ret |= (1<<ZSTD);
+#endif
+    return ret;
+
+}
+
+
+uint32_t codec::parse( const string& str ) {
+
+    string s = boost::to_lower_copy( str );
+    if( s.empty() || s == "auto" ) return available();
+    uint32_t ret(0);
+    vector<string> names;
+    boost::split( names, s, boost::is_any_of(",") );
+    for( auto& n: names ) {
+        boost::trim( n );
+        auto it = std::find( std::begin(typeNames), std::end(typeNames), n );
+        if( it == std::end(typeNames) ) throw invalid_argument( "codec::parse(): unknown codec \"" + n + "\"" );
+        if( it != std::begin(typeNames) ) ret |= (1 << (it-std::begin(typeNames)));
+    }
+    return ret & available();
+
+}
+
+
+codec::Type codec::negotiate( uint32_t mine, uint32_t theirs ) {
+
+    uint32_t common = mine & theirs & available();
+    for( auto& t: preferred ) {
+        if( common & (1<<t) ) return t;
+    }
+    return NONE;
+
+}
+
+
+string codec::name( Type t ) {
+
+    if( t < NTYPES ) return typeNames[t];
+    return "unknown(" + to_string(int(t)) + ")";
+
+}
+
+
+uint64_t codec::bound( uint64_t rawSize ) {
+
+    uint64_t n = nChunks( rawSize );
+    uint64_t ret = blockHdrSize + n*chunkHdrSize;
+    if( n ) ret += (n-1)*chunkBound( chunkSize ) + chunkBound( rawSize - (n-1)*chunkSize );
+    return ret;
+
+}
+
+
+uint64_t codec::rawSize( const char* in, bool swap_endian ) {
+
+    uint64_t ret(0);
+    redux::util::unpack( in, ret, swap_endian );
+    return ret;
+
+}
+
+
+shared_ptr<char> codec::encode( Type t, const char* in, uint64_t rawSize, uint64_t& encodedSize, uint8_t elementSize, uint64_t hdrSize ) {
+
+    using redux::util::pack;
+
+    const uint64_t nC = nChunks( rawSize );
+    const uint64_t slotSize = chunkHdrSize + chunkBound( chunkSize );
+    shared_ptr<char> buf = rdx_get_shared<char>( hdrSize + blockHdrSize + nC*slotSize );
+    char* out = buf.get() + hdrSize;
+
+    uint64_t count = pack( out, rawSize );
+    count += pack( out+count, static_cast<uint32_t>(nC) );
+    if( elementSize < 2 || t == NONE ) elementSize = 1;
+
+    vector<uint64_t> slotSizes( nC );
+    forEachChunk( nC, [&]( uint64_t i ) {
+        const uint64_t offset = i*chunkSize;
+        const uint32_t n = std::min<uint64_t>( chunkSize, rawSize-offset );
+        char* slot = out + count + i*slotSize;
+        const char* src = in + offset;
+        shared_ptr<char> tmp;
+        if( elementSize > 1 ) {
+            tmp = rdx_get_shared<char>( n );
+            shuffle( src, tmp.get(), n, elementSize );
+            src = tmp.get();
+        }
+        uint8_t type = t;
+        uint64_t encSize = compressChunk( t, src, n, slot+chunkHdrSize, slotSize-chunkHdrSize );
+        if( !encSize || encSize >= n ) {          // incompressible, store it as it is.
+            type = NONE;
+            encSize = n;
+            memcpy( slot+chunkHdrSize, in+offset, n );
+        } else if( elementSize > 1 ) type |= shuffleFlag;
+        uint64_t c = pack( slot, type );
+        c += pack( slot+c, elementSize );
+        c += pack( slot+c, n );
+        pack( slot+c, static_cast<uint32_t>(encSize) );
+        slotSizes[i] = chunkHdrSize + encSize;
+    });
+
+    for( uint64_t i=0; i<nC; ++i ) {        // compact the slots
+        char* slot = out + blockHdrSize + i*slotSize;
+        if( slot != out+count ) memmove( out+count, slot, slotSizes[i] );
+        count += slotSizes[i];
+    }
+
+    encodedSize = count;
+    return buf;
+
+}
+
+
+uint64_t codec::decode( const char* in, uint64_t encodedSize, char* out, bool swap_endian ) {
+
+    using redux::util::unpack;
+
+    uint64_t rawSize(0);
+    uint32_t nC(0);
+    if( encodedSize < blockHdrSize ) throw length_error( "codec::decode(): block too small." );
+    uint64_t count = unpack( in, rawSize, swap_endian );
+    count += unpack( in+count, nC, swap_endian );
+    // i.e. nC == ceil(rawSize/chunkSize), written without the overflow for a bogus rawSize.
+    if( uint64_t(nC)*chunkSize < rawSize || (nC && uint64_t(nC-1)*chunkSize >= rawSize) ) {
+        throw length_error( "codec::decode(): corrupt block header." );
+    }
+
+    struct Chunk { uint8_t type, elementSize; uint32_t raw, enc; const char* data; };
+    vector<Chunk> chunks( nC );
+    for( uint64_t i=0; i<nC; ++i ) {
+        Chunk& c = chunks[i];
+        if( count + chunkHdrSize > encodedSize ) throw length_error( "codec::decode(): truncated block." );
+        count += unpack( in+count, c.type );
+        count += unpack( in+count, c.elementSize );
+        count += unpack( in+count, c.raw, swap_endian );
+        count += unpack( in+count, c.enc, swap_endian );
+        c.data = in + count;
+        if( c.enc > encodedSize - count ) throw length_error( "codec::decode(): truncated block." );
+        count += c.enc;
+        // every chunk must exactly fill its part of the output, anything else would write outside of the rawSize bytes.
+        const uint64_t expected = std::min<uint64_t>( chunkSize, rawSize - i*chunkSize );
+        if( c.raw != expected ) {
+            throw length_error( "codec::decode(): corrupt chunk header, raw size " + to_string(c.raw)
+                                + " != " + to_string(expected) + " for chunk #" + to_string(i) );
+        }
+        Type t = static_cast<Type>( c.type & ~shuffleFlag );
+        if( (t == NONE && (c.enc != c.raw || (c.type & shuffleFlag))) || t >= NTYPES || ((c.type & shuffleFlag) && !c.elementSize) ) {
+            throw length_error( "codec::decode(): corrupt chunk header for chunk #" + to_string(i) );
+        }
+    }
+
+    forEachChunk( nC, [&]( uint64_t i ) {
+        const Chunk& c = chunks[i];
+        char* dst = out + i*chunkSize;
+        Type t = static_cast<Type>( c.type & ~shuffleFlag );
+        if( t == NONE ) {
+            memcpy( dst, c.data, c.raw );
+        } else if( c.type & shuffleFlag ) {
+            shared_ptr<char> tmp = rdx_get_shared<char>( c.raw );
+            decompressChunk( t, c.data, c.enc, tmp.get(), c.raw );
+            unshuffle( tmp.get(), dst, c.raw, c.elementSize );
+        } else {
+            decompressChunk( t, c.data, c.enc, dst, c.raw );
+        }
+    });
+
+    return count;
+
+}
+
+
+codec::Stats& codec::Stats::operator=( const Stats& rhs ) {
+
+    raw = rhs.raw.load();
+    wire = rhs.wire.load();
+    usecs = rhs.usecs.load();
+    return *this;
+
+}
+
+
+uint64_t codec::Stats::pack( char* ptr ) const {
+
+    using redux::util::pack;
+    uint64_t count = pack( ptr, raw.load() );
+    count += pack( ptr+count, wire.load() );
+    count += pack( ptr+count, usecs.load() );
+    return count;
+
+}
+
+
+uint64_t codec::Stats::unpack( const char* ptr, bool swap_endian ) {
+
+    using redux::util::unpack;
+    uint64_t tmp[3];
+    uint64_t count = unpack( ptr, tmp, 3, swap_endian );
+    raw = tmp[0];
+    wire = tmp[1];
+    usecs = tmp[2];
+    return count;
+
+}
+
+
+string codec::Stats::print( void ) const {
+
+    return boost::str( boost::format( "%.1f MiB @ %.2fx, %.1f s" ) % (raw/(1024.0*1024.0)) % ratio() % (usecs*1E-6) );
+
+}
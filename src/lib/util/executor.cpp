@@ -0,0 +1,423 @@
+#include "redux/util/executor.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include <boost/format.hpp>
+
+using namespace redux::util;
+using namespace std;
+
+
+namespace {
+
+    thread_local const Executor* currentExecutor(nullptr);
+    thread_local void* currentWorker(nullptr);
+    thread_local const void* currentGroup(nullptr);        // the TaskGroup::State of the group-task running in this thread.
+
+    const string laneNames[] = { "net", "io", "preprocess", "solve" };
+
+    uint64_t usecs( const chrono::steady_clock::duration& d ) {
+        return chrono::duration_cast<chrono::microseconds>( d ).count();
+    }
+
+}
+
+
+Executor& Executor::get( void ) {
+
+    static Executor* ex = new Executor();      // never destroyed, tasks might still be running when static objects are destructed.
+    return *ex;
+
+}
+
+
+Executor::Executor( size_t nThreads ) : pending(0), running(0) {
+
+    if( !nThreads ) nThreads = std::thread::hardware_concurrency();
+    resize( nThreads );
+
+}
+
+
+Executor::~Executor() {
+
+    {
+        unique_lock<shared_timed_mutex> lock( workersMtx );
+        for( auto& w: workers ) w->exit = true;
+    }
+    {
+        lock_guard<mutex> lock( sleepMtx );
+        sleepCond.notify_all();
+    }
+    for( auto& w: workers ) {
+        if( w->thread.joinable() ) w->thread.join();
+    }
+    lock_guard<mutex> lock( retiredMtx );
+    for( auto& w: retired ) {
+        if( w->thread.joinable() ) w->thread.join();
+    }
+
+}
+
+
+void Executor::submit( Lane lane, function<void(void)> fn ) {
+
+    if( lane >= NLANES ) lane = SOLVE;
+    Task t = { std::move(fn), clock::now() };
+    ++lanes[lane].queued;
+    ++pending;
+    Worker* self = (currentExecutor == this) ? static_cast<Worker*>( currentWorker ) : nullptr;
+    bool queued(false);
+    if( self ) {
+        lock_guard<mutex> lock( self->mtx );
+        if( !self->exit ) {         // checked under the lock, resize() drains the queues of removed workers.
+            self->tasks[lane].push_back( std::move(t) );
+            queued = true;
+        }
+    }
+    if( !queued ) {
+        lock_guard<mutex> lock( globalMtx );
+        global[lane].push_back( std::move(t) );
+    }
+    lock_guard<mutex> lock( sleepMtx );
+    sleepCond.notify_one();
+
+}
+
+
+void Executor::resize( size_t n ) {
+
+    n = std::max<size_t>( n, 1 );
+    vector<unique_ptr<Worker>> removed;
+    {
+        unique_lock<shared_timed_mutex> lock( workersMtx );
+        while( workers.size() < n ) {
+            workers.emplace_back( new Worker() );
+            Worker* w = workers.back().get();
+            w->thread = std::thread( &Executor::run, this, w );
+        }
+        while( workers.size() > n ) {
+            workers.back()->exit = true;
+            removed.push_back( std::move( workers.back() ) );
+            workers.pop_back();
+        }
+    }
+    if( removed.empty() ) return;
+    
+    // Hand over the local queues before anything else: a removed worker might be blocked waiting for one of its own tasks.
+    for( auto& w: removed ) {
+        lock_guard<mutex> lock( w->mtx );
+        lock_guard<mutex> glock( globalMtx );
+        for( int l=0; l<NLANES; ++l ) {
+            for( auto& t: w->tasks[l] ) global[l].push_back( std::move(t) );
+            w->tasks[l].clear();
+        }
+    }
+    {
+        lock_guard<mutex> lock( sleepMtx );
+        sleepCond.notify_all();
+    }
+    
+    // Don't wait for the removed workers, they exit when their current task is done. Join the ones that already did.
+    lock_guard<mutex> lock( retiredMtx );
+    for( auto it = retired.begin(); it != retired.end(); ) {
+        if( (*it)->finished ) {
+            (*it)->thread.join();
+            it = retired.erase( it );
+        } else ++it;
+    }
+    for( auto& w: removed ) retired.push_back( std::move(w) );
+
+}
+
+
+size_t Executor::nThreads( void ) const {
+
+    shared_lock<shared_timed_mutex> lock( workersMtx );
+    return workers.size();
+
+}
+
+
+void Executor::setLimit( Lane lane, size_t maxActive ) {
+
+    if( lane < NLANES ) lanes[lane].limit = maxActive;
+
+}
+
+
+void Executor::waitIdle( void ) {
+
+    unique_lock<mutex> lock( sleepMtx );
+    idleCond.wait( lock, [this](){ return !pending && !running; } );
+
+}
+
+
+Executor::LaneStats Executor::stats( Lane lane ) const {
+
+    LaneStats ret = { 0, 0, 0, 0, 0, 0 };
+    if( lane < NLANES ) {
+        const LaneInfo& li = lanes[lane];
+        ret.queued = li.queued;
+        ret.active = li.active;
+        ret.completed = li.completed;
+        ret.waitUs = li.waitUs;
+        ret.maxWaitUs = li.maxWaitUs;
+        ret.runUs = li.runUs;
+    }
+    return ret;
+
+}
+
+
+string Executor::print( void ) const {
+
+    string ret = boost::str( boost::format( "%-12s%8s%8s%8s%12s%22s%14s\n" ) % "LANE" % "LIMIT" % "QUEUED"
+                             % "ACTIVE" % "COMPLETED" % "WAIT avg/max [ms]" % "RUN avg [ms]" );
+    for( int l=0; l<NLANES; ++l ) {
+        LaneStats st = stats( static_cast<Lane>(l) );
+        double n = std::max<uint64_t>( st.completed, 1 );
+        size_t limit = lanes[l].limit;
+        ret += boost::str( boost::format( "%-12s%8s%8d%8d%12d%13.2f/%-8.2f%14.2f\n" ) % laneNames[l]
+                           % (limit ? to_string(limit) : string("-")) % st.queued % st.active % st.completed
+                           % (st.waitUs/n*1E-3) % (st.maxWaitUs*1E-3) % (st.runUs/n*1E-3) );
+    }
+    ret += to_string( nThreads() ) + " threads.";
+    return ret;
+
+}
+
+
+string Executor::laneName( Lane lane ) {
+
+    if( lane < NLANES ) return laneNames[lane];
+    return "unknown";
+
+}
+
+
+void Executor::setErrorHandler( std::function<void(const string&)> handler ) {
+
+    lock_guard<mutex> lock( errorMtx );
+    errorHandler = handler;
+
+}
+
+
+void Executor::reportError( const string& msg ) {
+
+    lock_guard<mutex> lock( errorMtx );
+    if( errorHandler ) {
+        errorHandler( msg );
+    } else {
+        cerr << msg << endl;
+    }
+
+}
+
+
+void Executor::run( Worker* self ) {
+
+    currentExecutor = this;
+    currentWorker = self;
+    size_t pick(0);
+
+    while( !self->exit ) {
+        Task t;
+        Lane lane;
+        if( next( self, t, lane, pick ) ) {
+            clock::time_point started = clock::now();
+            try {
+                t.fn();
+            } catch( const exception& e ) {
+                reportError( "Executor: uncaught exception in " + laneName(lane) + "-task: " + e.what() );
+            } catch( ... ) {
+                reportError( "Executor: uncaught exception in " + laneName(lane) + "-task." );
+            }
+            t.fn = nullptr;         // release captured resources before signalling completion.
+            done( lane, t.queued, started );
+            continue;
+        }
+        unique_lock<mutex> lock( sleepMtx );
+        if( self->exit ) break;
+        if( pending ) {         // there is work, but it is in a lane that is currently at its limit.
+            sleepCond.wait_for( lock, chrono::milliseconds(10) );
+        } else {
+            sleepCond.wait( lock, [&](){ return pending || self->exit; } );
+        }
+    }
+
+    currentExecutor = nullptr;
+    currentWorker = nullptr;
+    self->finished = true;
+
+}
+
+
+bool Executor::next( Worker* self, Task& t, Lane& lane, size_t& pick ) {
+
+    const bool reverse = ((++pick % 16) == 0);
+    for( int i=0; i<NLANES; ++i ) {
+        Lane l = static_cast<Lane>( reverse ? (NLANES-1-i) : i );
+        if( !lanes[l].queued || !reserve( l ) ) continue;
+        bool found(false);
+        {
+            lock_guard<mutex> lock( self->mtx );        // own queue, newest first.
+            auto& q = self->tasks[l];
+            if( !q.empty() ) {
+                t = std::move( q.back() );
+                q.pop_back();
+                found = true;
+            }
+        }
+        if( !found ) {
+            lock_guard<mutex> lock( globalMtx );
+            auto& q = global[l];
+            if( !q.empty() ) {
+                t = std::move( q.front() );
+                q.pop_front();
+                found = true;
+            }
+        }
+        if( !found ) {                                  // steal the oldest task from another worker.
+            shared_lock<shared_timed_mutex> wlock( workersMtx );
+            size_t nW = workers.size();
+            for( size_t j=0; !found && j<nW; ++j ) {
+                Worker* w = workers[ (pick+j) % nW ].get();
+                if( w == self ) continue;
+                lock_guard<mutex> lock( w->mtx );
+                auto& q = w->tasks[l];
+                if( !q.empty() ) {
+                    t = std::move( q.front() );
+                    q.pop_front();
+                    found = true;
+                }
+            }
+        }
+        if( found ) {
+            ++lanes[l].active;
+            ++running;
+            --lanes[l].queued;
+            --pending;
+            lane = l;
+            return true;
+        }
+        --lanes[l].reserved;
+    }
+    return false;
+
+}
+
+
+bool Executor::reserve( Lane l ) {
+
+    size_t limit = lanes[l].limit;
+    size_t reserved = lanes[l].reserved;
+    do {
+        if( limit && (reserved >= limit) ) return false;
+    } while( !lanes[l].reserved.compare_exchange_weak( reserved, reserved+1 ) );
+    return true;
+
+}
+
+
+void Executor::done( Lane l, const clock::time_point& queued, const clock::time_point& started ) {
+
+    LaneInfo& li = lanes[l];
+    uint64_t wait = usecs( started-queued );
+    li.waitUs += wait;
+    li.runUs += usecs( clock::now()-started );
+    uint64_t maxWait = li.maxWaitUs;
+    while( (wait > maxWait) && !li.maxWaitUs.compare_exchange_weak( maxWait, wait ) );
+    ++li.completed;
+    --li.active;
+    --li.reserved;
+    --running;
+
+    lock_guard<mutex> lock( sleepMtx );
+    if( pending ) {
+        if( li.limit ) sleepCond.notify_one();      // a task in this lane might have been waiting for a free slot.
+    } else if( !running ) {
+        idleCond.notify_all();
+    }
+
+}
+
+
+TaskGroup::TaskGroup( Executor& e ) : ex(e), state( make_shared<State>() ) {
+
+}
+
+
+TaskGroup::~TaskGroup() {
+
+    cancel();
+    wait();
+
+}
+
+
+void TaskGroup::submit( Executor::Lane lane, function<void(void)> fn ) {
+
+    shared_ptr<State> st = state;
+    {
+        lock_guard<mutex> lock( st->mtx );
+        if( st->cancelled ) return;
+        ++st->count;
+    }
+    ex.submit( lane, [st,fn](){
+        struct Finish {     // also when fn throws.
+            const shared_ptr<State>& st;
+            const void* prev;
+            ~Finish() {
+                currentGroup = prev;
+                lock_guard<mutex> lock( st->mtx );
+                if( --st->count <= 1 ) st->cond.notify_all();      // <=1: a group-task might be waiting for the others.
+            }
+        } finish = { st, currentGroup };
+        currentGroup = st.get();
+        if( !st->cancelled ) fn();
+    });
+
+}
+
+
+void TaskGroup::cancel( void ) {
+
+    state->cancelled = true;
+
+}
+
+
+void TaskGroup::restart( void ) {
+
+    state->cancelled = false;
+
+}
+
+
+bool TaskGroup::cancelled( void ) const {
+
+    return state->cancelled;
+
+}
+
+
+void TaskGroup::wait( void ) {
+
+    const size_t self = (currentGroup == state.get()) ? 1 : 0;       // don't wait for the calling task itself.
+    unique_lock<mutex> lock( state->mtx );
+    state->cond.wait( lock, [&](){ return state->count <= self; } );
+
+}
+
+
+size_t TaskGroup::size( void ) const {
+
+    lock_guard<mutex> lock( state->mtx );
+    return state->count;
+
+}
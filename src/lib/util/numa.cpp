@@ -0,0 +1,235 @@
+#include "redux/util/numa.hpp"
+
+#include "redux/util/stringutil.hpp"
+
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace redux::util;
+using namespace std;
+
+
+namespace {
+
+    struct Topology {
+        Topology( void ) {
+            const string nodeDir = "/sys/devices/system/node/";
+            for( size_t n=0; ; ++n ) {
+                ifstream cpulist( nodeDir + "node" + to_string(n) + "/cpulist" );
+                if( !cpulist.good() ) break;
+                string line;
+                getline( cpulist, line );
+                vector<uint32_t> nodeCPUs;
+                try {
+                    nodeCPUs = stringToUInts<uint32_t>( line );
+                } catch( ... ) {
+                    // ignore, an empty node (memory-only) is fine.
+                }
+                for( auto& c: nodeCPUs ) {
+                    if( c >= cpuNode.size() ) cpuNode.resize( c+1, -1 );
+                    cpuNode[c] = n;
+                }
+                nodeCpus.push_back( nodeCPUs );
+            }
+            if( nodeCpus.empty() ) {     // no sysfs info, assume a single node with all CPUs
+                uint32_t nCPU = std::max<uint32_t>( std::thread::hardware_concurrency(), 1 );
+                nodeCpus.resize( 1 );
+                for( uint32_t c=0; c<nCPU; ++c ) nodeCpus[0].push_back( c );
+                cpuNode.assign( nCPU, 0 );
+            }
+        }
+        vector< vector<uint32_t> > nodeCpus;
+        vector<int> cpuNode;
+    };
+
+    const Topology& topology( void ) {
+        static const Topology topo;
+        return topo;
+    }
+
+    bool numaEnabled(false);
+
+#ifdef __linux__
+    int setAffinity( const vector<uint32_t>& cpuList ) {
+        cpu_set_t cs;
+        CPU_ZERO( &cs );
+        for( auto& c: cpuList ) {
+            if( c < CPU_SETSIZE ) CPU_SET( c, &cs );
+        }
+        return pthread_setaffinity_np( pthread_self(), sizeof(cs), &cs );
+    }
+#endif
+
+}
+
+
+void numa::enable( bool en ) {
+    numaEnabled = en;
+}
+
+
+bool numa::enabled( void ) {
+    return numaEnabled && (nNodes() > 1);
+}
+
+
+size_t numa::nNodes( void ) {
+    return topology().nodeCpus.size();
+}
+
+
+const vector<uint32_t>& numa::cpus( size_t node ) {
+    const Topology& topo = topology();
+    return topo.nodeCpus[ node % topo.nodeCpus.size() ];
+}
+
+
+int numa::nodeOf( uint32_t cpu ) {
+    const Topology& topo = topology();
+    if( cpu < topo.cpuNode.size() ) return topo.cpuNode[cpu];
+    return -1;
+}
+
+
+int numa::currentNode( void ) {
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if( cpu >= 0 ) return nodeOf( cpu );
+#endif
+    return -1;
+}
+
+
+int numa::pinThread( size_t slot ) {
+
+    const Topology& topo = topology();
+    size_t nN = topo.nodeCpus.size();
+    for( size_t i=0; i<nN; ++i ) {          // skip memory-only nodes
+        size_t node = (slot+i) % nN;
+        if( topo.nodeCpus[node].empty() ) continue;
+#ifdef __linux__
+        if( setAffinity( topo.nodeCpus[node] ) == 0 ) {
+            std::this_thread::yield();      // make sure we are migrated before returning (so first-touch works as expected)
+            return node;
+        }
+#endif
+        break;
+    }
+    return -1;
+
+}
+
+
+void numa::unpinThread( void ) {
+
+#ifdef __linux__
+    vector<uint32_t> all;
+    for( auto& nc: topology().nodeCpus ) {
+        all.insert( all.end(), nc.begin(), nc.end() );
+    }
+    setAffinity( all );
+#endif
+
+}
+
+
+vector<uint32_t> numa::threadCpus( void ) {
+
+    vector<uint32_t> ret;
+#ifdef __linux__
+    cpu_set_t cs;
+    CPU_ZERO( &cs );
+    if( pthread_getaffinity_np( pthread_self(), sizeof(cs), &cs ) == 0 ) {
+        for( uint32_t c=0; c<CPU_SETSIZE; ++c ) {
+            if( CPU_ISSET( c, &cs ) ) ret.push_back( c );
+        }
+    }
+#endif
+    return ret;
+
+}
+
+
+bool numa::setThreadCpus( const vector<uint32_t>& cpuList ) {
+
+#ifdef __linux__
+    if( !cpuList.empty() ) return (setAffinity( cpuList ) == 0);
+#endif
+    return false;
+
+}
+
+
+numa::NodeMem numa::memInfo( size_t node ) {
+
+    NodeMem ret = { 0, 0 };
+    ifstream meminfo( "/sys/devices/system/node/node" + to_string(node) + "/meminfo" );
+    string line;
+    while( getline( meminfo, line ) ) {         // lines look like: "Node 0 MemTotal:       65842580 kB"
+        istringstream iss( line );
+        string tmp, key;
+        uint64_t value(0);
+        if( !(iss >> tmp >> tmp >> key >> value) ) continue;
+        if( key == "MemTotal:" ) ret.total = value*1024;
+        else if( key == "MemFree:" ) ret.free = value*1024;
+    }
+    return ret;
+
+}
+
+
+vector<uint64_t> numa::processMem( void ) {
+
+    vector<uint64_t> ret( nNodes(), 0 );
+    ifstream maps( "/proc/self/numa_maps" );
+    string line;
+    while( getline( maps, line ) ) {            // lines look like: "7f2c4a000000 default anon=512 dirty=512 N0=300 N1=212 kernelpagesize_kB=4"
+        istringstream iss( line );
+        string token;
+        uint64_t pageSize(4096);
+        vector< pair<size_t,uint64_t> > pages;
+        while( iss >> token ) {
+            size_t eq = token.find( '=' );
+            if( eq == string::npos ) continue;
+            try {
+                if( token.size() > 1 && token[0] == 'N' && isdigit( token[1] ) ) {
+                    pages.push_back( make_pair( stoul( token.substr( 1, eq-1 ) ), stoull( token.substr( eq+1 ) ) ) );
+                } else if( token.compare( 0, eq, "kernelpagesize_kB" ) == 0 ) {
+                    pageSize = stoull( token.substr( eq+1 ) )*1024;
+                }
+            } catch( ... ) {
+                // ignore malformed entries
+            }
+        }
+        for( auto& p: pages ) {
+            if( p.first >= ret.size() ) ret.resize( p.first+1, 0 );
+            ret[p.first] += p.second*pageSize;
+        }
+    }
+    return ret;
+
+}
+
+
+string numa::memString( void ) {
+
+    ostringstream oss;
+    vector<uint64_t> pm = processMem();
+    for( size_t n=0; n<nNodes(); ++n ) {
+        NodeMem nm = memInfo( n );
+        if( n ) oss << "  ";
+        oss << "node" << n << "(" << cpus(n).size() << " cpus): process " << ((n < pm.size()) ? pm[n] : 0)/(1024*1024)
+            << " MiB, system " << (nm.total-nm.free)/(1024*1024) << "/" << nm.total/(1024*1024) << " MiB";
+    }
+    if( !enabled() ) oss << "  (NUMA-mode disabled)";
+    return oss.str();
+
+}
+
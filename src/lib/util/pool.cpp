@@ -0,0 +1,314 @@
+#include "redux/util/pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <boost/format.hpp>
+
+using namespace redux::util;
+using namespace std;
+
+
+namespace {
+
+    const size_t maxClassSize = (1ULL<<28);
+    const size_t maxThreadClassSize = (1ULL<<20);
+    const size_t mmapThreshold = (1ULL<<21);
+    const size_t hugePageSize = (1ULL<<21);
+    const size_t threadCacheBytes = (4ULL<<20);         // per class and thread
+    const size_t maxThreadBlocks = 32;
+
+    // 64 byte steps up to 256, then 2^k + m*2^(k-2), m=1..4
+    constexpr size_t classIndex( size_t bytes ) {
+        if( bytes <= 256 ) return bytes ? (bytes-1)/64 : 0;
+        const int k = 63 - __builtin_clzll( bytes-1 );
+        return 4 + (k-8)*4 + ((bytes-1) - (size_t(1)<<k)) / (size_t(1)<<(k-2));
+    }
+
+    constexpr size_t classSize( size_t c ) {
+        if( c < 4 ) return 64*(c+1);
+        const int k = 8 + (c-4)/4;
+        return (size_t(1)<<k) + ((c-4)%4 + 1)*(size_t(1)<<(k-2));
+    }
+
+    const size_t nClasses = classIndex( maxClassSize ) + 1;
+    const size_t nThreadClasses = classIndex( maxThreadClassSize ) + 1;
+    static_assert( classSize( nClasses-1 ) == maxClassSize, "size-class table mismatch" );
+    static_assert( classSize( classIndex( 1000 ) ) == 1024, "size-class table mismatch" );
+
+    inline size_t threadLimit( size_t c ) {
+        return std::max<size_t>( 1, std::min<size_t>( maxThreadBlocks, threadCacheBytes / classSize(c) ) );
+    }
+
+    inline size_t pageRound( size_t bytes ) {
+        static const size_t pageSize = sysconf( _SC_PAGESIZE );
+        return ((bytes + pageSize - 1) / pageSize) * pageSize;
+    }
+
+    struct Depot {
+        mutex mtx;
+        vector<void*> blocks;
+    };
+
+    struct PoolState {
+        PoolState( void ) : inUse(0), requested(0), cached(0), system(0), peakSystem(0), hits(0), misses(0),
+            maxCached(1ULL<<30), hugePages(false) {
+            long nPages = sysconf( _SC_PHYS_PAGES );
+            long pageSize = sysconf( _SC_PAGESIZE );
+            if( nPages > 0 && pageSize > 0 ) maxCached = size_t(nPages) * pageSize / 8;
+        }
+        Depot depots[nClasses];
+        atomic<uint64_t> inUse, requested, cached, system, peakSystem, hits, misses;
+        atomic<size_t> maxCached;
+        atomic<bool> hugePages;
+    };
+
+    PoolState& state( void ) {
+        static PoolState* s = new PoolState();      // never destroyed, blocks might be released during static destruction.
+        return *s;
+    }
+
+    struct ThreadCache {
+        vector<void*> blocks[nThreadClasses];
+        ~ThreadCache() { flush(); }
+        void flush( void ) {
+            PoolState& s = state();
+            for( size_t c=0; c<nThreadClasses; ++c ) {
+                if( blocks[c].empty() ) continue;
+                lock_guard<mutex> lock( s.depots[c].mtx );
+                s.depots[c].blocks.insert( s.depots[c].blocks.end(), blocks[c].begin(), blocks[c].end() );
+                blocks[c].clear();
+            }
+        }
+    };
+
+    thread_local bool threadExiting(false);
+
+    ThreadCache* threadCache( void ) {
+        if( threadExiting ) return nullptr;         // blocks released by thread_local destructors go to the depot.
+        thread_local struct Holder {
+            ThreadCache tc;
+            ~Holder() { threadExiting = true; }
+        } holder;
+        return &holder.tc;
+    }
+
+    void* sysAlloc( size_t bytes ) {
+        PoolState& s = state();
+        void* p(nullptr);
+        if( bytes >= mmapThreshold ) {
+            const bool huge = s.hugePages;
+            const size_t len = bytes + (huge ? hugePageSize : 0);
+            void* m = mmap( nullptr, len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+            if( m == MAP_FAILED ) return nullptr;
+            p = m;
+            if( huge ) {        // align to a hugepage boundary and unmap the slack.
+                uintptr_t a = reinterpret_cast<uintptr_t>( m );
+                uintptr_t aligned = (a + hugePageSize - 1) & ~uintptr_t(hugePageSize - 1);
+                size_t head = aligned - a;
+                if( head ) munmap( m, head );
+                if( head < hugePageSize ) munmap( reinterpret_cast<void*>( aligned + bytes ), hugePageSize - head );
+                p = reinterpret_cast<void*>( aligned );
+#ifdef MADV_HUGEPAGE
+                madvise( p, bytes, MADV_HUGEPAGE );
+#endif
+            }
+        } else if( posix_memalign( &p, MemoryPool::alignment, bytes ) ) {
+            return nullptr;
+        }
+        uint64_t sys = (s.system += bytes);
+        uint64_t peak = s.peakSystem;
+        while( (sys > peak) && !s.peakSystem.compare_exchange_weak( peak, sys ) );
+        return p;
+    }
+
+    void sysFree( void* p, size_t bytes ) {
+        if( bytes >= mmapThreshold ) munmap( p, bytes );
+        else free( p );
+        state().system -= bytes;
+    }
+
+    void* getSystem( size_t bytes ) {
+        void* p = sysAlloc( bytes );
+        if( !p ) {                      // release what is cached and try again before giving up.
+            MemoryPool::trim();
+            p = sysAlloc( bytes );
+        }
+        if( !p ) throw bad_alloc();
+        ++state().misses;
+        return p;
+    }
+
+    string mib( uint64_t bytes ) {
+        return boost::str( boost::format( "%.1f MiB" ) % (bytes / 1048576.0) );
+    }
+
+}
+
+
+void* MemoryPool::allocate( size_t bytes ) {
+
+    PoolState& s = state();
+    if( !bytes ) bytes = 1;
+    if( bytes > maxClassSize ) {
+        size_t sz = pageRound( bytes );
+        void* p = getSystem( sz );
+        s.inUse += sz;
+        s.requested += bytes;
+        return p;
+    }
+
+    const size_t c = classIndex( bytes );
+    const size_t sz = classSize( c );
+    void* p(nullptr);
+    ThreadCache* tc = (c < nThreadClasses) ? threadCache() : nullptr;
+    if( tc && !tc->blocks[c].empty() ) {
+        p = tc->blocks[c].back();
+        tc->blocks[c].pop_back();
+    } else {
+        Depot& d = s.depots[c];
+        lock_guard<mutex> lock( d.mtx );
+        if( !d.blocks.empty() ) {
+            p = d.blocks.back();
+            d.blocks.pop_back();
+            if( tc ) {          // take a few more, to not hit the shared lock for every allocation.
+                size_t n = std::min( d.blocks.size(), threadLimit(c)/2 );
+                tc->blocks[c].insert( tc->blocks[c].end(), d.blocks.end()-n, d.blocks.end() );
+                d.blocks.resize( d.blocks.size()-n );
+            }
+        }
+    }
+
+    if( p ) {
+        s.cached -= sz;
+        ++s.hits;
+    } else {
+        p = getSystem( sz );
+    }
+    s.inUse += sz;
+    s.requested += bytes;
+    return p;
+
+}
+
+
+void MemoryPool::deallocate( void* p, size_t bytes ) {
+
+    if( !p ) return;
+    PoolState& s = state();
+    if( !bytes ) bytes = 1;
+    s.requested -= bytes;
+    if( bytes > maxClassSize ) {
+        size_t sz = pageRound( bytes );
+        s.inUse -= sz;
+        sysFree( p, sz );
+        return;
+    }
+
+    const size_t c = classIndex( bytes );
+    const size_t sz = classSize( c );
+    s.inUse -= sz;
+    if( s.cached + sz > s.maxCached ) {
+        sysFree( p, sz );
+        return;
+    }
+    s.cached += sz;
+
+    ThreadCache* tc = (c < nThreadClasses) ? threadCache() : nullptr;
+    if( tc ) {
+        vector<void*>& tb = tc->blocks[c];
+        if( tb.size() >= threadLimit(c) ) {     // move the older half to the depot
+            size_t n = tb.size()/2;
+            {
+                lock_guard<mutex> lock( s.depots[c].mtx );
+                s.depots[c].blocks.insert( s.depots[c].blocks.end(), tb.begin(), tb.begin()+n );
+            }
+            tb.erase( tb.begin(), tb.begin()+n );
+        }
+        tb.push_back( p );
+        return;
+    }
+
+    lock_guard<mutex> lock( s.depots[c].mtx );
+    s.depots[c].blocks.push_back( p );
+
+}
+
+
+void MemoryPool::trim( void ) {
+
+    if( ThreadCache* tc = threadCache() ) tc->flush();
+    PoolState& s = state();
+    for( size_t c=0; c<nClasses; ++c ) {
+        vector<void*> tmp;
+        {
+            lock_guard<mutex> lock( s.depots[c].mtx );
+            tmp.swap( s.depots[c].blocks );
+        }
+        const size_t sz = classSize( c );
+        for( auto& p: tmp ) {
+            sysFree( p, sz );
+            s.cached -= sz;
+        }
+    }
+
+}
+
+
+void MemoryPool::setMaxCached( size_t bytes ) {
+
+    state().maxCached = bytes;
+    if( state().cached > bytes ) trim();
+
+}
+
+
+size_t MemoryPool::maxCached( void ) {
+
+    return state().maxCached;
+
+}
+
+
+void MemoryPool::useHugePages( bool enable ) {
+
+    state().hugePages = enable;
+
+}
+
+
+MemoryPool::Stats MemoryPool::stats( void ) {
+
+    PoolState& s = state();
+    Stats ret;
+    ret.inUse = s.inUse;
+    ret.requested = s.requested;
+    ret.cached = s.cached;
+    ret.system = s.system;
+    ret.peakSystem = s.peakSystem;
+    ret.hits = s.hits;
+    ret.misses = s.misses;
+    rusage ru;
+    ret.peakRSS = (getrusage( RUSAGE_SELF, &ru ) == 0) ? uint64_t(ru.ru_maxrss)*1024 : 0;
+    return ret;
+
+}
+
+
+string MemoryPool::print( void ) {
+
+    Stats st = stats();
+    double hitRate = 100.0 * st.hits / std::max<uint64_t>( 1, st.hits + st.misses );
+    return "Memory pool: " + mib( st.inUse ) + " in use (" + mib( st.requested ) + " requested), "
+           + mib( st.cached ) + " cached, " + mib( st.system ) + " from system (peak " + mib( st.peakSystem )
+           + "), peak RSS " + mib( st.peakRSS ) + ", " + boost::str( boost::format( "%.1f%% hits" ) % hitRate );
+
+}
@@ -4,6 +4,7 @@
 
 #include <string.h>             // memset
 #include <memory>               // unique_ptr
+#include <type_traits>
 #include <iostream>
 #include <immintrin.h>
 
@@ -127,6 +128,82 @@ namespace {
         uint8_t u8[8];
     };
 
+    /* Straightforward decoder for the Rice format used in tile-compressed FITS (FSBITS/FSMAX = 3/6, 4/14 and 5/25
+     * for 8, 16 and 32-bit data). The stream is read MSB-first through a 64-bit reservoir.
+     */
+    template <typename T, int FSBITS, int FSMAX>
+    int rice_decomp_generic( const uint8_t* in, size_t inSize, T* out, size_t outSize, size_t blockSize ) {
+        
+        typedef typename std::make_unsigned<T>::type U;
+        const int bBits = 8*sizeof(T);
+        
+        if( inSize < sizeof(T) || !blockSize ) return -1;
+        
+        U lastValue(0);
+        for( size_t i=0; i<sizeof(T); ++i ) {       // the first value is stored as-is, big-endian
+            lastValue = static_cast<U>( (static_cast<uint64_t>(lastValue) << 8) | in[i] );
+        }
+        const uint8_t* inPtr = in + sizeof(T);
+        const uint8_t* inEnd = in + inSize;
+        uint64_t bits(0);           // the next bits of the stream, left-aligned
+        int nBits(0);               // number of valid bits in "bits"
+        size_t nPadded(0);          // bytes "read" beyond the end of the input
+        auto refill = [&]( void ) {
+            while( nBits <= 56 ) {
+                uint64_t b(0);
+                if( inPtr < inEnd ) b = *inPtr++;
+                else nPadded++;
+                bits |= b << (56-nBits);
+                nBits += 8;
+            }
+        };
+        auto get = [&]( int n ) -> uint64_t {      // n <= 32
+            if( !n ) return 0;
+            if( nBits < n ) refill();
+            uint64_t ret = bits >> (64-n);
+            bits <<= n;
+            nBits -= n;
+            return ret;
+        };
+        auto unmap = []( U d ) -> U { return (d & 1) ? ~(d >> 1) : (d >> 1); };
+
+        size_t i(0);
+        while( i < outSize ) {
+            const int fs = static_cast<int>( get( FSBITS ) ) - 1;
+            const size_t iMax = std::min( i+blockSize, outSize );
+            if( fs < 0 ) {                      // low-entropy block: all differences are zero
+                for( ; i<iMax; ++i ) out[i] = static_cast<T>( lastValue );
+            } else if( fs == FSMAX ) {          // high-entropy block: the differences are stored as-is
+                for( ; i<iMax; ++i ) {
+                    lastValue += unmap( static_cast<U>( get( bBits ) ) );
+                    out[i] = static_cast<T>( lastValue );
+                }
+            } else {
+                for( ; i<iMax; ++i ) {
+                    uint64_t nZeros(0);         // the high bits are unary coded, i.e. count the zeros up to the next set bit
+                    while( !bits ) {
+                        nZeros += nBits;
+                        nBits = 0;
+                        refill();
+                        if( nPadded > 8 ) return -1;
+                    }
+                    const int z = __builtin_clzll( bits );
+                    nZeros += z;
+                    bits <<= z;
+                    bits <<= 1;
+                    nBits -= z+1;
+                    const U diff = static_cast<U>( (nZeros << fs) | get( fs ) );
+                    lastValue += unmap( diff );
+                    out[i] = static_cast<T>( lastValue );
+                }
+            }
+            if( 8*nPadded > static_cast<size_t>(nBits) ) return -1;       // consumed more bits than there were
+        }
+        
+        return 0;
+        
+    }
+    
     int preprocess_block( const int16_t* block, size_t blockSize, uint32_t* diff, int16_t refValue );
 
     __attribute__ ((target ("default")))
@@ -495,3 +572,24 @@ int redux::util::rice_decomp16( const uint8_t* in, size_t inSize, int16_t* out,
     return 0;
 }
 
+
+
+int redux::util::rice_decomp( const uint8_t* in, size_t inSize, uint8_t* out, size_t outSize, size_t blockSize ) {
+    
+    return rice_decomp_generic<uint8_t, 3, 6>( in, inSize, out, outSize, blockSize );
+    
+}
+
+
+int redux::util::rice_decomp( const uint8_t* in, size_t inSize, int16_t* out, size_t outSize, size_t blockSize ) {
+    
+    return rice_decomp_generic<int16_t, 4, 14>( in, inSize, out, outSize, blockSize );
+    
+}
+
+
+int redux::util::rice_decomp( const uint8_t* in, size_t inSize, int32_t* out, size_t outSize, size_t blockSize ) {
+    
+    return rice_decomp_generic<int32_t, 5, 25>( in, inSize, out, outSize, blockSize );
+    
+}
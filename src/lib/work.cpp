@@ -10,6 +10,10 @@
 #include "redux/util/datautil.hpp"
 #include "redux/util/trace.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 using namespace redux::util;
 using namespace redux;
 using namespace std;
@@ -159,12 +163,56 @@ void WorkInProgress::resetParts( void ) {
 }
 
 
-uint64_t WorkInProgress::workSize(void) {
+void WorkInProgress::addParts( const WorkInProgress& rhs ) {
+    
+    for( auto& part: rhs.parts ) {
+        if( part && (std::find( parts.begin(), parts.end(), part ) == parts.end()) ) {
+            parts.push_back( part );
+        }
+    }
+    nParts = parts.size();
+    if( workStarted.is_not_a_date_time() ) {
+        workStarted = rhs.workStarted;
+    }
+    
+}
+
+
+bool WorkInProgress::removeParts( const vector<uint64_t>& ids ) {
+    
+    parts.erase( std::remove_if( parts.begin(), parts.end(), [&ids]( const Part::Ptr& p ) {
+        return !p || (std::find( ids.begin(), ids.end(), p->id ) != ids.end());
+    }), parts.end() );
+    nParts = parts.size();
+    
+    // The remaining parts (i.e. a prefetched unit) are timed from when the oldest of them was sent, not from
+    // when this WIP was first started. Auxiliary parts (partType != 0, e.g. momfbd globalData) are never returned.
+    bool remaining(false);
+    boost::posix_time::ptime oldest( boost::posix_time::not_a_date_time );
+    for( auto& p: parts ) {
+        if( p->partType != 0 ) continue;
+        remaining = true;
+        if( !p->partStarted.is_special() && (oldest.is_not_a_date_time() || p->partStarted < oldest) ) {
+            oldest = p->partStarted;
+        }
+    }
+    if( !remaining ) {
+        reset();
+        return false;
+    }
+    workStarted = oldest.is_not_a_date_time() ? boost::posix_time::second_clock::universal_time() : oldest;
+    return true;
+    
+}
+
+
+uint64_t WorkInProgress::workSize( BufferList* payload ) {
     uint64_t sz = this->size() + 1; // + newJob
     Job::JobPtr thisJob = job.lock();
     if( thisJob && (jobID != thisJob->info.id)) {
         sz += thisJob->size();
     }
+    BufferList::Scope scope( payload );     // same as in packWork, the deferred array data is not part of the packed block.
     nParts = 0;
     for( const auto& part: parts ) {
         if( part ) {
@@ -176,7 +224,7 @@ uint64_t WorkInProgress::workSize(void) {
 }
 
 
-uint64_t WorkInProgress::packWork( char* ptr ) {
+uint64_t WorkInProgress::packWork( char* ptr, BufferList* payload ) {
     
     Job::JobPtr thisJob = job.lock();
     if( !thisJob ) {
@@ -191,14 +239,17 @@ uint64_t WorkInProgress::packWork( char* ptr ) {
     if( newJob ) {
         count += thisJob->pack( ptr+count );                            // pack Job-info
     }
-    count += thisJob->packParts( ptr+count, shared_from_this() );       // pack parts
+    {
+        BufferList::Scope scope( payload );     // large arrays in the parts are added to payload instead of being copied.
+        count += thisJob->packParts( ptr+count, shared_from_this() );   // pack parts
+    }
     this->pack( ptr );                                              // write WIP info, (done last, in case nParts changed).
     THREAD_MARK
     return count;
 }
 
 
-uint64_t WorkInProgress::unpackWork( const char* ptr, std::shared_ptr<Job>& tmpJob, bool swap_endian ) {
+uint64_t WorkInProgress::unpackWork( const char* ptr, std::shared_ptr<Job>& tmpJob, bool swap_endian, BufferList* payload ) {
 
     using redux::util::unpack;
     uint64_t count = this->unpack( ptr, swap_endian );
@@ -216,6 +267,7 @@ uint64_t WorkInProgress::unpackWork( const char* ptr, std::shared_ptr<Job>& tmpJ
     }
     
     if( tmpJob ) {
+        BufferList::Scope scope( payload );     // the arrays are allocated, and the data is received into them afterwards.
         count += tmpJob->unpackParts( ptr+count, shared_from_this(), swap_endian );
     } else throw invalid_argument( "Can't unpack parts without a job instance..." );
     
@@ -262,3 +314,99 @@ std::string WorkInProgress::print( void ) {
     return ret;
     
 }
+
+
+void HostAffinity::update( size_t id, const WorkInProgress::Ptr& sent ) {
+    
+    static const size_t maxRecent = 16;
+    if( jobID != id ) recent.clear();
+    jobID = id;
+    if( sent ) {
+        for( auto& part: sent->parts ) {
+            if( part && !part->partType ) recent.push_back( part );
+        }
+        if( recent.size() > maxRecent ) {
+            recent.erase( recent.begin(), recent.end()-maxRecent );
+        }
+    }
+    
+}
+
+
+void HostAffinity::updateSpeed( const WorkInProgress::Ptr& returned, uint16_t hostThreads ) {
+    
+    if( !returned ) return;
+    double hostSeconds(0), cost(0);
+    for( auto& part: returned->parts ) {
+        if( !part || part->partType || (part->runtime_wall <= 0) ) continue;
+        hostSeconds += part->runtime_wall * std::max<uint16_t>( part->nThreads, 1 );
+        cost += part->cost();
+    }
+    if( cost <= 0 ) return;
+    hostSeconds /= std::max<uint16_t>( hostThreads, 1 );
+    
+    if( secPerCost > 0 ) secPerCost = 0.7*secPerCost + 0.3*(hostSeconds/cost);       // smooth out the variation between patches.
+    else secPerCost = hostSeconds/cost;
+    
+}
+
+
+deque<WorkInProgress::Ptr>::iterator HostAffinity::pick( deque<WorkInProgress::Ptr>& queue, bool fastHost,
+                                                         const shared_ptr<Job>& onlyJob ) const {
+    
+    struct Score {
+        bool sameJob;       // the host already has the global data for this job.
+        double cost;
+        double dist;        // to the parts most recently sent to the host.
+    };
+    auto getScore = [&]( const WorkInProgress::Ptr& w ) {
+        Score sc = { false, 0, std::numeric_limits<double>::max() };
+        shared_ptr<Job> job = w->job.lock();
+        sc.sameJob = job && (job->info.id == jobID);
+        for( auto& part: w->parts ) {
+            if( !part || part->partType ) continue;      // auxiliary parts (e.g. momfbd globalData) do not count.
+            sc.cost += part->cost();
+            if( !sc.sameJob ) continue;
+            for( auto& r: recent ) {
+                if( r ) sc.dist = std::min( sc.dist, part->distance( *r ) );
+            }
+        }
+        return sc;
+    };
+    auto similar = []( double a, double b ) { return std::abs(a-b) <= 0.1*std::max( a, b ); };
+    auto better = [&]( const Score& a, const Score& b ) {
+        if( fastHost ) {
+            if( !similar( a.cost, b.cost ) ) return (a.cost > b.cost);
+            if( a.sameJob != b.sameJob ) return a.sameJob;
+        } else {
+            if( a.sameJob != b.sameJob ) return a.sameJob;
+            if( !similar( a.cost, b.cost ) ) return (a.cost < b.cost);
+        }
+        return (a.dist < b.dist);
+    };
+    
+    auto best = queue.end();
+    Score bestScore = { false, 0, 0 };
+    for( auto it = queue.begin(); it != queue.end(); ++it ) {
+        if( !*it ) continue;
+        if( onlyJob && ((*it)->job.lock() != onlyJob) ) continue;   // used when filling up a work-unit, only parts from the same job can be combined.
+        Score sc = getScore( *it );
+        if( best == queue.end() || better( sc, bestScore ) ) {
+            best = it;
+            bestScore = sc;
+        }
+    }
+    return best;
+    
+}
+
+
+bool HostAffinity::isFast( double secPerCost, vector<double> speeds ) {
+    
+    if( secPerCost <= 0 ) return true;          // unknown, treat it as fast until we know better.
+    speeds.erase( std::remove_if( speeds.begin(), speeds.end(), []( double s ){ return s <= 0; } ), speeds.end() );
+    if( speeds.size() < 2 ) return true;
+    std::nth_element( speeds.begin(), speeds.begin()+speeds.size()/2, speeds.end() );
+    return (secPerCost <= speeds[ speeds.size()/2 ]);
+    
+}
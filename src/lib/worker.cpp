@@ -8,6 +8,7 @@
 #include "redux/network/protocol.hpp"
 #include "redux/util/arrayutil.hpp"
 #include "redux/util/datautil.hpp"
+#include "redux/util/executor.hpp"
 #include "redux/util/stringutil.hpp"
 #include "redux/util/trace.hpp"
 
@@ -19,8 +20,13 @@ using namespace std;
 
 
 Worker::Worker( Daemon& d ) : running_(false), stopped_(true), exitWhenDone_(false), resetWhenDone_(false),
-    wip(nullptr), daemon( d ), myInfo(Host::myInfo()) {
+    wip(nullptr), prefetchWIP(nullptr), unitSize(0), prefetch(true), daemon( d ), myInfo(Host::myInfo()) {
 
+    if( daemon.params.count("unit-size") ) {
+        unitSize = daemon.params["unit-size"].as<uint16_t>();
+    }
+    prefetch = !daemon.params.count("no-prefetch");
+    
 }
 
 
@@ -39,8 +45,11 @@ void Worker::start( void ) {
     } else {
         wip->reset();
     }
+    if( !prefetchWIP ) {
+        prefetchWIP.reset( new WorkInProgress() );
+    }
     
-    boost::asio::post( daemon.ioContext, std::bind(&Worker::run, this) );
+    boost::asio::post( daemon.ioContext, std::bind(&Worker::run, this) );     // on the daemon's pool, so stop() can interrupt it.
 
     myInfo.touch();
     myInfo.active();
@@ -94,33 +103,46 @@ void Worker::done( void ) {
 }
 
 
-bool Worker::fetchWork( void ) {
+bool Worker::fetchWork( WorkInProgress::Ptr w, bool isPrefetch ) {
 
     bool ret = false;
     network::TcpConnection::Ptr conn;
     string msg;
 
+    uint16_t nParts = unitSize;
+    if( !nParts ) {     // auto: a patch is solved faster with more threads, so the round-trip to the master matters more.
+        nParts = std::min<uint16_t>( std::max<uint16_t>( myInfo.status.nThreads/8, 1 ), 16 );
+    }
+
     try {
 
         if( (conn = daemon.getMaster()) ) {
 
             *conn << CMD_GET_WORK;
-            *conn << wip->jobID;
+            *conn << w->jobID;
+            *conn << nParts;
+            *conn << static_cast<uint8_t>(isPrefetch);
 
             size_t blockSize;
             shared_ptr<char> buf = conn->receiveBlock( blockSize );               // reply
 
             if( blockSize ) {
 
+                if( conn->getCodec() != codec::NONE ) {
+                    buf = conn->decode( buf, blockSize );
+                }
                 const char* ptr = buf.get();
-                uint64_t count = wip->unpackWork( ptr, currentJob, conn->getSwapEndian() );
+                Job::JobPtr tmpJob;
+                BufferList payload;
+                uint64_t count = w->unpackWork( ptr, (isPrefetch ? tmpJob : currentJob), conn->getSwapEndian(), &payload );
+                conn->receivePayload( payload );        // image data is received directly into the allocated arrays
 
                 if( count != blockSize ) {
                     throw invalid_argument( "Failed to unpack data, blockSize=" + to_string( blockSize ) + "  unpacked=" + to_string( count ) );
                 }
-                wip->isRemote = true;
+                w->isRemote = true;
                 
-                LLOG_TRACE(daemon.logger) << "Received work: " << wip->print() << ende;
+                LLOG_TRACE(daemon.logger) << "Received " << (isPrefetch?"prefetched ":"") << "work: " << w->print() << ende;
                 
                 ret = true;
 
@@ -131,6 +153,10 @@ bool Worker::fetchWork( void ) {
         }
         
     }
+    catch( const boost::thread_interrupted& ) {
+        if( conn ) daemon.unlockMaster();
+        throw;
+    }
     catch( const exception& e ) {
         msg = "fetchWork: Exception caught while fetching job: ";
         msg += e.what();
@@ -154,6 +180,42 @@ bool Worker::fetchWork( void ) {
 }
 
 
+void Worker::startPrefetch( void ) {
+
+    if( !prefetch || !wip->isRemote || prefetchResult.valid() ) return;
+    
+    // Only parts from the current job can be prefetched, so unpackWork will use the existing job instance.
+    prefetchWIP->reset();
+    prefetchWIP->job = wip->job;
+    prefetchWIP->jobID = wip->jobID;
+    prefetchResult = daemon.tasks.async( Executor::NET, [this](){
+        return fetchWork( prefetchWIP, true );
+    });
+
+}
+
+
+bool Worker::getPrefetched( void ) {
+
+    if( !prefetchResult.valid() ) return false;
+    
+    bool ret(false);
+    try {
+        ret = prefetchResult.get();         // waits for an ongoing request to finish
+    } catch( const boost::thread_interrupted& ) {
+        throw;
+    } catch( ... ) { }
+    
+    if( ret && prefetchWIP->parts.size() ) {
+        std::swap( wip, prefetchWIP );
+        prefetchWIP->reset();
+        return true;
+    }
+    return false;
+
+}
+
+
 
 bool Worker::getWork( void ) {
 
@@ -186,8 +248,9 @@ bool Worker::getWork( void ) {
     try {
         
         boost::this_thread::interruption_point();
-        if( running_ && !exitWhenDone_ && !resetWhenDone_ ) {
-            if( daemon.getWork( wip, false ) || fetchWork() ) {    // first check for local work, then remote
+        bool gotWork = getPrefetched();     // prefetched parts are already assigned to this host, so process them even when exiting.
+        if( gotWork || (running_ && !exitWhenDone_ && !resetWhenDone_) ) {
+            if( gotWork || daemon.getWork( wip, false ) || fetchWork( wip ) ) {    // first check for local work, then remote
                 myInfo.active();
                 myInfo.status.statusString = "...";
                 thisJob = wip->job.lock();
@@ -202,6 +265,9 @@ bool Worker::getWork( void ) {
                     wip->jobID = thisJob->info.id;
                     currentJob = thisJob;
                 }
+                if( thisJob && wip->isRemote ) {
+                    thisJob->setCheckpointCallback( std::bind( &Worker::sendCheckpoint, this, std::placeholders::_1, std::placeholders::_2 ) );
+                }
                 THREAD_MARK
                 if( !wip->isRemote ) {
                     for( auto& part: wip->parts ) {
@@ -209,6 +275,7 @@ bool Worker::getWork( void ) {
                     }
                 }
                 THREAD_UNMARK
+                startPrefetch();                        // request the next unit while this one is processed.
                 return true;
             }
         }
@@ -238,19 +305,28 @@ void Worker::returnWork( void ) {
 
                 LLOG_TRACE(daemon.logger) << "Returning result: " + wip->print() << ende;
 
-                uint64_t blockSize = wip->workSize();       // might be slightly bigger than needed due to compression.
+                BufferList payload;
+                uint64_t blockSize = wip->workSize( &payload );       // metadata only, might be slightly bigger than needed due to compression.
                 size_t totalSize = blockSize + sizeof( uint64_t ) + 1;        // + blocksize + cmd
                 
                 shared_ptr<char> data = rdx_get_shared<char>(totalSize);
                 char* ptr = data.get() + sizeof( uint64_t ) + 1;
                 uint64_t count(0);
                 if( blockSize ) {
-                    count = wip->packWork( ptr );
+                    count = wip->packWork( ptr, &payload );
+                }
+                bool hasBlock = (count > 0);
+                if( hasBlock && conn->getCodec() != codec::NONE ) {
+                    data = conn->encode( ptr, count, sizeof( uint64_t ) + 1 );
                 }
                 count += pack( data.get()+1, count );
                 count += pack( data.get(), CMD_PUT_PARTS );
 
-                conn->asyncWrite( data, count );
+                if( hasBlock ) {
+                    conn->writeGathered( data.get(), count, payload );
+                } else {
+                    conn->asyncWrite( data, count );
+                }
 
                 Command cmd = CMD_ERR;
                 *(conn) >> cmd;
@@ -262,6 +338,10 @@ void Worker::returnWork( void ) {
             }
             
         }
+        catch( const boost::thread_interrupted& ) {
+            if( conn ) daemon.unlockMaster();
+            throw;
+        }
         catch( const exception& e ) {
             LLOG_ERR(daemon.logger) << "getJob: Exception caught while returning work: " << e.what() << ende;
         }
@@ -276,11 +356,42 @@ void Worker::returnWork( void ) {
 }
 
 
+void Worker::sendCheckpoint( shared_ptr<char> data, uint64_t dataSize ) {
+
+    // N.B. called from the job (i.e. in the middle of run()), so the master connection is not in use by this worker.
+    if( !wip->isRemote || !dataSize ) return;
+    
+    network::TcpConnection::Ptr conn = daemon.getMaster();
+    try {
+        if( conn && conn->socket().is_open() ) {
+            size_t totalSize = dataSize + sizeof( uint64_t ) + 1;        // + blocksize + cmd
+            shared_ptr<char> buf = rdx_get_shared<char>(totalSize);
+            char* ptr = buf.get();
+            uint64_t count = pack( ptr, CMD_PUT_CHECKPOINT );
+            count += pack( ptr+count, dataSize );
+            memcpy( ptr+count, data.get(), dataSize );
+            conn->asyncWrite( buf, totalSize );
+            Command cmd = CMD_ERR;
+            *(conn) >> cmd;
+            if( cmd != CMD_OK ) {
+                LLOG_DETAIL(daemon.logger) << "sendCheckpoint: the checkpoint was not accepted by the master." << ende;
+            }
+        }
+    }
+    catch( const exception& e ) {
+        LLOG_ERR(daemon.logger) << "sendCheckpoint: Exception caught while sending checkpoint: " << e.what() << ende;
+    }
+    
+    if( conn ) daemon.unlockMaster();
+
+}
+
+
 void Worker::run( void ) {
 
     running_ = true;
 
-    if( wip ) {
+    if( wip ) try {
         // LOG_TRACE << "run:   nWipParts = " << wip->parts.size() << "  conn = " << hexString(wip->connection.get()) << "  job = " << hexString(wip->job.get());
         while( getWork() ) {
             try {
@@ -299,6 +410,9 @@ void Worker::run( void ) {
                 LLOG_ERR(daemon.logger) << "Worker: Unrecognized exception caught while processing job." << ende;
             }
         }
+    } catch( const boost::thread_interrupted& ) {     // stopped: clean up, and let the interruption reach the thread.
+        done();
+        throw;
     }
 
     done();
@@ -6,7 +6,13 @@
 
 #include "testsuite.hpp"
 
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
 #include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
 #include <boost/test/unit_test.hpp>
 
 using namespace redux::file;
@@ -198,9 +204,78 @@ namespace testsuite {
         }
 
 
+        template <typename T>
+        void anaCompressionSpeed( size_t sy, size_t sx, int sliceSize ) {
+            
+            typedef std::chrono::steady_clock clock;
+            Image<T> image( sy, sx );
+            T* ptr = image.get();
+            srand( 1 );
+            for( size_t y = 0; y < sy; ++y ) {
+                for( size_t x = 0; x < sx; ++x ) {      // smooth gradient + some noise, and a few large jumps to get long codes.
+                    *ptr++ = static_cast<T>( (y + x) / 16 + rand() % 32 + ((rand() % 1000) ? 0 : 100) );
+                }
+            }
+            auto hdr = make_shared<Ana>();
+            hdr->m_Header.datyp = (sizeof(T) == 1) ? Ana::ANA_BYTE : ((sizeof(T) == 2) ? Ana::ANA_WORD : Ana::ANA_LONG);
+            hdr->m_Header.ndim = 2;
+            hdr->m_Header.dim[0] = sx;
+            hdr->m_Header.dim[1] = sy;
+            image.meta = hdr;
+            
+            const double MB = sy * sx * sizeof(T) / 1048576.0;
+            const int nLoops = 5;
+            const unsigned int savedThreads = Ana::maxThreads;
+            const unsigned int nThreads = std::max( std::thread::hardware_concurrency(), 4U );     // also test the block-splitting on small machines.
+            shared_ptr<uint8_t> cData[2];
+            int cSize[2];
+            Image<T> data[2];
+            double compressSpeed[2], decompressSpeed[2];
+            for( int i = 0; i < 2; ++i ) {
+                Ana::maxThreads = i ? nThreads : 1;
+                auto start = clock::now();
+                for( int n = 0; n < nLoops; ++n ) {
+                    cSize[i] = Ana::compressData( cData[i], reinterpret_cast<const char*>( image.get() ), sy*sx, hdr, sliceSize );
+                }
+                compressSpeed[i] = nLoops * MB / std::chrono::duration<double>( clock::now() - start ).count();
+                redux::file::Ana::write( testFileAna, image, sliceSize );
+                start = clock::now();
+                for( int n = 0; n < nLoops; ++n ) {
+                    redux::file::Ana::read( testFileAna, data[i] );
+                }
+                decompressSpeed[i] = nLoops * MB / std::chrono::duration<double>( clock::now() - start ).count();
+            }
+            Ana::maxThreads = savedThreads;
+            
+            // the block-parallel stream should be identical to the serial one.
+            BOOST_REQUIRE( cSize[0] > 0 );
+            BOOST_TEST( cSize[0] == cSize[1] );
+            BOOST_TEST( memcmp( cData[0].get(), cData[1].get(), cSize[0] ) == 0 );
+            auto rhdr = static_pointer_cast<redux::file::Ana>( data[1].meta );
+            BOOST_TEST( (rhdr->m_Header.subf & 1) );
+            BOOST_CHECK( data[0] == image );
+            BOOST_CHECK( data[1] == image );
+            
+            cout << boost::format( "ANA %dx%d %d-bit: compress %.1f -> %.1f MB/s, decompress %.1f -> %.1f MB/s (serial -> %d threads)" )
+                    % sy % sx % (8*sizeof(T)) % compressSpeed[0] % compressSpeed[1] % decompressSpeed[0] % decompressSpeed[1]
+                    % nThreads << endl;
+            
+        }
+
+
+        void ana_compression_speed( void ) {
+
+            anaCompressionSpeed<uint8_t>( 2048, 2048, 3 );
+            anaCompressionSpeed<int16_t>( 2048, 2048, 5 );
+            anaCompressionSpeed<int32_t>( 2048, 2048, 5 );
+
+        }
+
+
         void add_ana_tests( test_suite* ts ) {
 
             ts->add( BOOST_TEST_CASE_NAME( &ana_test, "File ANA" ) );
+            ts->add( BOOST_TEST_CASE_NAME( &ana_compression_speed, "File ANA (de)compression speed" ) );
 
         }
 
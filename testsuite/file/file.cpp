@@ -51,6 +51,7 @@ namespace testsuite {
         
         void add_ana_tests( test_suite* ts );       // defined in ana.cpp
         void add_fits_tests( test_suite* ts );      // defined in fits.cpp
+        void add_momfbd_tests( test_suite* ts );    // defined in momfbd.cpp
 
         void add_tests( test_suite* ts ) {
             
@@ -58,6 +59,7 @@ namespace testsuite {
 
             add_ana_tests( ts );
             add_fits_tests( ts );
+            add_momfbd_tests( ts );
 
         }
 
@@ -4,6 +4,8 @@
 
 #include "testsuite.hpp"
 
+#include <functional>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/test/unit_test.hpp>
 
@@ -303,6 +305,114 @@ namespace testsuite {
 
 
 
+        template <typename T>
+        void writeCompressed( const string& filename, const Array<T>& data, int compType, long tileRows, long tileCols=0,
+                              std::function<void(fitsfile*,int&)> setKeys=nullptr ) {
+
+            fitsfile* fptr;
+            int status(0);
+            long naxes[2] = { long(data.dimSize(1)), long(data.dimSize(0)) };
+            long tile[2] = { tileCols ? tileCols : naxes[0], tileRows };
+            int bitpix = sizeof(T)*8;
+            int dataType = (sizeof(T) == 1) ? TBYTE : ((sizeof(T) == 2) ? TSHORT : TINT);
+            if( std::is_same<T,uint16_t>::value ) {
+                bitpix = USHORT_IMG;                // stored as int16 with BZERO=32768
+                dataType = TUSHORT;
+            }
+            fits_create_file( &fptr, ("!"+filename).c_str(), &status );
+            fits_set_compression_type( fptr, compType, &status );
+            fits_set_tile_dim( fptr, 2, tile, &status );
+            fits_create_img( fptr, bitpix, 2, naxes, &status );
+            if( setKeys ) setKeys( fptr, status );
+            fits_write_img( fptr, dataType, 1, data.nElements(), const_cast<T*>(data.ptr()), &status );
+            fits_close_file( fptr, &status );
+            BOOST_REQUIRE( status == 0 );
+
+        }
+        
+        
+        template <typename T>
+        void readCompressedAndVerify( const string& filename, const Array<T>& expected, size_t nTiles ) {
+            
+            for( unsigned int nThreads: { 1, 4 } ) {
+                Fits::maxThreads = nThreads;
+                uint64_t tilesBefore = Fits::nativeTiles;
+                Array<T> data;
+                readFile( filename, data );
+                BOOST_TEST( Fits::nativeTiles-tilesBefore == nTiles );       // i.e. the native reader was used, not cfitsio
+                BOOST_TEST( data.nDimensions() == 2 );
+                BOOST_TEST( data.dimSize( 0 ) == expected.dimSize( 0 ) );
+                BOOST_TEST( data.dimSize( 1 ) == expected.dimSize( 1 ) );
+                BOOST_CHECK( data == expected );
+            }
+            Fits::maxThreads = 0;
+            
+        }
+
+
+        template <typename T>
+        void readCompressed( void ) {
+
+            Array<T> indata( 97, 131 );     // odd sizes to get a partial last tile.
+            for( size_t j = 0; j < indata.dimSize( 0 ); ++j ) {
+                for( size_t k = 0; k < indata.dimSize( 1 ); ++k ) {
+                    indata( j, k ) = static_cast<T>( ((j*31+k*17)%101) + 3*j - k );        // a gradient with some noise
+                }
+            }
+            const int compTypes[] = { RICE_1, GZIP_1, GZIP_2 };
+            const long tileRows[] = { 1, 16, 97 };
+            const long tileCols[] = { 0, 32 };         // full rows, and partial rows (i.e. tiles that are not contiguous in the image)
+            for( int ct: compTypes ) {
+                for( long tr: tileRows ) {
+                    for( long tc: tileCols ) {
+                        writeCompressed( testFileFits, indata, ct, tr, tc );
+                        size_t nTiles = ((97+tr-1)/tr) * (tc ? (131+tc-1)/tc : 1);
+                        readCompressedAndVerify( testFileFits, indata, nTiles );
+                    }
+                }
+            }
+
+        }
+        
+        
+        void readCompressedScaled( void ) {
+            
+            // uint16 data, stored as int16 with BZERO=32768
+            Array<uint16_t> udata( 97, 131 );
+            for( size_t j = 0; j < udata.dimSize( 0 ); ++j ) {
+                for( size_t k = 0; k < udata.dimSize( 1 ); ++k ) {
+                    udata( j, k ) = static_cast<uint16_t>( (j*677+k*131) % 65536 );      // covers the full range
+                }
+            }
+            for( int ct: { RICE_1, GZIP_2 } ) {
+                writeCompressed( testFileFits, udata, ct, 16, 32 );
+                readCompressedAndVerify( testFileFits, udata, 7*5 );
+            }
+            
+            // int16 data with BSCALE=2, BZERO=10 and BLANK=-5, blank pixels should be read as 0
+            Array<int16_t> raw( 97, 131 ), expected( 97, 131 );
+            for( size_t j = 0; j < raw.dimSize( 0 ); ++j ) {
+                for( size_t k = 0; k < raw.dimSize( 1 ); ++k ) {
+                    raw( j, k ) = static_cast<int16_t>( ((j*31+k*17)%101) - 50 );
+                    expected( j, k ) = (raw( j, k ) == -5) ? 0 : 2*raw( j, k ) + 10;
+                }
+            }
+            auto setKeys = []( fitsfile* fptr, int& status ) {
+                double bscale(2), bzero(10);
+                int blank(-5);
+                fits_write_key( fptr, TDOUBLE, "BSCALE", &bscale, nullptr, &status );
+                fits_write_key( fptr, TDOUBLE, "BZERO", &bzero, nullptr, &status );
+                fits_write_key( fptr, TINT, "BLANK", &blank, nullptr, &status );
+                fits_set_bscale( fptr, 1.0, 0.0, &status );     // write the raw values
+            };
+            for( int ct: { RICE_1, GZIP_1 } ) {
+                writeCompressed( testFileFits, raw, ct, 16, 0, setKeys );
+                readCompressedAndVerify( testFileFits, expected, 7 );
+            }
+            
+        }
+
+
         void fits_test( void ) {
 
             // test reading/casting to various types.
@@ -350,6 +460,12 @@ namespace testsuite {
             for( size_t i(0); i<1; ++i ) {
                 writeAndVerifyFitsHdr( testFileFits, array, cards );
             }
+
+            // tile-compressed images
+            readCompressed<uint8_t>();
+            readCompressed<int16_t>();
+            readCompressed<int32_t>();
+            readCompressedScaled();
         }
 
 
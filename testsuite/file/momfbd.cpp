@@ -0,0 +1,161 @@
+#include "redux/file/filemomfbd.hpp"
+#include "redux/util/array.hpp"
+
+#include "testsuite.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace redux::file;
+using namespace redux::util;
+
+using namespace std;
+using namespace boost::unit_test;
+
+
+namespace testsuite {
+
+    namespace file {
+
+        const char testFileMomfbd[]  = "testsuite.momfbd";
+
+        template <typename T>
+        void setShared( std::shared_ptr<T>& p, T value ) {
+            p.reset( new T[1], [] ( T* ptr ) { delete[] ptr; } );
+            *p = value;
+        }
+
+
+        void momfbd_test( void ) {
+
+            const int nPH(8), nModes(3), nPatchesY(2), nPatchesX(3);
+            const int patchSize(16), npsf(2), nalpha(2), nm(nModes), ndiv(2), nph(8);
+
+            FileMomfbd info;
+            info.versionString = "20201022.0";
+            info.version = atof( info.versionString.c_str() );
+            info.dateString = "2020-10-22";
+            info.timeString = "12:00:00";
+            info.nChannels = 1;
+            setShared<int16_t>( info.clipStartX, 1 );
+            setShared<int16_t>( info.clipEndX, patchSize*nPatchesX );
+            setShared<int16_t>( info.clipStartY, 1 );
+            setShared<int16_t>( info.clipEndY, patchSize*nPatchesY );
+            info.nPH = nPH;
+            info.nModes = nModes;
+            info.nPatchesY = nPatchesY;
+            info.nPatchesX = nPatchesX;
+            info.nPoints = patchSize;
+
+            // the data to write: pupil, modes, and then img/psf/alpha/diversity for each patch. All values are unique.
+            size_t nFloats = nPH*nPH*(nModes+1);
+            info.phOffset = 0;
+            info.modesOffset = nPH*nPH*sizeof(float);
+            info.patches.resize( nPatchesY, nPatchesX );
+            for( int y=0; y<nPatchesY; ++y ) {
+                for( int x=0; x<nPatchesX; ++x ) {
+                    FileMomfbd::PatchInfo& p = *info.patches.ptr( y, x );
+                    p.region[0] = x*patchSize + 1;
+                    p.region[1] = (x+1)*patchSize;
+                    p.region[2] = y*patchSize + 1;
+                    p.region[3] = (y+1)*patchSize;
+                    p.nChannels = 1;
+                    setShared<int32_t>( p.nim, 10 );
+                    setShared<int32_t>( p.dx, 0 );
+                    setShared<int32_t>( p.dy, 0 );
+                    p.npsf = npsf;
+                    p.nalpha = nalpha;
+                    p.nm = nm;
+                    p.ndiv = ndiv;
+                    p.nphx = p.nphy = nph;
+                    p.imgPos = nFloats*sizeof(float);
+                    nFloats += patchSize*patchSize;
+                    p.psfPos = nFloats*sizeof(float);
+                    nFloats += npsf*patchSize*patchSize;
+                    p.alphaPos = nFloats*sizeof(float);
+                    nFloats += nalpha*nm;
+                    p.diversityPos = nFloats*sizeof(float);
+                    nFloats += ndiv*nph*nph;
+                }
+            }
+            vector<float> data( nFloats );
+            for( size_t i=0; i<nFloats; ++i ) data[i] = i;
+            const char* dataPtr = reinterpret_cast<const char*>( data.data() );
+            info.write( testFileMomfbd, dataPtr, MOMFBD_ALL );
+
+            auto checkField = [&]( const Array<float>& arr, int64_t offset, size_t n ) {
+                BOOST_TEST( arr.nElements() == n );
+                const float* expected = reinterpret_cast<const float*>( dataPtr + offset );
+                size_t nMismatch(0);
+                for( size_t i=0; i<std::min( n, arr.nElements() ); ++i ) {
+                    if( arr.get()[i] != expected[i] ) nMismatch++;
+                }
+                BOOST_TEST( nMismatch == 0 );
+            };
+
+            Array<float> img;
+            {
+                FileMomfbd mapped;
+                BOOST_CHECK( !mapped.isMapped() );
+                BOOST_CHECK_THROW( mapped.getPupil(), std::logic_error );
+                mapped.map( testFileMomfbd );
+                BOOST_CHECK( mapped.isMapped() );
+                BOOST_TEST( mapped.nPatchesY == nPatchesY );
+                BOOST_TEST( mapped.nPatchesX == nPatchesX );
+
+                Array<float> pupil = mapped.getPupil();
+                BOOST_TEST( pupil.dimSize(0) == nPH );
+                checkField( pupil, info.phOffset, nPH*nPH );
+                Array<float> modes = mapped.getModes();         // modes are interleaved with type-bytes, i.e. copied.
+                BOOST_TEST( modes.nDimensions() == 3 );
+                BOOST_TEST( modes.dimSize(0) == nModes );
+                checkField( modes, info.modesOffset, nModes*nPH*nPH );
+
+                // visit the patches in reverse order, to make sure nothing depends on the order of access.
+                for( int y=nPatchesY-1; y>=0; --y ) {
+                    for( int x=nPatchesX-1; x>=0; --x ) {
+                        const FileMomfbd::PatchInfo& p = *info.patches.ptr( y, x );
+                        Array<float> tmp = mapped.getPatchData( y, x, MOMFBD_IMG );
+                        BOOST_TEST( tmp.dimSize(0) == patchSize );
+                        BOOST_TEST( tmp.dimSize(1) == patchSize );
+                        checkField( tmp, p.imgPos, patchSize*patchSize );
+                        checkField( mapped.getPatchData( y, x, MOMFBD_PSF ), p.psfPos, npsf*patchSize*patchSize );
+                        checkField( mapped.getPatchData( y, x, MOMFBD_ALPHA ), p.alphaPos, nalpha*nm );
+                        checkField( mapped.getPatchData( y, x, MOMFBD_DIV ), p.diversityPos, ndiv*nph*nph );
+                        BOOST_TEST( mapped.getPatchData( y, x, MOMFBD_OBJ ).nElements() == 0 );
+                        BOOST_TEST( mapped.getPatchData( y, x, MOMFBD_RES ).nElements() == 0 );
+                    }
+                }
+                BOOST_CHECK_THROW( mapped.getPatchData( nPatchesY, 0, MOMFBD_IMG ), std::out_of_range );
+                BOOST_CHECK_THROW( mapped.getPatchData( 0, 0, MOMFBD_MODES ), std::invalid_argument );
+
+                img = mapped.getPatchData( 1, 2, MOMFBD_IMG );
+
+                // pupil & modes should be the same when loaded the old way.
+                vector<float> loaded( nPH*nPH*(nModes+1) );
+                ifstream file( testFileMomfbd );
+                mapped.load( file, reinterpret_cast<char*>( loaded.data() ), MOMFBD_MODES );
+                BOOST_TEST( vector<float>( pupil.get(), pupil.get()+nPH*nPH ) == vector<float>( loaded.begin(), loaded.begin()+nPH*nPH ),
+                            btt::per_element() );
+                BOOST_TEST( vector<float>( modes.get(), modes.get()+nModes*nPH*nPH ) == vector<float>( loaded.begin()+nPH*nPH, loaded.end() ),
+                            btt::per_element() );
+            }
+
+            // the returned arrays keep the mapping alive
+            checkField( img, info.patches.ptr( 1, 2 )->imgPos, patchSize*patchSize );
+
+        }
+
+
+        void add_momfbd_tests( test_suite* ts ) {
+
+            ts->add( BOOST_TEST_CASE_NAME( &momfbd_test, "File MOMFBD" ) );
+
+        }
+
+    }
+
+}
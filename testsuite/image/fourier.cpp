@@ -908,6 +908,61 @@ namespace testsuite {
                 
                 
                 
+            }
+
+            {   // test batched auto-correlation (many-plan) against the single version
+
+                size_t nX = 32;
+                size_t nY = 32;
+                size_t nBlocks = 5;
+                size_t nPix = nY*nX;
+
+                FourierTransform fullFT( nY, nX, FULLCOMPLEX );
+                Array<complex_t> input( nBlocks, nY, nX );
+                for( auto& c: input ) c = complex_t( rand()%100, rand()%100 ) * 0.01;
+                Array<complex_t> batch = input.copy<complex_t>();
+                Array<complex_t> work( nBlocks, nY, nX );
+                FourierTransform::autocorrelate( batch.get(), work.get(), nY, nX, nBlocks );
+
+                Array<complex_t> single( nY, nX );
+                for( size_t b(0); b<nBlocks; ++b ) {
+                    std::copy_n( input.get()+b*nPix, nPix, single.get() );
+                    fullFT.autocorrelate( single.get() );
+                    const complex_t* bPtr = batch.get()+b*nPix;
+                    for( size_t i(0); i<nPix; ++i ) {
+                        BOOST_TEST( abs(bPtr[i]-single.get()[i]) < tol );
+                    }
+                }
+
+#ifdef HAVE_FFTW3F
+                // single precision version, compare against the double result with a relative tolerance
+                Array<complexf_t> batchf( nBlocks, nY, nX );
+                Array<complexf_t> workf( nBlocks, nY, nX );
+                std::copy_n( input.get(), nBlocks*nPix, batchf.get() );
+                FourierTransform::autocorrelate( batchf.get(), workf.get(), nY, nX, nBlocks );
+                double maxVal(0), maxDiff(0);
+                for( size_t i(0); i<nBlocks*nPix; ++i ) {
+                    maxVal = std::max( maxVal, abs(batch.get()[i]) );
+                    maxDiff = std::max( maxDiff, abs(batch.get()[i]-complex_t(batchf.get()[i])) );
+                }
+                BOOST_TEST( maxDiff < 1E-5*maxVal );
+#endif
+
+
+                // half-plane (r2c) version, expanded and centered, compare against the centered single version
+                Array<complex_t> half( nBlocks, nY, nX );
+                batch = input.copy<complex_t>();
+                FourierTransform::autocorrelateHalf( batch.get(), half.get(), nY, nX, nBlocks );
+                Array<complex_t> expanded( nY, nX );
+                for( size_t b(0); b<nBlocks; ++b ) {
+                    std::copy_n( input.get()+b*nPix, nPix, single.get() );
+                    fullFT.autocorrelate( single.get(), true );
+                    FourierTransform::reorderHalfInto( half.get()+b*nY*(nX/2+1), nY, nX, expanded.get() );
+                    for( size_t i(0); i<nPix; ++i ) {
+                        BOOST_TEST( abs(expanded.get()[i]-single.get()[i]) < tol );
+                    }
+                }
+
             }
                 
         }
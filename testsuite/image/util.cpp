@@ -1,5 +1,8 @@
 
 #include "redux/image/utils.hpp"
+#include "redux/image/pixelfiller.hpp"
+#include "redux/image/pupil.hpp"
+#include "redux/image/pupilkernels.hpp"
 #include "redux/util/array.hpp"
 
 
@@ -7,6 +10,7 @@
 
 using namespace redux::image;
 using namespace redux::util;
+using namespace redux;
 
 using namespace std;
 
@@ -124,9 +128,144 @@ namespace testsuite {
 
         }
 
+        void test_pupil_kernels( void ) {
+            
+            const double EPS = 1E-12;
+            const uint16_t nPixels = 64;
+            Pupil pupil( nPixels, 27.3 );
+            
+            size_t n = pupil.pupilInOTF.size();
+            BOOST_REQUIRE( n > 0 );
+            BOOST_TEST( pupil.pupilIndex.size() % kernels::simdWidth == 0 );
+            BOOST_TEST( pupil.pupilIndex.size() >= n );
+            for( size_t i(0); i<n; ++i ) {
+                BOOST_TEST( pupil.pupilIndex[i] == pupil.pupilInOTF[i].first );
+                BOOST_TEST( pupil.otfIndex[i] == pupil.pupilInOTF[i].second );
+            }
+            
+            size_t nPix = nPixels*nPixels;
+            size_t nOtf = 4*nPix;
+            size_t np = pupil.pupilIndex.size();
+            Array<double> phi( nPixels, nPixels ), vog( nPixels, nPixels );
+            for( auto& p: phi ) p = (rand()%20000-10000)*1E-3;          // phases in [-10,10)
+            
+            kernels::KERNEL_LEVEL maxLevel = kernels::maxLevel();
+            vector<complex_t> pf[2], otf[2];
+            vector<double> vogel[2];
+            double dot[2];
+            for( int l(0); l<2; ++l ) {
+                kernels::setLevel( l ? maxLevel : kernels::KL_SCALAR );
+                pf[l].assign( nPix, 0 );
+                otf[l].assign( nOtf, 0 );
+                vogel[l].assign( nPix, 0 );
+                kernels::polar( pupil.pupilIndex.data(), pupil.otfIndex.data(), pupil.pupilWeight.data(), np,
+                                phi.get(), pf[l].data(), otf[l].data(), 0.5 );
+                kernels::vogel( pupil.pupilIndex.data(), pupil.otfIndex.data(), pupil.pupilWeight.data(), np,
+                                pf[l].data(), otf[l].data(), vogel[l].data() );
+                dot[l] = kernels::gatherDot( pupil.pupilIndex.data(), n, phi.get(), pupil.get() );
+            }
+            kernels::setLevel( maxLevel );
+            
+            for( size_t i(0); i<n; ++i ) {      // compare with the definition, and the scalar kernels with the dispatched ones.
+                const size_t pi = pupil.pupilInOTF[i].first;
+                const size_t oi = pupil.pupilInOTF[i].second;
+                BOOST_TEST( abs( pf[0][pi] - polar( pupil.get()[pi], phi.get()[pi] ) ) < EPS );
+                BOOST_TEST( abs( pf[1][pi] - pf[0][pi] ) < EPS );
+                BOOST_TEST( abs( otf[1][oi] - otf[0][oi] ) < EPS );
+                BOOST_TEST( abs( vogel[1][pi] - vogel[0][pi] ) < EPS );
+            }
+            BOOST_CHECK_CLOSE( dot[0], dot[1], 1E-9 );
+
+            // single precision OTF output (SINGLE_PRECISION), should be the double result rounded to float
+            vector<double> phiOffset( nPix, 0.25 );
+            for( int l(0); l<2; ++l ) {
+                kernels::setLevel( l ? maxLevel : kernels::KL_SCALAR );
+                vector<complexf_t> otff( nOtf, 0 ), stepf( nOtf, 0 );
+                vector<complex_t> stepd( nOtf, 0 );
+                kernels::polar( pupil.pupilIndex.data(), pupil.otfIndex.data(), pupil.pupilWeight.data(), np,
+                                phi.get(), pf[l].data(), otff.data(), 0.5 );
+                kernels::polarOffset( pupil.pupilIndex.data(), pupil.otfIndex.data(), pupil.pupilWeight.data(), np,
+                                      phi.get(), phiOffset.data(), 0.3, stepf.data(), 0.5 );
+                kernels::polarOffset( pupil.pupilIndex.data(), pupil.otfIndex.data(), pupil.pupilWeight.data(), np,
+                                      phi.get(), phiOffset.data(), 0.3, stepd.data(), 0.5 );
+                for( size_t i(0); i<n; ++i ) {
+                    const size_t oi = pupil.pupilInOTF[i].second;
+                    BOOST_TEST( abs( complex_t(otff[oi]) - otf[0][oi] ) < 1E-6 );
+                    BOOST_TEST( abs( complex_t(stepf[oi]) - stepd[oi] ) < 1E-6 );
+                }
+            }
+            kernels::setLevel( maxLevel );
+
+            // the half-support together with its mirror should cover the otf-support exactly once
+            size_t nHalf = pupil.otfHalfSupport.size();
+            BOOST_REQUIRE( nHalf > 0 );
+            BOOST_TEST( pupil.otfHalfMirror.size() == nHalf );
+            BOOST_TEST( pupil.otfHalfWeight.size() == nHalf );
+            vector<int> cover( nOtf, 0 );
+            double wSum(0);
+            for( size_t i(0); i<nHalf; ++i ) {
+                BOOST_TEST( pupil.otfMirror( pupil.otfHalfMirror[i] ) == pupil.otfHalfSupport[i] );
+                cover[pupil.otfHalfSupport[i]]++;
+                if( pupil.otfHalfMirror[i] != pupil.otfHalfSupport[i] ) cover[pupil.otfHalfMirror[i]]++;
+                wSum += pupil.otfHalfWeight[i];
+            }
+            BOOST_TEST( wSum == pupil.otfSupport.size() );
+            for( const size_t& ind: pupil.otfSupport ) {
+                BOOST_TEST( cover[ind] == 1 );
+            }
+            
+        }
+
+        void test_pixelfiller( void ) {
+            
+            const size_t sy(97), sx(131);
+            Array<float> img( sy, sx );
+            Array<uint8_t> mask( sy, sx );
+            mask.zero();
+            float* iPtr = img.ptr();
+            uint8_t* mPtr = mask.ptr();
+            srand( 1 );
+            for( size_t i(0); i<sy*sx; ++i ) {
+                iPtr[i] = 100 + (rand() % 1000);
+                if( (rand() % 20) == 0 ) iPtr[i] = 0;           // bad pixels
+                if( (rand() % 3) == 0 ) mPtr[i] = 1;
+            }
+            for( size_t x(20); x<40; ++x ) iPtr[50*sx+x] = 0;   // a line, to have some pixels without close neighbours.
+            
+            namespace sp = std::placeholders;
+            for( int horint(0); horint<2; ++horint ) {
+                for( int useMask(0); useMask<2; ++useMask ) {
+                    Array<float> ref = img.copy();
+                    shared_ptr<float*> ref2D = reshapeArray( ref.ptr(), sy, sx );
+                    shared_ptr<uint8_t*> mask2D = reshapeArray( mPtr, sy, sx );
+                    function<double(size_t,size_t)> func = bind( inverseDistanceWeight<float>, ref2D.get(), sy, sx, sp::_1, sp::_2 );
+                    if( horint ) func = bind( horizontalInterpolation<float>, ref2D.get(), sy, sx, sp::_1, sp::_2 );
+                    fillPixels( ref2D.get(), sy, sx, func, std::bind( std::less_equal<double>(), sp::_1, 0 ),
+                                useMask ? mask2D.get() : nullptr );
+                    PixelFiller filler( sy, sx, useMask ? mPtr : nullptr );
+                    for( unsigned int nThreads: { 1, 4 } ) {
+                        Array<float> tmp = img.copy();
+                        size_t n = filler.fill( tmp.ptr(), 0, horint ? PixelFiller::HORINT : PixelFiller::IDW, true, nThreads );
+                        BOOST_TEST( n > 0 );
+                        BOOST_TEST( std::equal( tmp.ptr(), tmp.ptr()+sy*sx, ref.ptr() ) );
+                    }
+                }
+            }
+            
+            // ignoring the mask should fill all bad pixels.
+            PixelFiller filler( sy, sx, mPtr );
+            Array<float> tmp = img.copy();
+            filler.fill( tmp.ptr(), 0, PixelFiller::IDW, false );
+            BOOST_TEST( std::count( tmp.ptr(), tmp.ptr()+sy*sx, 0.0f ) == 0 );
+            BOOST_TEST( !filler.valid( sx, sy ) );
+            
+        }
+
         void util_tests( void ) {
             
             test_plane();
+            test_pupil_kernels();
+            test_pixelfiller();
 
         }
 
@@ -153,6 +153,7 @@ return;
                 gcfg.modeBasis = KARHUNEN_LOEVE;
                 gcfg.klMinMode = gcfg.klMaxMode = gcfg.klCutoff = gcfg.nInitialModes = gcfg.nModeIncrement = 118;
                 gcfg.telescopeD = gcfg.minIterations = gcfg.maxIterations = gcfg.targetIterations = 119;
+                gcfg.checkpointInterval = 120;
                 gcfg.fillpixMethod = gcfg.getstepMethod = 3;
                 gcfg.gradientMethod = 2;
                 gcfg.badPixelThreshold = gcfg.FTOL = gcfg.EPS = gcfg.reg_alpha = gcfg.sequenceNumber = 117;
@@ -1,5 +1,6 @@
 
 #include "redux/momfbd/momfbdjob.hpp"
+#include "redux/work.hpp"
 #include "redux/logging/logger.hpp"
 #include "redux/util/arrayutil.hpp"
 
@@ -75,6 +76,36 @@ namespace testsuite {
                 BOOST_CHECK_EQUAL( count, pd2.size() );
                 BOOST_CHECK( pd == pd2 );
 
+                // with a solver checkpoint
+                pd.checkpoint.modeCount = 15;
+                pd.checkpoint.iteration = 3;
+                pd.checkpoint.totalIterations = 42;
+                pd.checkpoint.failCount = 1;
+                pd.checkpoint.alpha.assign( 20, 0.5 );
+                pd.checkpoint.metrics = { 1.0, 0.9, 0.8 };
+                BOOST_CHECK( pd.checkpoint.valid() );
+                buf = sharedArray<char>( pd.size() );
+                ptr = buf.get();
+                count = pd.pack( ptr );
+                BOOST_CHECK_EQUAL( count, pd.size() );
+                count = pd2.unpack( ptr, false );
+                BOOST_CHECK_EQUAL( count, pd.size() );
+                BOOST_CHECK( pd2.checkpoint.valid() );
+                BOOST_CHECK_EQUAL( pd2.checkpoint.modeCount, 15 );
+                BOOST_CHECK_EQUAL( pd2.checkpoint.iteration, 3 );
+                BOOST_CHECK_EQUAL( pd2.checkpoint.totalIterations, 42 );
+                BOOST_CHECK_EQUAL( pd2.checkpoint.failCount, 1 );
+                BOOST_CHECK( pd2.checkpoint.alpha == pd.checkpoint.alpha );
+                BOOST_CHECK( pd2.checkpoint.metrics == pd.checkpoint.metrics );
+                pd.checkpoint.clear();
+                BOOST_CHECK( !pd.checkpoint.valid() );
+
+                // scheduling helpers
+                pd2.index = Point16(4,7);
+                BOOST_CHECK_EQUAL( pd.distance( pd ), 0 );
+                BOOST_CHECK_EQUAL( pd.distance( pd2 ), 5 );
+                BOOST_CHECK_EQUAL( pd.cost(), 0 );       // no objects in a default-constructed job
+
                 // with images
                 /*pd.images.resize(10,100,120);
                 float cnt(0.3);
@@ -103,10 +134,280 @@ namespace testsuite {
         }
 
 
+        void workTest( void ) {
+
+            auto mjob = make_shared<MomfbdJob>();
+            mjob->info.id = 17;
+            auto sjob = make_shared<MomfbdJob>();       // the receiving side, already knows this job
+            sjob->info.id = 17;
+
+            redux::WorkInProgress::Ptr wip( new redux::WorkInProgress() );
+            wip->job = mjob;
+            wip->jobID = mjob->info.id;                 // same job as last time -> no job-info/globalData in the block
+            for( uint16_t i=0; i<3; ++i ) {
+                PatchData::Ptr pd( new PatchData( *mjob, i, 2*i+1 ) );
+                pd->id = 100+i;
+                pd->position = Point16( 10*i, 20*i );
+                wip->parts.push_back( pd );
+            }
+            wip->parts.push_back( nullptr );            // null parts are skipped
+
+            uint64_t blockSize = wip->workSize();
+            BOOST_CHECK_EQUAL( wip->nParts, 3 );
+            auto buf = sharedArray<char>( blockSize );
+            uint64_t count = wip->packWork( buf.get() );
+            BOOST_CHECK_EQUAL( count, blockSize );
+            BOOST_CHECK_EQUAL( wip->nParts, 3 );
+            BOOST_CHECK_EQUAL( wip->parts.size(), 3 );
+
+            redux::WorkInProgress::Ptr wip2( new redux::WorkInProgress() );
+            wip2->job = sjob;
+            shared_ptr<redux::Job> tmpJob;
+            count = wip2->unpackWork( buf.get(), tmpJob, false );
+            BOOST_CHECK_EQUAL( count, blockSize );
+            BOOST_CHECK( tmpJob == sjob );
+            BOOST_CHECK_EQUAL( wip2->jobID, 17 );
+            BOOST_CHECK_EQUAL( wip2->nParts, 3 );
+            BOOST_REQUIRE_EQUAL( wip2->parts.size(), 3 );
+            for( uint16_t i=0; i<3; ++i ) {
+                PatchData::Ptr pd = static_pointer_cast<PatchData>( wip->parts[i] );
+                PatchData::Ptr pd2 = static_pointer_cast<PatchData>( wip2->parts[i] );
+                BOOST_REQUIRE( pd2 );
+                BOOST_CHECK( *pd2 == *pd );
+                BOOST_CHECK_EQUAL( pd2->id, 100+i );
+                BOOST_CHECK( pd2->position == pd->position );
+            }
+
+            // first work-unit for this slave -> the globalData has to be sent along, and there is none yet.
+            wip->jobID = 0;
+            buf = sharedArray<char>( wip->workSize() );
+            BOOST_CHECK_THROW( wip->packWork( buf.get() ), redux::job_error );
+
+        }
+
+
+        struct JobTest {
+            
+            // The master receives checkpoints from the network (Daemon::putCheckpoint -> MomfbdJob::putCheckpoint),
+            // truncated or corrupt blocks must be rejected without reading past the end of the block.
+            static void checkpoint( void ) {
+                
+                MomfbdJob job;
+                job.patches.resize( 2, 3 );
+                for( uint16_t y=0; y<2; ++y ) {
+                    for( uint16_t x=0; x<3; ++x ) {
+                        job.patches(y,x).reset( new PatchData( job, y, x ) );
+                        job.patches(y,x)->id = 100+3*y+x;
+                        job.patches(y,x)->step = MomfbdJob::JSTEP_RUNNING;
+                    }
+                }
+                PatchData::Ptr pd = job.patches(1,2);
+                redux::WorkInProgress::Ptr wip( new redux::WorkInProgress() );
+                wip->parts.push_back( pd );
+                
+                pd->checkpoint.modeCount = 15;
+                pd->checkpoint.iteration = 3;
+                pd->checkpoint.totalIterations = 42;
+                pd->checkpoint.failCount = 1;
+                pd->checkpoint.alpha.assign( 20, 0.5 );
+                pd->checkpoint.metrics = { 1.0, 0.9, 0.8 };
+                SolverCheckpoint sent = pd->checkpoint;
+                
+                shared_ptr<char> block;
+                uint64_t blockSize(0);
+                job.setCheckpointCallback( [&]( shared_ptr<char> b, uint64_t n ){ block = b; blockSize = n; } );
+                job.checkpoint( *pd );
+                BOOST_REQUIRE( block && blockSize );
+                
+                auto put = [&]( uint64_t n ) {          // only n bytes, in a buffer of exactly that size.
+                    vector<char> buf( block.get(), block.get()+n );
+                    pd->checkpoint.clear();
+                    job.putCheckpoint( wip, buf.data(), n, false );
+                };
+                
+                put( blockSize );
+                BOOST_CHECK( pd->checkpoint.valid() );
+                BOOST_CHECK_EQUAL( pd->checkpoint.totalIterations, sent.totalIterations );
+                BOOST_CHECK( pd->checkpoint.alpha == sent.alpha );
+                BOOST_CHECK( pd->checkpoint.metrics == sent.metrics );
+                
+                const uint64_t header = sizeof(uint64_t) + Point16::size();      // part-ID + patch-index
+                for( uint64_t n: { uint64_t(0), uint64_t(5), header-1, header, header+10, header+17, blockSize-1 } ) {
+                    BOOST_CHECK_THROW( put( n ), redux::job_error );
+                    BOOST_CHECK( !pd->checkpoint.valid() );
+                }
+                
+                // a corrupt element count (alpha) must not be used to read/allocate.
+                uint64_t corrupt = uint64_t(1) << 60;
+                memcpy( block.get()+header+10, &corrupt, sizeof(uint64_t) );
+                BOOST_CHECK_THROW( put( blockSize ), redux::job_error );
+                BOOST_CHECK( !pd->checkpoint.valid() );
+                
+                // the ID of an assigned patch, but the index of another one.
+                job.checkpoint( *pd );
+                Point16( 0, 1 ).pack( block.get()+sizeof(uint64_t) );
+                job.patches(0,1)->checkpoint.clear();
+                BOOST_CHECK_THROW( put( blockSize ), redux::job_error );
+                BOOST_CHECK( !job.patches(0,1)->checkpoint.valid() );
+                
+                // a patch that is not in the WIP of the sending host.
+                job.checkpoint( *job.patches(0,1) );
+                BOOST_CHECK_THROW( put( blockSize ), redux::job_error );
+                
+            }
+            
+        };
+
+
+        namespace {
+            struct TestPart : public redux::Part {      // a part with a given cost, at a position along a line.
+                TestPart( uint64_t i, double c, double p ) : c(c), p(p) { id = i; }
+                double cost( void ) const override { return c; }
+                double distance( const redux::Part& rhs ) const override {
+                    const TestPart* tp = dynamic_cast<const TestPart*>( &rhs );
+                    return tp ? std::abs( p - tp->p ) : 0;
+                }
+                double c, p;
+            };
+            redux::WorkInProgress::Ptr testWIP( const shared_ptr<redux::Job>& job, uint64_t id, double cost, double pos ) {
+                redux::WorkInProgress::Ptr wip( new redux::WorkInProgress() );
+                wip->job = job;
+                wip->parts.push_back( make_shared<TestPart>( id, cost, pos ) );
+                return wip;
+            }
+        }
+
+        void schedulingTest( void ) {
+
+            using redux::HostAffinity;
+            using redux::WorkInProgress;
+            
+            auto jobA = make_shared<MomfbdJob>();       // cheap parts
+            jobA->info.id = 1;
+            auto jobB = make_shared<MomfbdJob>();       // expensive parts
+            jobB->info.id = 2;
+            
+            deque<WorkInProgress::Ptr> queue;
+            for( int i=0; i<4; ++i ) queue.push_back( testWIP( jobA, 10+i, 1.0, i ) );
+            queue.push_back( nullptr );                 // empty slots are skipped
+            for( int i=0; i<2; ++i ) queue.push_back( testWIP( jobB, 20+i, 4.0, i ) );
+            
+            // The hosts were sent A4 or B2 (i.e. they hold the global data for that job), the speeds are host-seconds per cost.
+            HostAffinity fast, slowA, slowB;
+            fast.update( 1, testWIP( jobA, 14, 1.0, 4 ) );
+            slowA.update( 1, testWIP( jobA, 14, 1.0, 4 ) );
+            slowB.update( 2, testWIP( jobB, 22, 4.0, 2 ) );
+            fast.secPerCost = 1.0;
+            slowA.secPerCost = 3.0;
+            slowB.secPerCost = 2.5;
+            vector<double> speeds = { 1.0, 3.0, 2.5, 0 };      // 0 = not measured yet
+            BOOST_CHECK( HostAffinity::isFast( fast.secPerCost, speeds ) );
+            BOOST_CHECK( !HostAffinity::isFast( slowA.secPerCost, speeds ) );
+            BOOST_CHECK( HostAffinity::isFast( slowB.secPerCost, speeds ) );     // the median
+            BOOST_CHECK( !HostAffinity::isFast( 2.6, speeds ) );
+            BOOST_CHECK( HostAffinity::isFast( 0, speeds ) );                   // unknown hosts are treated as fast
+            BOOST_CHECK( HostAffinity::isFast( 9.0, { 1.0, 0 } ) );              // too few measurements to tell
+            
+            auto take = [&]( HostAffinity& aff, bool isFast, const shared_ptr<redux::Job>& onlyJob=nullptr ) {
+                auto it = aff.pick( queue, isFast, onlyJob );
+                if( it == queue.end() ) return uint64_t(0);
+                WorkInProgress::Ptr wip = *it;
+                queue.erase( it );
+                aff.update( wip->job.lock()->info.id, wip );
+                return wip->parts[0]->id;
+            };
+            
+            BOOST_CHECK_EQUAL( take( fast, true ), 20 );        // the most expensive part, even though it holds job A.
+            BOOST_CHECK_EQUAL( fast.jobID, 2 );
+            BOOST_CHECK_EQUAL( fast.recent.size(), 1 );         // a new job clears the recent parts.
+            BOOST_CHECK_EQUAL( take( slowA, false ), 13 );      // stays with job A, the neighbour of A4.
+            BOOST_CHECK_EQUAL( take( slowB, false ), 21 );      // stays with job B, although those parts are expensive.
+            BOOST_CHECK_EQUAL( take( slowA, false ), 12 );      // the neighbour of A3
+            BOOST_CHECK_EQUAL( take( fast, true ), 10 );        // same cost and no affinity for the rest, queue order.
+            BOOST_CHECK_EQUAL( fast.jobID, 1 );
+            BOOST_CHECK_EQUAL( take( slowB, false ), 11 );      // nothing left of job B, take what is there.
+            BOOST_CHECK_EQUAL( take( fast, true ), 0 );
+            
+            // onlyJob (filling up a work-unit) overrides the cost ranking.
+            queue.push_back( testWIP( jobB, 30, 4.0, 0 ) );
+            queue.push_back( testWIP( jobA, 31, 1.0, 0 ) );
+            BOOST_CHECK_EQUAL( take( fast, true, jobA ), 31 );
+            BOOST_CHECK_EQUAL( take( fast, true, jobA ), 0 );
+            BOOST_CHECK_EQUAL( queue.size(), 2 );               // the empty slot and B30
+            
+            // the speed is measured in host-seconds per cost unit: 2 s wall-time on 4 of 8 threads, for a cost of 4.
+            HostAffinity aff;
+            WorkInProgress::Ptr done = testWIP( jobA, 40, 4.0, 0 );
+            done->parts[0]->runtime_wall = 2;
+            done->parts[0]->nThreads = 4;
+            aff.updateSpeed( done, 8 );
+            BOOST_CHECK_CLOSE( aff.secPerCost, 0.25, 1E-9 );
+            done->parts[0]->runtime_wall = 6;
+            aff.updateSpeed( done, 8 );
+            BOOST_CHECK_CLOSE( aff.secPerCost, 0.7*0.25+0.3*0.75, 1E-9 );
+            
+        }
+
+
+        void prefetchTimeoutTest( void ) {
+
+            using redux::WorkInProgress;
+            using namespace boost::posix_time;
+            
+            auto job = make_shared<MomfbdJob>();
+            const ptime t0 = second_clock::universal_time();
+            const time_duration unitTime = seconds(10);
+            const time_duration timeout = seconds(50);          // returnResults shrinks the timeout to ~5*maxProcessingTime
+            auto unit = [&]( uint64_t id, ptime sent ) {        // a unit of two parts, sent to the host at "sent"
+                WorkInProgress::Ptr wip = testWIP( job, id, 1.0, 0 );
+                wip->parts.push_back( make_shared<TestPart>( id+1, 1.0, 1 ) );
+                wip->workStarted = sent;
+                for( auto& p: wip->parts ) p->partStarted = sent;
+                return wip;
+            };
+            
+            WorkInProgress::Ptr hostWIP = unit( 100, t0 );
+            auto globalData = make_shared<TestPart>( 1, 0, 0 );
+            globalData->partType = 1;                           // never returned
+            hostWIP->parts.push_back( globalData );
+            
+            // The host keeps prefetching: unit n+1 is sent right after it started on unit n, and unit n is returned
+            // after unitTime. The in-flight units overlap, so the host's WIP is never empty.
+            ptime expected = t0;
+            for( int n=0; n<20; ++n ) {
+                ptime started = t0 + unitTime*n;
+                hostWIP->addParts( *unit( 102+2*n, started + seconds(1) ) );
+                BOOST_CHECK( hostWIP->workStarted == expected );                 // still working on the oldest unit
+                BOOST_CHECK_EQUAL( hostWIP->nParts, 5 );
+                ptime returned = started + unitTime;
+                BOOST_CHECK( hostWIP->removeParts( { uint64_t(100+2*n), uint64_t(101+2*n) } ) );
+                expected = started + seconds(1);                                 // the prefetched unit
+                BOOST_CHECK( hostWIP->workStarted == expected );
+                BOOST_CHECK( returned - hostWIP->workStarted < timeout );
+                BOOST_CHECK_EQUAL( hostWIP->nParts, 3 );
+            }
+            BOOST_CHECK( unitTime*20 > timeout );               // the host has been busy for longer than the timeout
+            
+            // the last unit is returned, only the auxiliary part is left.
+            BOOST_CHECK( !hostWIP->removeParts( { 140, 141 } ) );
+            BOOST_CHECK( hostWIP->workStarted.is_not_a_date_time() );
+            BOOST_CHECK( hostWIP->parts.empty() );
+            
+            // merging into an empty WIP takes the start time of the unit.
+            hostWIP->addParts( *unit( 200, t0 ) );
+            BOOST_CHECK( hostWIP->workStarted == t0 );
+            
+        }
+
+
         using namespace boost::unit_test;
         void add_data_tests( test_suite* ts ) {
 
             ts->add( BOOST_TEST_CASE_NAME( &dataTest, "Data" ) );
+            ts->add( BOOST_TEST_CASE_NAME( &workTest, "Multi-patch work-units" ) );
+            ts->add( BOOST_TEST_CASE_NAME( &schedulingTest, "Work scheduling/host affinity" ) );
+            ts->add( BOOST_TEST_CASE_NAME( &prefetchTimeoutTest, "Prefetched work-units and timeouts" ) );
+            ts->add( BOOST_TEST_CASE_NAME( &JobTest::checkpoint, "Truncated/corrupt checkpoints" ) );
 
         }
 
@@ -2,11 +2,22 @@
 
 #include "redux/momfbd/momfbdjob.hpp"
 #include "redux/logging/logger.hpp"
+#include "redux/file/fileana.hpp"
+#include "redux/image/utils.hpp"
+#include "redux/util/gsl.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
 
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/info_parser.hpp>
 
 
+using namespace redux;
 using namespace redux::logging;
 using namespace redux::image;
 using namespace redux::momfbd;
@@ -357,12 +368,250 @@ namespace testsuite {
             
         }
         
+        struct SolverTest {
+            
+            // The FAST_LINESEARCH path of the Solver (my_precalc + metricAt) has to give the same metric as a full
+            // evaluation (applyBeta + metric) at beta + step*dir, including the REG_ALPHA term.
+            // With 11 images, the OTFs are autocorrelated in a full and a partial batch (see Solver::placeImages).
+            static void lineSearch( void ) {
+                
+                lineSearch( false );
+                lineSearch( true );
+                
+            }
+            
+            static void lineSearch( bool singlePrecision ) {
+                
+                const uint16_t nThreads(2), patchSize(32);
+                const uint32_t nImages(11);
+                
+                MomfbdJob job;
+                job.runFlags |= RF_NOSWAP | RF_FAST_LINESEARCH;
+                if( singlePrecision ) job.runFlags |= RF_SINGLE_PRECISION;
+                job.telescopeD = 0.97;
+                job.reg_alpha = 1.0;
+                job.normType = NORM_NONE;
+                for( uint16_t m=2; m<=10; ++m ) job.modeList.push_back( ModeID( m, ZERNIKE ) );
+                job.modeList.setDefaultModeType( ZERNIKE );
+                job.nModes = job.modeList.size();
+                job.patchSize = patchSize;
+                
+                Object::Ptr obj = job.addObject();
+                BOOST_REQUIRE_MESSAGE( obj, "Got null Object, can't continue." );
+                obj->wavelength = 630E-9;
+                obj->arcSecsPerPixel = 0.059;
+                obj->patchSize = patchSize;
+                Channel::Ptr chan = obj->addChannel();
+                BOOST_REQUIRE_MESSAGE( chan, "Got null Channel, can't continue." );
+                chan->nFrames.assign( 1, nImages );
+                chan->nTotalFrames = nImages;
+                chan->waveFrontList.resize( nImages );
+                std::iota( chan->waveFrontList.begin(), chan->waveFrontList.end(), 0 );
+                obj->waveFrontList = chan->waveFrontList;
+                obj->nImages( true );
+                
+                job.initCache();        // pupil, modes and constraints (as on the master)
+                
+                boost::asio::io_context ioc;
+                auto workGuard = boost::asio::make_work_guard( ioc );
+                vector<std::thread> threads;
+                for( uint16_t i=0; i<nThreads; ++i ) {
+                    threads.push_back( std::thread( [&ioc](){ ioc.run(); } ) );
+                }
+                
+                {
+                    Solver solver( job, ioc, nThreads );
+                    BOOST_CHECK_EQUAL( solver.batches.size(), 2 );
+                    
+                    PatchData::Ptr patch( new PatchData( job, 0, 0 ) );
+                    ChannelData::Ptr cd = patch->objects[0]->channels[0];
+                    cd->images.resize( nImages, patchSize, patchSize );
+                    for( size_t i=0; i<nImages; ++i ) {
+                        for( size_t y=0; y<patchSize; ++y ) {
+                            for( size_t x=0; x<patchSize; ++x ) {
+                                cd->images(i,y,x) = 1000 + 200*sin( 0.3*x + 0.2*y + 0.5*i )*cos( 0.25*y - 0.1*x ) + ((x*7+y*13+i*5) % 17);
+                            }
+                        }
+                    }
+                    
+                    // same initialization as in Solver::run
+                    patch->initPatch();
+                    solver.zeroAlphas();
+                    solver.loadInit( patch, solver.alpha_offset.get() );
+                    solver.shiftAndInit( solver.alpha_offset.get(), true );
+                    
+                    const size_t nFree = solver.nFreeParameters;
+                    BOOST_REQUIRE( nFree > 0 );
+                    vector<double> b( nFree ), dir( nFree ), tmp( nFree );
+                    for( size_t i=0; i<nFree; ++i ) {
+                        b[i] = 2E-8*sin( 0.7*i + 0.3 );
+                        dir[i] = 1E-8*cos( 1.3*i );
+                    }
+                    gsl_vector_view bView = gsl_vector_view_array( b.data(), nFree );
+                    gsl_vector_view dirView = gsl_vector_view_array( dir.data(), nFree );
+                    gsl_vector_view tmpView = gsl_vector_view_array( tmp.data(), nFree );
+                    auto regTerm = [&solver]( void ) {
+                        const double* a = solver.alpha.get();
+                        const double* w = solver.regAlphaWeights.get();
+                        double sum(0);
+                        for( size_t i=0; i<solver.nParameters; ++i ) sum += 0.5*a[i]*a[i]*w[i];
+                        return sum;
+                    };
+                    
+                    // N.B. all the steps are evaluated before my_f is called, since that modifies alpha.
+                    const vector<double> steps = { -1.5, -0.4, 0.25, 1.0, 2.5 };
+                    solver.my_precalc( &bView.vector, &dirView.vector );
+                    const double reg0 = regTerm();
+                    BOOST_REQUIRE( reg0 > 0 );
+                    vector<double> fast;
+                    for( auto& s: steps ) {
+                        fast.push_back( solver.metricAt( s ) );
+                    }
+                    
+                    const double tol = singlePrecision ? 1E-2 : 1E-6;       // percent
+                    for( size_t j=0; j<steps.size(); ++j ) {
+                        for( size_t i=0; i<nFree; ++i ) tmp[i] = b[i] + steps[j]*dir[i];
+                        double full = solver.my_f( &tmpView.vector, nullptr );
+                        BOOST_CHECK( std::isfinite( full ) );
+                        BOOST_CHECK_CLOSE( fast[j], full, tol );
+                        BOOST_CHECK_CLOSE( regTerm()-reg0, steps[j]*(solver.lineReg1 + steps[j]*solver.lineReg2), 1E-6 );
+                    }
+                }
+                
+                workGuard.reset();
+                for( auto& t: threads ) t.join();
+                
+            }
+            
+        };
+        
+        struct ChannelTest {
+            
+            // Check that the pipelined load/preprocessing (Channel::loadData) gives the same frames and statistics
+            // as the step-by-step calibration (subtract dark, multiply by gain, fillPixels) computed here.
+            static void pipeline( void ) {
+                
+                namespace bfs = boost::filesystem;
+                namespace sp = std::placeholders;
+                const string tmpl = "testsuite_chan_%03d.f0";
+                const size_t nFiles(3), nF(4), sy(64), sx(72), clip(4);
+                
+                struct TmpDir {     // removed also when a check fails
+                    bfs::path path;
+                    TmpDir() : path( bfs::temp_directory_path() / bfs::unique_path( "rdx_testsuite_%%%%-%%%%-%%%%" ) ) {
+                        bfs::create_directories( path );
+                    }
+                    ~TmpDir() { boost::system::error_code ec; bfs::remove_all( path, ec ); }
+                } tmpDir;
+                
+                MomfbdJob job;
+                job.runFlags |= RF_NOSWAP;          // keep the images in memory
+                Object::Ptr obj = job.addObject();
+                BOOST_REQUIRE_MESSAGE( obj, "Got null Object, can't continue." );
+                Channel::Ptr chan = obj->addChannel();
+                BOOST_REQUIRE_MESSAGE( chan, "Got null Channel, can't continue." );
+                
+                vector<Array<float>> raw;
+                for( size_t i=0; i<nFiles; ++i ) {
+                    Array<float> data( nF, sy, sx );
+                    for( size_t j=0; j<nF; ++j ) {
+                        for( size_t y=0; y<sy; ++y ) {
+                            for( size_t x=0; x<sx; ++x ) {
+                                data(j,y,x) = 1000 + 100*sin( 0.1*(x+3*i) + 0.05*y*(j+1) ) + ((x*7+y*13+j) % 17);
+                            }
+                        }
+                    }
+                    bfs::path fn = tmpDir.path / boost::str( boost::format( tmpl ) % i );
+                    redux::file::Ana::write( fn.string(), data );
+                    raw.push_back( data );
+                    chan->fileNumbers.push_back( i );
+                }
+                chan->imageDataDir = tmpDir.path.string();
+                chan->imageTemplate = tmpl;
+                chan->borderClip = clip;
+                chan->nFrames.assign( nFiles, nF );
+                chan->nTotalFrames = nFiles*nF;
+                chan->imgSize = Point16( sy, sx );
+                
+                chan->dark.resize( sy, sx );
+                chan->gain.resize( sy, sx );
+                for( size_t y=0; y<sy; ++y ) {
+                    for( size_t x=0; x<sx; ++x ) {
+                        chan->dark(y,x) = 90 + (x+y) % 5;
+                        chan->gain(y,x) = ((x*y) % 97 == 5) ? 0.0 : 0.9 + 0.001*x;    // a few bad pixels to be filled
+                    }
+                }
+                chan->ccdResponse.resize( sy-2, sx );       // wrong size, should be dropped before the frames are processed.
+                chan->ccdResponse = 2.0;
+                
+                boost::asio::io_context ioc;
+                Array<PatchData::Ptr> patches;
+                chan->loadData( ioc, patches );
+                vector<std::thread> threads;
+                for( int i=0; i<4; ++i ) {
+                    threads.push_back( std::thread( [&ioc](){ ioc.run(); } ) );
+                }
+                for( auto& t: threads ) t.join();
+                BOOST_CHECK( !chan->ccdResponse.valid() );
+                BOOST_REQUIRE_EQUAL( chan->imageStats.size(), nFiles*nF );
+                
+                double maxDiff(0);
+                for( size_t i=0; i<nFiles; ++i ) {
+                    for( size_t j=0; j<nF; ++j ) {
+                        const size_t n = i*nF+j;
+                        Array<double> ref( sy, sx );
+                        for( size_t y=0; y<sy; ++y ) {
+                            for( size_t x=0; x<sx; ++x ) {
+                                ref(y,x) = raw[i](j,y,x);
+                            }
+                        }
+                        ref -= chan->dark;
+                        ref *= chan->gain;
+                        shared_ptr<double*> ref2D = ref.reshape( sy, sx );
+                        function<double(size_t,size_t)> func = bind( inverseDistanceWeight<double>, ref2D.get(), sy, sx, sp::_1, sp::_2 );
+                        for( int pass=0; pass<2; ++pass ) {     // default method (IDW), then the larger features
+                            fillPixels( ref2D.get(), sy, sx, func, std::bind( std::less_equal<double>(), sp::_1, job.badPixelThreshold ) );
+                        }
+                        for( size_t y=0; y<sy; ++y ) {
+                            for( size_t x=0; x<sx; ++x ) {
+                                float r = static_cast<float>( ref(y,x) );
+                                maxDiff = std::max<double>( maxDiff, std::abs( chan->images(n,y,x) - r )/std::max( std::abs(r), 1.0f ) );
+                            }
+                        }
+                        
+                        vector<double> v;
+                        for( size_t y=clip; y<sy-clip; ++y ) {
+                            for( size_t x=clip; x<sx-clip; ++x ) {
+                                v.push_back( ref(y,x) );
+                            }
+                        }
+                        double sum(0), sqrSum(0);
+                        for( auto& val: v ) {
+                            sum += val;
+                            sqrSum += val*val;
+                        }
+                        std::sort( v.begin(), v.end() );
+                        double median = 0.5*( v[(v.size()-1)/2] + v[v.size()/2] );
+                        BOOST_REQUIRE( chan->imageStats[n] );
+                        BOOST_CHECK_CLOSE( chan->imageStats[n]->mean, sum/v.size(), 1E-6 );
+                        BOOST_CHECK_CLOSE( chan->imageStats[n]->rms, sqrt( sqrSum/v.size() ), 1E-6 );
+                        BOOST_CHECK_CLOSE( chan->imageStats[n]->median, median, 1E-6 );
+                    }
+                }
+                BOOST_CHECK_SMALL( maxDiff, 1E-6 );
+                
+            }
+            
+        };
+        
         void add_config_tests( test_suite* ts );    // defined in config.cpp
         void add_data_tests( test_suite* ts );      // defined in data.cpp
 
         void add_tests( test_suite* ts ) {
 
             ts->add( BOOST_TEST_CASE_NAME( &test_structure, "Test the overall structure (classes etc.)"  ) );
+            ts->add( BOOST_TEST_CASE_NAME( static_cast<void(*)(void)>(&SolverTest::lineSearch), "Compare the fast/full line-search of the Solver (FAST_LINESEARCH)"  ) );
+            ts->add( BOOST_TEST_CASE_NAME( &ChannelTest::pipeline, "Compare the pipelined preprocessing of a Channel with a step-by-step calibration"  ) );
             
             add_config_tests( ts );
             add_data_tests( ts );
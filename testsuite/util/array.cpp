@@ -460,6 +460,37 @@ namespace testsuite {
             stats.getRmsStddev( array );
             BOOST_CHECK_CLOSE( stats.rms, rms, tiny );
             BOOST_CHECK_CLOSE( stats.stddev, stddev, tiny );
+            
+            // histogram median: exact for all types.
+            std::vector<double> sorted( rawPtr, rawPtr+nEl );
+            std::sort( sorted.begin(), sorted.end() );
+            double median = 0.5*( sorted[(nEl-1)/2] + sorted[nEl/2] );
+            stats.getMedian( array );
+            BOOST_CHECK_SMALL( stats.median-median, tiny );
+            BOOST_CHECK_SMALL( stats.getPercentile( rawPtr, nEl, 0.0 )-mn, tiny );
+            BOOST_CHECK_SMALL( stats.getPercentile( rawPtr, nEl, 1.0 )-mx, tiny );
+            
+            // everything in one call.
+            ArrayStats stats2;
+            stats2.getStats( array, ST_VALUES|ST_RMS|ST_MEDIAN );
+            BOOST_CHECK_CLOSE( stats2.min, double(mn), tiny );
+            BOOST_CHECK_CLOSE( stats2.max, double(mx), tiny );
+            BOOST_CHECK_CLOSE( stats2.mean, avg, tiny );
+            BOOST_CHECK_CLOSE( stats2.rms, rms, tiny );
+            BOOST_CHECK_CLOSE( stats2.stddev, stddev, tiny );
+            BOOST_CHECK_SMALL( stats2.median-median, tiny );
+            
+            if( std::is_floating_point<T>::value && nEl > 2 ) {    // a far outlier makes the bins much wider than the spread of the data
+                rawPtr[0] = static_cast<T>( 1E6 );
+                for( size_t x(1); x < nEl; ++x ) rawPtr[x] += static_cast<T>( (x%7)*1E-3 );
+                sorted.assign( rawPtr, rawPtr+nEl );
+                std::sort( sorted.begin(), sorted.end() );
+                median = 0.5*( sorted[(nEl-1)/2] + sorted[nEl/2] );
+                ArrayStats stats3;
+                stats3.getMinMaxMean( array );
+                stats3.getMedian( array );
+                BOOST_CHECK_SMALL( stats3.median-median, 1E-9 );
+            }
 
         }
 
@@ -704,6 +735,80 @@ namespace testsuite {
         }
 
 
+        void bufferListTest( void ) {
+            
+            Array<float> array( 20, 100, 100 );             // large enough to be deferred
+            float cnt(0.5);
+            for( auto& it: array ) it = (cnt += 1);
+            
+            auto buf = sharedArray<char>( array.size() );
+            char* ptr = buf.get();
+            BufferList out;
+            uint64_t count, packedSize;
+            {
+                BufferList::Scope scope( &out );
+                packedSize = array.size();                  // the size of the packed block, i.e. without the deferred data
+                count = array.pack( ptr );
+            }
+            BOOST_CHECK_EQUAL( count, packedSize );
+            BOOST_CHECK_LT( count, array.size() );           // only the header was packed
+            BOOST_CHECK_EQUAL( out.blocks().size(), 1 );
+            BOOST_CHECK_EQUAL( out.size(), array.nElements()*sizeof(float) );
+            BOOST_CHECK( out.blocks()[0].data == reinterpret_cast<const char*>(array.get()) );     // no copy
+            
+            Array<float> tmp;
+            BufferList in;
+            {
+                BufferList::Scope scope( &in );
+                BOOST_CHECK_EQUAL( tmp.unpack( ptr, false ), count );
+            }
+            BOOST_CHECK( tmp.sameSize(array) );
+            BOOST_CHECK_EQUAL( in.blocks().size(), 1 );
+            BOOST_CHECK_EQUAL( in.size(), out.size() );
+            memcpy( in.blocks()[0].data, out.blocks()[0].data, out.size() );     // i.e. what the connection does
+            BOOST_CHECK( tmp == array );
+            
+            BOOST_CHECK_THROW( Array<float>().unpack( ptr, false ), std::runtime_error );   // header-only, without a list
+            
+            in.swapEndian();
+            in.swapEndian();
+            BOOST_CHECK( tmp == array );
+            
+            Array<float> sub( array, 0, 19, 0, 49, 0, 49 );    // non-dense sub-array: gathered into a staged block
+            out.clear();
+            in.clear();
+            {
+                BufferList::Scope scope( &out );
+                count = sub.pack( ptr );
+            }
+            BOOST_CHECK_EQUAL( out.size(), sub.nElements()*sizeof(float) );
+            BOOST_CHECK( out.blocks()[0].data != reinterpret_cast<const char*>(array.get()) );
+            {
+                BufferList::Scope scope( &in );
+                BOOST_CHECK_EQUAL( tmp.unpack( ptr, false ), count );
+            }
+            memcpy( in.blocks()[0].data, out.blocks()[0].data, out.size() );
+            BOOST_CHECK_EQUAL( tmp.nElements(), sub.nElements() );
+            const float* tPtr = tmp.get();
+            bool same(true);
+            for( auto& it: sub ) same &= (it == *tPtr++);
+            BOOST_CHECK( same );
+            
+            Array<float> small( 10, 10 );                   // small arrays are always packed inline
+            out.clear();
+            {
+                BufferList::Scope scope( &out );
+                count = small.pack( ptr );
+                BufferList::Scope inlineOnly( nullptr );
+                BOOST_CHECK( BufferList::active() == nullptr );
+            }
+            BOOST_CHECK( BufferList::active() == nullptr );
+            BOOST_CHECK_EQUAL( count, small.size() );
+            BOOST_CHECK( out.empty() );
+            
+        }
+
+
         void arrayStatTest( void ) {
             
             // Numerical verification for various types.
@@ -727,9 +832,96 @@ namespace testsuite {
         }
 
 
+        void arithmeticTest( void ) {
+
+            // reference values computed element by element, via operator() (no iterators/runs involved)
+            Array<double> full( 5, 11, 13 );
+            Array<float> other( 4, 9, 17 );
+            for( size_t i=0; i<5; ++i ) for( size_t j=0; j<11; ++j ) for( size_t k=0; k<13; ++k ) full( i, j, k ) = 1000*i + 10*j + k + 0.5;
+            for( size_t i=0; i<4; ++i ) for( size_t j=0; j<9; ++j ) for( size_t k=0; k<17; ++k ) other( i, j, k ) = 1 + i + 0.25*j + 0.125*k;
+            Array<double> ref = full.copy();
+            
+            Array<double> a( full, 1, 3, 2, 8, 3, 11 );     // 3x7x9 non-dense views with different strides/offsets
+            Array<float> b( other, 0, 2, 1, 7, 4, 12 );
+            Array<double> c = a.copy();                     // dense, same number of elements
+            BOOST_TEST( !a.dense() );
+            BOOST_TEST( !b.dense() );
+            BOOST_TEST( c.dense() );
+            BOOST_CHECK( a == c );
+            
+            auto check = [&]( const Array<double>& view, std::function<double(size_t,size_t,size_t)> expected ) {
+                for( size_t i=0; i<3; ++i ) for( size_t j=0; j<7; ++j ) for( size_t k=0; k<9; ++k ) {
+                    BOOST_CHECK_CLOSE( view( i, j, k ), expected( i, j, k ), 1E-9 );
+                }
+            };
+            auto ra = [&]( size_t i, size_t j, size_t k ) { return ref( i+1, j+2, k+3 ); };
+            auto rb = [&]( size_t i, size_t j, size_t k ) { return double( other( i, j+1, k+4 ) ); };
+            
+            a += b;
+            check( a, [&]( size_t i, size_t j, size_t k ) { return ra(i,j,k) + rb(i,j,k); } );
+            a -= b;
+            a *= 2.0;
+            check( a, [&]( size_t i, size_t j, size_t k ) { return 2*ra(i,j,k); } );
+            a /= 2.0;
+            a *= c;
+            check( a, [&]( size_t i, size_t j, size_t k ) { return ra(i,j,k)*ra(i,j,k); } );
+            a.assign( c );
+            check( a, ra );
+            a.subtract( b, 3.0 );
+            check( a, [&]( size_t i, size_t j, size_t k ) { return ra(i,j,k) - 3*rb(i,j,k); } );
+            a.add( b, 3.0 );
+            a.add( b, c );
+            check( a, [&]( size_t i, size_t j, size_t k ) { return ra(i,j,k) + rb(i,j,k)*ra(i,j,k); } );
+            a.assign( c );
+            
+            // elements outside the views must not be touched.
+            Array<double> d( full, 0, 0, 0, 10, 0, 12 );
+            BOOST_CHECK( d == Array<double>( ref, 0, 0, 0, 10, 0, 12 ) );
+            
+            // copy in/out of non-dense views
+            vector<float> buf( a.nElements() );
+            a.copyTo<float>( buf.data() );
+            BOOST_CHECK_EQUAL( buf[0], float( ra(0,0,0) ) );
+            BOOST_CHECK_EQUAL( buf.back(), float( ra(2,6,8) ) );
+            Array<double> e = b.copy<double>();
+            check( e, rb );
+            b.copy( e );
+            check( e, rb );
+            
+            // lazy expressions, on views and dense arrays
+            a = (lazy( a ) - lazy( b )*2.0) * c + 1.0;
+            check( a, [&]( size_t i, size_t j, size_t k ) { return (ra(i,j,k) - 2*rb(i,j,k))*ra(i,j,k) + 1; } );
+            a.assign( c );
+            a -= lazy( b ) / c;
+            check( a, [&]( size_t i, size_t j, size_t k ) { return ra(i,j,k) - rb(i,j,k)/ra(i,j,k); } );
+            a.assign( c );
+            Array<double> f;
+            f = lazy( a ) * b;          // empty destination gets the shape of the expression
+            BOOST_CHECK( f.dimensions() == a.dimensions() );
+            check( f, [&]( size_t i, size_t j, size_t k ) { return ra(i,j,k)*rb(i,j,k); } );
+            BOOST_CHECK_THROW( (a += lazy( full ) * 2), invalid_argument );
+            
+            // parallel evaluation of large arrays should give identical results.
+            Array<float> big( 1100, 1100 ), big2( 1100, 1100 ), res1, res2;
+            for( size_t i=0; i<big.nElements(); ++i ) {
+                big.ptr()[i] = 0.001f*(i%1009);
+                big2.ptr()[i] = 1.0f + 0.01f*(i%13);
+            }
+            res1 = (lazy( big ) - 0.5f) * big2;
+            expr::maxThreads() = 4;
+            res2 = (lazy( big ) - 0.5f) * big2;
+            expr::maxThreads() = 1;
+            BOOST_CHECK( res1 == res2 );
+            BOOST_CHECK_EQUAL( res2( 1099, 1099 ), (big( 1099, 1099 ) - 0.5f) * big2( 1099, 1099 ) );
+
+        }
+
+
         void add_array_tests( test_suite* ts ) {
 
             ts->add( BOOST_TEST_CASE_NAME( &arrayTest, "Array manipulations" ) );
+            ts->add( BOOST_TEST_CASE_NAME( &arithmeticTest, "Array arithmetic on views/lazy expressions" ) );
+            ts->add( BOOST_TEST_CASE_NAME( &bufferListTest, "Scatter/gather pack/unpack" ) );
             ts->add( BOOST_TEST_CASE_NAME( &arrayStatTest, "Statistics and numerical tools"  ) );
 
         }
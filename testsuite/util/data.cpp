@@ -1,8 +1,12 @@
 
 
+#include "redux/util/codec.hpp"
 #include "redux/util/endian.hpp"
 #include "redux/util/datautil.hpp"
 
+#include <cmath>
+#include <cstring>
+
 #include <boost/test/unit_test.hpp>
 
 using namespace redux::util;
@@ -199,12 +203,91 @@ namespace testsuite {
         }
 
 
+        void codecTest( void ) {
+
+            BOOST_CHECK_EQUAL( codec::parse( "none" ), 0 );
+            BOOST_CHECK_EQUAL( codec::parse( "auto" ), codec::available() );
+            BOOST_CHECK( codec::available() & (1<<codec::ZLIB) );
+            BOOST_CHECK_THROW( codec::parse( "foo" ), std::invalid_argument );
+            BOOST_CHECK_EQUAL( codec::negotiate( codec::available(), 0 ), codec::NONE );
+            BOOST_CHECK_EQUAL( codec::negotiate( codec::available(), (1<<codec::ZLIB) ), codec::ZLIB );
+            
+            // smooth "image" spanning a few chunks (with a partial chunk at the end), and some incompressible data.
+            const size_t nFloats = 2*codec::chunkSize/sizeof(float) + 1234;
+            vector<float> img( nFloats );
+            for( size_t i=0; i<nFloats; ++i ) img[i] = 1000 + 100*sin( i*1E-3 );
+            vector<char> noise( codec::chunkSize/3 );
+            for( auto& n: noise ) n = rand();
+
+            for( uint8_t t=codec::ZLIB; t<codec::NTYPES; ++t ) {
+                if( !(codec::available() & (1<<t)) ) continue;
+                codec::Type type = static_cast<codec::Type>(t);
+                uint64_t rawSize = nFloats*sizeof(float);
+                uint64_t encSize(0), encSizeNoShuffle(0);
+                shared_ptr<char> enc = codec::encode( type, reinterpret_cast<const char*>(img.data()), rawSize, encSize, sizeof(float), 9 );
+                codec::encode( type, reinterpret_cast<const char*>(img.data()), rawSize, encSizeNoShuffle );
+                BOOST_CHECK_LE( encSize, codec::bound( rawSize ) );
+                BOOST_CHECK_LT( encSize, rawSize );
+                BOOST_CHECK_LE( encSize, encSizeNoShuffle );
+                BOOST_CHECK_EQUAL( codec::rawSize( enc.get()+9, false ), rawSize );
+                vector<float> dec( nFloats );
+                BOOST_CHECK_EQUAL( codec::decode( enc.get()+9, encSize, reinterpret_cast<char*>(dec.data()), false ), encSize );
+                BOOST_CHECK( memcmp( img.data(), dec.data(), rawSize ) == 0 );
+                
+                enc = codec::encode( type, noise.data(), noise.size(), encSize, 4 );       // stored as it is, but still decodable
+                BOOST_CHECK_LE( encSize, codec::bound( noise.size() ) );
+                vector<char> decNoise( noise.size() );
+                codec::decode( enc.get(), encSize, decNoise.data(), false );
+                BOOST_CHECK( decNoise == noise );
+                BOOST_CHECK_THROW( codec::decode( enc.get(), encSize/2, decNoise.data(), false ), std::length_error );
+                
+                // corrupt chunk headers must be rejected before anything is written outside the output buffer.
+                enc = codec::encode( type, reinterpret_cast<const char*>(img.data()), rawSize, encSize, sizeof(float) );
+                vector<uint64_t> hdrs;      // offsets of the chunk headers
+                uint64_t offset = sizeof(uint64_t) + sizeof(uint32_t);
+                while( offset < encSize ) {
+                    hdrs.push_back( offset );
+                    uint32_t enc_sz(0);
+                    unpack( enc.get()+offset+2+sizeof(uint32_t), enc_sz );
+                    offset += 2 + 2*sizeof(uint32_t) + enc_sz;
+                }
+                BOOST_REQUIRE_EQUAL( hdrs.size(), 3 );
+                auto corrupt = [&]( uint64_t pos, uint32_t val ) {
+                    vector<char> bad( enc.get(), enc.get()+encSize );
+                    pack( bad.data()+pos, val );
+                    return bad;
+                };
+                vector<char> bad = corrupt( hdrs.back()+2, codec::chunkSize );                // oversized last chunk
+                BOOST_CHECK_THROW( codec::decode( bad.data(), encSize, reinterpret_cast<char*>(dec.data()), false ), std::length_error );
+                bad = corrupt( hdrs.front()+2, codec::chunkSize/2 );                           // truncated first chunk
+                BOOST_CHECK_THROW( codec::decode( bad.data(), encSize, reinterpret_cast<char*>(dec.data()), false ), std::length_error );
+                bad = corrupt( hdrs[1]+2+sizeof(uint32_t), 0xFFFFFFFF );                        // encoded size past the end of the block
+                BOOST_CHECK_THROW( codec::decode( bad.data(), encSize, reinterpret_cast<char*>(dec.data()), false ), std::length_error );
+                bad = corrupt( sizeof(uint64_t), 2 );                                          // chunk count does not match rawSize
+                BOOST_CHECK_THROW( codec::decode( bad.data(), encSize, reinterpret_cast<char*>(dec.data()), false ), std::length_error );
+                BOOST_CHECK_THROW( codec::decode( enc.get(), hdrs.back()+4, reinterpret_cast<char*>(dec.data()), false ), std::length_error );   // truncated header
+            }
+            
+            codec::Stats st, st2;
+            st.add( 1000, 250, 10 );
+            BOOST_CHECK_CLOSE( st.ratio(), 4.0, 1E-6 );
+            vector<char> buf( st.size() );
+            BOOST_CHECK_EQUAL( st.pack( buf.data() ), st.size() );
+            BOOST_CHECK_EQUAL( st2.unpack( buf.data(), false ), st.size() );
+            BOOST_CHECK_EQUAL( st2.raw, 1000 );
+            BOOST_CHECK_EQUAL( st2.wire, 250 );
+            BOOST_CHECK_EQUAL( st2.usecs, 10 );
+
+        }
+
+
         void add_data_tests( test_suite* ts ) {
             
             srand (time(NULL));
             
             ts->add( BOOST_TEST_CASE_NAME( &dataTest, "Data tools"  ) );
             ts->add( BOOST_TEST_CASE_NAME( &endianTest, "Endian tests"  ) );
+            ts->add( BOOST_TEST_CASE_NAME( &codecTest, "Network codecs"  ) );
 
         }
 
@@ -1,10 +1,22 @@
 #include <boost/test/unit_test.hpp>
 
+#include "redux/logging/logger.hpp"
+
 #include "redux/util/bitoperations.hpp"
 #include "redux/util/boundvalue.hpp"
+#include "redux/util/cache.hpp"
+#include "redux/util/executor.hpp"
+#include "redux/util/numa.hpp"
 #include "redux/util/point.hpp"
+#include "redux/util/pool.hpp"
 #include "redux/util/region.hpp"
+#include "redux/util/trace.hpp"
+
+#include <numeric>
+#include <sstream>
+#include <thread>
 
+using namespace redux::logging;
 using namespace redux::util;
 
 using namespace std;
@@ -578,6 +590,392 @@ namespace testsuite {
           
         }
         
+        void numaTest( void ) {
+            
+            BOOST_REQUIRE( numa::nNodes() > 0 );
+            size_t nCPU(0);
+            for( size_t n=0; n<numa::nNodes(); ++n ) {
+                for( auto& c: numa::cpus(n) ) {
+                    BOOST_TEST( numa::nodeOf(c) == (int)n );
+                }
+                nCPU += numa::cpus(n).size();
+            }
+            BOOST_TEST( nCPU > 0 );
+            
+            // every item should be popped exactly once, regardless of which node the workers are on,
+            // and also after a reset.
+            for( bool en: { false, true } ) {
+                numa::enable( en );
+                const size_t nItems(1000);
+                numa::NodeQueue<size_t> queue;
+                for( size_t i=0; i<nItems; ++i ) queue.push( i%7, i );
+                BOOST_TEST( queue.size() == nItems );
+                for( int pass=0; pass<2; ++pass ) {
+                    queue.reset();
+                    vector<std::atomic<int>> count( nItems );
+                    for( auto& c: count ) c = 0;
+                    vector<std::thread> workers;
+                    for( int t=0; t<4; ++t ) {
+                        workers.push_back( std::thread( [&,t](){
+                            size_t i;
+                            while( queue.pop( t, i ) ) count[i]++;
+                        }) );
+                    }
+                    for( auto& w: workers ) w.join();
+                    for( auto& c: count ) BOOST_TEST( c == 1 );
+                }
+            }
+            numa::enable( false );
+            
+        }
+        
+        void executorTest( void ) {
+            
+            Executor ex( 4 );
+            BOOST_TEST( ex.nThreads() == 4 );
+            
+            // every task should run exactly once, also the ones spawned from inside other tasks (local queues/stealing).
+            const size_t nItems(1000);
+            vector<std::atomic<int>> count( 2*nItems );
+            for( auto& c: count ) c = 0;
+            for( size_t i=0; i<nItems; ++i ) {
+                Executor::Lane lane = static_cast<Executor::Lane>( i % Executor::NLANES );
+                ex.submit( lane, [&,i](){
+                    count[i]++;
+                    ex.submit( Executor::SOLVE, [&,i](){ count[nItems+i]++; } );
+                });
+            }
+            ex.waitIdle();
+            for( auto& c: count ) BOOST_TEST( c == 1 );
+            uint64_t nCompleted(0);
+            for( int l=0; l<Executor::NLANES; ++l ) {
+                Executor::LaneStats st = ex.stats( static_cast<Executor::Lane>(l) );
+                BOOST_TEST( st.queued == 0 );
+                BOOST_TEST( st.active == 0 );
+                nCompleted += st.completed;
+            }
+            BOOST_TEST( nCompleted == 2*nItems );
+            BOOST_TEST( ex.stats( Executor::SOLVE ).completed == nItems + nItems/Executor::NLANES );
+            
+            // the lane limit must hold, and the other lanes should still get through.
+            ex.setLimit( Executor::IO, 1 );
+            std::atomic<int> active(0), maxActive(0);
+            for( int i=0; i<20; ++i ) {
+                ex.submit( Executor::IO, [&](){
+                    int a = ++active;
+                    int m = maxActive;
+                    while( (a > m) && !maxActive.compare_exchange_weak( m, a ) );
+                    std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+                    --active;
+                });
+            }
+            auto res = ex.async( Executor::NET, [](){ return 42; } );
+            BOOST_TEST( res.get() == 42 );
+            ex.waitIdle();
+            BOOST_TEST( maxActive == 1 );
+            
+            // shrinking should not lose queued tasks.
+            std::atomic<int> n(0);
+            for( int i=0; i<100; ++i ) ex.submit( Executor::PREPROCESS, [&](){ ++n; } );
+            ex.resize( 1 );
+            BOOST_TEST( ex.nThreads() == 1 );
+            ex.waitIdle();
+            BOOST_TEST( n == 100 );
+            
+            // shrinking should not wait for running tasks, and the local queues of removed workers must be handed over.
+            ex.resize( 2 );
+            std::promise<void> go;
+            std::shared_future<void> release = go.get_future().share();
+            std::atomic<int> started(0), nLocal(0);
+            for( int i=0; i<2; ++i ) {
+                ex.submit( Executor::SOLVE, [&,release](){
+                    ex.submit( Executor::IO, [&](){ ++nLocal; } );        // goes to the local queue of this worker
+                    ++started;
+                    release.wait();
+                });
+            }
+            while( started < 2 ) std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+            ex.resize( 1 );                                                 // both workers are busy, this must not block.
+            BOOST_TEST( ex.nThreads() == 1 );
+            go.set_value();
+            ex.waitIdle();
+            BOOST_TEST( nLocal == 2 );
+            ex.resize( 3 );                                                 // also reaps the retired worker
+            BOOST_TEST( ex.nThreads() == 3 );
+            
+            // a TaskGroup: cancel() skips the queued tasks, wait() returns when the running ones are done.
+            {
+                ex.resize( 1 );
+                TaskGroup group( ex );
+                std::promise<void> go2;
+                std::shared_future<void> release2 = go2.get_future().share();
+                std::atomic<int> nStarted(0), nRun(0);
+                group.submit( Executor::SOLVE, [&,release2](){ ++nStarted; release2.wait(); ++nRun; } );
+                for( int i=0; i<10; ++i ) group.submit( Executor::SOLVE, [&](){ ++nRun; } );
+                while( !nStarted ) std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+                BOOST_TEST( group.size() == 11 );
+                group.cancel();
+                group.submit( Executor::SOLVE, [&](){ ++nRun; } );          // not accepted after cancel()
+                auto fut = group.async( Executor::NET, [](){ return 1; } );
+                std::thread t( [&](){ std::this_thread::sleep_for( std::chrono::milliseconds(20) ); go2.set_value(); } );
+                group.wait();
+                t.join();
+                BOOST_TEST( nRun == 1 );
+                BOOST_TEST( group.size() == 0 );
+                BOOST_CHECK_THROW( fut.get(), std::future_error );
+                
+                group.restart();                                            // wait() from inside a group-task must not block on itself.
+                auto inner = group.async( Executor::IO, [&](){ group.wait(); return 2; } );
+                BOOST_TEST( inner.get() == 2 );
+                group.wait();
+                ex.resize( 3 );
+            }
+            
+            // uncaught exceptions go to the error handler, and the worker survives them.
+            std::mutex errMtx;
+            vector<string> errors;
+            ex.setErrorHandler( [&]( const string& msg ){ lock_guard<std::mutex> lock( errMtx ); errors.push_back( msg ); } );
+            ex.submit( Executor::IO, [](){ throw std::runtime_error( "oops" ); } );
+            ex.submit( Executor::IO, [](){ throw 1; } );
+            ex.waitIdle();
+            ex.setErrorHandler( nullptr );
+            BOOST_REQUIRE( errors.size() == 2 );
+            BOOST_TEST( std::count_if( errors.begin(), errors.end(), []( const string& e ){ return e.find( "io-task: oops" ) != string::npos; } ) == 1 );
+            BOOST_TEST( ex.async( Executor::IO, [](){ return 3; } ).get() == 3 );
+            
+        }
+        
+        void poolTest( void ) {
+            
+            MemoryPool::trim();
+            MemoryPool::Stats st0 = MemoryPool::stats();
+            
+            // alignment, and that the whole block is writable.
+            const size_t sizes[] = { 1, 63, 64, 65, 257, 1000, 4096, 100000, (1<<20)+1, (3<<21)+17, (1<<28)+1 };
+            vector<pair<void*,size_t>> blocks;
+            for( size_t sz: sizes ) {
+                char* p = reinterpret_cast<char*>( MemoryPool::allocate( sz ) );
+                BOOST_REQUIRE( p );
+                BOOST_TEST( (reinterpret_cast<uintptr_t>(p) % MemoryPool::alignment) == 0 );
+                std::fill_n( p, sz, char(sz) );
+                blocks.push_back( make_pair( p, sz ) );
+            }
+            for( auto& b: blocks ) {
+                char* p = reinterpret_cast<char*>( b.first );
+                BOOST_TEST( std::count( p, p+b.second, char(b.second) ) == (int64_t)b.second );
+            }
+            MemoryPool::Stats st = MemoryPool::stats();
+            BOOST_TEST( st.inUse >= st.requested );
+            BOOST_TEST( st.requested - st0.requested == std::accumulate( begin(sizes), end(sizes), size_t(0) ) );
+            for( auto& b: blocks ) MemoryPool::deallocate( b.first, b.second );
+            st = MemoryPool::stats();
+            BOOST_TEST( st.inUse == st0.inUse );
+            BOOST_TEST( st.requested == st0.requested );
+            
+            // a freed block should be re-used for a request of the same size-class.
+            void* p1 = MemoryPool::allocate( 5000 );
+            MemoryPool::deallocate( p1, 5000 );
+            uint64_t hits = MemoryPool::stats().hits;
+            void* p2 = MemoryPool::allocate( 5100 );
+            BOOST_TEST( p1 == p2 );
+            BOOST_TEST( MemoryPool::stats().hits == hits+1 );
+            
+            // blocks allocated in one thread and released in another.
+            const size_t nBlocks(1000);
+            vector<shared_ptr<double>> shared;
+            for( size_t i=0; i<nBlocks; ++i ) shared.push_back( rdx_get_shared<double>( 1+(i%97)*13 ) );
+            std::thread t( [&](){ shared.clear(); } );
+            t.join();
+            MemoryPool::deallocate( p2, 5100 );
+            BOOST_TEST( MemoryPool::stats().inUse == st0.inUse );
+            
+            // elements with a non-trivial destructor are constructed/destructed.
+            {
+                shared_ptr<string> strs = rdx_get_shared<string>( 10 );
+                for( int i=0; i<10; ++i ) {
+                    BOOST_TEST( strs.get()[i].empty() );
+                    strs.get()[i] = string( 100, 'a'+i );
+                }
+            }
+            
+            MemoryPool::trim();
+            BOOST_TEST( MemoryPool::stats().cached == 0 );
+            BOOST_TEST( MemoryPool::stats().system == MemoryPool::stats().inUse );
+            
+        }
+        
+        void loggerTest( void ) {
+            
+            const int nThreads(4), nEntries(1000);
+            auto countLines = []( const string& s, const string& tag ) {
+                istringstream iss( s );
+                string line;
+                int cnt(0);
+                while( getline( iss, line ) ) {
+                    if( line.find( tag ) != string::npos ) cnt++;
+                }
+                return cnt;
+            };
+            
+            {   // entries from several threads, none should be lost with OVERFLOW_FLUSH, and each thread's order is kept.
+                ostringstream out;
+                Logger logger;
+                logger.setLevel( LOG_LEVEL_NORMAL );
+                logger.addStream( out );
+                logger.setFlushPeriod( 100 );       // i.e. asynchronous
+                logger.setOverflowPolicy( Logger::OVERFLOW_FLUSH );
+                logger.setContext( "ctx" );
+                vector<std::thread> threads;
+                for( int t=0; t<nThreads; ++t ) {
+                    threads.push_back( std::thread( [&logger,t,nEntries](){
+                        for( int i=0; i<nEntries; ++i ) {
+                            LOG << "msg " << t << " " << i << ende;
+                        }
+                    }) );
+                }
+                for( auto& th: threads ) th.join();
+                string longMsg( 5000, 'x' );
+                LOG_ERR << longMsg << ende;
+                LOG_DEBUG << "msg filtered" << ende;
+                logger.flushAll();
+                
+                BOOST_TEST( countLines( out.str(), "msg " ) == nThreads*nEntries );
+                BOOST_TEST( countLines( out.str(), "(ctx)" ) == nThreads*nEntries+1 );
+                BOOST_TEST( countLines( out.str(), longMsg ) == 1 );
+                BOOST_TEST( logger.nDropped() == 0 );
+                vector<int> last( nThreads, -1 );
+                istringstream iss( out.str() );
+                string line;
+                while( getline( iss, line ) ) {
+                    size_t pos = line.find( "msg " );
+                    if( pos == string::npos ) continue;
+                    int t, i;
+                    istringstream( line.substr( pos+4 ) ) >> t >> i;
+                    BOOST_TEST( i == last[t]+1 );
+                    last[t] = i;
+                }
+            }
+            
+            {   // with OVERFLOW_DROP entries might be dropped, but they should all be accounted for.
+                ostringstream out;
+                Logger logger;
+                logger.setLevel( LOG_LEVEL_NORMAL );
+                logger.addStream( out );
+                logger.setFlushPeriod( 100 );
+                string padding( 200, '.' );
+                for( int i=0; i<5*nEntries; ++i ) {
+                    LOG << "msg " << i << padding << ende;
+                }
+                logger.flushAll();
+                BOOST_TEST( countLines( out.str(), "msg " ) + logger.nDropped() == 5*nEntries );
+                BOOST_TEST( (countLines( out.str(), "dropped" ) > 0) == (logger.nDropped() > 0) );
+            }
+            
+            {   // flushPeriod <= 1 (default): the entry reaches the outputs before append returns, records longer than a ring are not truncated.
+                ostringstream out;
+                Logger logger;
+                logger.setLevel( LOG_LEVEL_NORMAL );
+                logger.addStream( out, 0, 0 );      // flushPeriod=0 -> the stream writes every item immediately
+                LOG << "msg sync" << ende;
+                BOOST_TEST( countLines( out.str(), "msg sync" ) == 1 );
+                string hugeMsg( 40000, 'y' );
+                LOG << "msg huge " << hugeMsg << ende;
+                LOG << "msg after" << ende;
+                BOOST_TEST( countLines( out.str(), hugeMsg ) == 1 );
+                BOOST_TEST( out.str().find( "msg huge" ) < out.str().find( "msg after" ) );
+                logger.setFlushPeriod( 100 );
+                LOG << "msg huge2 " << hugeMsg << ende;
+                logger.flushAll();
+                BOOST_TEST( countLines( out.str(), hugeMsg ) == 2 );
+                string longContext( 300, 'c' );            // longer than a slot, goes through the item queue too.
+                logger.setContext( longContext );
+                LOG << "msg context" << ende;
+                logger.flushAll();
+                BOOST_TEST( countLines( out.str(), "(" + longContext + ")" ) == 1 );
+            }
+            
+        }
+        
+        struct CacheTestItem {
+            explicit CacheTestItem( size_t s ) : sz(s) {}
+            size_t cacheSize( void ) const { return sz; }
+            size_t sz;
+        };
+        
+        void cacheTest( void ) {
+            
+            typedef shared_ptr<CacheTestItem> ItemPtr;
+            Cache& c = Cache::get();
+            const size_t oldBudget = c.budget();
+            const unsigned int oldIdle = c.minIdle();
+            auto cached = []( int i ) -> ItemPtr& { return Cache::get<int,ItemPtr>( i ); };
+            auto nCached = []( void ) { return Cache::size<int,ItemPtr>(); };
+            
+            const int nItems(20);
+            const size_t itemSize(1<<20);
+            Cache::setEvictable<int,ItemPtr>();
+            for( int i=0; i<nItems; ++i ) {
+                ItemPtr& ip = cached( i );
+                BOOST_TEST( !ip );
+                ip.reset( new CacheTestItem( itemSize ) );
+            }
+            BOOST_TEST( cached( 0 ) );                          // hit, and now the most recently used
+            ItemPtr held = cached( 1 );                         // referenced, can not be evicted
+            
+            c.setMinIdle( 0 );
+            c.setBudget( 1<<30 );                               // large enough, nothing should be evicted
+            Cache::trim();
+            BOOST_TEST( nCached() == nItems );
+            
+            c.setBudget( 1 );                                   // evict everything that is not referenced
+            Cache::trim();
+            BOOST_TEST( nCached() == 1 );
+            BOOST_TEST( cached( 1 ) == held );
+            
+            held.reset();
+            for( int i=0; i<nItems; ++i ) {
+                cached( i ).reset( new CacheTestItem( itemSize ) );
+            }
+            c.setMinIdle( 3600 );                               // all entries were just used
+            Cache::trim();
+            BOOST_TEST( nCached() == nItems );
+            
+            // the least recently used entries go first: whatever is left must be the newest.
+            c.setMinIdle( 0 );
+            c.setBudget( (nItems/2)*itemSize );
+            Cache::trim();
+            size_t nLeft = nCached();
+            BOOST_TEST( nLeft < nItems );
+            for( int i=0; i<nItems; ++i ) {
+                bool present = (Cache::erase<int,ItemPtr>( i ) == 1);
+                BOOST_TEST( present == (i >= int(nItems-nLeft)) );
+            }
+            
+            // getOrCreate() constructs the entry under the map lock, and the returned copy pins it.
+            int nCreated(0);
+            auto create = [&nCreated, itemSize](){ ++nCreated; return ItemPtr( new CacheTestItem( itemSize ) ); };
+            ItemPtr pinned = Cache::getOrCreate<int,ItemPtr>( nItems, create );
+            BOOST_TEST( (Cache::getOrCreate<int,ItemPtr>( nItems, create ) == pinned) );
+            BOOST_TEST( nCreated == 1 );
+            BOOST_TEST( (Cache::find<int,ItemPtr>( nItems ) == pinned) );
+            BOOST_TEST( (!Cache::find<int,ItemPtr>( nItems+1 )) );
+            BOOST_TEST( nCached() == 1 );
+            c.setBudget( 1 );
+            Cache::trim();
+            BOOST_TEST( (Cache::find<int,ItemPtr>( nItems ) == pinned) );
+            pinned.reset();
+            Cache::trim();
+            BOOST_TEST( nCached() == 0 );
+            
+            string stats = Cache::getStats();
+            BOOST_TEST( stats.find( "Evicted" ) != string::npos );
+            
+            Cache::clear<int,ItemPtr>();
+            c.setBudget( oldBudget );
+            c.setMinIdle( oldIdle );
+            
+        }
+        
         void add_array_tests( test_suite* ts );     // defined in array.cpp
         void add_data_tests( test_suite* ts );      // defined in data.cpp
         void add_string_tests( test_suite* ts );    // defined in string.cpp
@@ -588,6 +986,11 @@ namespace testsuite {
             ts->add( BOOST_TEST_CASE_NAME( &boundValueTest, "BoundValue"  ) );
             ts->add( BOOST_TEST_CASE_NAME( &pointTest, "Point struct" ) );
             ts->add( BOOST_TEST_CASE_NAME( &regionTest, "Region struct" ) );
+            ts->add( BOOST_TEST_CASE_NAME( &numaTest, "NUMA topology/queues" ) );
+            ts->add( BOOST_TEST_CASE_NAME( &executorTest, "Executor lanes/work-stealing" ) );
+            ts->add( BOOST_TEST_CASE_NAME( &poolTest, "MemoryPool size-classes/reuse" ) );
+            ts->add( BOOST_TEST_CASE_NAME( &loggerTest, "Logger ring-buffers/flushing" ) );
+            ts->add( BOOST_TEST_CASE_NAME( &cacheTest, "Cache LRU eviction" ) );
 
             add_array_tests( ts );
             add_data_tests( ts );